@@ -417,7 +417,10 @@ std::pair<double,double> benchmark_spmv(
     size_t nnz = row.back();
 
     // Transfer data to compute devices.
+    prof.tic_cpu("Construction");
     vex::SpMat<real,uint> A(ctx, n * n * n, n * n * n, row.data(), col.data(), val.data());
+    ctx.finish();
+    double construction_time = prof.toc("Construction");
 
     vex::vector<real> x(ctx, X);
     vex::vector<real> y(ctx, Y);
@@ -440,6 +443,7 @@ std::pair<double,double> benchmark_spmv(
         << "  OpenCL"
         << "\n    GFLOPS:    " << gflops
         << "\n    Bandwidth: " << bwidth
+        << "\n    Construction (Mnnz/s): " << nnz / construction_time / 1e6
         << std::endl;
 
     if (options.bm_cpu) {
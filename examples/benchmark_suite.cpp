@@ -0,0 +1,893 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <array>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <vexcl/devlist.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/multivector.hpp>
+#include <vexcl/reductor.hpp>
+#include <vexcl/random.hpp>
+#include <vexcl/element_index.hpp>
+#include <vexcl/spmat.hpp>
+#include <vexcl/stencil.hpp>
+#include <vexcl/sort.hpp>
+#include <vexcl/scan.hpp>
+#include <vexcl/reduce_by_key.hpp>
+#include <vexcl/scan_by_key.hpp>
+#include <vexcl/fft.hpp>
+#include <vexcl/tensordot.hpp>
+#include <vexcl/gather.hpp>
+#include <vexcl/mba.hpp>
+#include <vexcl/profiler.hpp>
+
+#ifdef _MSC_VER
+#  pragma warning(disable : 4267)
+#endif
+
+// Structured benchmark of VexCL primitives.
+//
+// Every case is run for each of the requested sizes and value types. A case
+// is warmed up first, so that kernel compilation and allocation of temporary
+// buffers are not measured, and then timed the requested number of times,
+// with the queues finished before and after each run. The median, mean,
+// standard deviation, and extremes of the run times are reported in JSON or
+// CSV. A report may be stored and later passed as a baseline, in which case
+// the cases that got slower, and the selected baseline cases that failed or
+// were not run, are listed on stderr. The program exits with status 2 when
+// any case failed, regressed, or is missing from the run.
+
+//---------------------------------------------------------------------------
+struct Options {
+    std::vector<std::string> cases;
+    std::vector<std::string> types;
+    std::vector<size_t>      sizes;
+
+    size_t warmup;
+    size_t repeat;
+
+    std::string format;
+    std::string output;
+    std::string baseline;
+    double      threshold;
+} options;
+
+//---------------------------------------------------------------------------
+// A benchmark case: the work done by a single run, and the run itself.
+struct bench {
+    double bytes;  // Bytes moved to or from device memory, zero if unknown.
+    double flops;  // Floating point operations, zero if unknown.
+    double items;  // Elements processed.
+
+    std::function<void()> run;
+};
+
+// Statistics of the run times of a case.
+struct result {
+    std::string name;
+    std::string type;
+    size_t      size;
+
+    double bytes, flops, items;
+
+    size_t repeat;
+    double median, mean, stddev, min, max;
+};
+
+//---------------------------------------------------------------------------
+template <typename T>
+std::vector<T> random_vector(size_t n) {
+    std::default_random_engine rng( std::rand() );
+    std::uniform_real_distribution<double> rnd(0.0, 1.0);
+
+    std::vector<T> x(n);
+    for(size_t i = 0; i < n; ++i) x[i] = static_cast<T>(rnd(rng));
+
+    return x;
+}
+
+// Sorted keys with segments of random length (16 elements on average).
+std::vector<int> random_keys(size_t n) {
+    std::default_random_engine rng( std::rand() );
+    std::uniform_int_distribution<int> rnd(0, 15);
+
+    std::vector<int> k(n);
+    int key = 0;
+    for(size_t i = 0; i < n; ++i) {
+        if (rnd(rng) == 0) ++key;
+        k[i] = key;
+    }
+
+    return k;
+}
+
+// All cases that are restricted to a single device use the first one.
+std::vector<vex::backend::command_queue> first_queue(const vex::Context &ctx) {
+    return std::vector<vex::backend::command_queue>(1, ctx.queue(0));
+}
+
+//---------------------------------------------------------------------------
+// Cases. Each one sets up the problem of (about) the given size and returns
+// the closure that runs it. Vectors are held by shared pointers, so that they
+// outlive the setup.
+//---------------------------------------------------------------------------
+template <typename real>
+bench saxpy(const vex::Context &ctx, size_t n) {
+    auto a = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto b = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    real alpha = static_cast<real>(0.5);
+
+    bench b_ = { 3.0 * n * sizeof(real), 2.0 * n, 1.0 * n,
+        [a, b, alpha]() { *a = alpha * (*a) + (*b); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench vector_arithmetics(const vex::Context &ctx, size_t n) {
+    auto a = std::make_shared< vex::vector<real> >(ctx, n);
+    auto b = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto c = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto d = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+
+    *a = 0;
+
+    bench b_ = { 5.0 * n * sizeof(real), 3.0 * n, 1.0 * n,
+        [a, b, c, d]() { *a += (*b) + (*c) * (*d); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench reductor(const vex::Context &ctx, size_t n) {
+    auto a = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto b = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto s = std::make_shared< vex::Reductor<real, vex::SUM> >(ctx);
+
+    bench b_ = { 2.0 * n * sizeof(real), 2.0 * n, 1.0 * n,
+        [a, b, s]() { (*s)((*a) * (*b)); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench stencil(const vex::Context &ctx, size_t n) {
+    std::vector<real> S(21, static_cast<real>(1) / 21);
+
+    auto s = std::make_shared< vex::stencil<real> >(ctx, S, S.size() / 2);
+    auto a = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto b = std::make_shared< vex::vector<real> >(ctx, n);
+
+    bench b_ = { 2.0 * n * sizeof(real), 2.0 * S.size() * n, 1.0 * n,
+        [a, b, s]() { *b = (*a) * (*s); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// Poisson problem on a cubic grid with about n points. Returns the number of
+// points.
+template <typename real>
+size_t poisson(size_t n, std::vector<size_t> &row, std::vector<size_t> &col,
+        std::vector<real> &val)
+{
+    const size_t m = std::max<size_t>(3, std::lround(std::cbrt(static_cast<double>(n))));
+    const size_t N = m * m * m;
+
+    row.clear();
+    col.clear();
+    val.clear();
+
+    row.reserve(N + 1);
+    col.reserve(7 * N);
+    val.reserve(7 * N);
+
+    row.push_back(0);
+    for(size_t k = 0, idx = 0; k < m; ++k) {
+        for(size_t j = 0; j < m; ++j) {
+            for(size_t i = 0; i < m; ++i, ++idx) {
+                if (i == 0 || i + 1 == m || j == 0 || j + 1 == m || k == 0 || k + 1 == m) {
+                    col.push_back(idx);
+                    val.push_back(1);
+                } else {
+                    col.push_back(idx - m * m); val.push_back(-1);
+                    col.push_back(idx - m);     val.push_back(-1);
+                    col.push_back(idx - 1);     val.push_back(-1);
+                    col.push_back(idx);         val.push_back( 6);
+                    col.push_back(idx + 1);     val.push_back(-1);
+                    col.push_back(idx + m);     val.push_back(-1);
+                    col.push_back(idx + m * m); val.push_back(-1);
+                }
+                row.push_back(col.size());
+            }
+        }
+    }
+
+    return N;
+}
+
+template <typename real>
+bench spmv(const vex::Context &ctx, size_t n) {
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<real>   val;
+
+    const size_t N   = poisson(n, row, col, val);
+    const size_t nnz = col.size();
+
+    auto A = std::make_shared< vex::SpMat<real, size_t> >(
+            ctx, N, N, row.data(), col.data(), val.data());
+    auto x = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(N));
+    auto y = std::make_shared< vex::vector<real> >(ctx, N);
+
+    // Column numbers are stored in the narrowest type that fits, so their
+    // size is taken from the matrix.
+    bench b_ = {
+        1.0 * nnz * sizeof(real) + 1.0 * A->column_bytes() + 3.0 * N * sizeof(real),
+        2.0 * nnz, 1.0 * N,
+        [A, x, y]() { *y = (*A) * (*x); } };
+    return b_;
+}
+
+// Construction of the matrix from the host CSR arrays. Items are nonzeros, so
+// the throughput is reported in millions of nonzeros per second.
+template <typename real>
+bench spmat_construction(const vex::Context &ctx, size_t n) {
+    auto row = std::make_shared< std::vector<size_t> >();
+    auto col = std::make_shared< std::vector<size_t> >();
+    auto val = std::make_shared< std::vector<real> >();
+
+    const size_t N   = poisson(n, *row, *col, *val);
+    const size_t nnz = col->size();
+
+    bench b_ = {
+        0.0, 0.0, 1.0 * nnz,
+        [&ctx, N, row, col, val]() {
+            vex::SpMat<real, size_t> A(ctx, N, N, row->data(), col->data(), val->data());
+        } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench rng(const vex::Context &ctx, size_t n) {
+    auto x = std::make_shared< vex::vector<real> >(ctx, n);
+    auto seed = std::make_shared<cl_uint>(0);
+
+    bench b_ = { 1.0 * n * sizeof(real), 0, 1.0 * n,
+        [x, seed]() {
+            vex::Random<real> rnd;
+            *x = rnd(vex::element_index(), (*seed)++);
+        } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// Each run restores unsorted input with a device copy, which is included
+// into the measurement.
+template <typename real>
+bench sort(const vex::Context &ctx, size_t n) {
+    auto x0 = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto x  = std::make_shared< vex::vector<real> >(ctx, n);
+
+    bench b_ = { 0, 0, 1.0 * n,
+        [x0, x]() {
+            *x = *x0;
+            vex::sort(*x);
+        } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench scan(const vex::Context &ctx, size_t n) {
+    auto x = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto y = std::make_shared< vex::vector<real> >(ctx, n);
+
+    bench b_ = { 2.0 * n * sizeof(real), 1.0 * n, 1.0 * n,
+        [x, y]() { vex::exclusive_scan(*x, *y); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// Complex-to-complex transform of length n. The flop count is the usual
+// 5 n log2(n) estimate.
+template <typename real>
+bench fft(const vex::Context &ctx, size_t n) {
+    typedef typename vex::cl_vector_of<real, 2>::type complex;
+
+    std::vector<vex::backend::command_queue> q = first_queue(ctx);
+
+    auto a = std::make_shared< vex::vector<complex> >(q, n);
+    auto b = std::make_shared< vex::vector<complex> >(q, n);
+    auto f = std::make_shared< vex::FFT<complex> >(q, n);
+
+    std::vector<real>    r = random_vector<real>(2 * n);
+    std::vector<complex> h(n);
+    for(size_t i = 0; i < n; ++i) {
+        h[i].s[0] = r[2 * i];
+        h[i].s[1] = r[2 * i + 1];
+    }
+    vex::copy(h, *a);
+
+    bench b_ = { 2.0 * n * sizeof(complex), 5.0 * n * std::log2(static_cast<double>(n)), 1.0 * n,
+        [a, b, f]() { *b = (*f)(*a); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench reduce_by_key(const vex::Context &ctx, size_t n) {
+    std::vector<vex::backend::command_queue> q = first_queue(ctx);
+
+    auto ikeys = std::make_shared< vex::vector<int>  >(q, random_keys(n));
+    auto ivals = std::make_shared< vex::vector<real> >(q, random_vector<real>(n));
+    auto okeys = std::make_shared< vex::vector<int>  >(q, n);
+    auto ovals = std::make_shared< vex::vector<real> >(q, n);
+
+    bench b_ = { 1.0 * n * (sizeof(int) + sizeof(real)), 1.0 * n, 1.0 * n,
+        [ikeys, ivals, okeys, ovals]() {
+            vex::reduce_by_key(*ikeys, *ivals, *okeys, *ovals);
+        } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+template <typename real>
+bench scan_by_key(const vex::Context &ctx, size_t n) {
+    std::vector<vex::backend::command_queue> q = first_queue(ctx);
+
+    auto keys = std::make_shared< vex::vector<int>  >(q, random_keys(n));
+    auto ivals = std::make_shared< vex::vector<real> >(q, random_vector<real>(n));
+    auto ovals = std::make_shared< vex::vector<real> >(q, n);
+
+    bench b_ = { 1.0 * n * (sizeof(int) + 2 * sizeof(real)), 1.0 * n, 1.0 * n,
+        [keys, ivals, ovals]() {
+            vex::inclusive_scan_by_key(*keys, *ivals, *ovals);
+        } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// Dense matrix-vector product; the matrix has about n elements.
+template <typename real>
+bench tensordot(const vex::Context &ctx, size_t n) {
+    using vex::_;
+    using vex::extents;
+
+    std::vector<vex::backend::command_queue> q = first_queue(ctx);
+
+    const size_t N = std::max<size_t>(1, std::lround(std::sqrt(static_cast<double>(n))));
+
+    auto A = std::make_shared< vex::vector<real> >(q, random_vector<real>(N * N));
+    auto x = std::make_shared< vex::vector<real> >(q, random_vector<real>(N));
+    auto y = std::make_shared< vex::vector<real> >(q, N);
+
+    vex::slicer<2> mat(extents[N][N]);
+    vex::slicer<1> vec(extents[N]);
+
+    bench b_ = { (1.0 * N * N + 2.0 * N) * sizeof(real), 2.0 * N * N, 1.0 * N * N,
+        [A, x, y, mat, vec]() mutable {
+            *y = vex::tensordot(mat[_](*A), vec[_](*x), vex::axes_pairs(1, 0));
+        } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// Gathers every 16th element (on average) of a device vector to the host.
+template <typename real>
+bench gather(const vex::Context &ctx, size_t n) {
+    std::default_random_engine rnd( std::rand() );
+    std::uniform_int_distribution<size_t> pick(0, 15);
+
+    std::vector<size_t> idx;
+    for(size_t i = 0; i + 16 <= n; i += 16) idx.push_back(i + pick(rnd));
+    if (idx.empty()) idx.push_back(0);
+
+    const size_t m = idx.size();
+
+    auto x = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto g = std::make_shared< vex::gather<real> >(ctx, n, idx);
+    auto h = std::make_shared< std::vector<real> >(m);
+
+    bench b_ = { 1.0 * m * (2 * sizeof(real) + sizeof(size_t)), 0, 1.0 * m,
+        [x, g, h]() { (*g)(*x, *h); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// Interpolation at n points with a surface fitted to 1024 scattered points.
+template <typename real>
+bench mba(const vex::Context &ctx, size_t n) {
+    typedef vex::mba<2, real> surface;
+    typedef typename surface::point point;
+
+    std::vector<real> c = random_vector<real>(2 * 1024);
+    std::vector<point> p(1024);
+    std::vector<real>  v(1024);
+    for(size_t i = 0; i < p.size(); ++i) {
+        p[i][0] = c[2 * i];
+        p[i][1] = c[2 * i + 1];
+        v[i] = (p[i][0] - 0.5f) * (p[i][0] - 0.5f) + (p[i][1] - 0.5f) * (p[i][1] - 0.5f);
+    }
+
+    point lo = {{ static_cast<real>(-0.01), static_cast<real>(-0.01) }};
+    point hi = {{ static_cast<real>( 1.01), static_cast<real>( 1.01) }};
+    std::array<size_t, 2> grid = {{ 2, 2 }};
+
+    auto s = std::make_shared<surface>(ctx, lo, hi, p, v, grid);
+    auto x = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto y = std::make_shared< vex::vector<real> >(ctx, random_vector<real>(n));
+    auto z = std::make_shared< vex::vector<real> >(ctx, n);
+
+    bench b_ = { 3.0 * n * sizeof(real), 0, 1.0 * n,
+        [s, x, y, z]() { *z = (*s)(*x, *y); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+// SAXPY over a four-component multivector.
+template <typename real>
+bench multivector(const vex::Context &ctx, size_t n) {
+    auto x = std::make_shared< vex::multivector<real, 4> >(ctx, n);
+    auto y = std::make_shared< vex::multivector<real, 4> >(ctx, n);
+
+    vex::Random<real> rnd;
+    for(unsigned i = 0; i < 4; ++i) {
+        (*x)(i) = rnd(vex::element_index(), 2 * i);
+        (*y)(i) = rnd(vex::element_index(), 2 * i + 1);
+    }
+
+    real alpha = static_cast<real>(0.5);
+
+    bench b_ = { 12.0 * n * sizeof(real), 8.0 * n, 4.0 * n,
+        [x, y, alpha]() { *x = alpha * (*x) + (*y); } };
+    return b_;
+}
+
+//---------------------------------------------------------------------------
+typedef std::function<bench(const vex::Context&, size_t)> bench_factory;
+
+template <typename real>
+std::vector< std::pair<std::string, bench_factory> > all_cases() {
+    std::vector< std::pair<std::string, bench_factory> > c;
+
+    c.push_back(std::make_pair("saxpy",         bench_factory(saxpy<real>)));
+    c.push_back(std::make_pair("vector",        bench_factory(vector_arithmetics<real>)));
+    c.push_back(std::make_pair("reductor",      bench_factory(reductor<real>)));
+    c.push_back(std::make_pair("stencil",       bench_factory(stencil<real>)));
+    c.push_back(std::make_pair("spmv",          bench_factory(spmv<real>)));
+    c.push_back(std::make_pair("spmat_construction", bench_factory(spmat_construction<real>)));
+    c.push_back(std::make_pair("rng",           bench_factory(rng<real>)));
+    c.push_back(std::make_pair("sort",          bench_factory(sort<real>)));
+    c.push_back(std::make_pair("scan",          bench_factory(scan<real>)));
+    c.push_back(std::make_pair("fft",           bench_factory(fft<real>)));
+    c.push_back(std::make_pair("reduce_by_key", bench_factory(reduce_by_key<real>)));
+    c.push_back(std::make_pair("scan_by_key",   bench_factory(scan_by_key<real>)));
+    c.push_back(std::make_pair("tensordot",     bench_factory(tensordot<real>)));
+    c.push_back(std::make_pair("gather",        bench_factory(gather<real>)));
+    c.push_back(std::make_pair("mba",           bench_factory(mba<real>)));
+    c.push_back(std::make_pair("multivector",   bench_factory(multivector<real>)));
+
+    return c;
+}
+
+bool selected(const std::vector<std::string> &list, const std::string &name) {
+    return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+}
+
+std::string result_key(const std::string &name, const std::string &type, size_t size) {
+    std::ostringstream s;
+    s << name << "/" << type << "/" << size;
+    return s.str();
+}
+
+//---------------------------------------------------------------------------
+result measure(const vex::Context &ctx, const std::string &name,
+        const std::string &type, size_t size, const bench &b)
+{
+    for(size_t i = 0; i < options.warmup; ++i) b.run();
+    ctx.finish();
+
+    std::vector<double> t(options.repeat);
+    for(size_t i = 0; i < options.repeat; ++i) {
+        vex::stopwatch<> w;
+        b.run();
+        ctx.finish();
+        t[i] = w.toc();
+    }
+
+    result r;
+    r.name   = name;
+    r.type   = type;
+    r.size   = size;
+    r.bytes  = b.bytes;
+    r.flops  = b.flops;
+    r.items  = b.items;
+    r.repeat = t.size();
+
+    std::sort(t.begin(), t.end());
+
+    const size_t m = t.size();
+    r.median = (m % 2) ? t[m / 2] : 0.5 * (t[m / 2 - 1] + t[m / 2]);
+    r.min    = t.front();
+    r.max    = t.back();
+    r.mean   = std::accumulate(t.begin(), t.end(), 0.0) / m;
+
+    double s = 0;
+    for(size_t i = 0; i < m; ++i) s += (t[i] - r.mean) * (t[i] - r.mean);
+    r.stddev = m > 1 ? std::sqrt(s / (m - 1)) : 0.0;
+
+    return r;
+}
+
+template <typename real>
+void run_cases(const vex::Context &ctx, const std::string &type,
+        std::vector<result> &results, std::vector<std::string> &failed)
+{
+    auto cases = all_cases<real>();
+
+    for(auto n = options.sizes.begin(); n != options.sizes.end(); ++n) {
+        for(auto c = cases.begin(); c != cases.end(); ++c) {
+            if (!selected(options.cases, c->first)) continue;
+
+            std::cerr << c->first << " (" << type << ", " << *n << ")" << std::flush;
+            try {
+                result r = measure(ctx, c->first, type, *n, c->second(ctx, *n));
+                std::cerr << ": " << r.median << " s" << std::endl;
+                results.push_back(r);
+            } catch (const std::exception &e) {
+                std::cerr << ": FAILED (" << e.what() << ")" << std::endl;
+                failed.push_back(result_key(c->first, type, *n));
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Output.
+//---------------------------------------------------------------------------
+std::string json_escape(const std::string &s) {
+    std::string r;
+    for(auto c = s.begin(); c != s.end(); ++c) {
+        switch (*c) {
+            case '"':  r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '\n': r += "\\n";  break;
+            default:   r += *c;
+        }
+    }
+    return r;
+}
+
+double per_second(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0.0;
+}
+
+void write_json(std::ostream &os, const std::vector<std::string> &devices,
+        const std::vector<result> &results)
+{
+    os << "{\n  \"devices\": [";
+    for(size_t i = 0; i < devices.size(); ++i)
+        os << (i ? ", " : "") << "\"" << json_escape(devices[i]) << "\"";
+    os << "],\n  \"results\": [";
+
+    for(size_t i = 0; i < results.size(); ++i) {
+        const result &r = results[i];
+        os << (i ? "," : "") << "\n    {"
+           << "\"case\": \"" << r.name << "\", "
+           << "\"type\": \"" << r.type << "\", "
+           << "\"size\": " << r.size << ", "
+           << "\"repeat\": " << r.repeat << ", "
+           << "\"median\": " << r.median << ", "
+           << "\"mean\": " << r.mean << ", "
+           << "\"stddev\": " << r.stddev << ", "
+           << "\"min\": " << r.min << ", "
+           << "\"max\": " << r.max << ", "
+           << "\"gbps\": " << per_second(r.bytes, r.median) / 1e9 << ", "
+           << "\"gflops\": " << per_second(r.flops, r.median) / 1e9 << ", "
+           << "\"mitems\": " << per_second(r.items, r.median) / 1e6
+           << "}";
+    }
+
+    os << "\n  ]\n}\n";
+}
+
+void write_csv(std::ostream &os, const std::vector<result> &results) {
+    os << "case,type,size,repeat,median,mean,stddev,min,max,gbps,gflops,mitems\n";
+
+    for(auto r = results.begin(); r != results.end(); ++r) {
+        os << r->name << "," << r->type << "," << r->size << "," << r->repeat << ","
+           << r->median << "," << r->mean << "," << r->stddev << ","
+           << r->min << "," << r->max << ","
+           << per_second(r->bytes, r->median) / 1e9 << ","
+           << per_second(r->flops, r->median) / 1e9 << ","
+           << per_second(r->items, r->median) / 1e6 << "\n";
+    }
+}
+
+//---------------------------------------------------------------------------
+// Comparison with a baseline.
+//---------------------------------------------------------------------------
+struct base_time {
+    double median, stddev;
+
+    std::string name, type;
+    size_t size;
+};
+
+// Reads a report written by this program in either format.
+std::map<std::string, base_time> read_baseline(const std::string &fname) {
+    std::ifstream f(fname);
+    if (!f) throw std::runtime_error("can not open baseline " + fname);
+
+    std::map<std::string, base_time> base;
+
+    f >> std::ws;
+    const char first = static_cast<char>(f.peek());
+
+    if (first == '{') {
+        boost::property_tree::ptree pt;
+        boost::property_tree::read_json(f, pt);
+
+        for(auto &r : pt.get_child("results")) {
+            base_time b = {
+                r.second.get<double>("median"),
+                r.second.get<double>("stddev"),
+                r.second.get<std::string>("case"),
+                r.second.get<std::string>("type"),
+                r.second.get<size_t>("size")
+            };
+            base[result_key(b.name, b.type, b.size)] = b;
+        }
+    } else {
+        std::string line;
+        std::getline(f, line);
+
+        std::vector<std::string> head;
+        {
+            std::istringstream s(line);
+            for(std::string c; std::getline(s, c, ','); ) head.push_back(c);
+        }
+
+        auto column = [&head](const std::string &name) -> size_t {
+            size_t i = std::find(head.begin(), head.end(), name) - head.begin();
+            if (i == head.size()) throw std::runtime_error("baseline has no column " + name);
+            return i;
+        };
+
+        const size_t c_case = column("case");
+        const size_t c_type = column("type");
+        const size_t c_size = column("size");
+        const size_t c_med  = column("median");
+        const size_t c_dev  = column("stddev");
+
+        while(std::getline(f, line)) {
+            if (line.empty()) continue;
+
+            std::vector<std::string> v;
+            std::istringstream s(line);
+            for(std::string c; std::getline(s, c, ','); ) v.push_back(c);
+            if (v.size() < head.size()) continue;
+
+            base_time b = {
+                std::stod(v[c_med]), std::stod(v[c_dev]),
+                v[c_case], v[c_type], std::stoul(v[c_size])
+            };
+            base[result_key(b.name, b.type, b.size)] = b;
+        }
+    }
+
+    return base;
+}
+
+// A case regressed when its median is slower than the baseline by more than
+// the threshold, and the difference is not within the run-to-run noise.
+// Baseline cases that were selected for this run but have no result (because
+// they failed or could not be run on the current devices) are counted as
+// missing. Returns the number of regressed and missing cases.
+int compare(const std::map<std::string, base_time> &base,
+        const std::vector<result> &results)
+{
+    int regressions = 0;
+    int missing     = 0;
+
+    std::cerr << "\nComparison with " << options.baseline
+              << " (threshold " << 100 * options.threshold << "%):\n";
+
+    for(auto r = results.begin(); r != results.end(); ++r) {
+        std::string key = result_key(r->name, r->type, r->size);
+        auto b = base.find(key);
+
+        std::cerr << "  " << key << ": ";
+
+        if (b == base.end()) {
+            std::cerr << "no baseline" << std::endl;
+            continue;
+        }
+
+        double ratio = b->second.median > 0 ? r->median / b->second.median : 1.0;
+        double noise = 2 * std::max(r->stddev, b->second.stddev);
+
+        std::cerr << b->second.median << " -> " << r->median
+                  << " s (" << ratio << "x)";
+
+        if (ratio > 1 + options.threshold && r->median - b->second.median > noise) {
+            std::cerr << "  REGRESSION";
+            ++regressions;
+        } else if (ratio < 1 - options.threshold && b->second.median - r->median > noise) {
+            std::cerr << "  improvement";
+        }
+
+        std::cerr << std::endl;
+    }
+
+    std::set<std::string> done;
+    for(auto r = results.begin(); r != results.end(); ++r)
+        done.insert(result_key(r->name, r->type, r->size));
+
+    for(auto b = base.begin(); b != base.end(); ++b) {
+        if (done.count(b->first)) continue;
+
+        if (!selected(options.cases, b->second.name)) continue;
+        if (!selected(options.types, b->second.type)) continue;
+        if (std::find(options.sizes.begin(), options.sizes.end(), b->second.size) == options.sizes.end())
+            continue;
+
+        std::cerr << "  " << b->first << ": " << b->second.median
+                  << " -> MISSING (failed or not run)" << std::endl;
+        ++missing;
+    }
+
+    std::cerr << regressions << " regression(s), " << missing << " missing" << std::endl;
+
+    return regressions + missing;
+}
+
+//---------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+    namespace po = boost::program_options;
+    po::options_description desc("Options");
+
+    desc.add_options()
+        ("help,h", "show help")
+        ("list,l", "list benchmark cases")
+        ("case,c",
+            po::value< std::vector<std::string> >(&options.cases)->multitoken(),
+            "cases to run (all by default)"
+            )
+        ("type,t",
+            po::value< std::vector<std::string> >(&options.types)->multitoken()
+                ->default_value(std::vector<std::string>{"float", "double"}, "float double"),
+            "value types (float, double); double is skipped on devices without "
+            "double precision support"
+            )
+        ("size,n",
+            po::value< std::vector<size_t> >(&options.sizes)->multitoken()
+                ->default_value(std::vector<size_t>{1 << 16, 1 << 20, 1 << 22}, "65536 1048576 4194304"),
+            "problem sizes"
+            )
+        ("warmup,w",
+            po::value<size_t>(&options.warmup)->default_value(3),
+            "untimed runs before measurement"
+            )
+        ("repeat,r",
+            po::value<size_t>(&options.repeat)->default_value(15),
+            "timed runs"
+            )
+        ("format,f",
+            po::value<std::string>(&options.format)->default_value("json"),
+            "output format (json, csv)"
+            )
+        ("output,o",
+            po::value<std::string>(&options.output),
+            "output file (stdout by default)"
+            )
+        ("baseline,b",
+            po::value<std::string>(&options.baseline),
+            "report of a previous run (json or csv) to compare with"
+            )
+        ("threshold",
+            po::value<double>(&options.threshold)->default_value(0.1),
+            "relative slowdown that is reported as a regression"
+            )
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    if (vm.count("list")) {
+        auto cases = all_cases<float>();
+        for(auto c = cases.begin(); c != cases.end(); ++c)
+            std::cout << c->first << std::endl;
+        return 0;
+    }
+
+    if (options.format != "json" && options.format != "csv") {
+        std::cerr << "Unknown format: " << options.format << std::endl;
+        return 1;
+    }
+
+    if (options.repeat == 0) options.repeat = 1;
+
+    try {
+        std::vector<result>      results;
+        std::vector<std::string> failed;
+        std::vector<std::string> devices;
+
+        {
+            vex::Context ctx(vex::Filter::Env);
+            if (!ctx) {
+                std::cerr << "No compute devices found" << std::endl;
+                return 1;
+            }
+            std::cerr << ctx << std::endl;
+
+            for(unsigned d = 0; d < ctx.size(); ++d) {
+                std::ostringstream s;
+                s << ctx.queue(d);
+                devices.push_back(s.str());
+            }
+
+            if (selected(options.types, "float"))
+                run_cases<float>(ctx, "float", results, failed);
+        }
+
+        if (selected(options.types, "double")) {
+            vex::Context ctx(vex::Filter::Env && vex::Filter::DoublePrecision);
+            if (ctx)
+                run_cases<double>(ctx, "double", results, failed);
+            else
+                std::cerr << "double: skipped (no double precision support)" << std::endl;
+        }
+
+        std::ofstream f;
+        if (!options.output.empty()) f.open(options.output);
+        std::ostream &os = options.output.empty() ? std::cout : f;
+
+        os.precision(6);
+        if (options.format == "json")
+            write_json(os, devices, results);
+        else
+            write_csv(os, results);
+
+        int status = 0;
+
+        if (!options.baseline.empty() && compare(read_baseline(options.baseline), results))
+            status = 2;
+
+        if (!failed.empty()) {
+            std::cerr << failed.size() << " case(s) failed:";
+            for(auto k = failed.begin(); k != failed.end(); ++k)
+                std::cerr << " " << *k;
+            std::cerr << std::endl;
+            status = 2;
+        }
+
+        return status;
+    } catch (const vex::error &e) {
+        std::cerr << e << std::endl;
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// vim: et
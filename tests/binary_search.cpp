@@ -0,0 +1,95 @@
+#define BOOST_TEST_MODULE BinarySearch
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/sort.hpp>
+#include <vexcl/binary_search.hpp>
+#include "context_setup.hpp"
+
+BOOST_AUTO_TEST_CASE(lower_upper_bound)
+{
+    const size_t n = 1000;
+    const size_t m = 1000 * 1000;
+
+    std::vector<int> s = random_vector<int>(n);
+    std::sort(s.begin(), s.end());
+
+    std::vector<int> q = random_vector<int>(m);
+
+    vex::vector<int> S(ctx, s);
+    vex::vector<int> Q(ctx, q);
+    vex::vector<size_t> L(ctx, m);
+    vex::vector<size_t> U(ctx, m);
+
+    vex::lower_bound(S, Q, L);
+    vex::upper_bound(S, Q, U);
+
+    check_sample(L, [&](size_t idx, size_t v) {
+            BOOST_CHECK_EQUAL(v, static_cast<size_t>(
+                    std::lower_bound(s.begin(), s.end(), q[idx]) - s.begin()));
+            });
+
+    check_sample(U, [&](size_t idx, size_t v) {
+            BOOST_CHECK_EQUAL(v, static_cast<size_t>(
+                    std::upper_bound(s.begin(), s.end(), q[idx]) - s.begin()));
+            });
+}
+
+BOOST_AUTO_TEST_CASE(search_in_expression)
+{
+    const size_t n = 128;
+    const size_t m = 1000 * 1000;
+
+    std::vector<double> s = random_vector<double>(n);
+    std::sort(s.begin(), s.end());
+
+    std::vector<double> q = random_vector<double>(m);
+
+    vex::vector<double> S(ctx, s);
+    vex::vector<double> Q(ctx, q);
+    vex::vector<size_t> B(ctx, m);
+
+    // Number of sorted elements between q and 2q:
+    B = vex::lower_bound(S, 2 * Q) - vex::lower_bound(S, Q);
+
+    check_sample(B, [&](size_t idx, size_t v) {
+            BOOST_CHECK_EQUAL(v, static_cast<size_t>(
+                    std::lower_bound(s.begin(), s.end(), 2 * q[idx]) -
+                    std::lower_bound(s.begin(), s.end(), q[idx])));
+            });
+}
+
+BOOST_AUTO_TEST_CASE(multidevice_sorted_vector)
+{
+    // The same device is used three times, so that the sorted vector is
+    // gathered from its partitions.
+    std::vector<vex::command_queue> queue(3, ctx.queue(0));
+
+    const size_t n = 100;
+    const size_t m = 1024;
+
+    std::vector<int> s = random_vector<int>(n);
+    std::sort(s.begin(), s.end());
+
+    std::vector<int> q = random_vector<int>(m);
+
+    vex::vector<int> S(queue, s);
+    vex::vector<int> Q(queue, q);
+    vex::vector<size_t> L(queue, m);
+
+    // The gathered copies are reused by the second search, and should
+    // see the updated sorted vector.
+    for(int k = 0; k < 2; ++k) {
+        vex::lower_bound(S, Q, L);
+
+        check_sample(L, [&](size_t idx, size_t v) {
+                BOOST_CHECK_EQUAL(v, static_cast<size_t>(
+                        std::lower_bound(s.begin(), s.end(), q[idx]) - s.begin()));
+                });
+
+        for(auto &v : s) v *= 2;
+        vex::copy(s, S);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
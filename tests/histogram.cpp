@@ -0,0 +1,96 @@
+#define BOOST_TEST_MODULE Histogram
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/element_index.hpp>
+#include <vexcl/histogram.hpp>
+#include "context_setup.hpp"
+
+BOOST_AUTO_TEST_CASE(histogram)
+{
+    const size_t n = 1000 * 1000;
+    const size_t nbins = 64;
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(ctx, x);
+
+    std::vector<size_t> h = vex::histogram(2 * X - 0.5, nbins, 0.0, 1.0);
+
+    std::vector<size_t> href(nbins, 0);
+    for(size_t i = 0; i < n; ++i) {
+        double v = 2 * x[i] - 0.5;
+        if (v < 0 || v > 1) continue;
+        href[std::min<size_t>(static_cast<size_t>(v * nbins), nbins - 1)]++;
+    }
+
+    BOOST_REQUIRE_EQUAL(h.size(), nbins);
+    for(size_t i = 0; i < nbins; ++i)
+        BOOST_CHECK_EQUAL(h[i], href[i]);
+}
+
+BOOST_AUTO_TEST_CASE(bincount)
+{
+    const size_t n = 1000 * 1000;
+    const size_t nbins = 50;
+
+    std::vector<int> x = random_vector<int>(n);
+    vex::vector<int> X(ctx, x);
+
+    std::vector<size_t> h = vex::bincount(X, nbins);
+
+    std::vector<size_t> href(nbins, 0);
+    for(size_t i = 0; i < n; ++i)
+        if (x[i] < static_cast<int>(nbins)) href[x[i]]++;
+
+    for(size_t i = 0; i < nbins; ++i)
+        BOOST_CHECK_EQUAL(h[i], href[i]);
+}
+
+BOOST_AUTO_TEST_CASE(bincount_global)
+{
+    // Too many bins to keep in local memory.
+    const size_t n = 1000 * 1000;
+    const size_t nbins = 1 << 20;
+
+    std::vector<int> x(n);
+    for(size_t i = 0; i < n; ++i) x[i] = (i * 7919) % nbins;
+
+    vex::vector<int> X(ctx, x);
+
+    std::vector<size_t> h = vex::bincount(X, nbins);
+
+    std::vector<size_t> href(nbins, 0);
+    for(size_t i = 0; i < n; ++i) href[x[i]]++;
+
+    BOOST_CHECK(h == href);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_chunks)
+{
+    // Device parts longer than 2^32-1 elements are counted in chunks. Use
+    // small chunks to check the splitting.
+    const size_t n = 1000 * 1000;
+    const size_t nbins = 50;
+    const size_t chunk = 4999;
+
+    std::vector<int> x = random_vector<int>(n);
+    vex::vector<int> X(ctx, x);
+
+    std::vector<size_t> h = vex::detail::hist::histogram<false>(X, nbins, 0, 0, chunk);
+
+    std::vector<size_t> href(nbins, 0);
+    for(size_t i = 0; i < n; ++i)
+        if (x[i] < static_cast<int>(nbins)) href[x[i]]++;
+
+    BOOST_CHECK(h == href);
+
+    // Element indices should continue across the chunks.
+    h = vex::detail::hist::histogram<false>(
+            (X + vex::element_index()) % nbins, nbins, 0, 0, chunk);
+
+    std::fill(href.begin(), href.end(), 0);
+    for(size_t i = 0; i < n; ++i) href[(x[i] + i) % nbins]++;
+
+    BOOST_CHECK(h == href);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
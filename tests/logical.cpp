@@ -25,4 +25,44 @@ BOOST_AUTO_TEST_CASE(logical)
     BOOST_CHECK(!all_of(x > N/2)     );
 }
 
+BOOST_AUTO_TEST_CASE(early_exit)
+{
+    const size_t N = 1 << 20;
+
+    vex::vector<int> x(ctx, N);
+    x = vex::element_index();
+
+    vex::any_of any_of(ctx);
+    vex::all_of all_of(ctx);
+
+    // Match near the start, near the end, and at the partition boundaries.
+    BOOST_CHECK( any_of(x == 1)     );
+    BOOST_CHECK( any_of(x == N - 1) );
+    BOOST_CHECK(!any_of(x == N)     );
+
+    for(unsigned d = 0; d < ctx.size(); ++d)
+        BOOST_CHECK( any_of(x == static_cast<int>(x.part_start(d))) );
+
+    BOOST_CHECK( all_of(x >= 0)     );
+    BOOST_CHECK(!all_of(x != N / 3) );
+
+    // Repeated calls reset the flag.
+    BOOST_CHECK( any_of(x == 42)    );
+    BOOST_CHECK(!any_of(x < 0)      );
+}
+
+BOOST_AUTO_TEST_CASE(count_if)
+{
+    const size_t N = 1024;
+
+    vex::vector<int> x(ctx, N);
+    x = vex::element_index();
+
+    vex::count_if count_if(ctx);
+
+    BOOST_CHECK_EQUAL(count_if(x),          N - 1);
+    BOOST_CHECK_EQUAL(count_if(x % 3 == 0), (N + 2) / 3);
+    BOOST_CHECK_EQUAL(count_if(x < 0),      0u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
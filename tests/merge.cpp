@@ -0,0 +1,211 @@
+#define BOOST_TEST_MODULE Merge
+#include <algorithm>
+#include <iterator>
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/merge.hpp>
+#include "context_setup.hpp"
+
+template <typename T>
+std::vector<T> sorted_random_vector(size_t n) {
+    std::vector<T> x = random_vector<T>(n);
+    std::sort(x.begin(), x.end());
+    return x;
+}
+
+template <typename T>
+std::vector<T> head(const vex::vector<T> &x, size_t n) {
+    std::vector<T> y(n);
+    if (n) x.read_data(0, n, y.data(), true);
+    return y;
+}
+
+BOOST_AUTO_TEST_CASE(merge)
+{
+    const size_t n = 1000 * 1000;
+    const size_t m = 300 * 1000;
+
+    std::vector<double> a = sorted_random_vector<double>(n);
+    std::vector<double> b = sorted_random_vector<double>(m);
+
+    std::vector<double> c;
+    std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+    // Single device (merged on the device):
+    {
+        std::vector<vex::backend::command_queue> q(1, ctx.queue(0));
+
+        vex::vector<double> A(q, a);
+        vex::vector<double> B(q, b);
+        vex::vector<double> C(q, n + m);
+
+        vex::merge(A, B, C);
+
+        check_sample(C, [&](size_t idx, double v) { BOOST_CHECK_EQUAL(v, c[idx]); });
+    }
+
+    // All devices:
+    {
+        vex::vector<double> A(ctx, a);
+        vex::vector<double> B(ctx, b);
+        vex::vector<double> C(ctx, n + m);
+
+        vex::merge(A, B, C);
+
+        check_sample(C, [&](size_t idx, double v) { BOOST_CHECK_EQUAL(v, c[idx]); });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merge_by_key)
+{
+    const size_t n = 100 * 1000;
+    const size_t m = 200 * 1000;
+
+    std::vector<vex::backend::command_queue> q(1, ctx.queue(0));
+
+    std::vector<int> a = sorted_random_vector<int>(n);
+    std::vector<int> b = sorted_random_vector<int>(m);
+
+    vex::vector<int>    AK(q, a), BK(q, b), K(q, n + m);
+    vex::vector<double> AV(q, n), BV(q, m), V(q, n + m);
+
+    AV = 1;
+    BV = 2;
+
+    vex::merge_by_key(AK, AV, BK, BV, K, V);
+
+    std::vector<int> k;
+    std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(k));
+
+    BOOST_CHECK(head(K, n + m) == k);
+
+    // Equal keys from the first sequence come first.
+    std::vector<int>    hk = head(K, n + m);
+    std::vector<double> hv = head(V, n + m);
+    for(size_t i = 1; i < n + m; ++i)
+        if (hk[i] == hk[i - 1]) BOOST_CHECK(hv[i] >= hv[i - 1]);
+}
+
+BOOST_AUTO_TEST_CASE(set_operations)
+{
+    const size_t n = 100 * 1000;
+    const size_t m = 50 * 1000;
+
+    // Lots of duplicates for multiset semantics.
+    std::vector<int> a = sorted_random_vector<int>(n);
+    std::vector<int> b = sorted_random_vector<int>(m);
+
+    vex::vector<int> A(ctx, a);
+    vex::vector<int> B(ctx, b);
+    vex::vector<int> C(ctx, n + m);
+
+    {
+        std::vector<int> c;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+        size_t size = vex::set_union(A, B, C);
+        BOOST_REQUIRE_EQUAL(size, c.size());
+        BOOST_CHECK(head(C, size) == c);
+    }
+
+    {
+        std::vector<int> c;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+        size_t size = vex::set_intersection(A, B, C);
+        BOOST_REQUIRE_EQUAL(size, c.size());
+        BOOST_CHECK(head(C, size) == c);
+    }
+
+    {
+        std::vector<int> c;
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+        size_t size = vex::set_difference(A, B, C);
+        BOOST_REQUIRE_EQUAL(size, c.size());
+        BOOST_CHECK(head(C, size) == c);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(set_operations_duplicates)
+{
+    // Equal runs of different lengths in both inputs.
+    const int ha[] = {1, 1, 1, 2, 3, 3, 5, 5};
+    const int hb[] = {0, 1, 2, 2, 3, 3, 3, 5, 6, 6};
+
+    std::vector<int> a(std::begin(ha), std::end(ha));
+    std::vector<int> b(std::begin(hb), std::end(hb));
+
+    vex::vector<int> A(ctx, a);
+    vex::vector<int> B(ctx, b);
+    vex::vector<int> C(ctx, a.size() + b.size());
+
+    {
+        std::vector<int> c;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+        size_t size = vex::set_union(A, B, C);
+        BOOST_REQUIRE_EQUAL(size, c.size());
+        BOOST_CHECK(head(C, size) == c);
+    }
+
+    {
+        std::vector<int> c;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+        size_t size = vex::set_intersection(A, B, C);
+        BOOST_REQUIRE_EQUAL(size, c.size());
+        BOOST_CHECK(head(C, size) == c);
+    }
+
+    {
+        std::vector<int> c;
+        std::set_difference(b.begin(), b.end(), a.begin(), a.end(), std::back_inserter(c));
+
+        size_t size = vex::set_difference(B, A, C);
+        BOOST_REQUIRE_EQUAL(size, c.size());
+        BOOST_CHECK(head(C, size) == c);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(set_operations_by_key)
+{
+    const size_t n = 1000;
+
+    std::vector<int> a(n), b(n);
+    for(size_t i = 0; i < n; ++i) {
+        a[i] = 2 * i;
+        b[i] = 3 * i;
+    }
+
+    vex::vector<int> AK(ctx, a), BK(ctx, b), K(ctx, 2 * n);
+    vex::vector<int> AV(ctx, n), BV(ctx, n), V(ctx, 2 * n);
+
+    AV = -AK;
+    BV = -BK;
+
+    size_t size = vex::set_intersection_by_key(AK, AV, BK, K, V);
+
+    BOOST_REQUIRE_EQUAL(size, (n + 2) / 3);
+
+    std::vector<int> hk = head(K, size);
+    std::vector<int> hv = head(V, size);
+    for(size_t i = 0; i < size; ++i) {
+        BOOST_CHECK_EQUAL(hk[i], static_cast<int>(6 * i));
+        BOOST_CHECK_EQUAL(hv[i], -hk[i]);
+    }
+
+    size = vex::set_union_by_key(AK, AV, BK, BV, K, V);
+
+    std::vector<int> c;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+
+    BOOST_REQUIRE_EQUAL(size, c.size());
+    BOOST_CHECK(head(K, size) == c);
+
+    hk = head(K, size);
+    hv = head(V, size);
+    for(size_t i = 0; i < size; ++i) BOOST_CHECK_EQUAL(hv[i], -hk[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,33 @@
+#define BOOST_TEST_MODULE Metrics
+#include <boost/test/unit_test.hpp>
+#include <vexcl/devlist.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/metrics.hpp>
+
+BOOST_AUTO_TEST_CASE(metrics)
+{
+    vex::Context ctx( vex::Filter::Env );
+
+    const size_t n = 1024;
+
+    vex::metrics::reset();
+    vex::metrics::counters c0 = vex::metrics::snapshot(ctx);
+
+    vex::vector<int> x(ctx, n);
+    std::vector<int> y(n, 42);
+
+    vex::copy(y, x);
+    x = 2 * x;
+    x = 2 * x;
+    vex::copy(x, y);
+
+    BOOST_CHECK(y[0] == 84 * 2);
+
+    vex::metrics::counters c1 = vex::metrics::snapshot(ctx);
+
+    BOOST_CHECK(c1.allocations      >= c0.allocations + ctx.size());
+    BOOST_CHECK(c1.bytes_uploaded   >= c0.bytes_uploaded   + n * sizeof(int));
+    BOOST_CHECK(c1.bytes_downloaded >= c0.bytes_downloaded + n * sizeof(int));
+    BOOST_CHECK(c1.cache_hits       >  c0.cache_hits);
+    BOOST_CHECK(c1.peak_live_bytes  >= n * sizeof(int));
+}
@@ -0,0 +1,172 @@
+#define BOOST_TEST_MODULE Profiler
+#include <sstream>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+#include <vexcl/devlist.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/reductor.hpp>
+#include <vexcl/element_index.hpp>
+#include <vexcl/vector_view.hpp>
+#include <vexcl/profiler.hpp>
+
+BOOST_AUTO_TEST_CASE(event_profiling)
+{
+    vex::Context ctx( vex::Filter::Env, vex::backend::profiling_queue );
+
+    const size_t n = 1 << 20;
+
+    vex::vector<float> x(ctx, n);
+    vex::vector<float> y(ctx, n);
+
+    // Compile the kernels outside of the profiled interval.
+    x = 1;
+    y = 2 * x + y;
+    {
+        vex::Reductor<float, vex::SUM> sum(ctx);
+        sum(x);
+    }
+    ctx.finish();
+
+    vex::profiler<> prof(ctx);
+
+    prof.tic_cl("interval");
+
+    // Kernels launched by other threads are not attributed to the profiler.
+    boost::thread other([&ctx, &x]() {
+            vex::Reductor<float, vex::SUM> sum(ctx);
+            sum(x);
+            });
+
+    for(int i = 0; i < 4; ++i) y = 2 * x + y;
+
+    other.join();
+    prof.toc("interval");
+
+    std::ostringstream out;
+    out << prof;
+    std::string p = out.str();
+
+    // Kernels only show up as children of event-based intervals, which never
+    // finish the queues.
+    size_t k = p.find("vexcl_vector_kernel");
+    BOOST_REQUIRE(k != std::string::npos);
+
+    size_t avg = p.find("avg:", k);
+    BOOST_REQUIRE(avg != std::string::npos);
+    BOOST_CHECK(std::stod(p.substr(avg + 4)) > 0);
+
+    BOOST_CHECK(p.find("vexcl_reductor_kernel") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(kernel_work_estimate)
+{
+    vex::Context ctx( vex::Filter::Env, vex::backend::profiling_queue );
+
+    const size_t n = 1 << 20;
+
+    vex::vector<float> a(ctx, n);
+    vex::vector<float> b(ctx, n);
+    vex::vector<float> c(ctx, n);
+
+    BOOST_CHECK_EQUAL(vex::traits::terminal_bytes< vex::vector<float> >::value, sizeof(float));
+
+    // Work estimates are per element.
+    vex::backend::kernel_work w = vex::detail::assignment_work<vex::assign::SET>(a, b + c);
+    BOOST_CHECK_EQUAL(w.bytes, 12);
+    BOOST_CHECK_EQUAL(w.flops, 1);
+
+    // Compound assignment also reads the lhs and does one more operation.
+    w = vex::detail::assignment_work<vex::assign::ADD>(a, b * c);
+    BOOST_CHECK_EQUAL(w.bytes, 16);
+    BOOST_CHECK_EQUAL(w.flops, 2);
+
+    // Repeated terminals are only counted once.
+    w = vex::detail::assignment_work<vex::assign::SET>(a, b * b + a);
+    BOOST_CHECK_EQUAL(w.bytes, 12);
+
+    w = vex::detail::assignment_work<vex::assign::ADD>(a, a * b);
+    BOOST_CHECK_EQUAL(w.bytes, 12);
+
+    // Scalars and element indices do not touch global memory.
+    w = vex::detail::assignment_work<vex::assign::SET>(a, 2 * b + vex::element_index());
+    BOOST_CHECK_EQUAL(w.bytes, 8);
+
+    // Traffic of a slice is not estimated, so the estimate is unknown.
+    vex::slicer<1> slice(vex::extents[n]);
+    w = vex::detail::assignment_work<vex::assign::SET>(a, slice[vex::range(0, 2, n)](b));
+    BOOST_CHECK_EQUAL(w.bytes, 0);
+
+    b = 1;
+    c = 2;
+    a = b + c;
+    ctx.finish();
+
+    vex::profiler<> prof(ctx);
+    prof.set_peak_bandwidth(vex::device_bandwidth(ctx.queue(0)));
+
+    prof.tic_cl("sum");
+    for(int i = 0; i < 4; ++i) a = b + c;
+    prof.toc("sum");
+
+    std::ostringstream out;
+    out << prof;
+    std::string p = out.str();
+
+    size_t k = p.find("vexcl_vector_kernel");
+    BOOST_REQUIRE(k != std::string::npos);
+
+    std::string line = p.substr(k, p.find('\n', k) - k);
+    BOOST_CHECK(line.find("GB/s")     != std::string::npos);
+    BOOST_CHECK(line.find("of peak")  != std::string::npos);
+    BOOST_CHECK(line.find("GFLOP/s")  != std::string::npos);
+    BOOST_CHECK(line.find("flop/byte") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(kernels_by_source)
+{
+    vex::Context ctx( vex::Filter::Env && vex::Filter::Count(1), vex::backend::profiling_queue );
+
+    const size_t n = 1 << 20;
+
+    vex::vector<float> a(ctx, n);
+    vex::vector<float> b(ctx, n);
+    vex::vector<float> c(ctx, n);
+
+    b = 1;
+    c = 2;
+    a = b + c;
+    a = b;
+    ctx.finish();
+
+    vex::profiler<> prof(ctx);
+
+    prof.tic_cl("assign");
+    for(int i = 0; i < 4; ++i) {
+        a = b + c;
+        a = b;
+    }
+    prof.toc("assign");
+
+    std::ostringstream out;
+    out << prof;
+    std::string p = out.str();
+
+    // Both expressions are generated as vexcl_vector_kernel, but are
+    // reported separately.
+    std::vector<std::string> rows;
+    for(size_t k = p.find("vexcl_vector_kernel ["); k != std::string::npos;
+            k = p.find("vexcl_vector_kernel [", k + 1))
+        rows.push_back(p.substr(k, p.find('\n', k) - k));
+
+    BOOST_REQUIRE_EQUAL(rows.size(), 2U);
+    BOOST_CHECK(rows[0].substr(0, 30) != rows[1].substr(0, 30));
+
+    // 4 launches of n elements with 12 and 8 bytes per element.
+    const std::string mb12 = "50.332 MB";
+    const std::string mb8  = "33.554 MB";
+
+    BOOST_CHECK(
+            (rows[0].find(mb12) != std::string::npos && rows[1].find(mb8)  != std::string::npos) ||
+            (rows[0].find(mb8)  != std::string::npos && rows[1].find(mb12) != std::string::npos)
+            );
+}
@@ -1,4 +1,5 @@
 #define BOOST_TEST_MODULE SparseMatrixVectorProduct
+#include <map>
 #include <boost/test/unit_test.hpp>
 #include <vexcl/vector.hpp>
 #include <vexcl/multivector.hpp>
@@ -230,6 +231,173 @@ BOOST_AUTO_TEST_CASE(ccsr_vector_product)
             });
 }
 
+BOOST_AUTO_TEST_CASE(multidevice_ccsr_vector_product)
+{
+    const size_t n = 16;
+    const double h2i = (n - 1) * (n - 1);
+
+    std::vector<size_t> idx;
+    std::vector<size_t> row = {0, 1, 8};
+    std::vector<int>    col = {0, -static_cast<int>(n * n), -static_cast<int>(n), -1, 0, 1,
+                               static_cast<int>(n), static_cast<int>(n * n)};
+    std::vector<double> val = {1, -h2i, -h2i, -h2i, h2i * 6, -h2i, -h2i, -h2i};
+
+    idx.reserve(n * n * n);
+
+    for(size_t k = 0; k < n; k++)
+        for(size_t j = 0; j < n; j++)
+            for(size_t i = 0; i < n; i++)
+                idx.push_back(
+                        i == 0 || i == (n - 1) ||
+                        j == 0 || j == (n - 1) ||
+                        k == 0 || k == (n - 1) ? 0 : 1
+                        );
+
+    std::vector<double> x = random_vector<double>(n * n * n);
+
+    vex::SpMatCCSR<double,int> A(ctx, x.size(), row.size() - 1,
+            idx.data(), row.data(), col.data(), val.data());
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, x.size());
+
+    Y = 2 * X - A * X;
+
+    check_sample(Y, [&](size_t ii, double a) {
+            double sum = 0;
+            size_t i = idx[ii];
+            for(size_t j = row[i]; j < row[i + 1]; j++)
+                sum += val[j] * x[ii + col[j]];
+
+            BOOST_CHECK_CLOSE(a, 2 * x[ii] - sum, 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(multidevice_ccsr_several_products)
+{
+    const size_t n = 16;
+    const size_t N = n * n * n;
+    const double h2i = (n - 1) * (n - 1);
+
+    typedef std::array<double, 2> elem_t;
+
+    std::vector<size_t> idx;
+    std::vector<size_t> row = {0, 1, 8};
+    std::vector<int>    col = {0, -static_cast<int>(n * n), -static_cast<int>(n), -1, 0, 1,
+                               static_cast<int>(n), static_cast<int>(n * n)};
+    std::vector<double> val = {1, -h2i, -h2i, -h2i, h2i * 6, -h2i, -h2i, -h2i};
+
+    idx.reserve(N);
+
+    for(size_t k = 0; k < n; k++)
+        for(size_t j = 0; j < n; j++)
+            for(size_t i = 0; i < n; i++)
+                idx.push_back(
+                        i == 0 || i == (n - 1) ||
+                        j == 0 || j == (n - 1) ||
+                        k == 0 || k == (n - 1) ? 0 : 1
+                        );
+
+    std::vector<double> x = random_vector<double>(N * 2);
+
+    vex::SpMatCCSR<double,int> A(ctx, N, row.size() - 1,
+            idx.data(), row.data(), col.data(), val.data());
+
+    auto product = [&](size_t c, size_t ii) {
+        double sum = 0;
+        size_t i = idx[ii];
+        for(size_t j = row[i]; j < row[i + 1]; j++)
+            sum += val[j] * x[c * N + ii + col[j]];
+        return sum;
+    };
+
+    // Each product in the expression needs its own halo.
+    vex::vector<double> X(ctx, N, x.data());
+    vex::vector<double> Z(ctx, N, x.data() + N);
+    vex::vector<double> Y(ctx, N);
+
+    Y = A * X - 2 * (A * Z);
+
+    check_sample(Y, [&](size_t ii, double a) {
+            BOOST_CHECK_CLOSE(a, product(0, ii) - 2 * product(1, ii), 1e-8);
+            });
+
+    // More source vectors than the halo table holds.
+    for(int k = 0; k < 100; ++k) {
+        vex::vector<double> V(ctx, N, x.data());
+        Y = A * V + A * Z;
+    }
+
+    check_sample(Y, [&](size_t ii, double a) {
+            BOOST_CHECK_CLOSE(a, product(0, ii) + product(1, ii), 1e-8);
+            });
+
+    vex::multivector<double,2> MX(ctx, x);
+    vex::multivector<double,2> MY(ctx, N);
+
+    MY = A * MX;
+
+    check_sample(MY, [&](size_t ii, elem_t a) {
+            BOOST_CHECK_CLOSE(a[0], product(0, ii), 1e-8);
+            BOOST_CHECK_CLOSE(a[1], product(1, ii), 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(block_sparse_product)
+{
+    const size_t nb = 256;
+    const size_t B  = 3;
+    const size_t n  = nb * B;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> bval;
+
+    random_matrix(nb, nb, 8, row, col, bval);
+
+    std::vector<double> val = random_vector<double>(col.size() * B * B);
+    std::vector<double> x   = random_vector<double>(n);
+
+    vex::SpMatBSR<double, B> A(ctx, nb, nb, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    auto product = [&](size_t i) {
+        size_t bi = i / B, r = i % B;
+        double sum = 0;
+        for(size_t j = row[bi]; j < row[bi + 1]; ++j)
+            for(size_t k = 0; k < B; ++k)
+                sum += val[j * B * B + r * B + k] * x[col[j] * B + k];
+        return sum;
+    };
+
+    Y = A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, product(idx), 1e-8);
+            });
+
+    Y = X - 2 * (A * X);
+
+    check_sample(Y, [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, x[idx] - 2 * product(idx), 1e-8);
+            });
+
+    vex::multivector<double, 2> MX(ctx, n), MY(ctx, n);
+    MX(0) = X;
+    MX(1) = 2 * X;
+
+    MY = A * MX;
+
+    check_sample(MY(0), [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, product(idx), 1e-8);
+            });
+    check_sample(MY(1), [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, 2 * product(idx), 1e-8);
+            });
+}
+
 BOOST_AUTO_TEST_CASE(inline_spmv)
 {
     const size_t n = 1024;
@@ -259,6 +427,506 @@ BOOST_AUTO_TEST_CASE(inline_spmv)
             });
 }
 
+BOOST_AUTO_TEST_CASE(sell_vector_product)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    // Every 100th row is much wider than the rest.
+    row.push_back(0);
+    for(size_t i = 0; i < n; ++i) {
+        size_t w = (i % 100 == 0) ? 200 : i % 7;
+        for(size_t j = 0; j < w; ++j)
+            col.push_back((i + 5 * j) % n);
+        row.push_back(col.size());
+    }
+    val = random_vector<double>(col.size());
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::SpMat<double, size_t, size_t, vex::spmat_format::sell> A(
+            ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    Y = A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+
+    Y = X + A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, x[idx] + sum, 1e-8);
+            });
+}
+
+template <size_t C>
+void check_sell_slice_height() {
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    row.push_back(0);
+    for(size_t i = 0; i < n; ++i) {
+        size_t w = (i % 100 == 0) ? 200 : i % 7;
+        for(size_t j = 0; j < w; ++j)
+            col.push_back((i + 5 * j) % n);
+        row.push_back(col.size());
+    }
+    val = random_vector<double>(col.size());
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::SpMat<double, size_t, size_t, vex::spmat_format::sell_c<C> > A(
+            ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    Y = A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(sell_fixed_slice_height)
+{
+    // Slices that are narrower and wider than a warp, including a height
+    // that is not a power of two.
+    check_sell_slice_height<5>();
+    check_sell_slice_height<64>();
+}
+
+BOOST_AUTO_TEST_CASE(sell_inline_spmv)
+{
+    const size_t n = 1024;
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::SpMat<double, size_t, size_t, vex::spmat_format::sell> A(
+            queue, n, n, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Y(queue, n);
+
+    Y = sin(vex::make_inline(A * X));
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sin(sum), 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(assemble_from_coo)
+{
+    const size_t n = 1024;
+    const size_t m = 4 * n;
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    // Random triplets with lots of duplicates.
+    std::vector<size_t> ti = random_vector<size_t>(m);
+    std::vector<size_t> tj = random_vector<size_t>(m);
+    std::vector<double> tv = random_vector<double>(m);
+
+    for(size_t k = 0; k < m; ++k) {
+        ti[k] %= n;
+        tj[k] %= 64;
+    }
+
+    std::vector< std::map<size_t, double> > A_host(n);
+    for(size_t k = 0; k < m; ++k)
+        A_host[ti[k]][tj[k]] += tv[k];
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::vector<size_t> I(queue, ti);
+    vex::vector<size_t> J(queue, tj);
+    vex::vector<double> V(queue, tv);
+
+    auto A = vex::SpMat<double>::from_coo(queue, n, n, I, J, V);
+    auto B = vex::SpMat<double>::from_coo(ctx, n, n, I, J, V);
+
+    BOOST_CHECK_EQUAL(A.nonzeros(), B.nonzeros());
+
+    {
+        vex::vector<double> X(queue, x);
+        vex::vector<double> Y(queue, n);
+
+        Y = A * X;
+
+        check_sample(Y, [&](size_t idx, double a) {
+                double sum = 0;
+                for(auto e = A_host[idx].begin(); e != A_host[idx].end(); ++e)
+                    sum += e->second * x[e->first];
+
+                BOOST_CHECK_CLOSE(a, sum, 1e-8);
+                });
+    }
+
+    {
+        vex::vector<double> X(ctx, x);
+        vex::vector<double> Y(ctx, n);
+
+        Y = B * X;
+
+        check_sample(Y, [&](size_t idx, double a) {
+                double sum = 0;
+                for(auto e = A_host[idx].begin(); e != A_host[idx].end(); ++e)
+                    sum += e->second * x[e->first];
+
+                BOOST_CHECK_CLOSE(a, sum, 1e-8);
+                });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(transposed_product)
+{
+    const size_t n = 1024;
+    const size_t m = 2 * n;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, m, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n);
+    std::vector<double> y = random_vector<double>(m);
+
+    std::vector<double> z(m, 0.0);
+    for(size_t i = 0; i < n; ++i)
+        for(size_t j = row[i]; j < row[i + 1]; ++j)
+            z[col[j]] += val[j] * x[i];
+
+    vex::SpMat<double> A(ctx, n, m, row.data(), col.data(), val.data());
+    vex::SpMat<double, size_t, size_t, vex::spmat_format::sell> B(
+            ctx, n, m, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, y);
+    vex::vector<double> Z(ctx, m);
+
+    Z = vex::transpose(A) * X;
+
+    check_sample(Z, [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, z[idx], 1e-8);
+            });
+
+    Z = Y - 2 * (vex::transpose(B) * X);
+
+    check_sample(Z, [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, y[idx] - 2 * z[idx], 1e-8);
+            });
+}
+
+// Checks plain, multivector and transposed products of the matrix split
+// between the queues against the host reference. Each product is repeated,
+// so that the second exchange reuses the buffers of the first.
+void check_ghost_exchange(const std::vector<vex::command_queue> &queue, size_t n,
+        const std::vector<size_t> &row, const std::vector<size_t> &col,
+        const std::vector<double> &val)
+{
+    std::vector<double> x = random_vector<double>(2 * n);
+
+    std::vector<double> y(2 * n, 0.0), z(n, 0.0);
+    for(size_t i = 0; i < n; ++i) {
+        for(size_t j = row[i]; j < row[i + 1]; ++j) {
+            y[i]     += val[j] * x[col[j]];
+            y[n + i] += val[j] * x[n + col[j]];
+            z[col[j]] += val[j] * x[i];
+        }
+    }
+
+    vex::SpMat<double> A(queue, n, n, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(queue, n);
+    vex::vector<double> Y(queue, n);
+    vex::copy(x.begin(), x.begin() + n, X.begin());
+
+    vex::multivector<double, 2> MX(queue, x);
+    vex::multivector<double, 2> MY(queue, n);
+
+    std::vector<double> h(n), mh(2 * n);
+
+    for(int k = 0; k < 2; ++k) {
+        Y = A * X;
+        vex::copy(Y, h);
+        for(size_t i = 0; i < n; ++i)
+            BOOST_CHECK_SMALL(h[i] - y[i], 1e-8);
+
+        MY = A * MX;
+        vex::copy(MY(0), h);
+        for(size_t i = 0; i < n; ++i)
+            BOOST_CHECK_SMALL(h[i] - y[i], 1e-8);
+        vex::copy(MY(1), h);
+        for(size_t i = 0; i < n; ++i)
+            BOOST_CHECK_SMALL(h[i] - y[n + i], 1e-8);
+
+        Y = vex::transpose(A) * X;
+        vex::copy(Y, h);
+        for(size_t i = 0; i < n; ++i)
+            BOOST_CHECK_SMALL(h[i] - z[i], 1e-8);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ghost_exchange)
+{
+    // The same device is used three times, so the exchange goes through
+    // all the steps. With 20 rows the partition is [0, 16, 16, 20], with 40
+    // rows it is [0, 16, 32, 40].
+    std::vector<vex::command_queue> queue(3, ctx.queue(0));
+
+    for(size_t n : {20, 40}) {
+        std::vector<size_t> row;
+        std::vector<size_t> col;
+        std::vector<double> val;
+
+        random_matrix(n, n, 8, row, col, val);
+        check_ghost_exchange(queue, n, row, col, val);
+
+        // Lower band matrix: the first device has no ghost points, but
+        // sends its values to the others.
+        row.assign(1, 0);
+        col.clear();
+        for(size_t i = 0; i < n; ++i) {
+            for(size_t j = (i < 4 ? 0 : i - 4); j <= i; ++j)
+                col.push_back(j);
+            row.push_back(col.size());
+        }
+        val = random_vector<double>(col.size());
+
+        check_ghost_exchange(queue, n, row, col, val);
+    }
+}
+
+// Checks every row of the product of the matrix in the given format
+// against the host.
+template <class Format>
+void check_conversion(const std::vector<vex::command_queue> &queue,
+        size_t n, size_t m, const std::vector<size_t> &row,
+        const std::vector<size_t> &col, const std::vector<double> &val)
+{
+    std::vector<double> x = random_vector<double>(m);
+
+    std::vector<double> y(n, 0.0);
+    for(size_t i = 0; i < n; ++i)
+        for(size_t j = row[i]; j < row[i + 1]; ++j)
+            y[i] += val[j] * x[col[j]];
+
+    vex::SpMat<double, size_t, size_t, Format> A(
+            queue, n, m, row.data(), col.data(), val.data());
+
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Y(queue, n);
+
+    Y = 1;
+    Y = A * X;
+
+    std::vector<double> h(n);
+    vex::copy(Y, h);
+    for(size_t i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(h[i] - y[i], 1e-8);
+}
+
+void check_conversions(const std::vector<vex::command_queue> &queue,
+        size_t n, size_t m, const std::vector<size_t> &row,
+        const std::vector<size_t> &col, const std::vector<double> &val)
+{
+    check_conversion<vex::spmat_format::csr       >(queue, n, m, row, col, val);
+    check_conversion<vex::spmat_format::hybrid_ell>(queue, n, m, row, col, val);
+    check_conversion<vex::spmat_format::sell      >(queue, n, m, row, col, val);
+}
+
+BOOST_AUTO_TEST_CASE(format_conversion)
+{
+    // The same device is used three times to get the strips with ghost
+    // points. With 40 rows the partition is [0, 16, 32, 40].
+    std::vector< std::vector<vex::command_queue> > queues = {
+        std::vector<vex::command_queue>(1, ctx.queue(0)),
+        std::vector<vex::command_queue>(3, ctx.queue(0))
+    };
+
+    for(auto q = queues.begin(); q != queues.end(); ++q) {
+        std::vector<size_t> row;
+        std::vector<size_t> col;
+        std::vector<double> val;
+
+        // Empty rows at both ends of the matrix and in its middle.
+        {
+            const size_t n = 40;
+
+            std::vector<size_t> r, c;
+            random_matrix(n, n, 8, r, c, val);
+
+            row.assign(1, 0);
+            col.clear();
+            std::vector<double> v;
+            for(size_t i = 0; i < n; ++i) {
+                if (i >= 3 && i + 3 < n && i % 5 != 0)
+                    for(size_t j = r[i]; j < r[i + 1]; ++j) {
+                        col.push_back(c[j]);
+                        v.push_back(val[j]);
+                    }
+                row.push_back(col.size());
+            }
+            val.swap(v);
+
+            check_conversions(*q, n, n, row, col, val);
+        }
+
+        // A single row.
+        {
+            const size_t m = 50;
+
+            row = {0, 4};
+            col = {0, 7, 31, m - 1};
+            val = random_vector<double>(col.size());
+
+            check_conversions(*q, 1, m, row, col, val);
+        }
+
+        // Block diagonal matrix: the strips have no ghost points, but start
+        // from a nonzero column.
+        {
+            const size_t n = 40;
+
+            row.assign(1, 0);
+            col.clear();
+            for(size_t i = 0; i < n; ++i) {
+                size_t b = i / 16 * 16;
+                for(size_t j = b; j < std::min(b + 16, n); j += 1 + i % 3)
+                    col.push_back(j);
+                row.push_back(col.size());
+            }
+            val = random_vector<double>(col.size());
+
+            check_conversions(*q, n, n, row, col, val);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rcm_reordering)
+{
+    const size_t k = 32;
+    const size_t n = k * k;
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    // Poisson problem on a k x k grid with randomly shuffled unknowns.
+    std::vector<size_t> id(n);
+    for(size_t i = 0; i < n; ++i) id[i] = i;
+    std::shuffle(id.begin(), id.end(), std::default_random_engine(42));
+
+    std::vector< std::map<size_t, double> > A_host(n);
+    for(size_t i = 0; i < k; ++i) {
+        for(size_t j = 0; j < k; ++j) {
+            size_t r = id[i * k + j];
+            A_host[r][r] = 4;
+            if (i > 0)     A_host[r][id[(i - 1) * k + j]] = -1;
+            if (i + 1 < k) A_host[r][id[(i + 1) * k + j]] = -1;
+            if (j > 0)     A_host[r][id[i * k + j - 1]]   = -1;
+            if (j + 1 < k) A_host[r][id[i * k + j + 1]]   = -1;
+        }
+    }
+
+    std::vector<size_t> row(1, 0);
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    for(size_t i = 0; i < n; ++i) {
+        for(auto e = A_host[i].begin(); e != A_host[i].end(); ++e) {
+            col.push_back(e->first);
+            val.push_back(e->second);
+        }
+        row.push_back(col.size());
+    }
+
+    std::vector<size_t> p = vex::reorder::rcm(n, row.data(), col.data());
+
+    std::vector<size_t> prow, pcol;
+    std::vector<double> pval;
+    vex::reorder::permute(n, p, row.data(), col.data(), val.data(), prow, pcol, pval);
+
+    BOOST_CHECK(vex::reorder::bandwidth(n, prow.data(), pcol.data()) <= 2 * k);
+    BOOST_CHECK(vex::reorder::bandwidth(n, row.data(), col.data()) > 2 * k);
+
+    auto A = vex::SpMat<double>::reordered(queue, n, row.data(), col.data(), val.data());
+
+    BOOST_CHECK(A.permutation() == p);
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Xp(queue, n);
+    vex::vector<double> Yp(queue, n);
+    vex::vector<double> Y(queue, n);
+
+    Xp = A.to_reordered(X);
+    Yp = A * Xp;
+    Y  = A.to_original(Yp);
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(auto e = A_host[idx].begin(); e != A_host[idx].end(); ++e)
+                sum += e->second * x[e->first];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+
+    // Narrow index types.
+    std::vector<int> irow(row.begin(), row.end());
+    std::vector<int> icol(col.begin(), col.end());
+
+    auto B = vex::SpMat<double, int, int>::reordered(queue, n, irow.data(), icol.data(), val.data());
+
+    BOOST_CHECK(B.permutation() == p);
+
+    Xp = B.to_reordered(X);
+    Yp = B * Xp;
+    Y  = B.to_original(Yp);
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(auto e = A_host[idx].begin(); e != A_host[idx].end(); ++e)
+                sum += e->second * x[e->first];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+}
+
 BOOST_AUTO_TEST_CASE(multivector_product)
 {
     const size_t n = 1024;
@@ -306,6 +974,42 @@ BOOST_AUTO_TEST_CASE(multivector_product)
             });
 }
 
+BOOST_AUTO_TEST_CASE(wide_multivector_product)
+{
+    const size_t n = 1024;
+    const size_t m = 4;
+
+    typedef std::array<double, m> elem_t;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n * m);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+    vex::SpMat <double, size_t, size_t, vex::spmat_format::sell> B(
+            ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::multivector<double,m> X(ctx, x);
+    vex::multivector<double,m> Y(ctx, n);
+
+    Y = A * X;
+    Y += 2 * (B * X);
+
+    check_sample(Y, [&](size_t idx, elem_t a) {
+            for(size_t k = 0; k < m; ++k) {
+                double sum = 0;
+                for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                    sum += val[j] * x[k * n + col[j]];
+
+                BOOST_CHECK_CLOSE(a[k], 3 * sum, 1e-8);
+            }
+            });
+}
+
 BOOST_AUTO_TEST_CASE(inline_multivector_product)
 {
     const size_t n = 1024;
@@ -342,6 +1046,109 @@ BOOST_AUTO_TEST_CASE(inline_multivector_product)
             });
 }
 
+// Column numbers of a matrix part are stored in the narrowest type that holds
+// the column span of the part. Checks products of a single device matrix with
+// the given span against the host.
+template <typename col_t, class Format>
+void check_column_span(const std::vector<vex::command_queue> &queue, size_t m) {
+    const size_t n = 256;
+
+    std::vector<size_t> row;
+    std::vector<col_t>  col;
+    std::vector<double> val;
+
+    random_matrix(n, m, 8, row, col, val);
+
+    // Make sure the widest column is used, and that rows of the matrix
+    // have different lengths.
+    for(size_t i = 0; i < n; i += 3) {
+        if (row[i + 1] > row[i])     col[row[i]]     = static_cast<col_t>(m - 1);
+        if (row[i + 1] > row[i] + 1) col[row[i] + 1] = 0;
+    }
+
+    std::vector<double> x = random_vector<double>(2 * m);
+
+    vex::SpMat<double, col_t, size_t, Format> A(
+            queue, n, m, row.data(), col.data(), val.data());
+
+    // CSR format has no padding, so the size of the stored column numbers
+    // is known exactly.
+    if (std::is_same<Format, vex::spmat_format::csr>::value) {
+        size_t width = sizeof(col_t);
+        if (sizeof(col_t) > sizeof(cl_ushort) && m < 0xFFFFu) width = sizeof(cl_ushort);
+        else if (sizeof(col_t) > sizeof(cl_uint)) width = sizeof(cl_uint);
+
+        BOOST_CHECK_EQUAL(A.column_bytes(), col.size() * width);
+    }
+
+    std::vector<double> y0(n), y1(n);
+    for(size_t i = 0; i < n; ++i) {
+        for(size_t j = row[i]; j < row[i + 1]; ++j) {
+            y0[i] += val[j] * x[col[j]];
+            y1[i] += val[j] * x[m + col[j]];
+        }
+    }
+
+    {
+        vex::vector<double> X(queue, m, x.data());
+        vex::vector<double> Y(queue, n);
+
+        Y = A * X;
+        check_sample(Y, [&](size_t idx, double a) {
+                BOOST_CHECK_CLOSE(a, y0[idx], 1e-8);
+                });
+
+        Y = sin(vex::make_inline(A * X));
+        check_sample(Y, [&](size_t idx, double a) {
+                BOOST_CHECK_CLOSE(a, sin(y0[idx]), 1e-8);
+                });
+    }
+
+    {
+        typedef std::array<double, 2> elem_t;
+
+        vex::multivector<double, 2> X(queue, x);
+        vex::multivector<double, 2> Y(queue, n);
+
+        Y = A * X;
+        check_sample(Y, [&](size_t idx, elem_t a) {
+                BOOST_CHECK_CLOSE(a[0], y0[idx], 1e-8);
+                BOOST_CHECK_CLOSE(a[1], y1[idx], 1e-8);
+                });
+
+        Y = cos(vex::make_inline(A * X));
+        check_sample(Y, [&](size_t idx, elem_t a) {
+                BOOST_CHECK_CLOSE(a[0], cos(y0[idx]), 1e-8);
+                BOOST_CHECK_CLOSE(a[1], cos(y1[idx]), 1e-8);
+                });
+    }
+}
+
+template <class Format>
+void check_column_spans(const std::vector<vex::command_queue> &queue) {
+    // 16-bit columns below 65535, 32-bit from 65535 on: the largest
+    // 16-bit number marks padding.
+    check_column_span<size_t, Format>(queue, 65534);
+    check_column_span<size_t, Format>(queue, 65535);
+    check_column_span<size_t, Format>(queue, 65536);
+
+    // 32-bit column type is stored as is from 65535 on.
+    check_column_span<cl_uint, Format>(queue, 65534);
+    check_column_span<cl_uint, Format>(queue, 65535);
+
+    // 16-bit column type is never narrowed.
+    check_column_span<cl_ushort, Format>(queue, 1024);
+}
+
+BOOST_AUTO_TEST_CASE(column_storage_width)
+{
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    check_column_spans<vex::spmat_format::csr>(queue);
+    check_column_spans<vex::spmat_format::hybrid_ell>(queue);
+    check_column_spans<vex::spmat_format::sell>(queue);
+}
+
 BOOST_AUTO_TEST_CASE(ccsr_multivector_product)
 {
     const size_t n = 32;
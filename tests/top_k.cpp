@@ -0,0 +1,89 @@
+#define BOOST_TEST_MODULE TopK
+#include <algorithm>
+#include <functional>
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/top_k.hpp>
+#include "context_setup.hpp"
+
+BOOST_AUTO_TEST_CASE(top_k)
+{
+    const size_t n = 1000 * 1000;
+    const size_t k = 100;
+
+    std::vector<float> x = random_vector<float>(n);
+    for(size_t i = 0; i < n; i += 2) x[i] = -x[i];
+
+    vex::vector<float> X(ctx, x);
+
+    vex::vector<float> Y = vex::top_k(X, k);
+
+    std::partial_sort(x.begin(), x.begin() + k, x.end(), std::greater<float>());
+
+    BOOST_REQUIRE_EQUAL(Y.size(), k);
+
+    check_sample(Y, [&](size_t idx, float v) {
+            BOOST_CHECK_EQUAL(v, x[idx]);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(top_k_ties)
+{
+    // Integer keys in [0, 100] have lots of duplicates.
+    const size_t n = 1000 * 1000;
+    const size_t k = 15000;
+
+    std::vector<int> x = random_vector<int>(n);
+    vex::vector<int> X(ctx, x);
+
+    vex::vector<int> Y = vex::top_k(X, k);
+
+    std::partial_sort(x.begin(), x.begin() + k, x.end(), std::greater<int>());
+
+    check_sample(Y, [&](size_t idx, int v) {
+            BOOST_CHECK_EQUAL(v, x[idx]);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(top_k_by_key)
+{
+    const size_t n = 1000 * 1000;
+    const size_t k = 1000;
+
+    std::vector<int>    x = random_vector<int>(n);
+    std::vector<double> y(n);
+    for(size_t i = 0; i < n; ++i) y[i] = 2.0 * x[i];
+
+    vex::vector<int>    X(ctx, x);
+    vex::vector<double> Y(ctx, y);
+
+    auto top = vex::top_k_by_key(X, Y, k);
+
+    std::partial_sort(x.begin(), x.begin() + k, x.end(), std::greater<int>());
+
+    check_sample(top.first, [&](size_t idx, int v) {
+            BOOST_CHECK_EQUAL(v, x[idx]);
+            });
+
+    check_sample(top.second, [&](size_t idx, double v) {
+            BOOST_CHECK_EQUAL(v, 2.0 * x[idx]);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(nth_element)
+{
+    const size_t n = 1000 * 1000;
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(ctx, x);
+
+    for(size_t nth : {size_t(0), n / 3, n / 2, n - 1}) {
+        double v = vex::nth_element(X, nth);
+
+        std::nth_element(x.begin(), x.begin() + nth, x.end());
+
+        BOOST_CHECK_EQUAL(v, x[nth]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
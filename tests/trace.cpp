@@ -0,0 +1,56 @@
+#define BOOST_TEST_MODULE KernelTrace
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include <vexcl/devlist.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/reductor.hpp>
+#include <vexcl/trace.hpp>
+
+BOOST_AUTO_TEST_CASE(trace)
+{
+    vex::Context ctx( vex::Filter::Env, vex::backend::profiling_queue );
+
+    const size_t n = 1024;
+
+    vex::vector<int> x(ctx, n);
+    std::vector<int> y(n);
+
+    vex::Reductor<int, vex::SUM> sum(ctx);
+
+    vex::trace::start(ctx);
+    x = 42;
+    vex::copy(x, y);
+    int s = sum(x);
+    vex::trace::stop();
+
+    BOOST_CHECK(y[0] == 42);
+    BOOST_CHECK_EQUAL(s, 42 * static_cast<int>(n));
+
+    std::ostringstream json;
+    vex::trace::write(json);
+    vex::trace::clear();
+
+    BOOST_CHECK(json.str().find("\"cat\":\"kernel\"") != std::string::npos);
+    BOOST_CHECK(json.str().find("\"cat\":\"read\"")   != std::string::npos);
+    BOOST_CHECK(json.str().find("\"source_hash\"")    != std::string::npos);
+
+    // Device times are resolved once the commands complete.
+    BOOST_CHECK(json.str().find("\"ph\":\"X\",\"pid\":1") != std::string::npos);
+
+    // Waits made by the library are traced as well.
+    BOOST_CHECK(json.str().find("\"cat\":\"finish\"") != std::string::npos);
+
+    // The log is bounded.
+    vex::trace::set_capacity(1);
+    vex::trace::start();
+    x = 1;
+    x = 2;
+    vex::trace::stop();
+
+    json.str("");
+    vex::trace::write(json);
+    vex::trace::clear();
+    vex::trace::set_capacity(1 << 20);
+
+    BOOST_CHECK(json.str().find("\"dropped_records\":1") != std::string::npos);
+}
@@ -6,6 +6,7 @@
 #include <vexcl/constants.hpp>
 #include <vexcl/vector.hpp>
 #include <vexcl/reductor.hpp>
+#include <vexcl/device_scalar.hpp>
 #include <vexcl/element_index.hpp>
 #include <vexcl/tagged_terminal.hpp>
 #include <vexcl/function.hpp>
@@ -77,6 +78,134 @@ BOOST_AUTO_TEST_CASE(reduce_expression)
     BOOST_CHECK_EQUAL( max( fabs(X - X) ), 0.0);
 }
 
+BOOST_AUTO_TEST_CASE(reduce_to_device_scalar)
+{
+    const size_t N = 1024;
+
+    std::vector<double> x = random_vector<double>(N);
+    vex::vector<double> X(ctx, x);
+
+    vex::Reductor<double,vex::SUM> sum(ctx);
+    vex::Reductor<double,vex::MAX> max(ctx);
+
+    vex::device_scalar<double> s(ctx);
+
+    sum(X * X, s);
+
+    double norm2 = std::inner_product(x.begin(), x.end(), x.begin(), 0.0);
+    BOOST_CHECK_CLOSE(s.get(), norm2, 1e-8);
+
+    X = X / sqrt(s);
+
+    check_sample(X, [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, x[idx] / sqrt(norm2), 1e-8);
+            });
+
+    max(X, s);
+    BOOST_CHECK_CLOSE(s.get(),
+            *std::max_element(x.begin(), x.end()) / sqrt(norm2), 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(fused_reduction)
+{
+    const size_t N = 1024;
+
+    std::vector<double> x = random_vector<double>(N);
+    std::vector<double> y = random_vector<double>(N);
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, y);
+
+    vex::Reductor<double, std::tuple<vex::SUM_Kahan, vex::MIN, vex::MAX>> stat(ctx);
+
+    std::array<double, 3> r = stat(X);
+
+    BOOST_CHECK_CLOSE(r[0], std::accumulate(x.begin(), x.end(), 0.0), 1e-8);
+    BOOST_CHECK_EQUAL(r[1], *std::min_element(x.begin(), x.end()));
+    BOOST_CHECK_EQUAL(r[2], *std::max_element(x.begin(), x.end()));
+
+    r = stat(std::forward_as_tuple(X * Y, X, Y));
+
+    BOOST_CHECK_CLOSE(r[0], std::inner_product(x.begin(), x.end(), y.begin(), 0.0), 1e-8);
+    BOOST_CHECK_EQUAL(r[1], *std::min_element(x.begin(), x.end()));
+    BOOST_CHECK_EQUAL(r[2], *std::max_element(y.begin(), y.end()));
+
+    r = stat(std::tie(Y, Y, X));
+
+    BOOST_CHECK_CLOSE(r[0], std::accumulate(y.begin(), y.end(), 0.0), 1e-8);
+    BOOST_CHECK_EQUAL(r[1], *std::min_element(y.begin(), y.end()));
+    BOOST_CHECK_EQUAL(r[2], *std::max_element(x.begin(), x.end()));
+}
+
+BOOST_AUTO_TEST_CASE(argmin_argmax)
+{
+    const size_t N = 1024;
+
+    std::vector<double> x = random_vector<double>(N);
+    vex::vector<double> X(ctx, x);
+
+    vex::Reductor<double, vex::ARGMIN> argmin(ctx);
+    vex::Reductor<double, vex::ARGMAX> argmax(ctx);
+
+    std::pair<double, size_t> mn = argmin(X);
+    std::pair<double, size_t> mx = argmax(fabs(X - 0.5));
+
+    auto imin = std::min_element(x.begin(), x.end());
+    BOOST_CHECK_EQUAL(mn.first,  *imin);
+    BOOST_CHECK_EQUAL(mn.second, static_cast<size_t>(imin - x.begin()));
+
+    auto imax = std::max_element(x.begin(), x.end(),
+            [](double a, double b) { return fabs(a - 0.5) < fabs(b - 0.5); });
+    BOOST_CHECK_EQUAL(mx.first,  fabs(*imax - 0.5));
+    BOOST_CHECK_EQUAL(mx.second, static_cast<size_t>(imax - x.begin()));
+
+    // Ties are resolved in favor of the first element.
+    X = 42;
+    BOOST_CHECK_EQUAL(argmax(X).second, 0u);
+
+    // Elements that never beat the initial value still give a valid index.
+    X = std::numeric_limits<double>::infinity();
+    BOOST_CHECK_EQUAL(argmin(X).second, 0u);
+
+    X = -std::numeric_limits<double>::infinity();
+    BOOST_CHECK_EQUAL(argmax(X).second, 0u);
+
+    X = std::numeric_limits<double>::max();
+    BOOST_CHECK_EQUAL(argmin(X).second, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(statistics_reduction)
+{
+    const size_t N = 1 << 16;
+
+    // Large offset makes the naive sum of squares approach inaccurate.
+    std::vector<double> x = random_vector<double>(N);
+    std::transform(x.begin(), x.end(), x.begin(), [](double v){ return 1e6 + v; });
+
+    vex::vector<double> X(ctx, x);
+
+    double mean = std::accumulate(x.begin(), x.end(), 0.0) / N;
+    double m2 = 0, m3 = 0, m4 = 0;
+    for(double v : x) {
+        double d = v - mean;
+        m2 += d * d;
+        m3 += d * d * d;
+        m4 += d * d * d * d;
+    }
+
+    vex::Reductor<double, vex::MOMENTS> moments(ctx);
+    vex::statistics<double> s = moments(X);
+
+    BOOST_CHECK_EQUAL(s.count, N);
+    BOOST_CHECK_CLOSE(s.mean, mean, 1e-10);
+    BOOST_CHECK_CLOSE(s.m2, m2, 1e-6);
+    BOOST_CHECK_CLOSE(s.skewness(), sqrt(1.0 * N) * m3 / pow(m2, 1.5), 1e-2);
+    BOOST_CHECK_CLOSE(s.kurtosis(), N * m4 / (m2 * m2) - 3, 1e-2);
+
+    vex::Reductor<double, vex::VARIANCE> var(ctx);
+    BOOST_CHECK_CLOSE(var(X), m2 / N, 1e-6);
+}
+
 BOOST_AUTO_TEST_CASE(builtin_functions)
 {
     const size_t N = 1024;
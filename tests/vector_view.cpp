@@ -306,6 +306,41 @@ BOOST_AUTO_TEST_CASE(slice_reductor_single_dim)
         BOOST_CHECK_EQUAL(y[i], i2sum);
 }
 
+BOOST_AUTO_TEST_CASE(slice_reductor_statistics)
+{
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    using vex::extents;
+    using vex::_;
+
+    const size_t n = 64, m = 16;
+
+    std::vector<double> x = random_vector<double>(n * m);
+    vex::vector<double> X(queue, x);
+    vex::vector<double> mean(queue, m);
+    vex::vector<double> var(queue, m);
+
+    vex::slicer<2> slice(extents[n][m]);
+
+    // Column statistics.
+    mean = vex::reduce<vex::MEAN>(slice[_][_](X), 0);
+    var  = vex::reduce<vex::VARIANCE>(slice[_][_](X), 0);
+
+    std::vector<double> mh(m), vh(m);
+    vex::copy(mean, mh);
+    vex::copy(var,  vh);
+
+    for(size_t j = 0; j < m; ++j) {
+        double s = 0, s2 = 0;
+        for(size_t i = 0; i < n; ++i) s += x[i * m + j];
+        s /= n;
+        for(size_t i = 0; i < n; ++i) s2 += (x[i * m + j] - s) * (x[i * m + j] - s);
+
+        BOOST_CHECK_CLOSE(mh[j], s, 1e-8);
+        BOOST_CHECK_CLOSE(vh[j], s2 / n, 1e-8);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(slice_reductor_multi_dim)
 {
     std::vector<vex::command_queue> queue(1, ctx.queue(0));
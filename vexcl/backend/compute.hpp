@@ -54,6 +54,7 @@ namespace vex {
 }
 
 #include <vexcl/backend/compute/compiler.hpp>
+#include <vexcl/backend/compute/event.hpp>
 #include <vexcl/backend/compute/kernel.hpp>
 
 #endif
@@ -38,6 +38,8 @@ THE SOFTWARE.
 
 #include <vexcl/backend/common.hpp>
 #include <vexcl/detail/backtrace.hpp>
+#include <vexcl/detail/trace.hpp>
+#include <vexcl/backend/compute/context.hpp>
 
 namespace vex {
 namespace backend {
@@ -61,6 +63,11 @@ inline boost::compute::program build_sources(
         std::cout << source << std::endl;
 #endif
 
+    vex::detail::trace::scope trace("build", "build", queue.get(), 0,
+            std::hash<std::string>()(source));
+
+    vex::detail::metrics::device::inc(detail::device_metrics(queue).compiles);
+
     return boost::compute::program::build_with_source(
             source, queue.get_context(),
             options + " " + get_compile_options(queue)
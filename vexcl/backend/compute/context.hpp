@@ -36,6 +36,8 @@ THE SOFTWARE.
 
 #include <boost/compute/core.hpp>
 
+#include <vexcl/detail/metrics.hpp>
+
 namespace vex {
 namespace backend {
 
@@ -74,6 +76,17 @@ inline device_id get_device_id(const command_queue &q) {
     return q.get_device().get();
 }
 
+/// \cond INTERNAL
+namespace detail {
+
+// Runtime counters of the device associated with the queue.
+inline vex::detail::metrics::device& device_metrics(const command_queue &q) {
+    return vex::detail::metrics::get(reinterpret_cast<std::uintptr_t>(get_device_id(q)));
+}
+
+} // namespace detail
+/// \endcond
+
 /// \cond INTERNAL
 /// Returns raw context id for the given queue.
 inline context_id get_context_id(const command_queue &q) {
@@ -110,6 +123,11 @@ inline bool is_cpu(const command_queue &q) {
     return q.get_device().get_info<cl_device_type>(CL_DEVICE_TYPE) & CL_DEVICE_TYPE_CPU;
 }
 
+/// The size in bytes of shared (local) memory per block on the device.
+inline size_t max_shared_memory_per_block(const command_queue &q) {
+    return static_cast<size_t>(q.get_device().local_memory_size());
+}
+
 /// Select devices by given criteria.
 /**
  * \param filter  Device filter functor. Functors may be combined with logical
@@ -33,6 +33,8 @@ THE SOFTWARE.
 
 #include <boost/compute/core.hpp>
 
+#include <vexcl/backend/compute/event.hpp>
+
 namespace vex {
 namespace backend {
 namespace compute {
@@ -43,6 +45,36 @@ static const mem_flags MEM_READ_ONLY  = CL_MEM_READ_ONLY;
 static const mem_flags MEM_WRITE_ONLY = CL_MEM_WRITE_ONLY;
 static const mem_flags MEM_READ_WRITE = CL_MEM_READ_WRITE;
 
+/// \cond INTERNAL
+namespace detail {
+
+struct released_memory {
+    vex::detail::metrics::device *dev;
+    size_t bytes;
+};
+
+inline void CL_CALLBACK release_memory(cl_mem, void *data) {
+    released_memory *m = static_cast<released_memory*>(data);
+    m->dev->release(m->bytes);
+    delete m;
+}
+
+// Accounts for the new buffer in the device metrics. The buffer is
+// accounted as released when OpenCL destroys it.
+inline void track_allocation(const boost::compute::buffer &buf, vex::detail::metrics::device &dev, size_t bytes) {
+#ifdef CL_VERSION_1_1
+    dev.allocate(bytes);
+    released_memory *m = new released_memory{&dev, bytes};
+    clSetMemObjectDestructorCallback(buf.get(), &release_memory, m);
+#else
+    vex::detail::metrics::device::inc(dev.allocations);
+    vex::detail::metrics::device::inc(dev.bytes_allocated, bytes);
+#endif
+}
+
+} // namespace detail
+/// \endcond
+
 template <typename T>
 class device_vector {
     public:
@@ -57,9 +89,14 @@ class device_vector {
             if (host && !(flags & CL_MEM_USE_HOST_PTR))
                 flags |= CL_MEM_COPY_HOST_PTR;
 
-            if (n)
+            if (n) {
                 buffer = boost::compute::buffer(q.get_context(), n * sizeof(T),
                         flags, static_cast<void*>(const_cast<T*>(host)));
+
+                vex::detail::metrics::device &m = detail::device_metrics(q);
+                detail::track_allocation(buffer, m, n * sizeof(T));
+                if (flags & CL_MEM_COPY_HOST_PTR) m.upload(n * sizeof(T));
+            }
         }
 
         device_vector(boost::compute::buffer buffer) : buffer( std::move(buffer) ) {}
@@ -68,34 +105,124 @@ class device_vector {
                 size_t size, const T *host, bool blocking = false
                 ) const
         {
-            if (size) {
-                if (blocking) {
-                    q.enqueue_write_buffer(
+            if (!size) return;
+
+            detail::device_metrics(q).upload(sizeof(T) * size);
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            boost::compute::event e;
+
+            if (blocking) {
+                e = q.enqueue_write_buffer(
                         buffer, sizeof(T) * offset, sizeof(T) * size, host
                         );
-                } else {
-                    q.enqueue_write_buffer_async(
+            } else {
+                e = q.enqueue_write_buffer_async(
                         buffer, sizeof(T) * offset, sizeof(T) * size, host
                         );
-                }
             }
+
+            if (trace)
+                detail::trace("write", "write", q, begin, event(e), sizeof(T) * size);
         }
 
         void read(boost::compute::command_queue q, size_t offset,
                 size_t size, T *host, bool blocking = false
                 ) const
         {
-            if (size) {
-                if (blocking) {
-                    q.enqueue_read_buffer(
-                            buffer, sizeof(T) * offset, sizeof(T) * size, host
-                            );
-                } else {
-                    q.enqueue_read_buffer_async(
-                            buffer, sizeof(T) * offset, sizeof(T) * size, host
-                            );
-                }
+            if (!size) return;
+
+            detail::device_metrics(q).download(sizeof(T) * size);
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            boost::compute::event e;
+
+            if (blocking) {
+                e = q.enqueue_read_buffer(
+                        buffer, sizeof(T) * offset, sizeof(T) * size, host
+                        );
+            } else {
+                e = q.enqueue_read_buffer_async(
+                        buffer, sizeof(T) * offset, sizeof(T) * size, host
+                        );
             }
+
+            if (trace)
+                detail::trace("read", "read", q, begin, event(e), sizeof(T) * size);
+        }
+
+        /// Enqueues copy from host memory to the device.
+        /**
+         * The host memory should stay untouched until the returned event
+         * completes.
+         */
+        event write_async(boost::compute::command_queue q, size_t offset,
+                size_t size, const T *host) const
+        {
+            if (!size) return event();
+
+            detail::device_metrics(q).upload(sizeof(T) * size);
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            event e(q.enqueue_write_buffer_async(
+                        buffer, sizeof(T) * offset, sizeof(T) * size, host));
+
+            if (trace)
+                detail::trace("write", "write", q, begin, e, sizeof(T) * size);
+
+            return e;
+        }
+
+        /// Enqueues copy from the device to host memory.
+        /**
+         * The host memory receives the data when the returned event
+         * completes.
+         */
+        event read_async(boost::compute::command_queue q, size_t offset,
+                size_t size, T *host) const
+        {
+            if (!size) return event();
+
+            detail::device_metrics(q).download(sizeof(T) * size);
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            event e(q.enqueue_read_buffer_async(
+                        buffer, sizeof(T) * offset, sizeof(T) * size, host));
+
+            if (trace)
+                detail::trace("read", "read", q, begin, e, sizeof(T) * size);
+
+            return e;
+        }
+
+        /// Enqueues copy to another device vector.
+        /**
+         * Both vectors should belong to the context of the queue (see
+         * can_copy_peer()).
+         */
+        event copy_async(boost::compute::command_queue q, size_t offset,
+                size_t size, const device_vector &dst, size_t dst_offset) const
+        {
+            if (!size) return event();
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            event e(q.enqueue_copy_buffer(buffer, dst.buffer,
+                        sizeof(T) * offset, sizeof(T) * dst_offset, sizeof(T) * size));
+
+            if (trace)
+                detail::trace("copy", "copy", q, begin, e, sizeof(T) * size);
+
+            return e;
         }
 
         size_t size() const {
@@ -142,6 +269,60 @@ class device_vector {
         boost::compute::buffer buffer;
 };
 
+/// Checks if device_vector::copy_async() may copy between the queues.
+/** Buffers may only be copied directly within the same context. */
+inline bool can_copy_peer(const command_queue &src, const command_queue &dst) {
+    return src.get_context() == dst.get_context();
+}
+
+/// Page-locked host memory for asynchronous transfers.
+/**
+ * The memory is allocated by the OpenCL implementation and stays mapped
+ * for the lifetime of the buffer.
+ */
+template <typename T>
+class pinned_buffer {
+    public:
+        pinned_buffer() : n(0) {}
+
+        pinned_buffer(command_queue q, size_t n) : n(n) {
+            if (!n) return;
+
+            boost::compute::buffer buf(q.get_context(), n * sizeof(T),
+                    CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR);
+
+            ptr.reset(
+                    static_cast<T*>(q.enqueue_map_buffer(buf,
+                            CL_MAP_READ | CL_MAP_WRITE, 0, n * sizeof(T))),
+                    unmapper(q, buf));
+        }
+
+        /// Pointer to the host memory.
+        T* data() const {
+            return ptr.get();
+        }
+
+        /// Size of the buffer in elements.
+        size_t size() const {
+            return n;
+        }
+    private:
+        struct unmapper {
+            command_queue          queue;
+            boost::compute::buffer buffer;
+
+            unmapper(const command_queue &q, const boost::compute::buffer &b)
+                : queue(q), buffer(b) {}
+
+            void operator()(T *p) {
+                queue.enqueue_unmap_buffer(buffer, p);
+            }
+        };
+
+        size_t n;
+        std::shared_ptr<T> ptr;
+};
+
 } // namespace compute
 } // namespace backend
 } // namespace vex
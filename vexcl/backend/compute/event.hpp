@@ -0,0 +1,210 @@
+#ifndef VEXCL_BACKEND_COMPUTE_EVENT_HPP
+#define VEXCL_BACKEND_COMPUTE_EVENT_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/backend/compute/event.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Boost.Compute events with profiling information.
+ */
+
+#include <string>
+#include <vector>
+
+#include <boost/compute/event.hpp>
+#include <boost/compute/command_queue.hpp>
+#include <vexcl/detail/trace.hpp>
+#include <vexcl/detail/kernel_observer.hpp>
+#include <vexcl/backend/compute/context.hpp>
+
+namespace vex {
+namespace backend {
+namespace compute {
+
+/// Device-side interval of time spanned by one or more enqueued commands.
+/**
+ * Timings are only available for queues created with
+ * CL_QUEUE_PROFILING_ENABLE property.
+ */
+class event {
+    public:
+        event() {}
+
+        /// Wraps Boost.Compute event.
+        event(const boost::compute::event &e) : first(e), last(e) {}
+
+        /// Interval from the start of the first event to the end of the last one.
+        event(const event &first, const event &last)
+            : first(first.first), last(last.last) {}
+
+        /// Enqueues a marker that completes after all previously enqueued commands.
+        static event marker(command_queue q) {
+            return event(q.enqueue_marker());
+        }
+
+        /// Blocks until the commands complete.
+        void wait() const {
+            last.wait();
+        }
+
+        /// Checks without blocking if the commands completed.
+        bool ready() const {
+            return last.status() <= CL_COMPLETE;
+        }
+
+        /// Checks if the event refers to no commands.
+        bool empty() const {
+            return last.get() == 0;
+        }
+
+        /// Time in seconds the commands spent executing on the device.
+        double duration() const {
+            wait();
+            return 1e-9 * (time(last, CL_PROFILING_COMMAND_END) - time(first, CL_PROFILING_COMMAND_START));
+        }
+
+        /// Time in seconds the first command spent waiting in the queue.
+        double queue_wait() const {
+            wait();
+            return 1e-9 * (time(first, CL_PROFILING_COMMAND_START) - time(first, CL_PROFILING_COMMAND_QUEUED));
+        }
+
+        /// Time in seconds between completion of the given event and of this one.
+        double since(const event &e) const {
+            wait();
+            e.wait();
+            return 1e-9 * (
+                    static_cast<double>(time(last, CL_PROFILING_COMMAND_END)) -
+                    static_cast<double>(time(e.last, CL_PROFILING_COMMAND_END)));
+        }
+
+        /// Returns raw Boost.Compute event.
+        const boost::compute::event& raw() const {
+            return last;
+        }
+    private:
+        boost::compute::event first, last;
+
+        static cl_ulong time(const boost::compute::event &e, cl_profiling_info info) {
+            return e.get_profiling_info<cl_ulong>(info);
+        }
+};
+
+/// Makes commands enqueued later into the queue wait for the events.
+/**
+ * Empty events are skipped. Queues of the events are flushed, so that the
+ * commands are submitted before the queue starts waiting for them. Events
+ * from a different context can not be waited for by the device, so the
+ * host blocks until they complete. The host also waits when OpenCL 1.2 is
+ * not available.
+ */
+inline void enqueue_barrier(command_queue q, const std::vector<event> &wait) {
+    boost::compute::wait_list list;
+
+    for(auto e = wait.begin(); e != wait.end(); ++e) {
+        if (e->empty()) continue;
+
+#ifdef BOOST_COMPUTE_CL_VERSION_1_2
+        if (e->raw().get_info<cl_context>(CL_EVENT_CONTEXT) == q.get_context().get()) {
+            cl_command_queue eq = e->raw().get_info<cl_command_queue>(CL_EVENT_COMMAND_QUEUE);
+            if (eq && eq != q.get()) clFlush(eq);
+
+            list.insert(e->raw());
+            continue;
+        }
+#endif
+        e->wait();
+    }
+
+#ifdef BOOST_COMPUTE_CL_VERSION_1_2
+    if (list.size()) q.enqueue_barrier(list);
+#endif
+}
+
+/// Makes commands enqueued later into the queue wait for the event.
+inline void enqueue_barrier(command_queue q, const event &e) {
+    enqueue_barrier(q, std::vector<event>(1, e));
+}
+
+/// Checks if timings of the events are available for the queue.
+inline bool profiling_enabled(const command_queue &q) {
+    return (q.get_properties() & CL_QUEUE_PROFILING_ENABLE) != 0;
+}
+
+/// Command queue properties that enable timing of the events.
+const command_queue_properties profiling_queue = CL_QUEUE_PROFILING_ENABLE;
+
+/// Estimated amount of work done by a kernel launch.
+typedef vex::detail::kernel_work kernel_work;
+
+/// Observer of kernel launches.
+typedef vex::detail::kernel_observer<command_queue, event>::type kernel_observer_type;
+
+/// Returns observer of kernel launches made by the calling thread.
+inline kernel_observer_type& kernel_observer() {
+    return vex::detail::kernel_observer<command_queue, event>::get();
+}
+
+/// \cond INTERNAL
+namespace detail {
+
+inline const void* queue_id(const command_queue &q) {
+    return q.get();
+}
+
+// Device timestamps are related to the host trace clock through a marker
+// enqueued into an idle queue when the trace is started.
+inline void trace_start(const command_queue &q) {
+    if (!profiling_enabled(q)) return;
+
+    command_queue(q).finish();
+    vex::detail::trace::device_clock<event>::start(queue_id(q), event::marker(q));
+}
+
+// Records the command spanning the given event.
+inline void trace(const char *category, const std::string &name,
+        const command_queue &q, double begin, const event &e,
+        size_t bytes = 0, size_t hash = 0)
+{
+    vex::detail::trace::device_clock<event>::log(category, name, queue_id(q),
+            begin, e, profiling_enabled(q), bytes, hash);
+}
+
+} // namespace detail
+/// \endcond
+
+/// Blocks until all commands in the queue complete.
+/** The wait is recorded by vex::trace. */
+inline void finish(const command_queue &q) {
+    vex::detail::trace::scope trace("finish", "finish", detail::queue_id(q));
+    command_queue(q).finish();
+}
+
+} // namespace compute
+} // namespace backend
+} // namespace vex
+
+#endif
@@ -36,6 +36,7 @@ THE SOFTWARE.
 #include <boost/compute/core.hpp>
 #include <boost/compute/memory/local_buffer.hpp>
 #include <vexcl/backend/compute/compiler.hpp>
+#include <vexcl/backend/compute/event.hpp>
 
 namespace vex {
 namespace backend {
@@ -46,7 +47,7 @@ namespace compute {
 /// An abstraction over OpenCL compute kernel.
 class kernel {
     public:
-        kernel() : argpos(0), w_size(0), g_size(0) {}
+        kernel() : argpos(0), hash(0), w_size(0), g_size(0) {}
 
         /// Constructor. Creates a cl::Kernel instance from source.
         kernel(const boost::compute::command_queue &queue,
@@ -55,7 +56,8 @@ class kernel {
                size_t smem_per_thread = 0,
                const std::string &options = ""
                )
-            : argpos(0), K(build_sources(queue, src, options), name)
+            : argpos(0), K(build_sources(queue, src, options), name),
+              hash(std::hash<std::string>()(src))
         {
             config(queue,
                     [smem_per_thread](size_t wgs){ return wgs * smem_per_thread; });
@@ -67,7 +69,8 @@ class kernel {
                std::function<size_t(size_t)> smem,
                const std::string &options = ""
                )
-            : argpos(0), K(build_sources(queue, src, options), name)
+            : argpos(0), K(build_sources(queue, src, options), name),
+              hash(std::hash<std::string>()(src))
         {
             config(queue, smem);
         }
@@ -101,10 +104,32 @@ class kernel {
                     );
         }
 
+        /// Sets estimated amount of work done by the next launch.
+        /**
+         * The estimate is passed to the kernel observer (see vex::profiler)
+         * and is reset after the launch.
+         */
+        void set_work(double bytes, double flops = 0) {
+            work = kernel_work(bytes, flops);
+        }
+
         /// Enqueue the kernel to the specified command queue.
         void operator()(boost::compute::command_queue q) {
-            q.enqueue_nd_range_kernel(K, 3, NULL, g_size.dim, w_size.dim);
+            kernel_observer_type &observer = kernel_observer();
+            bool trace = vex::detail::trace::enabled();
+
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            boost::compute::event e = q.enqueue_nd_range_kernel(K, 3, NULL, g_size.dim, w_size.dim);
+
+            if (observer) observer(name(), hash, q, event(e), work);
+            if (trace) detail::trace("kernel", name(), q, begin, event(e),
+                    static_cast<size_t>(work.bytes), hash);
+
+            ++vex::detail::launch_counter::get();
+
             argpos = 0;
+            work   = kernel_work();
         }
 
 #ifndef BOOST_NO_VARIADIC_TEMPLATES
@@ -133,6 +158,11 @@ class kernel {
             return K.get_work_group_info<size_t>(q.get_device(), CL_KERNEL_WORK_GROUP_SIZE);
         }
 
+        /// The number of threads the device executes together (warp or wavefront width).
+        size_t preferred_work_group_size_multiple(const boost::compute::command_queue &q) const {
+            return K.get_work_group_info<size_t>(q.get_device(), CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE);
+        }
+
         /// The size in bytes of shared memory per block available for this kernel.
         size_t max_shared_memory_per_block(const boost::compute::command_queue &q) const {
             boost::compute::device d = q.get_device();
@@ -180,10 +210,22 @@ class kernel {
         size_t preferred_work_group_size_multiple(const boost::compute::command_queue &q) const {
             return K.get_work_group_info<size_t>(q.get_device(), CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE);
         }
+
+        /// Name of the kernel.
+        std::string name() const {
+            return K.name();
+        }
+
+        /// Hash of the kernel source.
+        size_t source_hash() const {
+            return hash;
+        }
     private:
         unsigned argpos;
 
         boost::compute::kernel K;
+        size_t hash;
+        kernel_work work;
 
         backend::ndrange w_size;
         backend::ndrange g_size;
@@ -43,6 +43,7 @@ THE SOFTWARE.
 #include <vexcl/backend/cuda/device_vector.hpp>
 #include <vexcl/backend/cuda/source.hpp>
 #include <vexcl/backend/cuda/compiler.hpp>
+#include <vexcl/backend/cuda/event.hpp>
 #include <vexcl/backend/cuda/kernel.hpp>
 
 #endif
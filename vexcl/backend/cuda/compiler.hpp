@@ -36,6 +36,8 @@ THE SOFTWARE.
 
 #include <vexcl/backend/common.hpp>
 #include <vexcl/detail/backtrace.hpp>
+#include <vexcl/detail/trace.hpp>
+#include <vexcl/backend/cuda/context.hpp>
 
 namespace vex {
 namespace backend {
@@ -61,6 +63,9 @@ inline CUmodule build_sources(
 #  endif
 #endif
 
+    vex::detail::trace::scope trace("build", "build", queue.raw(), 0,
+            std::hash<std::string>()(source));
+
     queue.context().set_current();
 
     auto cc = queue.device().compute_capability();
@@ -80,7 +85,13 @@ inline CUmodule build_sources(
     std::string basename = program_binaries_path(hash, true) + "kernel";
     std::string ptxfile  = basename + ".ptx";
 
-    if ( !boost::filesystem::exists(ptxfile) ) {
+    vex::detail::metrics::device &metrics = detail::device_metrics(queue);
+
+    if ( boost::filesystem::exists(ptxfile) ) {
+        vex::detail::metrics::device::inc(metrics.binary_cache_hits);
+    } else {
+        vex::detail::metrics::device::inc(metrics.compiles);
+
         std::string cufile = basename + ".cu";
 
         {
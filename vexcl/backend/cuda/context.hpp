@@ -38,6 +38,8 @@ THE SOFTWARE.
 
 #include <cuda.h>
 
+#include <vexcl/detail/metrics.hpp>
+
 namespace vex {
 namespace backend {
 
@@ -254,6 +256,17 @@ inline device_id get_device_id(const command_queue &q) {
     return q.device().raw();
 }
 
+/// \cond INTERNAL
+namespace detail {
+
+// Runtime counters of the device associated with the queue.
+inline vex::detail::metrics::device& device_metrics(const command_queue &q) {
+    return vex::detail::metrics::get(static_cast<std::uintptr_t>(get_device_id(q)));
+}
+
+} // namespace detail
+/// \endcond
+
 /// Launch grid size.
 struct ndrange {
     size_t x, y, z;
@@ -302,6 +315,11 @@ inline bool is_cpu(const command_queue&) {
     return false;
 }
 
+/// The size in bytes of shared memory per block on the device.
+inline size_t max_shared_memory_per_block(const command_queue &q) {
+    return q.device().max_shared_memory_per_block();
+}
+
 /// Select devices by given criteria.
 /**
  * \param filter  Device filter functor. Functors may be combined with logical
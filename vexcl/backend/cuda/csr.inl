@@ -40,71 +40,24 @@ struct SpMatCSR : public sparse_matrix {
             const idx_t *row_begin, const idx_t *row_end,
             const col_t *col, const val_t *val,
             col_t col_begin, col_t col_end,
-            std::set<col_t> ghost_cols
+            const std::vector<col_t> &ghost_cols
             ) : queue(queue)
     {
-        auto is_local = [col_begin, col_end](col_t c) {
-            return c >= col_begin && c < col_end;
-        };
-
-        if (ghost_cols.empty()) {
+        if (ghost_cols.empty() && col_begin == 0) {
             loc.reset(new backend::cuda::spmat_crs<val_t>(queue,
                         static_cast<int>(row_end - row_begin),
                         static_cast<int>(col_end - col_begin),
                         row_begin, col, val
                         ));
         } else {
-            std::vector<idx_t> lrow;
-            std::vector<col_t> lcol;
-            std::vector<val_t> lval;
-
-            std::vector<idx_t> rrow;
-            std::vector<col_t> rcol;
-            std::vector<val_t> rval;
-
-            lrow.reserve(row_end - row_begin + 1);
-            lrow.push_back(0);
-
-            lcol.reserve(*row_end - *row_begin);
-            lval.reserve(*row_end - *row_begin);
-
-            if (!ghost_cols.empty()) {
-                rrow.reserve(row_end - row_begin + 1);
-                rrow.push_back(0);
-
-                rcol.reserve(*row_end - *row_begin);
-                rval.reserve(*row_end - *row_begin);
-            }
-
-            // Renumber columns.
-            std::unordered_map<col_t, col_t> r2l(2 * ghost_cols.size());
-            size_t nghost = 0;
-            for(auto c = ghost_cols.begin(); c != ghost_cols.end(); ++c)
-                r2l[*c] = static_cast<col_t>(nghost++);
-
-            for(auto row = row_begin; row != row_end; ++row) {
-                for(idx_t j = row[0]; j < row[1]; j++) {
-                    if (is_local(col[j])) {
-                        lcol.push_back(static_cast<col_t>(col[j] - col_begin));
-                        lval.push_back(val[j]);
-                    } else {
-                        assert(r2l.count(col[j]));
-                        rcol.push_back(r2l[col[j]]);
-                        rval.push_back(val[j]);
-                    }
-                }
-
-                lrow.push_back(static_cast<idx_t>(lcol.size()));
-                rrow.push_back(static_cast<idx_t>(rcol.size()));
-            }
-
+            csr_split A(row_begin, row_end, col, val, col_begin, col_end, ghost_cols);
 
             // Copy local part to the device.
-            if (lrow.back()) {
+            if (A.lrow.back()) {
                 loc.reset(new backend::cuda::spmat_crs<val_t>(queue,
                         static_cast<int>(row_end - row_begin),
                         static_cast<int>(col_end - col_begin),
-                        lrow.data(), lcol.data(), lval.data()
+                        A.lrow.data(), A.lcol.data(), A.lval.data()
                         ));
             }
 
@@ -112,8 +65,8 @@ struct SpMatCSR : public sparse_matrix {
             if (!ghost_cols.empty()) {
                 rem.reset(new backend::cuda::spmat_crs<val_t>(queue,
                             static_cast<int>(row_end - row_begin),
-                            static_cast<int>(nghost),
-                            rrow.data(), rcol.data(), rval.data()
+                            static_cast<int>(ghost_cols.size()),
+                            A.rrow.data(), A.rcol.data(), A.rval.data()
                             ));
             }
         }
@@ -34,6 +34,8 @@ THE SOFTWARE.
 #include <cuda.h>
 
 #include <vexcl/backend/cuda/context.hpp>
+#include <vexcl/backend/cuda/event.hpp>
+#include <vexcl/detail/trace.hpp>
 
 namespace vex {
 namespace backend {
@@ -60,6 +62,24 @@ struct deleter_impl<char*> {
     }
 };
 
+// Frees device memory and accounts for it in the device metrics.
+struct buffer_deleter {
+    buffer_deleter(CUcontext ctx, vex::detail::metrics::device &dev, size_t bytes)
+        : base(ctx), dev(&dev), bytes(bytes)
+    {
+        dev.allocate(bytes);
+    }
+
+    void operator()(char *ptr) const {
+        dev->release(bytes);
+        base(ptr);
+    }
+
+    deleter base;
+    vex::detail::metrics::device *dev;
+    size_t bytes;
+};
+
 } // namespace detail
 /// \endcond
 
@@ -83,7 +103,8 @@ class device_vector {
                 CUdeviceptr ptr;
                 cuda_check( cuMemAlloc(&ptr, n * sizeof(T)) );
 
-                buffer.reset(reinterpret_cast<char*>(static_cast<size_t>(ptr)), detail::deleter(q.context().raw()) );
+                buffer.reset(reinterpret_cast<char*>(static_cast<size_t>(ptr)),
+                        detail::buffer_deleter(q.context().raw(), detail::device_metrics(q), n * sizeof(T)) );
             }
         }
 
@@ -99,7 +120,8 @@ class device_vector {
                 CUdeviceptr ptr;
                 cuda_check( cuMemAlloc(&ptr, n * sizeof(T)) );
 
-                buffer.reset(reinterpret_cast<char*>(static_cast<size_t>(ptr)), detail::deleter(q.context().raw()) );
+                buffer.reset(reinterpret_cast<char*>(static_cast<size_t>(ptr)),
+                        detail::buffer_deleter(q.context().raw(), detail::device_metrics(q), n * sizeof(T)) );
 
                 if (host) {
                     if (std::is_same<T, H>::value)
@@ -116,25 +138,86 @@ class device_vector {
         }
 
         /// Copies data from host memory to device.
-        void write(const command_queue&, size_t offset, size_t size, const T *host,
+        void write(const command_queue &q, size_t offset, size_t size, const T *host,
                 bool /*blocking*/ = false) const
         {
             if (size) {
+                vex::detail::trace::scope trace("write", "write", q.raw(), size * sizeof(T));
+                detail::device_metrics(q).upload(size * sizeof(T));
+
                 ctx.set_current();
                 cuda_check( cuMemcpyHtoD(raw() + offset * sizeof(T), host, size * sizeof(T)) );
             }
         }
 
         /// Copies data from device to host memory.
-        void read(const command_queue&, size_t offset, size_t size, T *host,
+        void read(const command_queue &q, size_t offset, size_t size, T *host,
                 bool /*blocking*/ = false) const
         {
             if (size) {
+                vex::detail::trace::scope trace("read", "read", q.raw(), size * sizeof(T));
+                detail::device_metrics(q).download(size * sizeof(T));
+
                 ctx.set_current();
                 cuda_check( cuMemcpyDtoH(host, raw() + offset * sizeof(T), size * sizeof(T)) );
             }
         }
 
+        /// Enqueues copy from host memory to the device.
+        /**
+         * The host memory should stay untouched until the returned event
+         * completes. The copy is only asynchronous for page-locked memory
+         * (see pinned_buffer).
+         */
+        event write_async(const command_queue &q, size_t offset, size_t size,
+                const T *host) const
+        {
+            if (!size) return event();
+
+            detail::device_metrics(q).upload(size * sizeof(T));
+
+            return transfer("write", q, size, [&]() {
+                    cuda_check( cuMemcpyHtoDAsync(raw() + offset * sizeof(T), host,
+                                size * sizeof(T), q.raw()) );
+                    });
+        }
+
+        /// Enqueues copy from the device to host memory.
+        /**
+         * The host memory receives the data when the returned event
+         * completes. The copy is only asynchronous for page-locked memory
+         * (see pinned_buffer).
+         */
+        event read_async(const command_queue &q, size_t offset, size_t size,
+                T *host) const
+        {
+            if (!size) return event();
+
+            detail::device_metrics(q).download(size * sizeof(T));
+
+            return transfer("read", q, size, [&]() {
+                    cuda_check( cuMemcpyDtoHAsync(host, raw() + offset * sizeof(T),
+                                size * sizeof(T), q.raw()) );
+                    });
+        }
+
+        /// Enqueues copy to another device vector.
+        /**
+         * The vectors may reside on different devices (see can_copy_peer()).
+         */
+        event copy_async(const command_queue &q, size_t offset, size_t size,
+                const device_vector &dst, size_t dst_offset) const
+        {
+            if (!size) return event();
+
+            return transfer("copy", q, size, [&]() {
+                    cuda_check( cuMemcpyPeerAsync(
+                                dst.raw() + dst_offset * sizeof(T), dst.ctx.raw(),
+                                raw() + offset * sizeof(T), ctx.raw(),
+                                size * sizeof(T), q.raw()) );
+                    });
+        }
+
         /// Returns size (in elements) of the memory buffer.
         size_t size() const {
             return n;
@@ -191,6 +274,83 @@ class device_vector {
         context ctx;
         size_t n;
         std::shared_ptr<char> buffer;
+
+        // Enqueues the copy into the queue and returns its event.
+        template <class Copy>
+        static event transfer(const char *name, const command_queue &q,
+                size_t size, Copy copy)
+        {
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            event start;
+            if (trace) start = event::marker(q);
+
+            q.context().set_current();
+            copy();
+
+            event e = event::marker(q);
+
+            if (trace)
+                detail::trace(name, name, q, begin, event(start, e), size * sizeof(T));
+
+            return e;
+        }
+};
+
+/// Checks if device_vector::copy_async() may copy between the queues.
+/**
+ * Copies within a context, or between devices with peer access, do not go
+ * through host memory.
+ */
+inline bool can_copy_peer(const command_queue &src, const command_queue &dst) {
+    if (src.context().raw() == dst.context().raw()) return true;
+
+    int can_access;
+    cuda_check( cuDeviceCanAccessPeer(&can_access, dst.device().raw(), src.device().raw()) );
+    return can_access != 0;
+}
+
+/// Page-locked host memory for asynchronous transfers.
+/** The memory is accessible from all CUDA contexts. */
+template <typename T>
+class pinned_buffer {
+    public:
+        pinned_buffer() : n(0) {}
+
+        pinned_buffer(const command_queue &q, size_t n) : n(n) {
+            if (!n) return;
+
+            q.context().set_current();
+
+            void *p;
+            cuda_check( cuMemHostAlloc(&p, n * sizeof(T), CU_MEMHOSTALLOC_PORTABLE) );
+            ptr.reset(static_cast<T*>(p), host_deleter(q.context().raw()));
+        }
+
+        /// Pointer to the host memory.
+        T* data() const {
+            return ptr.get();
+        }
+
+        /// Size of the buffer in elements.
+        size_t size() const {
+            return n;
+        }
+    private:
+        struct host_deleter {
+            CUcontext ctx;
+
+            host_deleter(CUcontext ctx) : ctx(ctx) {}
+
+            void operator()(T *p) const {
+                cuda_check( cuCtxSetCurrent(ctx) );
+                cuda_check( cuMemFreeHost(p) );
+            }
+        };
+
+        size_t n;
+        std::shared_ptr<T> ptr;
 };
 
 } // namespace cuda
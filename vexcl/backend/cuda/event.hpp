@@ -0,0 +1,220 @@
+#ifndef VEXCL_BACKEND_CUDA_EVENT_HPP
+#define VEXCL_BACKEND_CUDA_EVENT_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/backend/cuda/event.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  CUDA events with timing information.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+#include <cuda.h>
+
+#include <vexcl/detail/trace.hpp>
+#include <vexcl/detail/kernel_observer.hpp>
+#include <vexcl/backend/cuda/error.hpp>
+#include <vexcl/backend/cuda/context.hpp>
+
+namespace vex {
+namespace backend {
+namespace cuda {
+
+/// \cond INTERNAL
+namespace detail {
+
+template <>
+struct deleter_impl<CUevent> {
+    static void dispose(CUevent e) {
+        cuda_check( cuEventDestroy(e) );
+    }
+};
+
+} // namespace detail
+/// \endcond
+
+/// Device-side interval of time spanned by one or more enqueued commands.
+/**
+ * CUDA events only record the moment the stream reaches them, so the
+ * interval is delimited by a pair of events, and the time spent by commands
+ * waiting in the stream is not available.
+ */
+class event {
+    public:
+        event() {}
+
+        /// Interval from the start of the first event to the end of the last one.
+        event(const event &first, const event &last)
+            : first(first.first), last(last.last) {}
+
+        /// Records an event that completes after all previously enqueued commands.
+        static event marker(const command_queue &q) {
+            event e;
+            e.first = e.last = record(q);
+            return e;
+        }
+
+        /// Blocks until the commands complete.
+        void wait() const {
+            cuda_check( cuEventSynchronize(last.get()) );
+        }
+
+        /// Checks without blocking if the commands completed.
+        bool ready() const {
+            CUresult rc = cuEventQuery(last.get());
+            if (rc == CUDA_ERROR_NOT_READY) return false;
+            cuda_check(rc);
+            return true;
+        }
+
+        /// Checks if the event refers to no commands.
+        bool empty() const {
+            return !last;
+        }
+
+        /// Time in seconds the commands spent executing on the device.
+        double duration() const {
+            return elapsed(first, last);
+        }
+
+        /// Time in seconds the first command spent waiting in the queue.
+        /** Not available for CUDA, always returns zero. */
+        double queue_wait() const {
+            return 0;
+        }
+
+        /// Time in seconds between completion of the given event and of this one.
+        double since(const event &e) const {
+            return elapsed(e.last, last);
+        }
+
+        /// Returns raw CUevent handle of the end of the interval.
+        CUevent raw() const {
+            return last.get();
+        }
+    private:
+        typedef std::shared_ptr<std::remove_pointer<CUevent>::type> handle;
+
+        handle first, last;
+
+        static handle record(const command_queue &q) {
+            q.context().set_current();
+
+            CUevent e;
+            cuda_check( cuEventCreate(&e, CU_EVENT_DEFAULT) );
+            cuda_check( cuEventRecord(e, q.raw()) );
+
+            return handle(e, detail::deleter(q.context().raw()));
+        }
+
+        static double elapsed(const handle &a, const handle &b) {
+            cuda_check( cuEventSynchronize(b.get()) );
+
+            float ms;
+            cuda_check( cuEventElapsedTime(&ms, a.get(), b.get()) );
+            return 1e-3 * ms;
+        }
+};
+
+/// Makes commands enqueued later into the queue wait for the events.
+/** Empty events are skipped. The events may come from other contexts. */
+inline void enqueue_barrier(const command_queue &q, const std::vector<event> &wait) {
+    q.context().set_current();
+
+    for(auto e = wait.begin(); e != wait.end(); ++e)
+        if (!e->empty()) cuda_check( cuStreamWaitEvent(q.raw(), e->raw(), 0) );
+}
+
+/// Makes commands enqueued later into the queue wait for the event.
+inline void enqueue_barrier(const command_queue &q, const event &e) {
+    enqueue_barrier(q, std::vector<event>(1, e));
+}
+
+/// Checks if timings of the events are available for the queue.
+/** CUDA events always carry timing information. */
+inline bool profiling_enabled(const command_queue&) {
+    return true;
+}
+
+/// Command queue properties that enable timing of the events.
+/** CUDA streams need no special properties for that. */
+const command_queue_properties profiling_queue = 0;
+
+/// Estimated amount of work done by a kernel launch.
+typedef vex::detail::kernel_work kernel_work;
+
+/// Observer of kernel launches.
+typedef vex::detail::kernel_observer<command_queue, event>::type kernel_observer_type;
+
+/// Returns observer of kernel launches made by the calling thread.
+inline kernel_observer_type& kernel_observer() {
+    return vex::detail::kernel_observer<command_queue, event>::get();
+}
+
+/// \cond INTERNAL
+namespace detail {
+
+inline const void* queue_id(const command_queue &q) {
+    return q.raw();
+}
+
+// Device timestamps are related to the host trace clock through a marker
+// enqueued into an idle queue when the trace is started.
+inline void trace_start(const command_queue &q) {
+    if (!profiling_enabled(q)) return;
+
+    q.finish();
+    vex::detail::trace::device_clock<event>::start(queue_id(q), event::marker(q));
+}
+
+// Records the command spanning the given event.
+inline void trace(const char *category, const std::string &name,
+        const command_queue &q, double begin, const event &e,
+        size_t bytes = 0, size_t hash = 0)
+{
+    vex::detail::trace::device_clock<event>::log(category, name, queue_id(q),
+            begin, e, profiling_enabled(q), bytes, hash);
+}
+
+} // namespace detail
+/// \endcond
+
+/// Blocks until all commands in the queue complete.
+/** The wait is recorded by vex::trace. */
+inline void finish(const command_queue &q) {
+    vex::detail::trace::scope trace("finish", "finish", detail::queue_id(q));
+    q.finish();
+}
+
+} // namespace cuda
+} // namespace backend
+} // namespace vex
+
+#endif
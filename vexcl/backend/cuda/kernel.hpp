@@ -36,6 +36,7 @@ THE SOFTWARE.
 #include <cuda.h>
 
 #include <vexcl/backend/cuda/compiler.hpp>
+#include <vexcl/backend/cuda/event.hpp>
 
 namespace vex {
 namespace backend {
@@ -46,7 +47,7 @@ namespace cuda {
 /// An abstraction over CUDA compute kernel.
 class kernel {
     public:
-        kernel() : w_size(0), g_size(0), smem(0) {}
+        kernel() : hash(0), w_size(0), g_size(0), smem(0) {}
 
         /// Constructor. Creates a cl::Kernel instance from source.
         kernel(const command_queue &queue,
@@ -57,7 +58,7 @@ class kernel {
                )
             : ctx(queue.context()),
               module(build_sources(queue, src, options), detail::deleter(queue.context().raw())),
-              smem(0)
+              kname(name), hash(std::hash<std::string>()(src)), smem(0)
         {
             cuda_check( cuModuleGetFunction(&K, module.get(), name.c_str()) );
 
@@ -73,7 +74,7 @@ class kernel {
                )
             : ctx(queue.context()),
               module(build_sources(queue, src, options), detail::deleter(queue.context().raw())),
-              smem(0)
+              kname(name), hash(std::hash<std::string>()(src)), smem(0)
         {
             cuda_check( cuModuleGetFunction(&K, module.get(), name.c_str()) );
             config(queue, smem);
@@ -99,8 +100,25 @@ class kernel {
             smem = f(workgroup_size());
         }
 
+        /// Sets estimated amount of work done by the next launch.
+        /**
+         * The estimate is passed to the kernel observer (see vex::profiler)
+         * and is reset after the launch.
+         */
+        void set_work(double bytes, double flops = 0) {
+            work = kernel_work(bytes, flops);
+        }
+
         /// Enqueue the kernel to the specified command queue.
         void operator()(const command_queue &q) {
+            kernel_observer_type &observer = kernel_observer();
+            bool trace = vex::detail::trace::enabled();
+
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            event start;
+            if (observer || trace) start = event::marker(q);
+
             prm_addr.clear();
             for(auto p = prm_pos.begin(); p != prm_pos.end(); ++p)
                 prm_addr.push_back(stack.data() + *p);
@@ -117,8 +135,19 @@ class kernel {
                         )
                     );
 
+            if (observer || trace) {
+                event e(start, event::marker(q));
+
+                if (observer) observer(kname, hash, q, e, work);
+                if (trace) detail::trace("kernel", kname, q, begin, e,
+                        static_cast<size_t>(work.bytes), hash);
+            }
+
+            ++vex::detail::launch_counter::get();
+
             stack.clear();
             prm_pos.clear();
+            work = kernel_work();
         }
 
 #ifndef BOOST_NO_VARIADIC_TEMPLATES
@@ -148,6 +177,11 @@ class kernel {
             return n;
         }
 
+        /// The number of threads the device executes together (warp width).
+        size_t preferred_work_group_size_multiple(const command_queue &q) const {
+            return q.device().warp_size();
+        }
+
         /// The size in bytes of shared memory per block available for this kernel.
         size_t max_shared_memory_per_block(const command_queue &q) const {
             return q.device().max_shared_memory_per_block() -
@@ -183,10 +217,23 @@ class kernel {
         size_t preferred_work_group_size_multiple(const backend::command_queue &q) const {
             return q.device().warp_size();
         }
+
+        /// Name of the kernel.
+        const std::string& name() const {
+            return kname;
+        }
+
+        /// Hash of the kernel source.
+        size_t source_hash() const {
+            return hash;
+        }
     private:
         context ctx;
         std::shared_ptr< std::remove_pointer<CUmodule>::type > module;
         CUfunction K;
+        std::string kname;
+        size_t hash;
+        kernel_work work;
 
         ndrange  w_size;
         ndrange  g_size;
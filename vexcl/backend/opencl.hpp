@@ -49,6 +49,7 @@ THE SOFTWARE.
 #include <vexcl/backend/opencl/device_vector.hpp>
 #include <vexcl/backend/opencl/source.hpp>
 #include <vexcl/backend/opencl/compiler.hpp>
+#include <vexcl/backend/opencl/event.hpp>
 #include <vexcl/backend/opencl/kernel.hpp>
 
 #endif
@@ -37,6 +37,8 @@ THE SOFTWARE.
 
 #include <vexcl/backend/common.hpp>
 #include <vexcl/detail/backtrace.hpp>
+#include <vexcl/detail/trace.hpp>
+#include <vexcl/backend/opencl/context.hpp>
 
 #ifndef __CL_ENABLE_EXCEPTIONS
 #  define __CL_ENABLE_EXCEPTIONS
@@ -127,6 +129,9 @@ inline cl::Program build_sources(
 #  endif
 #endif
 
+    vex::detail::trace::scope trace("build", "build", queue(), 0,
+            std::hash<std::string>()(source));
+
     auto context = queue.getInfo<CL_QUEUE_CONTEXT>();
     auto device  = context.getInfo<CL_CONTEXT_DEVICES>();
 
@@ -159,14 +164,18 @@ inline cl::Program build_sources(
 
     // Try to get cached program binaries:
     try {
-        if (boost::optional<cl::Program> program = load_program_binaries(hash, context, device))
+        if (boost::optional<cl::Program> program = load_program_binaries(hash, context, device)) {
+            vex::detail::metrics::device::inc(detail::device_metrics(queue).binary_cache_hits);
             return *program;
+        }
     } catch (...) {
         // Shit happens.
     }
 #endif
 
     // If cache is not available, just compile the sources.
+    vex::detail::metrics::device::inc(detail::device_metrics(queue).compiles);
+
     cl::Program program(context, cl::Program::Sources(
                 1, std::make_pair(source.c_str(), source.size())
                 ));
@@ -42,6 +42,8 @@ THE SOFTWARE.
 #endif
 #include <CL/cl.hpp>
 
+#include <vexcl/detail/metrics.hpp>
+
 namespace vex {
 namespace backend {
 
@@ -68,6 +70,17 @@ inline device_id get_device_id(const command_queue &q) {
     return q.getInfo<CL_QUEUE_DEVICE>()();
 }
 
+/// \cond INTERNAL
+namespace detail {
+
+// Runtime counters of the device associated with the queue.
+inline vex::detail::metrics::device& device_metrics(const command_queue &q) {
+    return vex::detail::metrics::get(reinterpret_cast<std::uintptr_t>(get_device_id(q)));
+}
+
+} // namespace detail
+/// \endcond
+
 /// \cond INTERNAL
 typedef cl_context       context_id;
 /// Returns raw context id for the given queue.
@@ -114,6 +127,12 @@ inline bool is_cpu(const command_queue &q) {
 #endif
 }
 
+/// The size in bytes of shared (local) memory per block on the device.
+inline size_t max_shared_memory_per_block(const command_queue &q) {
+    cl::Device d = q.getInfo<CL_QUEUE_DEVICE>();
+    return static_cast<size_t>(d.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>());
+}
+
 /// Select devices by given criteria.
 /**
  * \param filter  Device filter functor. Functors may be combined with logical
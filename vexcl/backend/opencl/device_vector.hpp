@@ -31,6 +31,8 @@ THE SOFTWARE.
  * \brief  OpenCL device vector.
  */
 
+#include <memory>
+
 #ifndef __CL_ENABLE_EXCEPTIONS
 #  define __CL_ENABLE_EXCEPTIONS
 #endif
@@ -39,6 +41,8 @@ THE SOFTWARE.
 #endif
 #include <CL/cl.hpp>
 
+#include <vexcl/backend/opencl/event.hpp>
+
 namespace vex {
 namespace backend {
 namespace opencl {
@@ -49,6 +53,36 @@ static const mem_flags MEM_READ_ONLY  = CL_MEM_READ_ONLY;
 static const mem_flags MEM_WRITE_ONLY = CL_MEM_WRITE_ONLY;
 static const mem_flags MEM_READ_WRITE = CL_MEM_READ_WRITE;
 
+/// \cond INTERNAL
+namespace detail {
+
+struct released_memory {
+    vex::detail::metrics::device *dev;
+    size_t bytes;
+};
+
+inline void CL_CALLBACK release_memory(cl_mem, void *data) {
+    released_memory *m = static_cast<released_memory*>(data);
+    m->dev->release(m->bytes);
+    delete m;
+}
+
+// Accounts for the new buffer in the device metrics. The buffer is
+// accounted as released when OpenCL destroys it.
+inline void track_allocation(cl::Memory &buf, vex::detail::metrics::device &dev, size_t bytes) {
+#ifdef CL_VERSION_1_1
+    dev.allocate(bytes);
+    released_memory *m = new released_memory{&dev, bytes};
+    buf.setDestructorCallback(&release_memory, m);
+#else
+    vex::detail::metrics::device::inc(dev.allocations);
+    vex::detail::metrics::device::inc(dev.bytes_allocated, bytes);
+#endif
+}
+
+} // namespace detail
+/// \endcond
+
 template <typename T>
 class device_vector {
     public:
@@ -63,9 +97,14 @@ class device_vector {
             if (host && !(flags & CL_MEM_USE_HOST_PTR))
                 flags |= CL_MEM_COPY_HOST_PTR;
 
-            if (n)
+            if (n) {
                 buffer = cl::Buffer(q.getInfo<CL_QUEUE_CONTEXT>(), flags,
                         n * sizeof(T), static_cast<void*>(const_cast<T*>(host)));
+
+                vex::detail::metrics::device &m = detail::device_metrics(q);
+                detail::track_allocation(buffer, m, n * sizeof(T));
+                if (flags & CL_MEM_COPY_HOST_PTR) m.upload(n * sizeof(T));
+            }
         }
 
         device_vector(cl::Buffer buffer) : buffer( std::move(buffer) ) {}
@@ -73,21 +112,125 @@ class device_vector {
         void write(const cl::CommandQueue &q, size_t offset, size_t size, const T *host,
                 bool blocking = false) const
         {
-            if (size)
+            if (!size) return;
+
+            detail::device_metrics(q).upload(sizeof(T) * size);
+
+            if (vex::detail::trace::enabled()) {
+                double begin = vex::detail::trace::now();
+
+                cl::Event e;
+                q.enqueueWriteBuffer(
+                        buffer, blocking ? CL_TRUE : CL_FALSE,
+                        sizeof(T) * offset, sizeof(T) * size, host, NULL, &e
+                        );
+
+                detail::trace("write", "write", q, begin, event(e), sizeof(T) * size);
+            } else {
                 q.enqueueWriteBuffer(
                         buffer, blocking ? CL_TRUE : CL_FALSE,
                         sizeof(T) * offset, sizeof(T) * size, host
                         );
+            }
         }
 
         void read(const cl::CommandQueue &q, size_t offset, size_t size, T *host,
                 bool blocking = false) const
         {
-            if (size)
+            if (!size) return;
+
+            detail::device_metrics(q).download(sizeof(T) * size);
+
+            if (vex::detail::trace::enabled()) {
+                double begin = vex::detail::trace::now();
+
+                cl::Event e;
+                q.enqueueReadBuffer(
+                        buffer, blocking ? CL_TRUE : CL_FALSE,
+                        sizeof(T) * offset, sizeof(T) * size, host, NULL, &e
+                        );
+
+                detail::trace("read", "read", q, begin, event(e), sizeof(T) * size);
+            } else {
                 q.enqueueReadBuffer(
                         buffer, blocking ? CL_TRUE : CL_FALSE,
                         sizeof(T) * offset, sizeof(T) * size, host
                         );
+            }
+        }
+
+        /// Enqueues copy from host memory to the device.
+        /**
+         * The host memory should stay untouched until the returned event
+         * completes.
+         */
+        event write_async(const cl::CommandQueue &q, size_t offset, size_t size,
+                const T *host) const
+        {
+            if (!size) return event();
+
+            detail::device_metrics(q).upload(sizeof(T) * size);
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            cl::Event e;
+            q.enqueueWriteBuffer(buffer, CL_FALSE,
+                    sizeof(T) * offset, sizeof(T) * size, host, NULL, &e);
+
+            if (trace)
+                detail::trace("write", "write", q, begin, event(e), sizeof(T) * size);
+
+            return event(e);
+        }
+
+        /// Enqueues copy from the device to host memory.
+        /**
+         * The host memory receives the data when the returned event
+         * completes.
+         */
+        event read_async(const cl::CommandQueue &q, size_t offset, size_t size,
+                T *host) const
+        {
+            if (!size) return event();
+
+            detail::device_metrics(q).download(sizeof(T) * size);
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            cl::Event e;
+            q.enqueueReadBuffer(buffer, CL_FALSE,
+                    sizeof(T) * offset, sizeof(T) * size, host, NULL, &e);
+
+            if (trace)
+                detail::trace("read", "read", q, begin, event(e), sizeof(T) * size);
+
+            return event(e);
+        }
+
+        /// Enqueues copy to another device vector.
+        /**
+         * Both vectors should belong to the context of the queue (see
+         * can_copy_peer()).
+         */
+        event copy_async(const cl::CommandQueue &q, size_t offset, size_t size,
+                const device_vector &dst, size_t dst_offset) const
+        {
+            if (!size) return event();
+
+            bool   trace = vex::detail::trace::enabled();
+            double begin = trace ? vex::detail::trace::now() : 0;
+
+            cl::Event e;
+            q.enqueueCopyBuffer(buffer, dst.buffer,
+                    sizeof(T) * offset, sizeof(T) * dst_offset, sizeof(T) * size,
+                    NULL, &e);
+
+            if (trace)
+                detail::trace("copy", "copy", q, begin, event(e), sizeof(T) * size);
+
+            return event(e);
         }
 
         size_t size() const {
@@ -132,6 +275,60 @@ class device_vector {
         cl::Buffer buffer;
 };
 
+/// Checks if device_vector::copy_async() may copy between the queues.
+/** Buffers may only be copied directly within the same context. */
+inline bool can_copy_peer(const command_queue &src, const command_queue &dst) {
+    return src.getInfo<CL_QUEUE_CONTEXT>()() == dst.getInfo<CL_QUEUE_CONTEXT>()();
+}
+
+/// Page-locked host memory for asynchronous transfers.
+/**
+ * The memory is allocated by the OpenCL implementation and stays mapped
+ * for the lifetime of the buffer.
+ */
+template <typename T>
+class pinned_buffer {
+    public:
+        pinned_buffer() : n(0) {}
+
+        pinned_buffer(const command_queue &q, size_t n) : n(n) {
+            if (!n) return;
+
+            cl::Buffer buf(q.getInfo<CL_QUEUE_CONTEXT>(),
+                    CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, n * sizeof(T));
+
+            ptr.reset(
+                    static_cast<T*>(q.enqueueMapBuffer(buf, CL_TRUE,
+                            CL_MAP_READ | CL_MAP_WRITE, 0, n * sizeof(T))),
+                    unmapper(q, buf));
+        }
+
+        /// Pointer to the host memory.
+        T* data() const {
+            return ptr.get();
+        }
+
+        /// Size of the buffer in elements.
+        size_t size() const {
+            return n;
+        }
+    private:
+        struct unmapper {
+            command_queue queue;
+            cl::Buffer    buffer;
+
+            unmapper(const command_queue &q, const cl::Buffer &b)
+                : queue(q), buffer(b) {}
+
+            void operator()(T *p) const {
+                queue.enqueueUnmapMemObject(buffer, p);
+            }
+        };
+
+        size_t n;
+        std::shared_ptr<T> ptr;
+};
+
 } // namespace opencl
 } // namespace backend
 } // namespace vex
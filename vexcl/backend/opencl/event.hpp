@@ -0,0 +1,229 @@
+#ifndef VEXCL_BACKEND_OPENCL_EVENT_HPP
+#define VEXCL_BACKEND_OPENCL_EVENT_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/backend/opencl/event.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  OpenCL events with profiling information.
+ */
+
+#include <string>
+#include <vector>
+
+#ifndef __CL_ENABLE_EXCEPTIONS
+#  define __CL_ENABLE_EXCEPTIONS
+#endif
+#ifndef CL_USE_DEPRECATED_OPENCL_2_0_APIS
+#define CL_USE_DEPRECATED_OPENCL_2_0_APIS
+#endif
+#include <CL/cl.hpp>
+
+#include <vexcl/detail/trace.hpp>
+#include <vexcl/detail/kernel_observer.hpp>
+#include <vexcl/backend/opencl/context.hpp>
+
+namespace vex {
+namespace backend {
+namespace opencl {
+
+/// Device-side interval of time spanned by one or more enqueued commands.
+/**
+ * Timings are only available for queues created with
+ * CL_QUEUE_PROFILING_ENABLE property.
+ */
+class event {
+    public:
+        event() {}
+
+        /// Wraps OpenCL event.
+        event(const cl::Event &e) : first(e), last(e) {}
+
+        /// Interval from the start of the first event to the end of the last one.
+        event(const event &first, const event &last)
+            : first(first.first), last(last.last) {}
+
+        /// Enqueues a marker that completes after all previously enqueued commands.
+        static event marker(const command_queue &q) {
+            // The marker methods of cl::CommandQueue are not const.
+            command_queue queue = q;
+
+            cl::Event e;
+#ifdef CL_VERSION_1_2
+            queue.enqueueMarkerWithWaitList(NULL, &e);
+#else
+            queue.enqueueMarker(&e);
+#endif
+            return event(e);
+        }
+
+        /// Blocks until the commands complete.
+        void wait() const {
+            last.wait();
+        }
+
+        /// Checks without blocking if the commands completed.
+        bool ready() const {
+            return last.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() <= CL_COMPLETE;
+        }
+
+        /// Checks if the event refers to no commands.
+        bool empty() const {
+            return last() == NULL;
+        }
+
+        /// Time in seconds the commands spent executing on the device.
+        double duration() const {
+            wait();
+            return 1e-9 * (time<CL_PROFILING_COMMAND_END>(last) - time<CL_PROFILING_COMMAND_START>(first));
+        }
+
+        /// Time in seconds the first command spent waiting in the queue.
+        double queue_wait() const {
+            wait();
+            return 1e-9 * (time<CL_PROFILING_COMMAND_START>(first) - time<CL_PROFILING_COMMAND_QUEUED>(first));
+        }
+
+        /// Time in seconds between completion of the given event and of this one.
+        double since(const event &e) const {
+            wait();
+            e.wait();
+            return 1e-9 * (
+                    static_cast<double>(time<CL_PROFILING_COMMAND_END>(last)) -
+                    static_cast<double>(time<CL_PROFILING_COMMAND_END>(e.last)));
+        }
+
+        /// Returns raw OpenCL event.
+        const cl::Event& raw() const {
+            return last;
+        }
+    private:
+        cl::Event first, last;
+
+        template <cl_profiling_info info>
+        static cl_ulong time(const cl::Event &e) {
+            return e.getProfilingInfo<info>();
+        }
+};
+
+/// Makes commands enqueued later into the queue wait for the events.
+/**
+ * Empty events are skipped. Queues of the events are flushed, so that the
+ * commands are submitted before the queue starts waiting for them. Events
+ * from a different context can not be waited for by the device, so the
+ * host blocks until they complete.
+ */
+inline void enqueue_barrier(const command_queue &q, const std::vector<event> &wait) {
+    cl_context ctx = q.getInfo<CL_QUEUE_CONTEXT>()();
+
+    std::vector<cl::Event> list;
+    for(auto e = wait.begin(); e != wait.end(); ++e) {
+        if (e->empty()) continue;
+
+        if (e->raw().getInfo<CL_EVENT_CONTEXT>()() == ctx) {
+            command_queue eq = e->raw().getInfo<CL_EVENT_COMMAND_QUEUE>();
+            if (eq() && eq() != q()) eq.flush();
+
+            list.push_back(e->raw());
+        } else {
+            e->wait();
+        }
+    }
+
+    if (list.empty()) return;
+
+    command_queue queue = q;
+#ifdef CL_VERSION_1_2
+    queue.enqueueBarrierWithWaitList(&list);
+#else
+    queue.enqueueWaitForEvents(list);
+#endif
+}
+
+/// Makes commands enqueued later into the queue wait for the event.
+inline void enqueue_barrier(const command_queue &q, const event &e) {
+    enqueue_barrier(q, std::vector<event>(1, e));
+}
+
+/// Checks if timings of the events are available for the queue.
+inline bool profiling_enabled(const command_queue &q) {
+    return (q.getInfo<CL_QUEUE_PROPERTIES>() & CL_QUEUE_PROFILING_ENABLE) != 0;
+}
+
+/// Command queue properties that enable timing of the events.
+const command_queue_properties profiling_queue = CL_QUEUE_PROFILING_ENABLE;
+
+/// Estimated amount of work done by a kernel launch.
+typedef vex::detail::kernel_work kernel_work;
+
+/// Observer of kernel launches.
+typedef vex::detail::kernel_observer<command_queue, event>::type kernel_observer_type;
+
+/// Returns observer of kernel launches made by the calling thread.
+inline kernel_observer_type& kernel_observer() {
+    return vex::detail::kernel_observer<command_queue, event>::get();
+}
+
+/// \cond INTERNAL
+namespace detail {
+
+inline const void* queue_id(const command_queue &q) {
+    return q();
+}
+
+// Device timestamps are related to the host trace clock through a marker
+// enqueued into an idle queue when the trace is started.
+inline void trace_start(const command_queue &q) {
+    if (!profiling_enabled(q)) return;
+
+    q.finish();
+    vex::detail::trace::device_clock<event>::start(queue_id(q), event::marker(q));
+}
+
+// Records the command spanning the given event.
+inline void trace(const char *category, const std::string &name,
+        const command_queue &q, double begin, const event &e,
+        size_t bytes = 0, size_t hash = 0)
+{
+    vex::detail::trace::device_clock<event>::log(category, name, queue_id(q),
+            begin, e, profiling_enabled(q), bytes, hash);
+}
+
+} // namespace detail
+/// \endcond
+
+/// Blocks until all commands in the queue complete.
+/** The wait is recorded by vex::trace. */
+inline void finish(const command_queue &q) {
+    vex::detail::trace::scope trace("finish", "finish", detail::queue_id(q));
+    q.finish();
+}
+
+} // namespace opencl
+} // namespace backend
+} // namespace vex
+
+#endif
@@ -42,6 +42,7 @@ THE SOFTWARE.
 #include <CL/cl.hpp>
 
 #include <vexcl/backend/opencl/compiler.hpp>
+#include <vexcl/backend/opencl/event.hpp>
 
 namespace vex {
 namespace backend {
@@ -52,7 +53,7 @@ namespace opencl {
 /// An abstraction over OpenCL compute kernel.
 class kernel {
     public:
-        kernel() : argpos(0), w_size(0), g_size(0) {}
+        kernel() : argpos(0), hash(0), w_size(0), g_size(0) {}
 
         /// Constructor. Creates a cl::Kernel instance from source.
         kernel(const cl::CommandQueue &queue,
@@ -61,7 +62,8 @@ class kernel {
                size_t smem_per_thread = 0,
                const std::string &options = ""
                )
-            : argpos(0), K(build_sources(queue, src, options), name.c_str())
+            : argpos(0), K(build_sources(queue, src, options), name.c_str()),
+              hash(std::hash<std::string>()(src))
         {
             config(queue,
                     [smem_per_thread](size_t wgs){ return wgs * smem_per_thread; });
@@ -73,7 +75,8 @@ class kernel {
                std::function<size_t(size_t)> smem,
                const std::string &options = ""
                )
-            : argpos(0), K(build_sources(queue, src, options), name.c_str())
+            : argpos(0), K(build_sources(queue, src, options), name.c_str()),
+              hash(std::hash<std::string>()(src))
         {
             config(queue, smem);
         }
@@ -103,10 +106,37 @@ class kernel {
             K.setArg(argpos++, smem);
         }
 
+        /// Sets estimated amount of work done by the next launch.
+        /**
+         * The estimate is passed to the kernel observer (see vex::profiler)
+         * and is reset after the launch.
+         */
+        void set_work(double bytes, double flops = 0) {
+            work = kernel_work(bytes, flops);
+        }
+
         /// Enqueue the kernel to the specified command queue.
         void operator()(const cl::CommandQueue &q) {
-            q.enqueueNDRangeKernel(K, cl::NullRange, g_size, w_size);
+            kernel_observer_type &observer = kernel_observer();
+            bool trace = vex::detail::trace::enabled();
+
+            if (observer || trace) {
+                double begin = trace ? vex::detail::trace::now() : 0;
+
+                cl::Event e;
+                q.enqueueNDRangeKernel(K, cl::NullRange, g_size, w_size, NULL, &e);
+
+                if (observer) observer(name(), hash, q, event(e), work);
+                if (trace) detail::trace("kernel", name(), q, begin, event(e),
+                        static_cast<size_t>(work.bytes), hash);
+            } else {
+                q.enqueueNDRangeKernel(K, cl::NullRange, g_size, w_size);
+            }
+
+            ++vex::detail::launch_counter::get();
+
             argpos = 0;
+            work   = kernel_work();
         }
 
 #ifndef BOOST_NO_VARIADIC_TEMPLATES
@@ -141,6 +171,12 @@ class kernel {
             return K.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(d);
         }
 
+        /// The number of threads the device executes together (warp or wavefront width).
+        size_t preferred_work_group_size_multiple(const cl::CommandQueue &q) const {
+            cl::Device d = q.getInfo<CL_QUEUE_DEVICE>();
+            return K.getWorkGroupInfo<CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE>(d);
+        }
+
         /// The size in bytes of shared memory per block available for this kernel.
         size_t max_shared_memory_per_block(const cl::CommandQueue &q) const {
             cl::Device d = q.getInfo<CL_QUEUE_DEVICE>();
@@ -205,10 +241,22 @@ class kernel {
                     q.getInfo<CL_QUEUE_DEVICE>()
                     );
         }
+
+        /// Name of the kernel.
+        std::string name() const {
+            return K.getInfo<CL_KERNEL_FUNCTION_NAME>();
+        }
+
+        /// Hash of the kernel source.
+        size_t source_hash() const {
+            return hash;
+        }
     private:
         unsigned argpos;
 
         cl::Kernel K;
+        size_t hash;
+        kernel_work work;
 
         backend::ndrange w_size;
         backend::ndrange g_size;
@@ -0,0 +1,258 @@
+#ifndef VEXCL_BINARY_SEARCH_HPP
+#define VEXCL_BINARY_SEARCH_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/binary_search.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Vectorized lower_bound and upper_bound.
+ */
+
+#include <vector>
+#include <string>
+#include <sstream>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/util.hpp>
+#include <vexcl/operations.hpp>
+#include <vexcl/vector.hpp>
+
+namespace vex {
+namespace detail {
+namespace bsearch {
+
+// Sorted vector that is searched by each of the queries. Every device
+// working on the queries needs the complete sorted vector, so the
+// partitions of a multi-device vector are gathered on each of its devices.
+// The partitions are copied between the devices directly when possible,
+// and only go through the host otherwise. The gathered copies live as long
+// as the search expression, since the sorted vector may change or go away
+// before the next search.
+template <typename T>
+struct sorted_data {
+    typedef T value_type;
+
+    std::vector< backend::device_vector<T> > data;
+
+    sorted_data(const vector<T> &x) {
+        const std::vector<backend::command_queue> &q = x.queue_list();
+
+        if (q.size() == 1) {
+            data.push_back(x(0));
+            return;
+        }
+
+        // Partitions are complete when their queues reach the markers.
+        std::vector<backend::event> ready;
+        for(unsigned p = 0; p < q.size(); ++p)
+            ready.push_back(backend::event::marker(q[p]));
+
+        // Host copies of the partitions, read on demand.
+        std::vector<T> host;
+        std::vector<char> on_host(q.size(), false);
+
+        // Direct copies from other devices, which the sources should wait
+        // for before they are modified.
+        std::vector<backend::event> copied(q.size());
+
+        data.reserve(q.size());
+        for(unsigned d = 0; d < q.size(); ++d) {
+            data.push_back(backend::device_vector<T>(q[d], x.size()));
+
+            bool peer = false;
+
+            for(unsigned p = 0; p < q.size(); ++p) {
+                size_t n = x.part_size(p);
+                if (!n) continue;
+
+                size_t start = x.part_start(p);
+
+                if (backend::can_copy_peer(q[p], q[d])) {
+                    if (p != d) {
+                        backend::enqueue_barrier(q[d], ready[p]);
+                        peer = true;
+                    }
+                    x(p).copy_async(q[d], 0, n, data[d], start);
+                } else {
+                    if (!on_host[p]) {
+                        host.resize(x.size());
+                        x(p).read(q[p], 0, n, &host[start], true);
+                        on_host[p] = true;
+                    }
+
+                    data[d].write(q[d], start, n, &host[start], true);
+                }
+            }
+
+            if (peer) copied[d] = backend::event::marker(q[d]);
+        }
+
+        for(unsigned p = 0; p < q.size(); ++p) {
+            std::vector<backend::event> wait;
+            for(unsigned d = 0; d < q.size(); ++d)
+                if (d != p) wait.push_back(copied[d]);
+
+            backend::enqueue_barrier(q[p], wait);
+        }
+    }
+};
+
+// Branch-free binary search: the comparison result only selects the next
+// base, so that all work-items in a warp stay converged.
+template <typename T, bool Upper>
+struct search_function
+    : UserFunction<search_function<T, Upper>, size_t(global_ptr<const T>, size_t, T)>
+{
+    search_function() {}
+
+    static std::string name() {
+        return std::string(Upper ? "vexcl_upper_bound_" : "vexcl_lower_bound_")
+            + type_name<T>();
+    }
+
+    static std::string body() {
+        // prm1: sorted data, prm2: its size, prm3: the query.
+        const char *less = Upper ? "!(prm3 < prm1[i])" : "prm1[i] < prm3";
+
+        std::ostringstream s;
+        s << "ulong n = prm2, base = 0;\n"
+             "    if (n == 0) return 0;\n"
+             "    while (n > 1) {\n"
+             "        ulong half = n / 2, i = base + half;\n"
+             "        base = (" << less << ") ? i : base;\n"
+             "        n -= half;\n"
+             "    }\n"
+             "    {\n"
+             "        ulong i = base;\n"
+             "        return base + ((" << less << ") ? 1 : 0);\n"
+             "    }";
+        return s.str();
+    }
+};
+
+template <typename T, bool Upper, class Expr>
+struct search_expr {
+    typedef typename boost::proto::result_of::make_expr<
+        boost::proto::tag::function,
+        vector_domain,
+        search_function<T, Upper>,
+        sorted_data<T>,
+        size_t,
+        const Expr&
+        >::type type;
+
+    static type make(const vector<T> &sorted, const Expr &queries) {
+        return boost::proto::make_expr<boost::proto::tag::function, vector_domain>(
+                search_function<T, Upper>(), sorted_data<T>(sorted),
+                sorted.size(), boost::ref(queries));
+    }
+};
+
+} // namespace bsearch
+} // namespace detail
+
+/// \cond INTERNAL
+namespace traits {
+
+template <typename T>
+struct is_vector_expr_terminal< detail::bsearch::sorted_data<T> >
+    : std::true_type {};
+
+template <typename T>
+struct kernel_param_declaration< detail::bsearch::sorted_data<T> > {
+    static void get(backend::source_generator &src,
+            const detail::bsearch::sorted_data<T>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src.parameter< global_ptr<const T> >(prm_name);
+    }
+};
+
+template <typename T>
+struct kernel_arg_setter< detail::bsearch::sorted_data<T> > {
+    static void set(const detail::bsearch::sorted_data<T> &term,
+            backend::kernel &kernel, unsigned part, size_t/*index_offset*/,
+            detail::kernel_generator_state_ptr)
+    {
+        precondition(part < term.data.size(),
+                "Sorted vector and queries are on different queues");
+        kernel.push_arg(term.data[part]);
+    }
+};
+
+} // namespace traits
+/// \endcond
+
+/// For each of the queries, finds the first position in the sorted vector where the query could be inserted.
+/**
+ * Returns a vector expression of type size_t. The sorted vector should live on
+ * the same queues as the queries. Multi-device sorted vectors are gathered on
+ * each of the devices with device-to-device copies where the backend allows
+ * them. The device memory for the gathered copies is kept between searches.
+ \code
+ idx = vex::lower_bound(bins, x);
+ \endcode
+ */
+template <typename T, class Expr>
+#ifdef DOXYGEN
+vector_expression
+#else
+typename detail::bsearch::search_expr<T, false, Expr>::type
+#endif
+lower_bound(const vector<T> &sorted, const Expr &queries) {
+    return detail::bsearch::search_expr<T, false, Expr>::make(sorted, queries);
+}
+
+/// For each of the queries, finds the last position in the sorted vector where the query could be inserted.
+/**
+ * Returns a vector expression of type size_t.
+ */
+template <typename T, class Expr>
+#ifdef DOXYGEN
+vector_expression
+#else
+typename detail::bsearch::search_expr<T, true, Expr>::type
+#endif
+upper_bound(const vector<T> &sorted, const Expr &queries) {
+    return detail::bsearch::search_expr<T, true, Expr>::make(sorted, queries);
+}
+
+/// Writes lower bounds of the queries in the sorted vector to result.
+template <typename T, class Expr>
+void lower_bound(const vector<T> &sorted, const Expr &queries, vector<size_t> &result) {
+    result = lower_bound(sorted, queries);
+}
+
+/// Writes upper bounds of the queries in the sorted vector to result.
+template <typename T, class Expr>
+void upper_bound(const vector<T> &sorted, const Expr &queries, vector<size_t> &result) {
+    result = upper_bound(sorted, queries);
+}
+
+} // namespace vex
+
+#endif
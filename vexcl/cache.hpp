@@ -161,8 +161,59 @@ struct object_cache : public object_cache_base, boost::noncopyable {
     }
 };
 
-// The most common type of object cache is kernel cache:
-typedef object_cache<index_by_context, backend::kernel> kernel_cache;
+// The most common type of object cache is kernel cache.
+// Its lookups are counted in the device metrics (see vex::metrics). The
+// metrics slot of each queue is resolved once, so that a lookup does not
+// have to query the device of the queue.
+struct kernel_cache : public object_cache<index_by_context, backend::kernel> {
+    typedef object_cache<index_by_context, backend::kernel> base_type;
+
+    typedef std::map<
+        backend::command_queue, metrics::device*, backend::compare_queues
+        > slot_type;
+
+    slot_type slot;
+
+    base_type::store_type::iterator find(const backend::command_queue &q) {
+        boost::lock_guard<boost::mutex> lock(store_mx);
+
+        auto i = store.find( index_by_context::get(q) );
+
+        auto s = slot.find(q);
+        if (s == slot.end())
+            s = slot.insert(std::make_pair(q, &backend::detail::device_metrics(q))).first;
+
+        metrics::device::inc(i == store.end() ? s->second->cache_misses : s->second->cache_hits);
+
+        return i;
+    }
+
+    void clear() {
+        boost::lock_guard<boost::mutex> lock(store_mx);
+        store.clear();
+        slot.clear();
+    }
+
+    void erase(const backend::command_queue &q) {
+        boost::lock_guard<boost::mutex> lock(store_mx);
+        store.erase( index_by_context::get(q) );
+        slot.erase(q);
+    }
+};
+
+// Family of kernel caches for kernels that also depend on a host-side key.
+// The map is guarded, so that threads may look up the caches concurrently.
+template <class Key>
+class kernel_cache_map : boost::noncopyable {
+    public:
+        kernel_cache& operator[](const Key &key) {
+            boost::lock_guard<boost::mutex> lock(mx);
+            return cache[key];
+        }
+    private:
+        std::map<Key, kernel_cache> cache;
+        boost::mutex mx;
+};
 
 }
 
@@ -0,0 +1,624 @@
+#ifndef VEXCL_COMPACTION_HPP
+#define VEXCL_COMPACTION_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/compaction.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Stream compaction: copy_if, remove_if, partition, unique.
+ *
+ * Each algorithm is a pair of kernels per device. The first kernel evaluates
+ * the predicate and counts selected elements per workgroup. The second one
+ * evaluates the predicate again, computes ranks of the selected elements with
+ * a workgroup-local scan, and scatters values of the input expression to the
+ * output. The only host synchronization is the readback of the per-workgroup
+ * counts, which is needed anyway to return the number of selected elements
+ * and to compute the output offsets for multi-device vectors.
+ */
+
+#include <vector>
+#include <string>
+#include <numeric>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/util.hpp>
+#include <vexcl/operations.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/function.hpp>
+
+namespace vex {
+namespace detail {
+namespace compaction {
+
+//---------------------------------------------------------------------------
+// Number of workgroups and the chunk of input processed by each workgroup.
+//---------------------------------------------------------------------------
+struct launch_config {
+    size_t num_blocks;
+    size_t chunk;
+
+    launch_config(const backend::command_queue &q, size_t n, size_t NT) {
+        num_blocks = std::max<size_t>(1,
+                std::min(backend::kernel::num_workgroups(q), (n + NT - 1) / NT));
+        chunk = alignup((n + num_blocks - 1) / num_blocks, NT);
+    }
+};
+
+//---------------------------------------------------------------------------
+// Sums values in shared memory, leaves the result in shared[0].
+//---------------------------------------------------------------------------
+template <int NT>
+void block_sum(backend::source_generator &src, const std::string &shared) {
+    src.new_line().barrier();
+    for(int s = NT / 2; s > 0; s /= 2) {
+        src.new_line() << "if (tid < " << s << ") "
+            << shared << "[tid] += " << shared << "[tid + " << s << "];";
+        src.new_line().barrier();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Counts elements satisfying the predicate in each workgroup.
+//---------------------------------------------------------------------------
+template <int NT, class Pred>
+backend::kernel& count_kernel(const backend::command_queue &queue, const Pred &pred)
+{
+    static kernel_cache cache;
+
+    auto kernel = cache.find(queue);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(queue);
+
+        auto state = empty_state();
+
+        output_terminal_preamble termpream(src, queue, "flag", state);
+        boost::proto::eval(boost::proto::as_child(pred), termpream);
+
+        src.kernel("compaction_count")
+            .open("(")
+            .template parameter< size_t >("n")
+            .template parameter< size_t >("chunk");
+
+        extract_terminals()(boost::proto::as_child(pred),
+                declare_expression_parameter(src, queue, "flag", state));
+
+        src.template parameter< global_ptr<size_t> >("counts");
+        src.close(")").open("{");
+
+        src.new_line() << "size_t tid   = " << src.local_id(0) << ";";
+        src.new_line() << "size_t block = " << src.group_id(0) << ";";
+        src.new_line() << "size_t beg   = block * chunk;";
+        src.new_line() << "size_t end   = beg + chunk;";
+        src.new_line() << "if (end > n) end = n;";
+
+        {
+            std::ostringstream shared;
+            shared << "shared[" << NT << "]";
+            src.smem_static_var(type_name<size_t>(), shared.str());
+        }
+
+        src.new_line() << "size_t cnt = 0;";
+        src.new_line() << "for(size_t idx = beg + tid; idx < end; idx += " << NT << ")";
+        src.open("{");
+
+        output_local_preamble locpream(src, queue, "flag", state);
+        boost::proto::eval(boost::proto::as_child(pred), locpream);
+
+        src.new_line() << "if (";
+        vector_expr_context expr_ctx(src, queue, "flag", state);
+        boost::proto::eval(boost::proto::as_child(pred), expr_ctx);
+        src << ") ++cnt;";
+
+        src.close("}");
+
+        src.new_line() << "shared[tid] = cnt;";
+        block_sum<NT>(src, "shared");
+        src.new_line() << "if (tid == 0) counts[block] = shared[0];";
+
+        src.close("}");
+
+        kernel = cache.insert(queue, backend::kernel(
+                    queue, src.str(), "compaction_count"));
+    }
+
+    return kernel->second;
+}
+
+//---------------------------------------------------------------------------
+// Scatters elements of the input expression to their positions in output.
+// When Partition is true, elements that do not satisfy the predicate are
+// written to the second output pointer in their original order.
+//---------------------------------------------------------------------------
+template <int NT, bool Partition, class Expr, class Pred>
+backend::kernel& scatter_kernel(const backend::command_queue &queue,
+        const Expr &expr, const Pred &pred)
+{
+    typedef typename return_type<Expr>::type T;
+
+    static kernel_cache cache;
+
+    auto kernel = cache.find(queue);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(queue);
+
+        auto state = empty_state();
+
+        {
+            output_terminal_preamble termpream(src, queue, "prm", state);
+            boost::proto::eval(boost::proto::as_child(expr), termpream);
+        }
+        {
+            output_terminal_preamble termpream(src, queue, "flag", state);
+            boost::proto::eval(boost::proto::as_child(pred), termpream);
+        }
+
+        src.kernel("compaction_scatter")
+            .open("(")
+            .template parameter< size_t >("n")
+            .template parameter< size_t >("chunk");
+
+        extract_terminals()(boost::proto::as_child(expr),
+                declare_expression_parameter(src, queue, "prm", state));
+        extract_terminals()(boost::proto::as_child(pred),
+                declare_expression_parameter(src, queue, "flag", state));
+
+        src.template parameter< global_ptr<const size_t> >("counts");
+        src.template parameter< global_ptr<T>            >("out");
+        src.template parameter< size_t                   >("out_head");
+
+        if (Partition) {
+            src.template parameter< global_ptr<T> >("rest");
+            src.template parameter< size_t        >("rest_head");
+        }
+
+        src.close(")").open("{");
+
+        src.new_line() << "size_t tid   = " << src.local_id(0) << ";";
+        src.new_line() << "size_t block = " << src.group_id(0) << ";";
+        src.new_line() << "size_t beg   = block * chunk;";
+        src.new_line() << "size_t end   = beg + chunk;";
+        src.new_line() << "if (end > n) end = n;";
+
+        {
+            std::ostringstream shared;
+            shared << "shared[" << NT << "]";
+            src.smem_static_var(type_name<size_t>(), shared.str());
+        }
+
+        // Number of selected elements in the preceding workgroups.
+        src.new_line() << "size_t base = 0;";
+        src.new_line() << "for(size_t i = tid; i < block; i += " << NT << ") base += counts[i];";
+        src.new_line() << "shared[tid] = base;";
+        block_sum<NT>(src, "shared");
+        src.new_line() << "base = shared[0];";
+
+        src.new_line() << "for(size_t pos = beg; pos < end; pos += " << NT << ")";
+        src.open("{");
+        src.new_line() << "size_t idx = pos + tid;";
+        src.new_line() << "size_t flag = 0;";
+        src.new_line() << "if (idx < end)";
+        src.open("{");
+        {
+            output_local_preamble locpream(src, queue, "flag", state);
+            boost::proto::eval(boost::proto::as_child(pred), locpream);
+
+            src.new_line() << "flag = (";
+            vector_expr_context expr_ctx(src, queue, "flag", state);
+            boost::proto::eval(boost::proto::as_child(pred), expr_ctx);
+            src << ") ? 1 : 0;";
+        }
+        src.close("}");
+
+        // Inclusive scan of the flags inside the workgroup.
+        src.new_line().barrier();
+        src.new_line() << "shared[tid] = flag;";
+        src.new_line() << "for(size_t offset = 1; offset < " << NT << "; offset *= 2)";
+        src.open("{");
+        src.new_line().barrier();
+        src.new_line() << "size_t prev = (tid >= offset) ? shared[tid - offset] : 0;";
+        src.new_line().barrier();
+        src.new_line() << "shared[tid] += prev;";
+        src.close("}");
+        src.new_line().barrier();
+
+        src.new_line() << "size_t rank = base + shared[tid] - flag;";
+
+        src.new_line() << "if (flag)";
+        src.open("{");
+        {
+            output_local_preamble locpream(src, queue, "prm", state);
+            boost::proto::eval(boost::proto::as_child(expr), locpream);
+
+            src.new_line() << "out[out_head + rank] = ";
+            vector_expr_context expr_ctx(src, queue, "prm", state);
+            boost::proto::eval(boost::proto::as_child(expr), expr_ctx);
+            src << ";";
+        }
+        src.close("}");
+
+        if (Partition) {
+            src.new_line() << "else if (idx < end)";
+            src.open("{");
+            {
+                output_local_preamble locpream(src, queue, "prm", state);
+                boost::proto::eval(boost::proto::as_child(expr), locpream);
+
+                src.new_line() << "rest[rest_head + idx - rank] = ";
+                vector_expr_context expr_ctx(src, queue, "prm", state);
+                boost::proto::eval(boost::proto::as_child(expr), expr_ctx);
+                src << ";";
+            }
+            src.close("}");
+        }
+
+        src.new_line() << "base += shared[" << NT - 1 << "];";
+
+        src.close("}");
+        src.close("}");
+
+        kernel = cache.insert(queue, backend::kernel(
+                    queue, src.str(), "compaction_scatter"));
+    }
+
+    return kernel->second;
+}
+
+//---------------------------------------------------------------------------
+template <bool Partition, class Expr, class Pred>
+size_t compact(const Expr &expr, const Pred &pred, vector<typename return_type<Expr>::type> &out)
+{
+    typedef typename return_type<Expr>::type T;
+
+    const std::vector<backend::command_queue> &queue = out.queue_list();
+
+    get_expression_properties prop;
+    extract_terminals()(boost::proto::as_child(expr), prop);
+    extract_terminals()(boost::proto::as_child(pred), prop);
+
+    // Sometimes the expression only knows its size:
+    if (prop.size && prop.part.empty())
+        prop.part = vex::partition(prop.size, queue);
+
+    if (prop.size == 0) return 0;
+
+    precondition(prop.queue.empty() || prop.queue.size() == queue.size(),
+            "Incompatible queue lists");
+
+    precondition(!Partition || out.size() == prop.size,
+            "Output of partition should have the same size as input");
+
+    const int NT_cpu = 1;
+    const int NT_gpu = 256;
+
+    std::vector<launch_config> cfg;
+    std::vector< backend::device_vector<size_t> > counts;
+    std::vector< std::vector<size_t> > host_counts(queue.size());
+
+    cfg.reserve(queue.size());
+    counts.reserve(queue.size());
+
+    // Count selected elements in each workgroup.
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        backend::select_context(queue[d]);
+
+        const int NT = is_cpu(queue[d]) ? NT_cpu : NT_gpu;
+
+        cfg.push_back(launch_config(queue[d], prop.part_size(d), NT));
+        counts.push_back(backend::device_vector<size_t>(queue[d], cfg[d].num_blocks));
+        host_counts[d].resize(cfg[d].num_blocks, 0);
+
+        if (size_t psize = prop.part_size(d)) {
+            auto &K = is_cpu(queue[d]) ?
+                count_kernel<NT_cpu>(queue[d], pred) :
+                count_kernel<NT_gpu>(queue[d], pred);
+
+            K.push_arg(psize);
+            K.push_arg(cfg[d].chunk);
+            extract_terminals()(boost::proto::as_child(pred),
+                    set_expression_argument(K, d, prop.part_start(d), empty_state()));
+            K.push_arg(counts[d]);
+
+            K.config(cfg[d].num_blocks, NT);
+            K(queue[d]);
+
+            counts[d].read(queue[d], 0, cfg[d].num_blocks, host_counts[d].data());
+        }
+    }
+
+    // Each device writes its selected elements after the ones selected on
+    // the preceding devices.
+    std::vector<size_t> head(queue.size() + 1, 0);
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        if (prop.part_size(d)) backend::finish(queue[d]);
+
+        head[d + 1] = head[d] + std::accumulate(
+                host_counts[d].begin(), host_counts[d].end(), size_t(0));
+    }
+
+    const size_t total = head.back();
+
+    precondition(out.size() >= total, "Output vector is too small");
+
+    // Elements that are written directly to the output partition on the same
+    // device do not need to go through the host.
+    std::vector< backend::device_vector<T> > tmp(queue.size());
+    std::vector< std::vector<T> > host_tmp(queue.size());
+    std::vector<char> direct(queue.size(), 0);
+
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        size_t psize = prop.part_size(d);
+        if (!psize) continue;
+
+        size_t sel  = head[d + 1] - head[d];
+        size_t rest = total + prop.part_start(d) - head[d];
+
+        // Nothing to write. This has to be decided before the first argument
+        // is pushed to the cached kernel.
+        if (!Partition && !sel) continue;
+
+        backend::select_context(queue[d]);
+
+        direct[d] =
+            out.part_start(d) <= head[d] && head[d + 1] <= out.part_start(d + 1) &&
+            (!Partition || (out.part_start(d) <= rest && rest + psize - sel <= out.part_start(d + 1)));
+
+        const int NT = is_cpu(queue[d]) ? NT_cpu : NT_gpu;
+
+        auto &K = is_cpu(queue[d]) ?
+            scatter_kernel<NT_cpu, Partition>(queue[d], expr, pred) :
+            scatter_kernel<NT_gpu, Partition>(queue[d], expr, pred);
+
+        K.push_arg(psize);
+        K.push_arg(cfg[d].chunk);
+        extract_terminals()(boost::proto::as_child(expr),
+                set_expression_argument(K, d, prop.part_start(d), empty_state()));
+        extract_terminals()(boost::proto::as_child(pred),
+                set_expression_argument(K, d, prop.part_start(d), empty_state()));
+        K.push_arg(counts[d]);
+
+        if (direct[d]) {
+            K.push_arg(out(d));
+            K.push_arg(head[d] - out.part_start(d));
+            if (Partition) {
+                K.push_arg(out(d));
+                K.push_arg(rest - out.part_start(d));
+            }
+        } else {
+            tmp[d] = backend::device_vector<T>(queue[d], Partition ? psize : sel);
+
+            K.push_arg(tmp[d]);
+            K.push_arg(size_t(0));
+            if (Partition) {
+                K.push_arg(tmp[d]);
+                K.push_arg(sel);
+            }
+        }
+
+        K.config(cfg[d].num_blocks, NT);
+        K(queue[d]);
+
+        if (!direct[d]) {
+            host_tmp[d].resize(Partition ? psize : sel);
+            tmp[d].read(queue[d], 0, host_tmp[d].size(), host_tmp[d].data());
+        }
+    }
+
+    // Move the remaining parts to their final positions.
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        if (!prop.part_size(d) || direct[d] || host_tmp[d].empty()) continue;
+
+        backend::finish(queue[d]);
+
+        size_t sel = head[d + 1] - head[d];
+
+        out.write_data(head[d], sel, host_tmp[d].data(), false);
+
+        if (Partition)
+            out.write_data(total + prop.part_start(d) - head[d],
+                    host_tmp[d].size() - sel, host_tmp[d].data() + sel, false);
+    }
+
+    for(unsigned d = 0; d < queue.size(); ++d)
+        if (!host_tmp[d].empty()) {
+            for(unsigned q = 0; q < queue.size(); ++q) backend::finish(queue[q]);
+            break;
+        }
+
+    return total;
+}
+
+//---------------------------------------------------------------------------
+// Flags the first element in each group of consecutive equivalent elements.
+//---------------------------------------------------------------------------
+template <typename T, class Equal>
+struct head_flag {
+    typedef int value_type;
+
+    const vector<T> &x;
+
+    // Last element of the preceding partition (for multi-device vectors).
+    std::vector<T> prev;
+
+    head_flag(const vector<T> &x) : x(x), prev(x.nparts()) {
+        const std::vector<backend::command_queue> &q = x.queue_list();
+
+        for(unsigned d = 1; d < q.size(); ++d)
+            if (x.part_size(d) && x.part_start(d))
+                x.read_data(x.part_start(d) - 1, 1, &prev[d], false);
+
+        for(unsigned d = 1; d < q.size(); ++d)
+            if (x.part_size(d) && x.part_start(d))
+                backend::finish(q[d - 1]);
+    }
+};
+
+} // namespace compaction
+} // namespace detail
+
+/// \cond INTERNAL
+namespace traits {
+
+template <typename T, class Equal>
+struct is_vector_expr_terminal< detail::compaction::head_flag<T, Equal> >
+    : std::true_type {};
+
+template <typename T, class Equal>
+struct terminal_preamble< detail::compaction::head_flag<T, Equal> > {
+    static void get(backend::source_generator &src,
+            const detail::compaction::head_flag<T, Equal>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        Equal::define(src, prm_name + "_equal");
+    }
+};
+
+template <typename T, class Equal>
+struct kernel_param_declaration< detail::compaction::head_flag<T, Equal> > {
+    static void get(backend::source_generator &src,
+            const detail::compaction::head_flag<T, Equal>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src.parameter< global_ptr<const T> >(prm_name + "_x");
+        src.parameter< T   >(prm_name + "_prev");
+        src.parameter< int >(prm_name + "_has_prev");
+    }
+};
+
+template <typename T, class Equal>
+struct partial_vector_expr< detail::compaction::head_flag<T, Equal> > {
+    static void get(backend::source_generator &src,
+            const detail::compaction::head_flag<T, Equal>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src << "(idx ? !" << prm_name << "_equal("
+            << prm_name << "_x[idx - 1], " << prm_name << "_x[idx]) : (!"
+            << prm_name << "_has_prev || !" << prm_name << "_equal("
+            << prm_name << "_prev, " << prm_name << "_x[0])))";
+    }
+};
+
+template <typename T, class Equal>
+struct kernel_arg_setter< detail::compaction::head_flag<T, Equal> > {
+    static void set(const detail::compaction::head_flag<T, Equal> &term,
+            backend::kernel &kernel, unsigned part, size_t/*index_offset*/,
+            detail::kernel_generator_state_ptr)
+    {
+        kernel.push_arg(term.x(part));
+        kernel.push_arg(term.prev[part]);
+        kernel.push_arg(static_cast<int>(term.x.part_start(part) > 0));
+    }
+};
+
+template <typename T, class Equal>
+struct expression_properties< detail::compaction::head_flag<T, Equal> > {
+    static void get(const detail::compaction::head_flag<T, Equal> &term,
+            std::vector<backend::command_queue> &queue_list,
+            std::vector<size_t> &partition,
+            size_t &size
+            )
+    {
+        queue_list = term.x.queue_list();
+        partition  = term.x.partition();
+        size       = term.x.size();
+    }
+};
+
+} // namespace traits
+/// \endcond
+
+/// Copies elements of the expression for which the predicate is true.
+/**
+ * The relative order of the copied elements is preserved. The output vector
+ * should be large enough to hold the result. Returns the number of copied
+ * elements.
+ \code
+ size_t n = vex::copy_if(x, x > 0, y); // y[0:n] holds positive elements of x.
+ \endcode
+ */
+template <class Expr, class Pred>
+size_t copy_if(const Expr &expr, const Pred &pred,
+        vector<typename detail::return_type<Expr>::type> &out)
+{
+    return detail::compaction::compact<false>(expr, pred, out);
+}
+
+/// Copies elements of the expression for which the predicate is false.
+/**
+ * The relative order of the copied elements is preserved. Returns the number
+ * of copied elements.
+ */
+template <class Expr, class Pred>
+size_t remove_if(const Expr &expr, const Pred &pred,
+        vector<typename detail::return_type<Expr>::type> &out)
+{
+    return detail::compaction::compact<false>(expr, !pred, out);
+}
+
+/// Stable partition of the expression with respect to the predicate.
+/**
+ * Elements for which the predicate is true are placed at the beginning of the
+ * output, followed by the rest of the elements. The relative order of
+ * elements is preserved in both groups. The output should have the same size
+ * as the input. Returns the number of elements in the first group.
+ */
+template <class Expr, class Pred>
+size_t partition(const Expr &expr, const Pred &pred,
+        vector<typename detail::return_type<Expr>::type> &out)
+{
+    return detail::compaction::compact<true>(expr, pred, out);
+}
+
+/// Copies the first element of each group of consecutive equivalent elements.
+/**
+ * Returns the number of copied elements.
+ * \param equal equivalence function.
+ */
+template <typename T, class Equal>
+size_t unique(const vector<T> &x, vector<T> &out, Equal) {
+    detail::compaction::head_flag<T, Equal> flag(x);
+
+    return detail::compaction::compact<false>(x,
+            boost::proto::as_expr<vector_domain>(flag), out);
+}
+
+/// Copies the first element of each group of consecutive equal elements.
+/**
+ * Returns the number of copied elements.
+ */
+template <typename T>
+size_t unique(const vector<T> &x, vector<T> &out) {
+    VEX_FUNCTION(bool, equal, (T, a)(T, b), return a == b;);
+    return unique(x, out, equal);
+}
+
+} // namespace vex
+
+#endif
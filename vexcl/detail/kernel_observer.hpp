@@ -0,0 +1,92 @@
+#ifndef VEXCL_DETAIL_KERNEL_OBSERVER_HPP
+#define VEXCL_DETAIL_KERNEL_OBSERVER_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/detail/kernel_observer.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Backend-independent observer of kernel launches.
+ */
+
+#include <string>
+#include <functional>
+
+#include <boost/thread/tss.hpp>
+
+namespace vex {
+namespace detail {
+
+/// Estimated amount of work done by a kernel launch.
+struct kernel_work {
+    double bytes; ///< Bytes transferred to or from global memory.
+    double flops; ///< Arithmetic operations.
+
+    kernel_work(double bytes = 0, double flops = 0) : bytes(bytes), flops(flops) {}
+};
+
+/// Observer of kernel launches for the given backend queue and event types.
+/**
+ * When set, receives name of each launched kernel, hash of its source, the
+ * queue, the event of the launch, and the estimated work (zero when
+ * unknown). Used by vex::profiler.
+ */
+template <class Queue, class Event>
+struct kernel_observer {
+    typedef std::function<
+        void(const std::string&, size_t, const Queue&, const Event&, const kernel_work&)
+        > type;
+
+    /// Returns observer of kernel launches made by the calling thread.
+    /**
+     * Each thread has its own observer, so that a profiler only sees the
+     * kernels launched by the thread that uses it.
+     */
+    static type& get() {
+        static boost::thread_specific_ptr<type> observer;
+
+        if (!observer.get()) observer.reset(new type());
+        return *observer;
+    }
+};
+
+/// Number of kernels launched by the calling thread.
+/**
+ * Lets the objects that hand out buffers as kernel arguments tell whether
+ * the kernel the buffers were passed to has been launched since.
+ */
+struct launch_counter {
+    static size_t& get() {
+        static boost::thread_specific_ptr<size_t> count;
+
+        if (!count.get()) count.reset(new size_t(0));
+        return *count;
+    }
+};
+
+} // namespace detail
+} // namespace vex
+
+#endif
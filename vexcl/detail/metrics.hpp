@@ -0,0 +1,146 @@
+#ifndef VEXCL_DETAIL_METRICS_HPP
+#define VEXCL_DETAIL_METRICS_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/detail/metrics.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Backend-independent storage for runtime counters.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace vex {
+namespace detail {
+namespace metrics {
+
+// Atomic counters of a single device.
+struct device {
+    std::atomic<size_t> cache_hits;
+    std::atomic<size_t> cache_misses;
+    std::atomic<size_t> compiles;
+    std::atomic<size_t> binary_cache_hits;
+    std::atomic<size_t> uploads;
+    std::atomic<size_t> bytes_uploaded;
+    std::atomic<size_t> downloads;
+    std::atomic<size_t> bytes_downloaded;
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> bytes_allocated;
+    std::atomic<size_t> live_bytes;
+    std::atomic<size_t> peak_live_bytes;
+
+    device() : live_bytes(0), peak_live_bytes(0) { reset(); }
+
+    static void inc(std::atomic<size_t> &c, size_t v = 1) {
+        c.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    void upload(size_t bytes) {
+        inc(uploads);
+        inc(bytes_uploaded, bytes);
+    }
+
+    void download(size_t bytes) {
+        inc(downloads);
+        inc(bytes_downloaded, bytes);
+    }
+
+    void allocate(size_t bytes) {
+        inc(allocations);
+        inc(bytes_allocated, bytes);
+
+        size_t live = live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+        while(live > peak && !peak_live_bytes.compare_exchange_weak(
+                    peak, live, std::memory_order_relaxed));
+    }
+
+    void release(size_t bytes) {
+        live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // Live memory is a gauge and is not reset; its peak restarts from the
+    // current value.
+    void reset() {
+        cache_hits        = 0;
+        cache_misses      = 0;
+        compiles          = 0;
+        binary_cache_hits = 0;
+        uploads           = 0;
+        bytes_uploaded    = 0;
+        downloads         = 0;
+        bytes_downloaded  = 0;
+        allocations       = 0;
+        bytes_allocated   = 0;
+        peak_live_bytes   = live_bytes.load();
+    }
+};
+
+// Fixed table of devices, so that the lookup is lock-free. Keys are stored
+// shifted by one, because zero marks an empty slot.
+const size_t max_devices = 64;
+
+struct registry {
+    std::atomic<std::uintptr_t> key[max_devices];
+    device                      dev[max_devices];
+
+    registry() {
+        for(size_t i = 0; i < max_devices; ++i) key[i] = 0;
+    }
+};
+
+inline registry& get_registry() {
+    static registry r;
+    return r;
+}
+
+// Returns counters of the device with the given id. Devices that do not fit
+// into the table share the last slot.
+inline device& get(std::uintptr_t id) {
+    registry &r = get_registry();
+    const std::uintptr_t k = id + 1;
+
+    for(size_t i = 0; i + 1 < max_devices; ++i) {
+        std::uintptr_t s = r.key[i].load(std::memory_order_acquire);
+
+        if (s == k) return r.dev[i];
+
+        if (s == 0) {
+            if (r.key[i].compare_exchange_strong(s, k, std::memory_order_acq_rel) || s == k)
+                return r.dev[i];
+        }
+    }
+
+    return r.dev[max_devices - 1];
+}
+
+} // namespace metrics
+} // namespace detail
+} // namespace vex
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef VEXCL_DETAIL_TRACE_HPP
+#define VEXCL_DETAIL_TRACE_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/detail/trace.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Backend-independent storage for the trace of device commands.
+ */
+
+#include <string>
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+#include <atomic>
+#include <chrono>
+
+#include <boost/thread.hpp>
+
+namespace vex {
+namespace detail {
+namespace trace {
+
+typedef std::chrono::steady_clock clock;
+
+// A single traced command. Times are in microseconds since trace origin.
+struct record {
+    const char  *category;
+    std::string  name;
+    const void  *queue;
+    boost::thread::id thread;
+
+    double begin, end;
+
+    size_t bytes;
+    size_t hash;
+
+    // Device begin/end times of the command, when available.
+    bool   on_device;
+    double device_begin, device_end;
+};
+
+// Backend event of a command whose device times are not yet known.
+struct device_event {
+    virtual ~device_event() {}
+
+    // Checks without blocking if the command completed.
+    virtual bool ready() const = 0;
+
+    // Waits for the command and returns its device times.
+    virtual bool time(double &begin, double &end) const = 0;
+};
+
+struct pending {
+    size_t serial;
+    std::shared_ptr<device_event> event;
+};
+
+// The log keeps at most `capacity` records; the oldest ones are dropped
+// first, so that a trace left running does not grow without limit.
+// Device times are resolved as soon as the commands complete, so that only
+// the events of the commands still in flight are kept alive.
+struct state {
+    std::atomic<bool>   on;
+    boost::mutex        mx;
+    clock::time_point   origin;
+    std::deque<record>  log;
+    size_t              first; // Serial number of log.front().
+    size_t              capacity;
+    size_t              dropped;
+
+    // Commands complete in order within a queue.
+    std::map<const void*, std::deque<pending>> in_flight;
+
+    state() : on(false), origin(clock::now()), first(0), capacity(1 << 20), dropped(0) {}
+};
+
+inline state& get_state() {
+    static state s;
+    return s;
+}
+
+// The only check made on the hot path when tracing is disabled.
+inline bool enabled() {
+    return get_state().on.load(std::memory_order_relaxed);
+}
+
+// Microseconds since trace origin.
+inline double now() {
+    return std::chrono::duration<double, std::micro>(
+            clock::now() - get_state().origin).count();
+}
+
+// The functions below expect the state mutex to be held.
+inline void resolve(state &s, const pending &p) {
+    if (p.serial < s.first) {
+        // The record has already been dropped.
+        return;
+    }
+
+    record &r = s.log[p.serial - s.first];
+    r.on_device = p.event->time(r.device_begin, r.device_end);
+}
+
+// Resolves completed commands at the head of the queue.
+inline void poll(state &s, const void *queue) {
+    auto q = s.in_flight.find(queue);
+    if (q == s.in_flight.end()) return;
+
+    while(!q->second.empty() && q->second.front().event->ready()) {
+        resolve(s, q->second.front());
+        q->second.pop_front();
+    }
+
+    if (q->second.empty()) s.in_flight.erase(q);
+}
+
+// Waits for and resolves all commands in flight.
+inline void flush(state &s) {
+    for(auto q = s.in_flight.begin(); q != s.in_flight.end(); ++q)
+        for(auto p = q->second.begin(); p != q->second.end(); ++p)
+            resolve(s, *p);
+
+    s.in_flight.clear();
+}
+
+inline void trim(state &s) {
+    while(s.log.size() > s.capacity) {
+        s.log.pop_front();
+        ++s.first;
+        ++s.dropped;
+    }
+}
+
+inline void log(const char *category, const std::string &name,
+        const void *queue, double begin, size_t bytes = 0, size_t hash = 0,
+        std::shared_ptr<device_event> event = std::shared_ptr<device_event>())
+{
+    record r = {category, name, queue, boost::this_thread::get_id(),
+        begin, now(), bytes, hash, false, 0.0, 0.0};
+
+    state &s = get_state();
+    boost::lock_guard<boost::mutex> lock(s.mx);
+
+    poll(s, queue);
+
+    s.log.push_back(std::move(r));
+
+    if (event) {
+        pending p = {s.first + s.log.size() - 1, std::move(event)};
+        s.in_flight[queue].push_back(std::move(p));
+    }
+
+    trim(s);
+}
+
+// Records host time spent in the enclosing scope.
+class scope {
+    public:
+        scope(const char *category, const std::string &name,
+                const void *queue = 0, size_t bytes = 0, size_t hash = 0)
+            : on(enabled()), category(category), queue(queue),
+              bytes(bytes), hash(hash)
+        {
+            if (on) {
+                this->name = name;
+                begin = now();
+            }
+        }
+
+        ~scope() {
+            if (on) log(category, name, queue, begin, bytes, hash);
+        }
+    private:
+        bool on;
+        const char *category;
+        const void *queue;
+        size_t bytes, hash;
+        std::string name;
+        double begin;
+};
+
+// Relates device timestamps of backend events to the host trace clock. The
+// origin of each queue is a completed marker recorded when the trace starts.
+template <class Event>
+struct device_clock {
+    typedef std::pair<Event, double> origin_type;
+    typedef std::map<const void*, origin_type> origin_map;
+
+    static origin_map& origin() {
+        static origin_map o;
+        return o;
+    }
+
+    static boost::mutex& origin_mx() {
+        static boost::mutex mx;
+        return mx;
+    }
+
+    static void start(const void *queue, const Event &marker) {
+        marker.wait();
+
+        double t = now();
+
+        boost::lock_guard<boost::mutex> lock(origin_mx());
+        origin()[queue] = std::make_pair(marker, t);
+    }
+
+    static bool find_origin(const void *queue, origin_type &o) {
+        boost::lock_guard<boost::mutex> lock(origin_mx());
+
+        auto i = origin().find(queue);
+        if (i == origin().end()) return false;
+
+        o = i->second;
+        return true;
+    }
+
+    struct timed_event : public device_event {
+        const void *queue;
+        Event e;
+
+        timed_event(const void *queue, const Event &e) : queue(queue), e(e) {}
+
+        bool ready() const {
+            return e.ready();
+        }
+
+        bool time(double &start, double &stop) const {
+            origin_type o;
+            if (!find_origin(queue, o)) return false;
+
+            stop  = o.second + 1e6 * e.since(o.first);
+            start = stop - 1e6 * e.duration();
+            return true;
+        }
+    };
+
+    // Records the command spanning the given event. Device times are only
+    // resolved when the events of the queue carry timings.
+    static void log(const char *category, const std::string &name,
+            const void *queue, double begin, const Event &e, bool timed,
+            size_t bytes = 0, size_t hash = 0)
+    {
+        std::shared_ptr<device_event> event;
+        if (timed) event = std::make_shared<timed_event>(queue, e);
+
+        trace::log(category, name, queue, begin, bytes, hash, std::move(event));
+    }
+};
+
+} // namespace trace
+} // namespace detail
+} // namespace vex
+
+#endif
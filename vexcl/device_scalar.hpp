@@ -0,0 +1,181 @@
+#ifndef VEXCL_DEVICE_SCALAR_HPP
+#define VEXCL_DEVICE_SCALAR_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/device_scalar.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Scalar value residing in device memory.
+ */
+
+#include <vector>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/operations.hpp>
+
+namespace vex {
+
+/// \cond INTERNAL
+struct device_scalar_terminal {};
+
+typedef vector_expression<
+    typename boost::proto::terminal< device_scalar_terminal >::type
+    > device_scalar_terminal_expression;
+
+namespace traits {
+
+// Hold device scalars by reference:
+template <class T>
+struct hold_terminal_by_reference< T,
+        typename std::enable_if<
+            boost::proto::matches<
+                typename boost::proto::result_of::as_expr< T >::type,
+                boost::proto::terminal< device_scalar_terminal >
+            >::value
+        >::type
+    >
+    : std::true_type
+{ };
+
+} // namespace traits
+/// \endcond
+
+/// Scalar value residing in device memory.
+/**
+ * Each of the devices in the queue list holds a copy of the value. A device
+ * scalar may be used in vector expressions as a constant, and it may receive
+ * result of a reduction (see vex::Reductor), so that results of reductions
+ * may be used in subsequent expressions without synchronization with the
+ * host:
+ \code
+ vex::Reductor<double, vex::SUM> sum(ctx);
+ vex::device_scalar<double> s(ctx);
+
+ sum(x * x, s);
+ x = x / sqrt(s);
+ \endcode
+ * The value is only transferred to the host on explicit call to get().
+ */
+template <typename T>
+class device_scalar : public device_scalar_terminal_expression {
+    public:
+        typedef T value_type;
+
+        /// Allocates the scalar on each of the devices and sets its value.
+        device_scalar(const std::vector<backend::command_queue> &queue, T value = T())
+            : queue(queue)
+        {
+            for(unsigned d = 0; d < queue.size(); d++)
+                buf.push_back(backend::device_vector<T>(queue[d], 1, &value));
+        }
+
+        /// Reads the value from the first device.
+        T get() const {
+            T value;
+            buf[0].read(queue[0], 0, 1, &value, true);
+            return value;
+        }
+
+        /// Writes the value to each of the devices.
+        device_scalar& operator=(T value) {
+            for(unsigned d = 0; d < queue.size(); d++)
+                buf[d].write(queue[d], 0, 1, &value, true);
+            return *this;
+        }
+
+        /// Buffer holding the value on the given device.
+        const backend::device_vector<T>& operator()(unsigned d = 0) const {
+            return buf[d];
+        }
+
+        /// Buffer holding the value on the given device.
+        backend::device_vector<T>& operator()(unsigned d = 0) {
+            return buf[d];
+        }
+
+        /// Queue list of the scalar.
+        const std::vector<backend::command_queue>& queue_list() const {
+            return queue;
+        }
+    private:
+        std::vector<backend::command_queue>        queue;
+        std::vector< backend::device_vector<T> > buf;
+};
+
+/// \cond INTERNAL
+namespace traits {
+
+template <>
+struct is_vector_expr_terminal< device_scalar_terminal > : std::true_type {};
+
+template <>
+struct proto_terminal_is_value< device_scalar_terminal > : std::true_type {};
+
+// The single value is read once per work-item and stays in cache.
+template <typename T>
+struct terminal_bytes< device_scalar<T> > : known_terminal_bytes<0> {};
+
+template <typename T>
+struct kernel_param_declaration< device_scalar<T> > {
+    static void get(backend::source_generator &src,
+            const device_scalar<T>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src.parameter< global_ptr<const T> >(prm_name);
+    }
+};
+
+template <typename T>
+struct partial_vector_expr< device_scalar<T> > {
+    static void get(backend::source_generator &src,
+            const device_scalar<T>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src << prm_name << "[0]";
+    }
+};
+
+template <typename T>
+struct kernel_arg_setter< device_scalar<T> > {
+    static void set(const device_scalar<T> &term,
+            backend::kernel &kernel, unsigned device, size_t/*index_offset*/,
+            detail::kernel_generator_state_ptr)
+    {
+        kernel.push_arg(term(device));
+    }
+};
+
+// Device scalars do not define size or partitioning of an expression, so
+// expression_properties is left at its default.
+
+} // namespace traits
+/// \endcond
+
+} // namespace vex
+
+#endif
@@ -367,15 +367,13 @@ class Context {
         }
 
         void finish() const {
-            for(auto queue = q.begin(); queue != q.end(); ++queue) {
-                backend::command_queue q = *queue;
-                q.finish();
-            }
+            for(auto queue = q.begin(); queue != q.end(); ++queue)
+                backend::finish(*queue);
         }
 
         void finish() {
             for(auto queue = q.begin(); queue != q.end(); ++queue)
-                queue->finish();
+                backend::finish(*queue);
         }
     private:
         std::vector<backend::context>       c;
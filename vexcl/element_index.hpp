@@ -70,6 +70,9 @@ struct is_vector_expr_terminal< elem_index > : std::true_type {};
 template <>
 struct is_multivector_expr_terminal< elem_index > : std::true_type {};
 
+template <>
+struct terminal_bytes< elem_index > : known_terminal_bytes<0> {};
+
 template <>
 struct kernel_param_declaration< elem_index >
 {
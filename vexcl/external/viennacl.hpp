@@ -42,8 +42,8 @@ namespace viennacl {
         }
 
         /// Matrix-vector product.
-        template <typename T, typename C, typename I>
-        auto prod(const vex::SpMat<T, C, I> &A, const vex::vector<T> &x)
+        template <typename T, typename C, typename I, class F>
+        auto prod(const vex::SpMat<T, C, I, F> &A, const vex::vector<T> &x)
             -> decltype(A * x)
         {
             return A * x;
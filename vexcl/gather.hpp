@@ -79,7 +79,7 @@ class gather {
             }
 
             for(unsigned d = 0; d < queue.size(); d++)
-                if (ptr[d + 1] - ptr[d]) queue[d].finish();
+                if (ptr[d + 1] - ptr[d]) backend::finish(queue[d]);
         }
 
         /// Gather elements of device vector into host vector.
@@ -102,7 +102,7 @@ class gather {
             }
 
             for(unsigned d = 0; d < queue.size(); d++)
-                if (ptr[d + 1] - ptr[d]) queue[d].finish();
+                if (ptr[d + 1] - ptr[d]) backend::finish(queue[d]);
         }
     private:
         std::vector<backend::command_queue> queue;
@@ -0,0 +1,323 @@
+#ifndef VEXCL_HISTOGRAM_HPP
+#define VEXCL_HISTOGRAM_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/histogram.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Histogram and bincount of vector expressions.
+ *
+ * When the bins fit into local memory, each workgroup accumulates a private
+ * copy of the histogram with local atomics and adds it to the global
+ * histogram once. Otherwise the bins are incremented with global atomics.
+ * Per-device histograms are summed on the host.
+ *
+ * Bins are counted on the device in 32-bit integers, since 64-bit atomics
+ * are not available everywhere. Device parts with more than 2^32-1 elements
+ * are processed in chunks, and the counts of the chunks are summed on the
+ * host in 64 bits.
+ */
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/util.hpp>
+#include <vexcl/operations.hpp>
+#include <vexcl/cache.hpp>
+
+namespace vex {
+namespace detail {
+namespace hist {
+
+inline const char* atomic_add() {
+#if defined(VEXCL_BACKEND_CUDA)
+    return "atomicAdd";
+#else
+    return "atomic_add";
+#endif
+}
+
+// Device and host buffers for the per-device histograms.
+struct histogram_data {
+    std::vector<cl_uint>            hbuf;
+    backend::device_vector<cl_uint> dbuf;
+
+    histogram_data(const backend::command_queue &q, size_t nbins)
+        : hbuf(nbins), dbuf(q, nbins)
+    { }
+};
+
+typedef object_cache<index_by_queue, histogram_data> histogram_data_cache;
+
+inline histogram_data_cache& get_data_cache() {
+    static histogram_data_cache cache;
+    return cache;
+}
+
+// Writes bin index of the current element into `bin`. Elements outside of
+// the histogram range get bin index equal to nbins.
+template <bool Ranged, typename T>
+void compute_bin(backend::source_generator &src) {
+    if (Ranged) {
+        src.new_line() << "ulong bin = nbins;";
+        src.new_line() << "if (val >= lo && val <= hi)";
+        src.open("{");
+        src.new_line() << "bin = (ulong)((val - lo) * nbins / (hi - lo));";
+        src.new_line() << "if (bin >= nbins) bin = nbins - 1;";
+        src.close("}");
+    } else {
+        src.new_line() << "ulong bin = (val >= 0 && (ulong)val < nbins) ? (ulong)val : nbins;";
+    }
+}
+
+template <bool Ranged, bool Private, class Expr>
+backend::kernel& histogram_kernel(const backend::command_queue &queue, const Expr &expr) {
+    typedef typename return_type<Expr>::type T;
+
+    static kernel_cache cache;
+
+    auto kernel = cache.find(queue);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(queue);
+
+        output_terminal_preamble termpream(src, queue, "prm", empty_state());
+        boost::proto::eval(boost::proto::as_child(expr), termpream);
+
+        src.kernel("vexcl_histogram_kernel")
+            .open("(")
+            .template parameter< size_t >("n")
+            .template parameter< size_t >("start")
+            .template parameter< size_t >("nbins");
+
+        if (Ranged) {
+            src.template parameter< T >("lo");
+            src.template parameter< T >("hi");
+        }
+
+        extract_terminals()(boost::proto::as_child(expr),
+                declare_expression_parameter(src, queue, "prm", empty_state()));
+
+        src.template parameter< global_ptr<cl_uint> >("hist");
+
+        if (Private) src.template smem_parameter<cl_uint>("bins");
+
+        src.close(")").open("{");
+
+        if (Private) {
+            src.smem_declaration<cl_uint>("bins");
+
+            src.new_line() << "for(size_t i = " << src.local_id(0)
+                << "; i < nbins; i += " << src.local_size(0) << ") bins[i] = 0;";
+            src.new_line().barrier();
+        }
+
+        // Elements [start, start + n) of the device part are counted.
+        src.grid_stride_loop("i").open("{");
+        src.new_line() << type_name<size_t>() << " idx = start + i;";
+
+        output_local_preamble locpream(src, queue, "prm", empty_state());
+        boost::proto::eval(boost::proto::as_child(expr), locpream);
+
+        src.new_line() << type_name<T>() << " val = ";
+        vector_expr_context expr_ctx(src, queue, "prm", empty_state());
+        boost::proto::eval(boost::proto::as_child(expr), expr_ctx);
+        src << ";";
+
+        compute_bin<Ranged, T>(src);
+
+        src.new_line() << "if (bin < nbins) " << atomic_add()
+            << (Private ? "(bins + bin, 1);" : "(hist + bin, 1);");
+
+        src.close("}");
+
+        if (Private) {
+            src.new_line().barrier();
+            src.new_line() << "for(size_t i = " << src.local_id(0)
+                << "; i < nbins; i += " << src.local_size(0) << ")";
+            src.open("{");
+            src.new_line() << "if (bins[i]) " << atomic_add() << "(hist + i, bins[i]);";
+            src.close("}");
+        }
+
+        src.close("}");
+
+        kernel = cache.insert(queue, backend::kernel(
+                    queue, src.str(), "vexcl_histogram_kernel"));
+    }
+
+    return kernel->second;
+}
+
+// Largest number of elements counted by a single launch, so that none of the
+// 32-bit device counters overflows.
+const size_t max_chunk = std::numeric_limits<cl_uint>::max();
+
+template <bool Ranged, class Expr, typename T>
+std::vector<size_t> histogram(const Expr &expr, size_t nbins, T lo, T hi,
+        size_t chunk = max_chunk)
+{
+    get_expression_properties prop;
+    extract_terminals()(boost::proto::as_child(expr), prop);
+
+    precondition(!prop.queue.empty(),
+            "Histogram: unable to deduce queue list from the expression");
+
+    const std::vector<backend::command_queue> &queue = prop.queue;
+
+    // Sometimes the expression only knows its size:
+    if (prop.size && prop.part.empty())
+        prop.part = vex::partition(prop.size, queue);
+
+    std::vector<size_t> result(nbins, 0);
+    if (!nbins) return result;
+
+    histogram_data_cache &data_cache = get_data_cache();
+
+    std::vector<histogram_data*> data(queue.size(), 0);
+
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        size_t psize = prop.part_size(d);
+        if (!psize) continue;
+
+        backend::select_context(queue[d]);
+
+        auto cached = data_cache.find(queue[d]);
+        if (cached == data_cache.end() || cached->second.hbuf.size() < nbins) {
+            data_cache.erase(queue[d]);
+            cached = data_cache.insert(queue[d], histogram_data(queue[d], nbins));
+        }
+
+        data[d] = &cached->second;
+
+        // Privatize the bins when they fit into local memory. The device
+        // limit is checked first, so that the private kernel is only built
+        // when it may be used.
+        const size_t smem_bytes = nbins * sizeof(cl_uint);
+
+        backend::kernel *K = 0;
+        bool priv = smem_bytes <= backend::max_shared_memory_per_block(queue[d]);
+
+        if (priv) {
+            K = &histogram_kernel<Ranged, true>(queue[d], expr);
+            priv = smem_bytes <= K->max_shared_memory_per_block(queue[d]);
+        }
+
+        if (!priv) K = &histogram_kernel<Ranged, false>(queue[d], expr);
+
+        for(size_t start = 0; start < psize; start += chunk) {
+            const size_t csize = std::min(chunk, psize - start);
+
+            // Counts of the previous chunk are added before the host
+            // buffer is reused. The counts of the last chunk are added
+            // after all devices are done.
+            if (start) {
+                backend::finish(queue[d]);
+
+                for(size_t i = 0; i < nbins; ++i)
+                    result[i] += data[d]->hbuf[i];
+            }
+
+            std::fill(data[d]->hbuf.begin(), data[d]->hbuf.begin() + nbins, 0);
+            data[d]->dbuf.write(queue[d], 0, nbins, data[d]->hbuf.data());
+
+            K->push_arg(csize);
+            K->push_arg(start);
+            K->push_arg(nbins);
+
+            if (Ranged) {
+                K->push_arg(lo);
+                K->push_arg(hi);
+            }
+
+            extract_terminals()(boost::proto::as_child(expr),
+                    set_expression_argument(*K, d, prop.part_start(d), empty_state()));
+
+            K->push_arg(data[d]->dbuf);
+
+            if (priv) K->set_smem([smem_bytes](size_t){ return smem_bytes; });
+
+            (*K)(queue[d]);
+
+            data[d]->dbuf.read(queue[d], 0, nbins, data[d]->hbuf.data());
+        }
+    }
+
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        if (!data[d]) continue;
+
+        backend::finish(queue[d]);
+
+        for(size_t i = 0; i < nbins; ++i)
+            result[i] += data[d]->hbuf[i];
+    }
+
+    return result;
+}
+
+} // namespace hist
+} // namespace detail
+
+/// Histogram of a vector expression.
+/**
+ * The range [lo, hi] is split into nbins bins of equal width. All bins but
+ * the last one are half-open; the last bin includes hi. Elements outside of
+ * the range are ignored.
+ \code
+ std::vector<size_t> h = vex::histogram(x, 10, 0.0, 1.0);
+ \endcode
+ */
+template <class Expr, typename T>
+std::vector<size_t> histogram(const Expr &expr, size_t nbins, T lo, T hi) {
+    typedef typename detail::return_type<Expr>::type value_type;
+
+    precondition(lo < hi, "Histogram: empty range");
+
+    return detail::hist::histogram<true>(
+            expr, nbins, static_cast<value_type>(lo), static_cast<value_type>(hi));
+}
+
+/// Counts occurrences of each value in an integral vector expression.
+/**
+ * Returns vector of size nbins, where i-th element holds the number of
+ * elements equal to i. Values outside of [0, nbins) are ignored.
+ */
+template <class Expr>
+std::vector<size_t> bincount(const Expr &expr, size_t nbins) {
+    typedef typename detail::return_type<Expr>::type value_type;
+
+    static_assert(std::is_integral<value_type>::value,
+            "bincount requires an integral expression");
+
+    return detail::hist::histogram<false>(expr, nbins, value_type(), value_type());
+}
+
+} // namespace vex
+
+#endif
@@ -28,11 +28,16 @@ THE SOFTWARE.
 /**
  * \file   vexcl/logical.hpp
  * \author Denis Demidov <dennis.demidov@gmail.com>
- * \brief  Implementation of any_of and all_of primitives.
+ * \brief  Implementation of any_of, all_of, and count_if primitives.
+ *
+ * any_of evaluates the expression in a grid-stride loop. The work-items
+ * share a flag in global memory, which is checked on each iteration, so that
+ * the scan stops soon after the first match is found.
  */
 
 #include <vector>
 #include <vexcl/operations.hpp>
+#include <vexcl/reductor.hpp>
 
 namespace vex {
 
@@ -50,7 +55,7 @@ class any_of {
 #ifndef VEXCL_NO_STATIC_CONTEXT_CONSTRUCTORS
                 = current_context().queue()
 #endif
-              ) : queue(queue)
+              ) : queue(queue), flag(queue.size())
         {
             result.reserve(queue.size());
             for(auto q = queue.begin(); q != queue.end(); ++q)
@@ -61,11 +66,15 @@ class any_of {
         bool operator()(const Expr &expr) const {
             using namespace detail;
 
+            static const char zero = 0;
+
             get_expression_properties prop;
             extract_terminals()(expr, prop);
 
             for(unsigned d = 0; d < queue.size(); ++d) {
                 if (size_t psize = prop.part_size(d)) {
+                    result[d].write(queue[d], 0, 1, &zero);
+
                     backend::kernel& k = make_kernel(queue[d], expr);
                     k.push_arg(psize);
                     extract_terminals()(expr,
@@ -75,22 +84,25 @@ class any_of {
                             );
                     k.push_arg(result[d]);
                     k(queue[d]);
+
+                    result[d].read(queue[d], 0, 1, &flag[d]);
                 }
             }
 
+            bool found = false;
             for(unsigned d = 0; d < queue.size(); ++d) {
                 if (prop.part_size(d)) {
-                    char r;
-                    result[d].read(queue[d], 0, 1, &r, true);
-                    if (r) return true;
+                    backend::finish(queue[d]);
+                    found = found || flag[d];
                 }
             }
-            return false;
+            return found;
         }
 
     private:
         std::vector<backend::command_queue> queue;
         std::vector<backend::device_vector<char>> result;
+        mutable std::vector<char> flag;
 
         template <class Expr>
         static backend::kernel& make_kernel(
@@ -121,8 +133,10 @@ class any_of {
                 src.template parameter< global_ptr<char> >("result");
 
                 src.close(")").open("{");
-                src.new_line() << "for(ulong idx = 0; idx < n; ++idx)";
-                src.open("{");
+                src.new_line() << "volatile " << type_name< global_ptr<char> >()
+                    << " found = result;";
+                src.grid_stride_loop().open("{");
+                src.new_line() << "if (found[0]) break;";
 
                 output_local_preamble lpre(src, q, "prm", empty_state());
                 boost::proto::eval(boost::proto::as_child(expr), lpre);
@@ -134,18 +148,16 @@ class any_of {
 
                 src << ")";
                 src.open("{");
-                src.new_line() << "result[0] = 1;";
-                src.new_line() << "return;";
+                src.new_line() << "found[0] = 1;";
+                src.new_line() << "break;";
                 src.close("}");
 
                 src.close("}");
-                src.new_line() << "result[0] = 0;";
                 src.close("}");
 
                 kernel = cache.insert(q, backend::kernel(
                             q, src.str(), "vexcl_any_of_kernel"
                             ));
-                kernel->second.config(1, 1);
             }
 
             return kernel->second;
@@ -174,6 +186,30 @@ class all_of : public any_of {
         }
 };
 
+/// Functor that counts elements of a vector expression that are true.
+/**
+ * Example:
+\code
+vex::count_if count_if(ctx);
+size_t nnz = count_if(x != 0);
+\endcode
+ */
+class count_if {
+    public:
+        count_if(const std::vector<backend::command_queue> &queue
+#ifndef VEXCL_NO_STATIC_CONTEXT_CONSTRUCTORS
+                = current_context().queue()
+#endif
+              ) : sum(queue) {}
+
+        template <class Expr>
+        size_t operator()(const Expr &expr) const {
+            return sum( if_else(expr, static_cast<size_t>(1), static_cast<size_t>(0)) );
+        }
+    private:
+        Reductor<size_t, SUM> sum;
+};
+
 } // namespace vexcl
 
 
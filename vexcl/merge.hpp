@@ -0,0 +1,345 @@
+#ifndef VEXCL_MERGE_HPP
+#define VEXCL_MERGE_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/merge.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Merge and set operations on sorted vectors.
+ *
+ * Merge uses the merge path partitioning and merge kernels from sort.hpp.
+ * Set operations follow the multiset semantics of the standard library: an
+ * element that occurs m times in the first input and n times in the second
+ * one occurs max(m, n) times in the union, min(m, n) times in the
+ * intersection, and max(m - n, 0) times in the difference. The decision for
+ * each element is made from its rank among equal elements, which is found
+ * by comparing two stable merges of the inputs in O(n + m); the selected
+ * elements are gathered with stream compaction.
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/util.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/element_index.hpp>
+#include <vexcl/sort.hpp>
+#include <vexcl/compaction.hpp>
+
+namespace vex {
+namespace detail {
+namespace setop {
+
+template <typename K, typename V = K>
+inline bool single_device(const vector<K> &a, const vector<V> &b) {
+    return a.nparts() == 1 && b.nparts() == 1 &&
+        !backend::compare_queues()(a.queue_list()[0], b.queue_list()[0]) &&
+        !backend::compare_queues()(b.queue_list()[0], a.queue_list()[0]);
+}
+
+// Merges first a_count elements of a with first b_count elements of b.
+template <typename K, class Comp>
+void merge(const vector<K> &a, size_t a_count, const vector<K> &b, size_t b_count,
+        vector<K> &out, Comp comp)
+{
+    precondition(out.size() >= a_count + b_count, "Output vector is too small");
+
+    if (!b_count) { copy_if(a, element_index() < a_count, out); return; }
+    if (!a_count) { copy_if(b, element_index() < b_count, out); return; }
+
+    if (single_device(a, b) && single_device(a, out)) {
+        auto ak = boost::fusion::transform(forward_as_sequence(a),   extract_device_vector(0));
+        auto bk = boost::fusion::transform(forward_as_sequence(b),   extract_device_vector(0));
+        auto ok = boost::fusion::transform(forward_as_sequence(out), extract_device_vector(0));
+
+        detail::merge(a.queue_list()[0],
+                ak, static_cast<int>(a_count), bk, static_cast<int>(b_count),
+                ok, comp.device);
+        return;
+    }
+
+    // Vectors span several devices. Do the merge on the host.
+    std::vector<K> ha(a_count), hb(b_count), hc(a_count + b_count);
+
+    a.read_data(0, a_count, ha.data(), true);
+    b.read_data(0, b_count, hb.data(), true);
+
+    std::merge(ha.begin(), ha.end(), hb.begin(), hb.end(), hc.begin(), comp);
+
+    out.write_data(0, hc.size(), hc.data(), true);
+}
+
+template <typename K, typename V, class Comp>
+void merge_by_key(
+        const vector<K> &a_keys, const vector<V> &a_vals, size_t a_count,
+        const vector<K> &b_keys, const vector<V> &b_vals, size_t b_count,
+        vector<K> &keys, vector<V> &vals, Comp comp)
+{
+    precondition(keys.size() >= a_count + b_count && vals.size() >= a_count + b_count,
+            "Output vector is too small");
+
+    if (!b_count) {
+        copy_if(a_keys, element_index() < a_count, keys);
+        copy_if(a_vals, element_index() < a_count, vals);
+        return;
+    }
+
+    if (!a_count) {
+        copy_if(b_keys, element_index() < b_count, keys);
+        copy_if(b_vals, element_index() < b_count, vals);
+        return;
+    }
+
+    if (single_device(a_keys, b_keys) && single_device(a_keys, keys) &&
+            single_device(a_keys, a_vals) && single_device(a_keys, b_vals) &&
+            single_device(a_keys, vals))
+    {
+        auto ak = boost::fusion::transform(forward_as_sequence(a_keys), extract_device_vector(0));
+        auto av = boost::fusion::transform(forward_as_sequence(a_vals), extract_device_vector(0));
+        auto bk = boost::fusion::transform(forward_as_sequence(b_keys), extract_device_vector(0));
+        auto bv = boost::fusion::transform(forward_as_sequence(b_vals), extract_device_vector(0));
+        auto ok = boost::fusion::transform(forward_as_sequence(keys),   extract_device_vector(0));
+        auto ov = boost::fusion::transform(forward_as_sequence(vals),   extract_device_vector(0));
+
+        detail::merge_by_key(a_keys.queue_list()[0],
+                ak, av, static_cast<int>(a_count),
+                bk, bv, static_cast<int>(b_count),
+                ok, ov, comp.device);
+        return;
+    }
+
+    std::vector<K> hak(a_count), hbk(b_count), hk(a_count + b_count);
+    std::vector<V> hav(a_count), hbv(b_count), hv(a_count + b_count);
+
+    a_keys.read_data(0, a_count, hak.data(), true);
+    a_vals.read_data(0, a_count, hav.data(), true);
+    b_keys.read_data(0, b_count, hbk.data(), true);
+    b_vals.read_data(0, b_count, hbv.data(), true);
+
+    for(size_t i = 0, j = 0, k = 0; k < hk.size(); ++k) {
+        if (j == b_count || (i < a_count && !comp(hbk[j], hak[i]))) {
+            hk[k] = hak[i];
+            hv[k] = hav[i++];
+        } else {
+            hk[k] = hbk[j];
+            hv[k] = hbv[j++];
+        }
+    }
+
+    keys.write_data(0, hk.size(), hk.data(), true);
+    vals.write_data(0, hv.size(), hv.data(), true);
+}
+
+// For each element of x, checks if y holds an equivalent element of the
+// same rank among the equivalent elements. Within a group of equivalent
+// elements, the merge where x goes first holds the elements of x followed
+// by the ones of y, and the merge where y goes first holds them in the
+// opposite order. So the element of x of rank r takes the position that
+// holds an element of y in the second merge exactly when y has more than r
+// equivalent elements.
+template <typename K, class Comp>
+vector<char> rank_matched(const vector<K> &x, const vector<K> &y, Comp comp) {
+    const std::vector<backend::command_queue> &queue = x.queue_list();
+
+    const size_t n = x.size();
+    const size_t m = y.size();
+
+    vector<char> flag(queue, n);
+    if (!n) return flag;
+
+    vector<char> x_tag(queue, n);
+    vector<char> y_tag(queue, m);
+
+    x_tag = 0;
+    if (m) y_tag = 1;
+
+    vector<K>    keys(queue, n + m);
+    vector<char> x_first(queue, n + m);
+    vector<char> y_first(queue, n + m);
+
+    merge_by_key(x, x_tag, n, y, y_tag, m, keys, x_first, comp);
+    merge_by_key(y, y_tag, m, x, x_tag, n, keys, y_first, comp);
+
+    // Elements of x come in their original order in both merges.
+    copy_if(y_first, x_first == 0, flag);
+
+    return flag;
+}
+
+} // namespace setop
+} // namespace detail
+
+/// Merges two sorted vectors.
+/**
+ * The output vector should hold at least a.size() + b.size() elements.
+ * Equivalent elements from the first vector precede the ones from the
+ * second vector.
+ * \param comp comparison function.
+ */
+template <typename K, class Comp>
+void merge(const vector<K> &a, const vector<K> &b, vector<K> &out, Comp comp) {
+    detail::setop::merge(a, a.size(), b, b.size(), out, comp);
+}
+
+/// Merges two sorted vectors.
+template <typename K>
+void merge(const vector<K> &a, const vector<K> &b, vector<K> &out) {
+    merge(a, b, out, less<K>());
+}
+
+/// Merges two sequences of keys and values sorted by key.
+/**
+ * \param comp comparison function.
+ */
+template <typename K, typename V, class Comp>
+void merge_by_key(
+        const vector<K> &a_keys, const vector<V> &a_vals,
+        const vector<K> &b_keys, const vector<V> &b_vals,
+        vector<K> &keys, vector<V> &vals, Comp comp)
+{
+    precondition(a_keys.size() == a_vals.size() && b_keys.size() == b_vals.size(),
+            "keys and values should have same size");
+
+    detail::setop::merge_by_key(
+            a_keys, a_vals, a_keys.size(),
+            b_keys, b_vals, b_keys.size(),
+            keys, vals, comp);
+}
+
+/// Merges two sequences of keys and values sorted by key.
+template <typename K, typename V>
+void merge_by_key(
+        const vector<K> &a_keys, const vector<V> &a_vals,
+        const vector<K> &b_keys, const vector<V> &b_vals,
+        vector<K> &keys, vector<V> &vals)
+{
+    merge_by_key(a_keys, a_vals, b_keys, b_vals, keys, vals, less<K>());
+}
+
+/// Union of two sorted vectors.
+/**
+ * The output vector should hold at least a.size() + b.size() elements.
+ * Returns the size of the union.
+ */
+template <typename K>
+size_t set_union(const vector<K> &a, const vector<K> &b, vector<K> &out) {
+    // Elements of b that do not have a match in a.
+    vector<char> matched = detail::setop::rank_matched(b, a, less<K>());
+
+    vector<K> rest(b.queue_list(), b.size());
+    size_t n = copy_if(b, matched == 0, rest);
+
+    detail::setop::merge(a, a.size(), rest, n, out, less<K>());
+
+    return a.size() + n;
+}
+
+/// Union of two sequences of keys and values sorted by key.
+/**
+ * Values of the matching elements are taken from the first sequence.
+ * Returns the size of the union.
+ */
+template <typename K, typename V>
+size_t set_union_by_key(
+        const vector<K> &a_keys, const vector<V> &a_vals,
+        const vector<K> &b_keys, const vector<V> &b_vals,
+        vector<K> &keys, vector<V> &vals)
+{
+    vector<char> matched = detail::setop::rank_matched(b_keys, a_keys, less<K>());
+
+    vector<K> rest_keys(b_keys.queue_list(), b_keys.size());
+    vector<V> rest_vals(b_keys.queue_list(), b_keys.size());
+
+    size_t n = copy_if(b_keys, matched == 0, rest_keys);
+    copy_if(b_vals, matched == 0, rest_vals);
+
+    detail::setop::merge_by_key(a_keys, a_vals, a_keys.size(), rest_keys, rest_vals, n,
+            keys, vals, less<K>());
+
+    return a_keys.size() + n;
+}
+
+/// Intersection of two sorted vectors.
+/**
+ * Elements are taken from the first vector. Returns the size of the
+ * intersection.
+ */
+template <typename K>
+size_t set_intersection(const vector<K> &a, const vector<K> &b, vector<K> &out) {
+    return copy_if(a, detail::setop::rank_matched(a, b, less<K>()) != 0, out);
+}
+
+/// Intersection of two sequences of keys and values sorted by key.
+/**
+ * Keys and values are taken from the first sequence. Returns the size of the
+ * intersection.
+ */
+template <typename K, typename V>
+size_t set_intersection_by_key(
+        const vector<K> &a_keys, const vector<V> &a_vals,
+        const vector<K> &b_keys,
+        vector<K> &keys, vector<V> &vals)
+{
+    vector<char> matched = detail::setop::rank_matched(a_keys, b_keys, less<K>());
+
+    size_t n = copy_if(a_keys, matched != 0, keys);
+    copy_if(a_vals, matched != 0, vals);
+
+    return n;
+}
+
+/// Difference of two sorted vectors.
+/**
+ * Copies the elements of a that are not found in b. Returns the size of the
+ * difference.
+ */
+template <typename K>
+size_t set_difference(const vector<K> &a, const vector<K> &b, vector<K> &out) {
+    return copy_if(a, detail::setop::rank_matched(a, b, less<K>()) == 0, out);
+}
+
+/// Difference of two sequences of keys and values sorted by key.
+/**
+ * Returns the size of the difference.
+ */
+template <typename K, typename V>
+size_t set_difference_by_key(
+        const vector<K> &a_keys, const vector<V> &a_vals,
+        const vector<K> &b_keys,
+        vector<K> &keys, vector<V> &vals)
+{
+    vector<char> matched = detail::setop::rank_matched(a_keys, b_keys, less<K>());
+
+    size_t n = copy_if(a_keys, matched == 0, keys);
+    copy_if(a_vals, matched == 0, vals);
+
+    return n;
+}
+
+} // namespace vex
+
+#endif
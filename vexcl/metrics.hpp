@@ -0,0 +1,160 @@
+#ifndef VEXCL_METRICS_HPP
+#define VEXCL_METRICS_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/metrics.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Runtime counters of kernel caches, compilations, transfers and allocations.
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/detail/metrics.hpp>
+
+namespace vex {
+
+/// Runtime counters.
+/**
+ * The counters are always on and are kept per device with relaxed atomic
+ * operations. The library feeds them from kernel caches, program builds,
+ * buffer allocations, and host/device transfers:
+ \code
+ vex::metrics::counters c = vex::metrics::snapshot(ctx);
+ std::cout << c.bytes_uploaded << " bytes uploaded" << std::endl;
+ vex::metrics::reset();
+ \endcode
+ */
+namespace metrics {
+
+/// Snapshot of the runtime counters.
+struct counters {
+    size_t cache_hits;        ///< Kernels found in the in-memory kernel caches.
+    size_t cache_misses;      ///< Kernel lookups that missed the in-memory kernel caches.
+    size_t compiles;          ///< Compilations of kernel sources.
+    size_t binary_cache_hits; ///< Programs loaded from the on-disk cache.
+    size_t uploads;           ///< Host to device transfers.
+    size_t bytes_uploaded;    ///< Bytes transferred from host to device.
+    size_t downloads;         ///< Device to host transfers.
+    size_t bytes_downloaded;  ///< Bytes transferred from device to host.
+    size_t allocations;       ///< Device buffer allocations.
+    size_t bytes_allocated;   ///< Bytes allocated on device.
+    size_t live_bytes;        ///< Bytes currently allocated on device.
+    size_t peak_live_bytes;   ///< Maximum of live_bytes since the last reset.
+
+    counters()
+        : cache_hits(0), cache_misses(0), compiles(0), binary_cache_hits(0),
+          uploads(0), bytes_uploaded(0), downloads(0), bytes_downloaded(0),
+          allocations(0), bytes_allocated(0), live_bytes(0), peak_live_bytes(0)
+    {}
+
+    /// Accumulates counters of another device.
+    counters& operator+=(const detail::metrics::device &d) {
+        cache_hits        += d.cache_hits.load();
+        cache_misses      += d.cache_misses.load();
+        compiles          += d.compiles.load();
+        binary_cache_hits += d.binary_cache_hits.load();
+        uploads           += d.uploads.load();
+        bytes_uploaded    += d.bytes_uploaded.load();
+        downloads         += d.downloads.load();
+        bytes_downloaded  += d.bytes_downloaded.load();
+        allocations       += d.allocations.load();
+        bytes_allocated   += d.bytes_allocated.load();
+        live_bytes        += d.live_bytes.load();
+        peak_live_bytes   += d.peak_live_bytes.load();
+        return *this;
+    }
+};
+
+/// Returns counters of the device associated with the queue.
+inline counters snapshot(const backend::command_queue &q) {
+    counters c;
+    c += backend::detail::device_metrics(q);
+    return c;
+}
+
+/// Returns counters summed over the devices of the queues.
+/**
+ * Each device is only counted once, even when several queues share it.
+ */
+inline counters snapshot(const std::vector<backend::command_queue> &queue) {
+    std::vector<const detail::metrics::device*> seen;
+
+    counters c;
+    for(auto q = queue.begin(); q != queue.end(); ++q) {
+        const detail::metrics::device *d = &backend::detail::device_metrics(*q);
+        if (std::find(seen.begin(), seen.end(), d) != seen.end()) continue;
+
+        seen.push_back(d);
+        c += *d;
+    }
+    return c;
+}
+
+/// Returns counters summed over all devices.
+inline counters snapshot() {
+    detail::metrics::registry &r = detail::metrics::get_registry();
+
+    counters c;
+    for(size_t i = 0; i < detail::metrics::max_devices; ++i)
+        if (r.key[i].load() || i + 1 == detail::metrics::max_devices) c += r.dev[i];
+    return c;
+}
+
+/// Resets the counters of all devices.
+/**
+ * Live memory is not reset; its peak restarts from the current value.
+ */
+inline void reset() {
+    detail::metrics::registry &r = detail::metrics::get_registry();
+
+    for(size_t i = 0; i < detail::metrics::max_devices; ++i)
+        r.dev[i].reset();
+}
+
+} // namespace metrics
+} // namespace vex
+
+namespace std {
+
+/// Sends the counters to the output stream.
+inline std::ostream& operator<<(std::ostream &os, const vex::metrics::counters &c) {
+    return os
+        << "cache hits/misses:       " << c.cache_hits << "/" << c.cache_misses << "\n"
+        << "compiles:                " << c.compiles << "\n"
+        << "binary cache hits:       " << c.binary_cache_hits << "\n"
+        << "uploads (bytes):         " << c.uploads   << " (" << c.bytes_uploaded   << ")\n"
+        << "downloads (bytes):       " << c.downloads << " (" << c.bytes_downloaded << ")\n"
+        << "allocations (bytes):     " << c.allocations << " (" << c.bytes_allocated << ")\n"
+        << "live bytes (peak):       " << c.live_bytes << " (" << c.peak_live_bytes << ")\n";
+}
+
+} // namespace std
+
+#endif
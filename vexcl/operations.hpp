@@ -35,7 +35,10 @@ THE SOFTWARE.
 #include <tuple>
 #include <deque>
 #include <set>
+#include <vector>
+#include <algorithm>
 #include <memory>
+#include <utility>
 
 #include <boost/proto/proto.hpp>
 #include <boost/mpl/max.hpp>
@@ -258,6 +261,26 @@ void extract_expression_properties(
     >::get(term, queue_list, partition, size);
 }
 
+// Number of bytes of global memory a terminal accesses per element of an
+// expression. Used to estimate memory traffic of the generated kernels.
+// Terminals without a specialization make the estimate unknown.
+template <class T, class Enable = void>
+struct terminal_bytes : boost::mpl::size_t<0> {
+    static const bool known = false;
+};
+
+template <size_t N>
+struct known_terminal_bytes : boost::mpl::size_t<N> {
+    static const bool known = true;
+};
+
+// Scalars are passed as kernel parameters.
+template <class T>
+struct terminal_bytes< T,
+    typename std::enable_if< is_cl_native< T >::value >::type
+    > : known_terminal_bytes<0>
+{ };
+
 //---------------------------------------------------------------------------
 // Scalars and helper types/functions used in multivector expressions
 //---------------------------------------------------------------------------
@@ -860,9 +883,28 @@ struct multiadditive_operator
 
     template <bool negate, bool append>
     void apply(V &y) const {
-        for(size_t i = 0; i < traits::number_of_components<V>::value; i++)
-            A.apply(x(i), y(i), negate ? -scale : scale, append);
+        apply_to(A, y, negate ? -scale : scale, append, 0);
     }
+
+    private:
+        typedef typename cl_scalar_of<value_type>::type scalar_type;
+
+        // Operators that are able to process all components at once are
+        // applied to the whole multivector:
+        template <class Op>
+        auto apply_to(const Op &op, V &y, scalar_type s, bool append, int) const
+            -> decltype(op.apply(std::declval<const V&>(), y, s, append))
+        {
+            op.apply(x, y, s, append);
+        }
+
+        // Others are applied to each of the components:
+        template <class Op>
+        void apply_to(const Op &op, V &y, scalar_type s, bool append, long) const
+        {
+            for(size_t i = 0; i < traits::number_of_components<V>::value; i++)
+                op.apply(x(i), y(i), s, append);
+        }
 };
 
 namespace traits {
@@ -1444,6 +1486,120 @@ struct get_expression_properties {
     }
 };
 
+//---------------------------------------------------------------------------
+// Estimation of work done by generated kernels (see vex::profiler).
+//---------------------------------------------------------------------------
+// Sums global memory traffic of the expression terminals. A terminal that
+// appears several times is only counted once. The sum is unknown (and is
+// reported as zero) when any of the terminals does not estimate its traffic.
+struct count_terminal_bytes {
+    mutable double bytes;
+    mutable bool   known;
+    mutable std::vector<const void*> seen;
+
+    count_terminal_bytes() : bytes(0), known(true) {}
+
+    template <typename Term>
+    typename std::enable_if<traits::terminal_is_value<Term>::value, void>::type
+    operator()(const Term &term) const {
+        add(term);
+    }
+
+    template <typename Term>
+    typename std::enable_if<!traits::terminal_is_value<Term>::value, void>::type
+    operator()(const Term &term) const {
+        add(boost::proto::value(term));
+    }
+
+    double total() const {
+        return known ? bytes : 0;
+    }
+
+    private:
+        template <class T>
+        void add(const T &term) const {
+            typedef traits::terminal_bytes<T> term_bytes;
+
+            if (!term_bytes::known) {
+                known = false;
+                return;
+            }
+
+            if (!term_bytes::value) return;
+
+            const void *id = &term;
+            if (std::find(seen.begin(), seen.end(), id) != seen.end()) return;
+
+            seen.push_back(id);
+            bytes += term_bytes::value;
+        }
+};
+
+template <class Tag>
+struct is_arithmetic_tag : std::false_type {};
+
+template <> struct is_arithmetic_tag<boost::proto::tag::plus>       : std::true_type {};
+template <> struct is_arithmetic_tag<boost::proto::tag::minus>      : std::true_type {};
+template <> struct is_arithmetic_tag<boost::proto::tag::multiplies> : std::true_type {};
+template <> struct is_arithmetic_tag<boost::proto::tag::divides>    : std::true_type {};
+template <> struct is_arithmetic_tag<boost::proto::tag::modulus>    : std::true_type {};
+template <> struct is_arithmetic_tag<boost::proto::tag::negate>     : std::true_type {};
+template <> struct is_arithmetic_tag<boost::proto::tag::function>   : std::true_type {};
+
+// Counts arithmetic operations in an expression. Function calls are counted
+// as single operations.
+struct count_flops {
+    double flops;
+
+    count_flops() : flops(0) {}
+
+    template <typename Expr, typename Tag = typename Expr::proto_tag>
+    struct eval {
+        typedef void result_type;
+
+        void operator()(const Expr &expr, count_flops &ctx) const {
+            ctx.flops += is_arithmetic_tag<Tag>::value;
+            boost::fusion::for_each(expr, do_eval<count_flops>(ctx));
+        }
+    };
+
+    template <typename Expr>
+    struct eval<Expr, boost::proto::tag::terminal> {
+        typedef void result_type;
+
+        void operator()(const Expr&, count_flops&) const {}
+    };
+};
+
+// The work estimates are only needed when the kernels are observed.
+inline bool kernel_work_needed() {
+    return static_cast<bool>(backend::kernel_observer()) || vex::detail::trace::enabled();
+}
+
+// Estimated work per element of assignment of rhs to lhs.
+template <class OP, class LHS, class RHS>
+backend::kernel_work assignment_work(const LHS &lhs, const RHS &rhs) {
+    // Compound assignments read lhs and do one more operation.
+    const int compound = !std::is_same<OP, assign::SET>::value;
+
+    count_terminal_bytes lhs_bytes, rhs_bytes;
+    extract_terminals()(boost::proto::as_child(lhs), lhs_bytes);
+
+    // The lhs read by a compound assignment is not read again by the rhs.
+    if (compound) rhs_bytes.seen = lhs_bytes.seen;
+    extract_terminals()(boost::proto::as_child(rhs), rhs_bytes);
+
+    count_flops ops;
+    boost::proto::eval(boost::proto::as_child(rhs), ops);
+
+    if (!lhs_bytes.known || !rhs_bytes.known)
+        return backend::kernel_work(0, ops.flops + compound);
+
+    return backend::kernel_work(
+            (1 + compound) * lhs_bytes.bytes + rhs_bytes.bytes,
+            ops.flops + compound);
+}
+
 //---------------------------------------------------------------------------
 VEXCL_VECTOR_EXPR_EXTRACTOR(extract_vector_expressions,
         vector_expr_grammar,
@@ -1825,6 +1981,11 @@ void assign_expression(LHS &lhs, const RHS &rhs,
 #endif
     static kernel_cache cache;
 
+    // Terminals are only counted once, so the estimate depends on the
+    // actual terminals of the expression.
+    const backend::kernel_work work = kernel_work_needed() ?
+        assignment_work<OP>(lhs, rhs) : backend::kernel_work();
+
     for(unsigned d = 0; d < queue.size(); d++) {
         auto kernel = cache.find(queue[d]);
 
@@ -1878,6 +2039,7 @@ void assign_expression(LHS &lhs, const RHS &rhs,
             extract_terminals()( boost::proto::as_child(lhs), setarg);
             extract_terminals()( boost::proto::as_child(rhs), setarg);
 
+            kernel->second.set_work(psize * work.bytes, psize * work.flops);
             kernel->second(queue[d]);
         }
     }
@@ -2065,6 +2227,30 @@ struct kernel_arg_setter {
     }
 };
 
+template <class OP, class LHS, class RHS>
+struct work_estimator {
+    const LHS &lhs;
+    const RHS &rhs;
+
+    mutable backend::kernel_work work;
+    mutable bool known;
+
+    work_estimator(const LHS &lhs, const RHS &rhs) : lhs(lhs), rhs(rhs), known(true) {}
+
+    // An assignment always writes its lhs, so zero bytes means the traffic
+    // of the component is unknown.
+    template <size_t I>
+    void apply() const {
+        backend::kernel_work w = assignment_work<OP>(
+                subexpression<I>::get(lhs), subexpression<I>::get(rhs));
+
+        known = known && w.bytes > 0;
+
+        work.bytes += w.bytes;
+        work.flops += w.flops;
+    }
+};
+
 template <class OP, class LHS, class RHS>
 void assign_multiexpression( LHS &lhs, const RHS &rhs,
         const std::vector<backend::command_queue> &queue,
@@ -2115,6 +2301,13 @@ void assign_multiexpression( LHS &lhs, const RHS &rhs,
         return;
     }
 
+    const backend::kernel_work work = [&]() {
+        work_estimator<OP, LHS, RHS> estimate(lhs, rhs);
+        if (kernel_work_needed()) static_for<0, N::value>::loop(estimate);
+        if (!estimate.known) estimate.work.bytes = 0;
+        return estimate.work;
+    }();
+
     for(unsigned d = 0; d < queue.size(); d++) {
         auto kernel = cache.find(queue[d]);
 
@@ -2154,6 +2347,7 @@ void assign_multiexpression( LHS &lhs, const RHS &rhs,
                     kernel_arg_setter<LHS, RHS>(lhs, rhs, kernel->second, d, part[d])
                     );
 
+            kernel->second.set_work(psize * work.bytes, psize * work.flops);
             kernel->second(queue[d]);
         }
     }
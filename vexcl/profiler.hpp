@@ -37,11 +37,15 @@ THE SOFTWARE.
 
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <string>
 #include <map>
 #include <memory>
 #include <stack>
 #include <vector>
+#include <deque>
+#include <utility>
+#include <algorithm>
 #include <cassert>
 
 #if defined(_MSC_VER) && (_MSC_VER < 1700)
@@ -117,6 +121,11 @@ class stopwatch {
             return delta;
         }
 
+        /// Adds externally measured interval (in seconds) to the timer.
+        inline void add(double delta) {
+            acc(delta);
+        }
+
         /// Average time across tics.
         inline double average() const {
             namespace ba = boost::accumulators;
@@ -188,6 +197,15 @@ class profiler {
                     return watch.toc();
                 }
 
+                // Collects timings that are not available at toc().
+                virtual void resolve() {
+                    for(auto c = children.begin(); c != children.end(); c++)
+                        (*c)->resolve();
+                }
+
+                // Additional info printed after the timing line.
+                virtual void print_info(std::ostream&, double /*peak*/) const {}
+
                 double children_time() const {
                     double tm = 0;
 
@@ -207,7 +225,7 @@ class profiler {
                 }
 
                 void print(std::ostream &out,
-                        size_t level, double total, size_t width) const
+                        size_t level, double total, size_t width, double peak) const
                 {
                     using namespace std;
                     print_line(out, name, watch.total(), 100 * watch.total() / total, width, level);
@@ -218,6 +236,8 @@ class profiler {
                             << (watch.average() * 1e6) << " usec.)";
                     }
 
+                    print_info(out, peak);
+
                     out << endl;
 
                     if (!children.empty()) {
@@ -230,7 +250,7 @@ class profiler {
                     }
 
                     for(auto c = children.begin(); c != children.end(); c++)
-                        (*c)->print(out, level + shift_width, total, width);
+                        (*c)->print(out, level + shift_width, total, width, peak);
                 }
 
                 void print_line(std::ostream &out, const std::string &name,
@@ -253,14 +273,14 @@ class profiler {
 
                 void tic() {
                     for(auto q = queue.begin(); q != queue.end(); ++q)
-                        q->finish();
+                        backend::finish(*q);
 
                     profile_unit::tic();
                 }
 
                 double toc() {
                     for(auto q = queue.begin(); q != queue.end(); ++q)
-                        q->finish();
+                        backend::finish(*q);
 
                     return profile_unit::toc();
                 }
@@ -268,6 +288,190 @@ class profiler {
                 std::vector<backend::command_queue> &queue;
         };
 
+        class kernel_profile_unit : public profile_unit {
+            public:
+                kernel_profile_unit(const std::string &name)
+                    : profile_unit(name), wait(0), bytes(0), flops(0) {}
+
+                void add(double time, double queue_wait, const backend::kernel_work &work) {
+                    this->watch.add(time);
+                    wait  += queue_wait;
+                    bytes += work.bytes;
+                    flops += work.flops;
+                }
+
+                // Queue wait, transferred data and achieved throughput.
+                // Throughput is only known for the kernels that estimate
+                // their work.
+                void print_info(std::ostream &out, double peak) const {
+                    using namespace std;
+
+                    const double time = this->watch.total();
+                    const char *sep = " [";
+
+                    if (wait > 0) {
+                        out << sep << "wait: " << setprecision(6) << scientific
+                            << (wait / this->watch.tics() * 1e6) << " usec.";
+                        sep = "; ";
+                    }
+
+                    if (bytes > 0 && time > 0) {
+                        out << sep << fixed << setprecision(3)
+                            << (bytes * 1e-6) << " MB, "
+                            << (bytes / time * 1e-9) << " GB/s";
+                        if (peak > 0)
+                            out << " (" << setprecision(1)
+                                << (100 * bytes / time / peak) << "% of peak)";
+                        sep = "; ";
+                    }
+
+                    if (flops > 0 && time > 0) {
+                        out << sep << fixed << setprecision(3)
+                            << (flops / time * 1e-9) << " GFLOP/s";
+                        if (bytes > 0)
+                            out << ", " << (flops / bytes) << " flop/byte";
+                        sep = "; ";
+                    }
+
+                    if (sep[0] == ';') out << "]";
+                }
+            private:
+                double wait, bytes, flops;
+        };
+
+        // Measures device time with events enqueued into the queues, so that
+        // the queues are never drained. Kernels launched by the calling thread
+        // between tic() and toc() are recorded as children of the unit.
+        // Timings are collected as the events complete; the rest is collected
+        // when the profile is printed.
+        class event_profile_unit : public profile_unit {
+            public:
+                event_profile_unit(const std::string &name, std::vector<backend::command_queue> &queue)
+                    : profile_unit(name), queue(queue), active(false) {}
+
+                ~event_profile_unit() {
+                    if (active) backend::kernel_observer() = saved;
+                }
+
+                void tic() {
+                    start.clear();
+                    for(auto q = queue.begin(); q != queue.end(); ++q)
+                        start.push_back(backend::event::marker(*q));
+
+                    saved  = backend::kernel_observer();
+                    active = true;
+
+                    backend::kernel_observer() = [this](
+                            const std::string &name, size_t hash,
+                            const backend::command_queue&,
+                            const backend::event &e,
+                            const backend::kernel_work &work
+                            )
+                    {
+                        launch.push_back(kernel_launch(name, hash, e, work));
+                        collect(false);
+                    };
+
+                    host.tic();
+                }
+
+                double toc() {
+                    std::vector<backend::event> stop;
+                    for(size_t i = 0; i < queue.size(); ++i)
+                        stop.push_back(backend::event(start[i], backend::event::marker(queue[i])));
+                    interval.push_back(stop);
+
+                    backend::kernel_observer() = saved;
+                    active = false;
+
+                    collect(false);
+
+                    return host.toc();
+                }
+
+                void resolve() {
+                    collect(true);
+                    profile_unit::resolve();
+                }
+            private:
+                struct kernel_launch {
+                    std::string          name;
+                    backend::event       e;
+                    backend::kernel_work work;
+
+                    // Generated kernels share a few names, so the kernels
+                    // are told apart by a short hash of their source.
+                    kernel_launch(const std::string &kname, size_t hash,
+                            const backend::event &e, const backend::kernel_work &work)
+                        : e(e), work(work)
+                    {
+                        std::ostringstream s;
+                        s << kname << " [" << std::hex << std::setw(8) << std::setfill('0')
+                          << (hash & 0xffffffff) << "]";
+                        name = s.str();
+                    }
+                };
+
+                // Number of pending events after which the oldest ones are
+                // waited for, so that a long profiled loop does not hold an
+                // unbounded number of device events.
+                static const size_t max_pending = 1024;
+
+                std::vector<backend::command_queue> &queue;
+
+                bool active;
+                backend::kernel_observer_type saved;
+                stopwatch<Clock> host;
+
+                std::vector<backend::event> start;
+                std::deque< std::vector<backend::event> > interval;
+                std::deque<kernel_launch> launch;
+
+                static bool ready(const std::vector<backend::event> &i) {
+                    for(auto e = i.begin(); e != i.end(); ++e)
+                        if (!e->ready()) return false;
+                    return true;
+                }
+
+                // Devices work in parallel, so the slowest one wins.
+                void add_interval(const std::vector<backend::event> &i) {
+                    double t = 0;
+                    for(auto e = i.begin(); e != i.end(); ++e)
+                        t = std::max(t, e->duration());
+                    this->watch.add(t);
+                }
+
+                void add_launch(const kernel_launch &k) {
+                    auto &index = this->children.template get<1>();
+                    auto c = index.find(k.name);
+
+                    if (c == index.end())
+                        c = this->children.template project<1>(this->children.push_back(
+                                    std::make_shared<kernel_profile_unit>(k.name)).first);
+
+                    if (auto u = std::dynamic_pointer_cast<kernel_profile_unit>(*c))
+                        u->add(k.e.duration(), k.e.queue_wait(), k.work);
+                    else
+                        (*c)->watch.add(k.e.duration());
+                }
+
+                // Moves timings of completed events into the profile. With
+                // all = true waits for the pending events. Events complete in
+                // order within a queue, so the scan stops at the first
+                // pending one.
+                void collect(bool all) {
+                    while(!interval.empty() && (all || interval.size() > max_pending || ready(interval.front()))) {
+                        add_interval(interval.front());
+                        interval.pop_front();
+                    }
+
+                    while(!launch.empty() && (all || launch.size() > max_pending || launch.front().e.ready())) {
+                        add_launch(launch.front());
+                        launch.pop_front();
+                    }
+                }
+        };
+
     public:
         /// Constructor.
         /**
@@ -277,7 +481,7 @@ class profiler {
         profiler(
                 const std::vector<backend::command_queue> &queue = std::vector<backend::command_queue>(),
                 const std::string &name = "Profile"
-                ) : queue(queue)
+                ) : queue(queue), peak(0)
         {
             auto root = std::shared_ptr<profile_unit>(new profile_unit(name));
             root->tic();
@@ -308,15 +512,39 @@ class profiler {
         /**
          * Also pushes named interval to the top of the profiler hierarchy.
          * \param name name of the measured interval.
+         *
+         * When every queue was created with profiling enabled (see
+         * vex::backend::profiling_queue), the device time is measured with
+         * events and the queues are not synchronized with the host. Each
+         * kernel launched inside the interval is then reported separately
+         * (kernels sharing a name are told apart by the hash of their source
+         * shown in brackets), along with its average time spent waiting in
+         * the queue (OpenCL only). The device timings are collected when the profile is
+         * printed. Otherwise the queues are finished at tic and toc.
+         *
+         * Kernels generated for vector and multivector expressions and for
+         * reductions also report achieved memory bandwidth and arithmetic
+         * throughput, estimated from the terminals and the operations of
+         * the expression.
          */
         void tic_cl(const std::string &name) {
             assert(!queue.empty());
-            tic(new cl_profile_unit(name, queue));
+
+            bool events = true;
+            for(auto q = queue.begin(); q != queue.end(); ++q)
+                events = events && backend::profiling_enabled(*q);
+
+            if (events)
+                tic(new event_profile_unit(name, queue));
+            else
+                tic(new cl_profile_unit(name, queue));
         }
 
         /// Returns time since last tic.
         /**
          * Also removes interval from the top of the profiler hierarchy.
+         * For event-based intervals the returned value is the host time;
+         * the device time is shown in the printed profile.
          */
         double toc(const std::string &) {
             assert(stack.size() > 1);
@@ -327,6 +555,15 @@ class profiler {
             return delta;
         }
 
+        /// Sets peak memory bandwidth of the devices in bytes per second.
+        /**
+         * Achieved bandwidth of the kernels is then reported as a fraction
+         * of the peak. The peak may be measured with vex::device_bandwidth().
+         */
+        void set_peak_bandwidth(double bytes_per_second) {
+            peak = bytes_per_second;
+        }
+
         /// Outputs profile to the provided stream.
         void print(std::ostream &out) {
             boost::io::ios_all_saver stream_state(out);
@@ -336,12 +573,14 @@ class profiler {
 
             auto root = stack.front();
             double length = root->toc();
+            root->resolve();
             out << std::endl;
-            root->print(out, 0, length, root->max_line_width(0));
+            root->print(out, 0, length, root->max_line_width(0), peak);
         }
 
     private:
         std::vector<backend::command_queue> queue;
+        double peak;
         std::deque<std::shared_ptr<profile_unit>> stack;
 };
 
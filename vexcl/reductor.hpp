@@ -37,8 +37,13 @@ THE SOFTWARE.
 #include <sstream>
 #include <numeric>
 #include <limits>
+#include <utility>
+#include <tuple>
+#include <cmath>
+#include <cstring>
 
 #include <vexcl/operations.hpp>
+#include <vexcl/device_scalar.hpp>
 
 namespace vex {
 
@@ -124,13 +129,392 @@ struct MIN {
     };
 };
 
+/// Base class for reduction kinds with compound accumulators.
+/**
+ * Accumulator of a compound reduction consists of several fields of possibly
+ * different types, and the reduction may depend on the global index of the
+ * reduced element. Fields are kept in separate registers and separate
+ * buffers on the device. In order to define a compound reduction kind, one
+ * should derive it from this class and define a nested template like the
+ * following (see vex::ARGMAX for an example):
+ \code
+ template <class T>
+ struct impl {
+     // Accumulator fields. Should be a std::tuple or a std::pair.
+     typedef std::tuple<...> fields;
+
+     // Result of the reduction returned from vex::Reductor.
+     typedef ... value_type;
+
+     // Initial value of the accumulator.
+     static fields initial();
+
+     // Converts final value of the accumulator to the result.
+     static value_type get(const fields &a);
+
+     // Outputs device code folding the element with value v and global
+     // index i into the accumulator with fields a[0], a[1], ...
+     static void element(backend::source_generator &src,
+         const std::vector<std::string> &a, const std::string &v, const std::string &i);
+
+     // Outputs device code combining accumulator b into accumulator a.
+     static void combine(backend::source_generator &src,
+         const std::vector<std::string> &a, const std::vector<std::string> &b);
+
+     // Host-side combination of two accumulators.
+     fields operator()(const fields &a, const fields &b) const;
+ };
+ \endcode
+ * Compound kinds with scalar results may also define
+ \code
+ // Outputs device expression for the result of the reduction.
+ static void device_result(backend::source_generator &src,
+     const std::vector<std::string> &a);
+ \endcode
+ * and then they may be used to reduce slices of multidimensional expressions
+ * with vex::reduce().
+ */
+struct compound_reduction {};
+
+/// \cond INTERNAL
+namespace detail {
+
+// Value and index of the extreme element. Cmp is either MIN or MAX.
+template <typename T, class Cmp>
+struct arg_reduction {
+    typedef std::pair<T, size_t> fields;
+    typedef std::pair<T, size_t> value_type;
+
+    static fields initial() {
+        return fields(Cmp::template impl<T>::initial(), static_cast<size_t>(-1));
+    }
+
+    static value_type get(const fields &a) {
+        return a;
+    }
+
+    static void element(backend::source_generator &src,
+            const std::vector<std::string> &a, const std::string &v, const std::string &i)
+    {
+        std::vector<std::string> b;
+        b.push_back(v);
+        b.push_back(i);
+        combine(src, a, b);
+    }
+
+    // Ties are resolved in favor of the smaller index. An accumulator with
+    // index (size_t)-1 is empty, so that the first element always replaces
+    // it, even if it is infinite, NaN, or equal to the initial value.
+    static void combine(backend::source_generator &src,
+            const std::vector<std::string> &a, const std::vector<std::string> &b)
+    {
+        const std::string none = "(" + type_name<size_t>() + ")(-1)";
+
+        src.new_line() << "if (" << b[1] << " != " << none << " && ("
+            << a[1] << " == " << none << " || "
+            << b[0] << " " << op() << " " << a[0] << " || ("
+            << b[0] << " == " << a[0] << " && " << b[1] << " < " << a[1] << ")))";
+        src.open("{");
+        src.new_line() << a[0] << " = " << b[0] << ";";
+        src.new_line() << a[1] << " = " << b[1] << ";";
+        src.close("}");
+    }
+
+    fields operator()(const fields &a, const fields &b) const {
+        const size_t none = static_cast<size_t>(-1);
+
+        if (b.second == none) return a;
+        if (a.second == none) return b;
+
+        bool better = std::is_same<Cmp, MAX>::value ?
+            b.first > a.first : b.first < a.first;
+
+        return (better || (b.first == a.first && b.second < a.second)) ? b : a;
+    }
+
+    static const char* op() {
+        return std::is_same<Cmp, MAX>::value ? ">" : "<";
+    }
+};
+
+} // namespace detail
+/// \endcond
+
+/// Maximum element and its index.
+/**
+ * Reductor with this kind returns std::pair<T, size_t> holding the value of
+ * the maximum element and its global index. The smallest index is returned
+ * when there are several maximum elements.
+ */
+struct ARGMAX : compound_reduction {
+    template <class T>
+    struct impl : detail::arg_reduction<T, MAX> {};
+};
+
+/// Minimum element and its index.
+/**
+ * Reductor with this kind returns std::pair<T, size_t> holding the value of
+ * the minimum element and its global index. The smallest index is returned
+ * when there are several minimum elements.
+ */
+struct ARGMIN : compound_reduction {
+    template <class T>
+    struct impl : detail::arg_reduction<T, MIN> {};
+};
+
+/// Descriptive statistics of a sample.
+/**
+ * Holds number of elements in the sample, its mean, and central moments
+ * of the sample multiplied by the number of elements (m2 is sum of squared
+ * deviations from the mean, etc).
+ */
+template <typename T>
+struct statistics {
+    size_t count;
+    T mean, m2, m3, m4;
+
+    statistics() : count(0), mean(), m2(), m3(), m4() {}
+
+    /// Population variance.
+    T variance() const {
+        return count ? m2 / count : T();
+    }
+
+    /// Unbiased sample variance.
+    T sample_variance() const {
+        return count > 1 ? m2 / (count - 1) : T();
+    }
+
+    /// Skewness. Only available for vex::MOMENTS.
+    T skewness() const {
+        return m2 > 0 ? std::sqrt(static_cast<T>(count)) * m3 / std::pow(m2, static_cast<T>(1.5)) : T();
+    }
+
+    /// Excess kurtosis. Only available for vex::MOMENTS.
+    T kurtosis() const {
+        return m2 > 0 ? count * m4 / (m2 * m2) - 3 : T();
+    }
+};
+
+/// \cond INTERNAL
+namespace detail {
+
+// Single-pass Welford update of mean and central moments. Accumulators are
+// combined with the formulas of Chan et al. and Pebay. Order is either 2
+// (count, mean, m2) or 4 (count, mean, m2, m3, m4).
+template <typename T, int Order>
+struct welford {
+    typedef typename std::conditional<Order == 2,
+                std::tuple<size_t, T, T>,
+                std::tuple<size_t, T, T, T, T>
+            >::type fields;
+
+    static fields initial() {
+        return pack(statistics<T>());
+    }
+
+    static void element(backend::source_generator &src,
+            const std::vector<std::string> &a, const std::string &v, const std::string&)
+    {
+        const std::string t = type_name<T>();
+
+        src.open("{");
+        src.new_line() << t << " w_x = " << v << ";";
+        src.new_line() << t << " w_n1 = (" << t << ")" << a[0] << ";";
+        src.new_line() << a[0] << " += 1;";
+        src.new_line() << t << " w_n = (" << t << ")" << a[0] << ";";
+        src.new_line() << t << " w_delta = w_x - " << a[1] << ";";
+        src.new_line() << t << " w_delta_n = w_delta / w_n;";
+        src.new_line() << t << " w_term = w_delta * w_delta_n * w_n1;";
+        src.new_line() << a[1] << " += w_delta_n;";
+        if (Order > 2) {
+            src.new_line() << t << " w_delta_n2 = w_delta_n * w_delta_n;";
+            src.new_line() << a[4] << " += w_term * w_delta_n2 * (w_n * w_n - 3 * w_n + 3)"
+                " + 6 * w_delta_n2 * " << a[2] << " - 4 * w_delta_n * " << a[3] << ";";
+            src.new_line() << a[3] << " += w_term * w_delta_n * (w_n - 2)"
+                " - 3 * w_delta_n * " << a[2] << ";";
+        }
+        src.new_line() << a[2] << " += w_term;";
+        src.close("}");
+    }
+
+    static void combine(backend::source_generator &src,
+            const std::vector<std::string> &a, const std::vector<std::string> &b)
+    {
+        const std::string t = type_name<T>();
+
+        src.new_line() << "if (" << b[0] << ")";
+        src.open("{");
+        src.new_line() << t << " w_na = (" << t << ")" << a[0] << ";";
+        src.new_line() << t << " w_nb = (" << t << ")" << b[0] << ";";
+        src.new_line() << t << " w_n = w_na + w_nb;";
+        src.new_line() << t << " w_delta = " << b[1] << " - " << a[1] << ";";
+        src.new_line() << t << " w_delta2 = w_delta * w_delta;";
+        if (Order > 2) {
+            src.new_line() << t << " w_m3 = " << a[3] << " + " << b[3]
+                << " + w_delta * w_delta2 * w_na * w_nb * (w_na - w_nb) / (w_n * w_n)"
+                << " + 3 * w_delta * (w_na * " << b[2] << " - w_nb * " << a[2] << ") / w_n;";
+            src.new_line() << t << " w_m4 = " << a[4] << " + " << b[4]
+                << " + w_delta2 * w_delta2 * w_na * w_nb * (w_na * w_na - w_na * w_nb + w_nb * w_nb) / (w_n * w_n * w_n)"
+                << " + 6 * w_delta2 * (w_na * w_na * " << b[2] << " + w_nb * w_nb * " << a[2] << ") / (w_n * w_n)"
+                << " + 4 * w_delta * (w_na * " << b[3] << " - w_nb * " << a[3] << ") / w_n;";
+        }
+        src.new_line() << a[2] << " += " << b[2] << " + w_delta2 * w_na * w_nb / w_n;";
+        src.new_line() << a[1] << " += w_delta * w_nb / w_n;";
+        src.new_line() << a[0] << " += " << b[0] << ";";
+        if (Order > 2) {
+            src.new_line() << a[3] << " = w_m3;";
+            src.new_line() << a[4] << " = w_m4;";
+        }
+        src.close("}");
+    }
+
+    fields operator()(const fields &a, const fields &b) const {
+        return pack(combine(unpack(a), unpack(b)));
+    }
+
+    static statistics<T> combine(const statistics<T> &a, const statistics<T> &b) {
+        if (b.count == 0) return a;
+        if (a.count == 0) return b;
+
+        T na = static_cast<T>(a.count);
+        T nb = static_cast<T>(b.count);
+        T n  = na + nb;
+
+        T delta  = b.mean - a.mean;
+        T delta2 = delta * delta;
+
+        statistics<T> c;
+        c.count = a.count + b.count;
+        c.mean  = a.mean + delta * nb / n;
+        c.m2    = a.m2 + b.m2 + delta2 * na * nb / n;
+        c.m3    = a.m3 + b.m3
+                + delta * delta2 * na * nb * (na - nb) / (n * n)
+                + 3 * delta * (na * b.m2 - nb * a.m2) / n;
+        c.m4    = a.m4 + b.m4
+                + delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n)
+                + 6 * delta2 * (na * na * b.m2 + nb * nb * a.m2) / (n * n)
+                + 4 * delta * (na * b.m3 - nb * a.m3) / n;
+        return c;
+    }
+
+    static statistics<T> unpack(const std::tuple<size_t, T, T> &f) {
+        statistics<T> s;
+        s.count = std::get<0>(f);
+        s.mean  = std::get<1>(f);
+        s.m2    = std::get<2>(f);
+        return s;
+    }
+
+    static statistics<T> unpack(const std::tuple<size_t, T, T, T, T> &f) {
+        statistics<T> s = unpack(std::make_tuple(std::get<0>(f), std::get<1>(f), std::get<2>(f)));
+        s.m3 = std::get<3>(f);
+        s.m4 = std::get<4>(f);
+        return s;
+    }
+
+    static fields pack(const statistics<T> &s) {
+        return pack(s, static_cast<fields*>(0));
+    }
+
+    static std::tuple<size_t, T, T> pack(const statistics<T> &s, std::tuple<size_t, T, T>*) {
+        return std::make_tuple(s.count, s.mean, s.m2);
+    }
+
+    static std::tuple<size_t, T, T, T, T> pack(const statistics<T> &s, std::tuple<size_t, T, T, T, T>*) {
+        return std::make_tuple(s.count, s.mean, s.m2, s.m3, s.m4);
+    }
+};
+
+} // namespace detail
+/// \endcond
+
+/// Count, mean, and sum of squared deviations from the mean.
+/**
+ * Computed in a single pass with a numerically stable algorithm. Reductor
+ * with this kind returns vex::statistics<T>.
+ */
+struct STATISTICS : compound_reduction {
+    template <class T>
+    struct impl : detail::welford<T, 2> {
+        typedef statistics<T> value_type;
+
+        static value_type get(const typename detail::welford<T, 2>::fields &a) {
+            return detail::welford<T, 2>::unpack(a);
+        }
+    };
+};
+
+/// Count, mean, and central moments up to the fourth.
+/**
+ * Same as vex::STATISTICS, but also computes the third and the fourth central
+ * moments, so that statistics::skewness() and statistics::kurtosis() are
+ * available.
+ */
+struct MOMENTS : compound_reduction {
+    template <class T>
+    struct impl : detail::welford<T, 4> {
+        typedef statistics<T> value_type;
+
+        static value_type get(const typename detail::welford<T, 4>::fields &a) {
+            return detail::welford<T, 4>::unpack(a);
+        }
+    };
+};
+
+/// Mean value.
+/**
+ * Unlike vex::SUM, may be used with vex::reduce() to compute means along
+ * dimensions of a multidimensional expression.
+ */
+struct MEAN : compound_reduction {
+    template <class T>
+    struct impl : detail::welford<T, 2> {
+        typedef T value_type;
+
+        static value_type get(const typename detail::welford<T, 2>::fields &a) {
+            return std::get<1>(a);
+        }
+
+        static void device_result(backend::source_generator &src,
+                const std::vector<std::string> &a)
+        {
+            src << a[1];
+        }
+    };
+};
+
+/// Population variance.
+/**
+ * Computed in a single pass with a numerically stable algorithm. May be used
+ * with vex::reduce() to compute variances along dimensions of a
+ * multidimensional expression.
+ */
+struct VARIANCE : compound_reduction {
+    template <class T>
+    struct impl : detail::welford<T, 2> {
+        typedef T value_type;
+
+        static value_type get(const typename detail::welford<T, 2>::fields &a) {
+            return detail::welford<T, 2>::unpack(a).variance();
+        }
+
+        static void device_result(backend::source_generator &src,
+                const std::vector<std::string> &a)
+        {
+            src << "(" << a[0] << " ? " << a[2] << " / " << a[0]
+                << " : (" << type_name<T>() << ")0)";
+        }
+    };
+};
+
 /// Parallel reduction of arbitrary expression.
 /**
  * Reduction uses small temporary buffer on each device present in the queue
  * parameter. One Reductor class for each reduction kind is enough per thread
  * of execution.
  */
-template <typename real, class RDC = SUM>
+template <typename real, class RDC = SUM, class Enable = void>
 class Reductor {
     public:
         /// Constructor.
@@ -164,6 +548,24 @@ class Reductor {
         >::type
 #endif
         operator()(const Expr &expr) const;
+
+        /// Compute reduction of a vector expression and leave the result on the compute devices.
+        /**
+         * On a single device, the partial results of the work-groups are
+         * combined on the device, and the host is not synchronized with the
+         * device. In multi-device contexts the partial results are combined
+         * on the host, and the result is written to each of the devices.
+         */
+        template <class Expr>
+#ifdef DOXYGEN
+        void
+#else
+        typename std::enable_if<
+            boost::proto::matches<Expr, vector_expr_grammar>::value,
+            void
+        >::type
+#endif
+        operator()(const Expr &expr, device_scalar<real> &result) const;
     private:
         mutable std::vector<backend::command_queue> queue;
 
@@ -186,20 +588,19 @@ class Reductor {
             return cache;
         }
 
-        template <size_t I, size_t N, class Expr>
-        typename std::enable_if<I == N, void>::type
-        assign_subexpressions(std::array<real, N> &, const Expr &) const
-        { }
-
-        template <size_t I, size_t N, class Expr>
-        typename std::enable_if<I < N, void>::type
-        assign_subexpressions(std::array<real, N> &result, const Expr &expr) const
-        {
-            result[I] = (*this)(detail::extract_subexpression<I>()(expr));
-
-            assign_subexpressions<I + 1, N, Expr>(result, expr);
+        // The kernel that combines partial results on the device does not
+        // depend on the reduced expression.
+        static detail::kernel_cache& get_combine_cache() {
+            static detail::kernel_cache cache;
+            return cache;
         }
 
+        // Launches reduction kernels that leave partial results of each
+        // work-group in the device buffers.
+        template <class Expr>
+        void partial_reduce(const Expr &expr,
+                const detail::get_expression_properties &prop) const;
+
         template <class Expr, class OP>
         struct local_sum {
             static void get(const backend::command_queue &q, const Expr &expr,
@@ -257,35 +658,260 @@ class Reductor {
         };
 };
 
-#ifndef DOXYGEN
+/// \cond INTERNAL
+namespace detail {
+
+// std::tuple with N copies of reduction kind RDC.
+template <class RDC, size_t N, class... Kinds>
+struct repeat_reduction : repeat_reduction<RDC, N - 1, RDC, Kinds...> {};
+
+template <class RDC, class... Kinds>
+struct repeat_reduction<RDC, 0, Kinds...> {
+    typedef std::tuple<Kinds...> type;
+};
+
+// Per work-item accumulation for fused reductions.
 template <typename real, class RDC>
-Reductor<real,RDC>::Reductor(const std::vector<backend::command_queue> &queue)
+struct fused_accumulator {
+    static void init(backend::source_generator &source, size_t i) {
+        source.new_line()
+            << type_name<real>() << " mySum_" << i << " = ("
+            << type_name<real>() << ")" << RDC::template impl<real>::initial() << ";";
+    }
+
+    static void update(backend::source_generator &source, size_t i, size_t j) {
+        typedef typename RDC::template impl<real>::device fun;
+
+        source.new_line() << "mySum_" << i << " = "
+            << fun::name() << "(mySum_" << i << ", val_" << j << ");";
+    }
+};
+
+template <typename real>
+struct fused_accumulator<real, SUM_Kahan> {
+    static void init(backend::source_generator &source, size_t i) {
+        source.new_line()
+            << type_name<real>() << " mySum_" << i << " = ("
+            << type_name<real>() << ")0, c_" << i << " = ("
+            << type_name<real>() << ")0;";
+    }
+
+    static void update(backend::source_generator &source, size_t i, size_t j) {
+        source.open("{");
+        source.new_line() << type_name<real>() << " y = val_" << j << " - c_" << i << ";";
+        source.new_line() << type_name<real>() << " t = mySum_" << i << " + y;";
+        source.new_line() << "c_" << i << " = (t - mySum_" << i << ") - y;";
+        source.new_line() << "mySum_" << i << " = t;";
+        source.close("}");
+    }
+};
+
+// Kernel generation steps for a fused reduction of a multivector expression
+// (or a tuple of vector expressions). Reduction kind I is applied to
+// component I of the expression, or to the only component when the
+// expression has dimension one.
+template <typename real, class Kinds, class Expr>
+struct fused_reduction {
+    static const size_t N = std::tuple_size<Kinds>::value;
+    static const size_t E = traits::get_dimension<Expr>::value;
+
+    template <size_t I>
+    struct kind {
+        typedef typename std::tuple_element<I, Kinds>::type type;
+        typedef typename type::template impl<real> impl;
+        static const size_t component = (E == 1 ? 0 : I);
+    };
+
+    struct preamble {
+        const Expr &expr;
+        output_terminal_preamble &ctx;
+
+        preamble(const Expr &expr, output_terminal_preamble &ctx)
+            : expr(expr), ctx(ctx)
+        {}
+
+        template <size_t J>
+        void apply() const {
+            boost::proto::eval(boost::proto::as_child(subexpression<J>::get(expr)), ctx);
+        }
+    };
+
+    // Definitions of the device-side reduction functions.
+    struct functions {
+        output_terminal_preamble &ctx;
+
+        functions(output_terminal_preamble &ctx) : ctx(ctx) {}
+
+        template <size_t I>
+        void apply() const {
+            typedef typename kind<I>::impl::device fun;
+            boost::proto::eval(boost::proto::as_child( fun()( real(), real()) ), ctx);
+        }
+    };
+
+    struct parameters {
+        const Expr &expr;
+        mutable declare_expression_parameter ctx;
+
+        parameters(const Expr &expr, backend::source_generator &source,
+                const backend::command_queue &queue)
+            : expr(expr), ctx(source, queue, "prm", empty_state())
+        {}
+
+        template <size_t J>
+        void apply() const {
+            extract_terminals()(subexpression<J>::get(expr), ctx);
+        }
+    };
+
+    struct values {
+        const Expr &expr;
+        backend::source_generator &source;
+        mutable output_local_preamble pre;
+        mutable vector_expr_context   ctx;
+
+        values(const Expr &expr, backend::source_generator &source,
+                const backend::command_queue &queue)
+            : expr(expr), source(source),
+              pre(source, queue, "prm", empty_state()),
+              ctx(source, queue, "prm", empty_state())
+        {}
+
+        template <size_t J>
+        void apply() const {
+            boost::proto::eval(boost::proto::as_child(subexpression<J>::get(expr)), pre);
+
+            source.new_line() << type_name<real>() << " val_" << J << " = ";
+            boost::proto::eval(boost::proto::as_child(subexpression<J>::get(expr)), ctx);
+            source << ";";
+        }
+    };
+
+    struct init {
+        backend::source_generator &source;
+        init(backend::source_generator &source) : source(source) {}
+
+        template <size_t I>
+        void apply() const {
+            fused_accumulator<real, typename kind<I>::type>::init(source, I);
+        }
+    };
+
+    struct update {
+        backend::source_generator &source;
+        update(backend::source_generator &source) : source(source) {}
+
+        template <size_t I>
+        void apply() const {
+            fused_accumulator<real, typename kind<I>::type>::update(
+                    source, I, kind<I>::component);
+        }
+    };
+
+    // One step of the tree reduction in shared memory.
+    struct combine {
+        backend::source_generator &source;
+        const char *buf;
+        unsigned bs;
+
+        combine(backend::source_generator &source, const char *buf, unsigned bs)
+            : source(source), buf(buf), bs(bs) {}
+
+        template <size_t I>
+        void apply() const {
+            typedef typename kind<I>::impl::device fun;
+
+            source.new_line() << buf << "_" << I << "[tid] = mySum_" << I << " = "
+                << fun::name() << "(mySum_" << I << ", "
+                << buf << "_" << I << "[tid + " << bs << "]);";
+        }
+    };
+
+    struct arguments {
+        const Expr &expr;
+        mutable set_expression_argument ctx;
+
+        arguments(const Expr &expr, backend::kernel &krn, unsigned part, size_t offset)
+            : expr(expr), ctx(krn, part, offset, empty_state())
+        {}
+
+        template <size_t J>
+        void apply() const {
+            extract_terminals()(subexpression<J>::get(expr), ctx);
+        }
+    };
+
+    struct properties {
+        const Expr &expr;
+        get_expression_properties &prop;
+
+        properties(const Expr &expr, get_expression_properties &prop)
+            : expr(expr), prop(prop) {}
+
+        template <size_t J>
+        void apply() const {
+            extract_terminals()(subexpression<J>::get(expr), prop);
+        }
+    };
+
+    // Combines partial results of the work-groups on the host.
+    struct finalize {
+        const std::vector<real> &hbuf;
+        std::array<real, N> &result;
+
+        finalize(const std::vector<real> &hbuf, std::array<real, N> &result)
+            : hbuf(hbuf), result(result) {}
+
+        template <size_t I>
+        void apply() const {
+            typename kind<I>::impl rdc;
+            for(size_t g = I; g < hbuf.size(); g += N)
+                result[I] = rdc(result[I], hbuf[g]);
+        }
+    };
+
+    struct initial {
+        std::array<real, N> &result;
+        initial(std::array<real, N> &result) : result(result) {}
+
+        template <size_t I>
+        void apply() const {
+            result[I] = kind<I>::impl::initial();
+        }
+    };
+};
+
+} // namespace detail
+/// \endcond
+
+#ifndef DOXYGEN
+template <typename real, class RDC, class Enable>
+Reductor<real,RDC,Enable>::Reductor(const std::vector<backend::command_queue> &queue)
     : queue(queue)
 { }
 
-template <typename real, class RDC> template <class Expr>
-typename std::enable_if<
-    boost::proto::matches<Expr, vector_expr_grammar>::value,
-    real
->::type
-Reductor<real,RDC>::operator()(const Expr &expr) const {
+template <typename real, class RDC, class Enable> template <class Expr>
+void Reductor<real,RDC,Enable>::partial_reduce(const Expr &expr,
+        const detail::get_expression_properties &prop) const
+{
     using namespace detail;
 
     static kernel_cache cache;
 
-    auto &data_cache = get_data_cache();
+    // Each element is read and reduced once.
+    const backend::kernel_work work = [&]() {
+        if (!kernel_work_needed()) return backend::kernel_work();
 
-    get_expression_properties prop;
-    extract_terminals()(expr, prop);
+        count_terminal_bytes bytes;
+        extract_terminals()(boost::proto::as_child(expr), bytes);
 
-    real initial = RDC::template impl<real>::initial();
+        count_flops ops;
+        boost::proto::eval(boost::proto::as_child(expr), ops);
 
-    // If expression is of zero size, then there is nothing to do. Hurray!
-    if (prop.size == 0) return initial;
+        return backend::kernel_work(bytes.total(), ops.flops + 1);
+    }();
 
-    // Sometimes the expression only knows its size:
-    if (prop.size && prop.part.empty())
-        prop.part = vex::partition(prop.size, queue);
+    auto &data_cache = get_data_cache();
 
     for(unsigned d = 0; d < queue.size(); ++d) {
         auto kernel = cache.find(queue[d]);
@@ -376,9 +1002,35 @@ Reductor<real,RDC>::operator()(const Expr &expr) const {
                             return wgs * sizeof(real);
                         });
 
+            kernel->second.set_work(psize * work.bytes, psize * work.flops);
             kernel->second(queue[d]);
         }
     }
+}
+
+template <typename real, class RDC, class Enable> template <class Expr>
+typename std::enable_if<
+    boost::proto::matches<Expr, vector_expr_grammar>::value,
+    real
+>::type
+Reductor<real,RDC,Enable>::operator()(const Expr &expr) const {
+    using namespace detail;
+
+    auto &data_cache = get_data_cache();
+
+    get_expression_properties prop;
+    extract_terminals()(expr, prop);
+
+    real initial = RDC::template impl<real>::initial();
+
+    // If expression is of zero size, then there is nothing to do. Hurray!
+    if (prop.size == 0) return initial;
+
+    // Sometimes the expression only knows its size:
+    if (prop.size && prop.part.empty())
+        prop.part = vex::partition(prop.size, queue);
+
+    partial_reduce(expr, prop);
 
     for(unsigned d = 0; d < queue.size(); d++) {
         if (prop.part_size(d)) {
@@ -394,7 +1046,7 @@ Reductor<real,RDC>::operator()(const Expr &expr) const {
         if (prop.part_size(d)) {
             auto data = data_cache.find(queue[d]);
 
-            queue[d].finish();
+            backend::finish(queue[d]);
 
             result = rdc(result, std::accumulate(
                         data->second.hbuf.begin(), data->second.hbuf.end(),
@@ -405,19 +1057,690 @@ Reductor<real,RDC>::operator()(const Expr &expr) const {
     return result;
 }
 
-template <typename real, class RDC> template <class Expr>
+template <typename real, class RDC, class Enable> template <class Expr>
 typename std::enable_if<
-    boost::proto::matches<Expr, multivector_expr_grammar>::value &&
-    !boost::proto::matches<Expr, vector_expr_grammar>::value,
-    std::array<real, std::result_of<traits::multiex_dimension(Expr)>::type::value>
+    boost::proto::matches<Expr, vector_expr_grammar>::value,
+    void
 >::type
-Reductor<real,RDC>::operator()(const Expr &expr) const {
-    const size_t dim = std::result_of<traits::multiex_dimension(Expr)>::type::value;
-    std::array<real, dim> result;
+Reductor<real,RDC,Enable>::operator()(const Expr &expr, device_scalar<real> &result) const {
+    using namespace detail;
 
-    assign_subexpressions<0, dim, Expr>(result, expr);
+    precondition(result.queue_list().size() == queue.size(),
+            "Reduction result should reside on the same devices as the reductor");
 
-    return result;
+    if (queue.size() > 1) {
+        result = (*this)(expr);
+        return;
+    }
+
+    get_expression_properties prop;
+    extract_terminals()(expr, prop);
+
+    real initial = RDC::template impl<real>::initial();
+
+    if (prop.size == 0) {
+        result = initial;
+        return;
+    }
+
+    if (prop.part.empty())
+        prop.part = vex::partition(prop.size, queue);
+
+    partial_reduce(expr, prop);
+
+    // Combine partial results of the work-groups on the device.
+    kernel_cache &cache = get_combine_cache();
+
+    backend::select_context(queue[0]);
+
+    auto kernel = cache.find(queue[0]);
+
+    if (kernel == cache.end()) {
+        backend::source_generator source(queue[0]);
+
+        typedef typename RDC::template impl<real>::device fun;
+
+        output_terminal_preamble termpream(source, queue[0], "prm", empty_state());
+        boost::proto::eval(boost::proto::as_child( fun()( real(), real()) ), termpream);
+
+        source.kernel("vexcl_reductor_combine")
+            .open("(")
+                .template parameter<size_t>("n")
+                .template parameter< global_ptr<const real> >("g_idata")
+                .template parameter< global_ptr<real> >("g_result")
+            .close(")").open("{");
+
+        source.new_line()
+            << type_name<real>() << " mySum = ("
+            << type_name<real>() << ")" << initial << ";";
+        source.new_line() << "for(size_t i = 0; i < n; ++i) mySum = "
+            << fun::name() << "(mySum, g_idata[i]);";
+        source.new_line() << "g_result[0] = mySum;";
+        source.close("}");
+
+        kernel = cache.insert(queue[0], backend::kernel(
+                    queue[0], source.str(), "vexcl_reductor_combine"));
+
+        // The number of partial results is small, a single thread is enough.
+        kernel->second.config(1, 1);
+    }
+
+    auto data = get_data_cache().find(queue[0]);
+
+    kernel->second.push_arg(data->second.hbuf.size());
+    kernel->second.push_arg(data->second.dbuf);
+    kernel->second.push_arg(result(0));
+
+    kernel->second(queue[0]);
+}
+
+template <typename real, class RDC, class Enable> template <class Expr>
+typename std::enable_if<
+    boost::proto::matches<Expr, multivector_expr_grammar>::value &&
+    !boost::proto::matches<Expr, vector_expr_grammar>::value,
+    std::array<real, std::result_of<traits::multiex_dimension(Expr)>::type::value>
+>::type
+Reductor<real,RDC,Enable>::operator()(const Expr &expr) const {
+    const size_t dim = std::result_of<traits::multiex_dimension(Expr)>::type::value;
+
+    // Components are reduced in a single fused kernel.
+    return Reductor<real, typename detail::repeat_reduction<RDC, dim>::type>(queue)(expr);
+}
+#endif
+
+/// Fused reduction of several kinds in a single pass.
+/**
+ * Computes several reductions of a vector expression, or reductions of the
+ * components of a multivector expression (or of a tuple of vector
+ * expressions), in a single kernel and with a single readback per device:
+ \code
+ vex::Reductor<double, std::tuple<vex::SUM, vex::MIN, vex::MAX>> stat(ctx);
+
+ // Sum, minimum and maximum of x:
+ std::array<double, 3> r = stat(x);
+
+ // Sum of x * y, minimum of x, and maximum of y:
+ std::array<double, 3> q = stat(std::forward_as_tuple(x * y, x, y));
+ \endcode
+ * The tuple should hold references to its elements (std::forward_as_tuple()
+ * or std::tie()); std::make_tuple() would make copies of the vectors.
+ */
+template <typename real, class... RDC>
+class Reductor<real, std::tuple<RDC...>> {
+    public:
+        /// Number of the reductions computed.
+        static const size_t N = sizeof...(RDC);
+
+        /// Constructor.
+        Reductor(const std::vector<backend::command_queue> &queue
+#ifndef VEXCL_NO_STATIC_CONTEXT_CONSTRUCTORS
+                = current_context().queue()
+#endif
+                ) : queue(queue)
+        { }
+
+        /// Applies each of the reduction kinds to a vector expression.
+        template <class Expr>
+#ifdef DOXYGEN
+        std::array<real, N>
+#else
+        typename std::enable_if<
+            boost::proto::matches<
+                typename boost::proto::result_of::as_expr<Expr>::type,
+                vector_expr_grammar
+            >::value,
+            std::array<real, N>
+        >::type
+#endif
+        operator()(const Expr &expr) const {
+            return reduce(std::tie(expr));
+        }
+
+        /// Applies I-th reduction kind to I-th component of a multivector expression.
+        template <class Expr>
+#ifdef DOXYGEN
+        std::array<real, N>
+#else
+        typename std::enable_if<
+            boost::proto::matches<
+                typename boost::proto::result_of::as_expr<Expr>::type,
+                multivector_expr_grammar
+            >::value &&
+            !boost::proto::matches<
+                typename boost::proto::result_of::as_expr<Expr>::type,
+                vector_expr_grammar
+            >::value,
+            std::array<real, N>
+        >::type
+#endif
+        operator()(const Expr &expr) const {
+            return reduce(expr);
+        }
+
+        /// Applies I-th reduction kind to I-th vector expression in a tuple.
+        template <class... Expr>
+        std::array<real, N> operator()(const std::tuple<Expr...> &expr) const {
+            return reduce(expr);
+        }
+    private:
+        mutable std::vector<backend::command_queue> queue;
+
+        struct reductor_data {
+            std::vector<real>            hbuf;
+            backend::device_vector<real> dbuf;
+
+            reductor_data(const backend::command_queue &q)
+                : hbuf(N * backend::kernel::num_workgroups(q)),
+                  dbuf(q, N * backend::kernel::num_workgroups(q))
+            { }
+        };
+
+        typedef
+            detail::object_cache<detail::index_by_queue, reductor_data>
+            reductor_data_cache;
+
+        static reductor_data_cache& get_data_cache() {
+            static reductor_data_cache cache;
+            return cache;
+        }
+
+        template <class Expr>
+        std::array<real, N> reduce(const Expr &expr) const;
+};
+
+#ifndef DOXYGEN
+template <typename real, class... RDC> template <class Expr>
+std::array<real, Reductor<real, std::tuple<RDC...>>::N>
+Reductor<real, std::tuple<RDC...>>::reduce(const Expr &expr) const {
+    using namespace detail;
+
+    typedef fused_reduction<real, std::tuple<RDC...>, Expr> F;
+
+    static_assert(F::E == 1 || F::E == N,
+            "Expression should have either one or N components");
+
+    static kernel_cache cache;
+
+    auto &data_cache = get_data_cache();
+
+    get_expression_properties prop;
+    static_for<0, F::E>::loop(typename F::properties(expr, prop));
+
+    std::array<real, N> result;
+    static_for<0, N>::loop(typename F::initial(result));
+
+    if (prop.size == 0) return result;
+
+    if (prop.part.empty())
+        prop.part = vex::partition(prop.size, queue);
+
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        auto kernel = cache.find(queue[d]);
+
+        backend::select_context(queue[d]);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue[d]);
+
+            output_terminal_preamble termpream(source, queue[d], "prm", empty_state());
+            static_for<0, F::E>::loop(typename F::preamble(expr, termpream));
+            static_for<0, N>::loop(typename F::functions(termpream));
+
+            source.kernel("vexcl_fused_reductor_kernel")
+                .open("(").template parameter<size_t>("n");
+
+            static_for<0, F::E>::loop(typename F::parameters(expr, source, queue[d]));
+
+            source.template parameter< global_ptr<real> >("g_odata");
+
+            if (!backend::is_cpu(queue[d]))
+                source.template smem_parameter<real>();
+
+            source.close(")").open("{");
+
+            static_for<0, N>::loop(typename F::init(source));
+
+            source.grid_stride_loop().open("{");
+            static_for<0, F::E>::loop(typename F::values(expr, source, queue[d]));
+            static_for<0, N>::loop(typename F::update(source));
+            source.close("}");
+
+            if ( backend::is_cpu(queue[d]) ) {
+                for(size_t i = 0; i < N; ++i)
+                    source.new_line() << "g_odata[" << source.group_id(0) << " * "
+                        << N << " + " << i << "] = mySum_" << i << ";";
+            } else {
+                source.smem_declaration<real>();
+
+                source.new_line() << "size_t tid = " << source.local_id(0) << ";";
+                source.new_line() << "size_t block_size = " << source.local_size(0) << ";";
+
+                for(size_t i = 0; i < N; ++i) {
+                    source.new_line() << type_name< shared_ptr<real> >()
+                        << " sdata_" << i << " = smem + " << i << " * block_size;";
+                    source.new_line() << "sdata_" << i << "[tid] = mySum_" << i << ";";
+                }
+                source.new_line().barrier();
+                for(unsigned bs = 512; bs > 32; bs /= 2) {
+                    source.new_line() << "if (block_size >= " << bs * 2 << ")";
+                    source.open("{").new_line() << "if (tid < " << bs << ")";
+                    source.open("{");
+                    static_for<0, N>::loop(typename F::combine(source, "sdata", bs));
+                    source.close("}");
+                    source.new_line().barrier().close("}");
+                }
+                source.new_line() << "if (tid < 32)";
+                source.open("{");
+                for(size_t i = 0; i < N; ++i)
+                    source.new_line() << "volatile " << type_name< shared_ptr<real> >()
+                        << " vdata_" << i << " = sdata_" << i << ";";
+                for(unsigned bs = 32; bs > 0; bs /= 2) {
+                    source.new_line() << "if (block_size >= " << 2 * bs << ")";
+                    source.open("{");
+                    static_for<0, N>::loop(typename F::combine(source, "vdata", bs));
+                    source.close("}");
+                }
+                source.close("}");
+                source.new_line() << "if (tid == 0)";
+                source.open("{");
+                for(size_t i = 0; i < N; ++i)
+                    source.new_line() << "g_odata[" << source.group_id(0) << " * "
+                        << N << " + " << i << "] = sdata_" << i << "[0];";
+                source.close("}");
+            }
+
+            source.close("}");
+
+            kernel = cache.insert(queue[d], backend::kernel(
+                        queue[d], source.str(), "vexcl_fused_reductor_kernel",
+                        N * sizeof(real)));
+        }
+
+        if (size_t psize = prop.part_size(d)) {
+            auto data = data_cache.find(queue[d]);
+            if (data == data_cache.end())
+                data = data_cache.insert(queue[d], reductor_data(queue[d]));
+
+            kernel->second.push_arg(psize);
+
+            static_for<0, F::E>::loop(
+                    typename F::arguments(expr, kernel->second, d, prop.part_start(d)));
+
+            kernel->second.push_arg(data->second.dbuf);
+
+            if (!backend::is_cpu(queue[d]))
+                kernel->second.set_smem(
+                        [](size_t wgs){
+                            return wgs * N * sizeof(real);
+                        });
+
+            kernel->second(queue[d]);
+
+            data->second.dbuf.read(queue[d], 0, data->second.hbuf.size(),
+                    data->second.hbuf.data());
+        }
+    }
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        if (prop.part_size(d)) {
+            auto data = data_cache.find(queue[d]);
+
+            backend::finish(queue[d]);
+
+            static_for<0, N>::loop(typename F::finalize(data->second.hbuf, result));
+        }
+    }
+
+    return result;
+}
+#endif
+
+/// \cond INTERNAL
+namespace detail {
+
+// Kernel generation steps for the fields of a compound reduction.
+template <class Fields>
+struct compound_fields {
+    static const size_t N = std::tuple_size<Fields>::value;
+
+    template <size_t K>
+    struct field {
+        typedef typename std::tuple_element<K, Fields>::type type;
+    };
+
+    // Collects type names, sizes, and initial values of the fields.
+    struct info {
+        std::vector<std::string> &types, &shared_types, &init;
+        std::vector<size_t> &sizes;
+        const Fields &initial;
+
+        info(std::vector<std::string> &types, std::vector<std::string> &shared_types,
+                std::vector<std::string> &init, std::vector<size_t> &sizes,
+                const Fields &initial)
+            : types(types), shared_types(shared_types), init(init),
+              sizes(sizes), initial(initial)
+        {}
+
+        template <size_t K>
+        void apply() const {
+            typedef typename field<K>::type T;
+
+            std::ostringstream v;
+            v << "(" << type_name<T>() << ")" << std::get<K>(initial);
+            if (std::is_integral<T>::value && std::is_unsigned<T>::value) v << "u";
+
+            types.push_back(type_name<T>());
+            shared_types.push_back(type_name< shared_ptr<T> >());
+            init.push_back(v.str());
+            sizes.push_back(sizeof(T));
+        }
+    };
+
+    struct parameters {
+        backend::source_generator &source;
+        parameters(backend::source_generator &source) : source(source) {}
+
+        template <size_t K>
+        void apply() const {
+            std::ostringstream name;
+            name << "g_odata_" << K;
+            source.template parameter< global_ptr<typename field<K>::type> >(name.str());
+        }
+    };
+
+    // Restores the fields of the accumulator from the host buffers.
+    struct unpack {
+        const std::vector< std::vector<char> > &hbuf;
+        size_t g;
+        Fields &f;
+
+        unpack(const std::vector< std::vector<char> > &hbuf, size_t g, Fields &f)
+            : hbuf(hbuf), g(g), f(f) {}
+
+        template <size_t K>
+        void apply() const {
+            typedef typename field<K>::type T;
+            std::memcpy(&std::get<K>(f), hbuf[K].data() + g * sizeof(T), sizeof(T));
+        }
+    };
+};
+
+} // namespace detail
+/// \endcond
+
+/// Reduction with compound accumulator.
+/**
+ * Used for reduction kinds derived from vex::compound_reduction, e.g.
+ * vex::ARGMAX:
+ \code
+ vex::Reductor<double, vex::ARGMAX> argmax(ctx);
+ std::pair<double, size_t> m = argmax(fabs(x));
+ \endcode
+ */
+template <typename real, class RDC>
+class Reductor<real, RDC,
+    typename std::enable_if<std::is_base_of<compound_reduction, RDC>::value>::type>
+{
+    public:
+        typedef typename RDC::template impl<real> impl;
+
+        /// Result of the reduction.
+        typedef typename impl::value_type value_type;
+
+        /// Constructor.
+        Reductor(const std::vector<backend::command_queue> &queue
+#ifndef VEXCL_NO_STATIC_CONTEXT_CONSTRUCTORS
+                = current_context().queue()
+#endif
+                ) : queue(queue)
+        { }
+
+        /// Compute reduction of a vector expression.
+        template <class Expr>
+#ifdef DOXYGEN
+        value_type
+#else
+        typename std::enable_if<
+            boost::proto::matches<Expr, vector_expr_grammar>::value,
+            value_type
+        >::type
+#endif
+        operator()(const Expr &expr) const;
+    private:
+        typedef typename impl::fields fields;
+        typedef detail::compound_fields<fields> F;
+
+        mutable std::vector<backend::command_queue> queue;
+
+        struct reductor_data {
+            std::vector< std::vector<char> >            hbuf;
+            std::vector< backend::device_vector<char> > dbuf;
+
+            reductor_data(const backend::command_queue &q, const std::vector<size_t> &sizes) {
+                size_t nwg = backend::kernel::num_workgroups(q);
+
+                for(size_t k = 0; k < sizes.size(); ++k) {
+                    hbuf.push_back(std::vector<char>(nwg * sizes[k]));
+                    dbuf.push_back(backend::device_vector<char>(q, nwg * sizes[k]));
+                }
+            }
+        };
+
+        typedef
+            detail::object_cache<detail::index_by_queue, reductor_data>
+            reductor_data_cache;
+
+        static reductor_data_cache& get_data_cache() {
+            static reductor_data_cache cache;
+            return cache;
+        }
+};
+
+#ifndef DOXYGEN
+template <typename real, class RDC> template <class Expr>
+typename std::enable_if<
+    boost::proto::matches<Expr, vector_expr_grammar>::value,
+    typename Reductor<real, RDC,
+        typename std::enable_if<std::is_base_of<compound_reduction, RDC>::value>::type
+        >::value_type
+>::type
+Reductor<real, RDC,
+    typename std::enable_if<std::is_base_of<compound_reduction, RDC>::value>::type
+>::operator()(const Expr &expr) const
+{
+    using namespace detail;
+
+    static kernel_cache cache;
+
+    auto &data_cache = get_data_cache();
+
+    get_expression_properties prop;
+    extract_terminals()(expr, prop);
+
+    fields result = impl::initial();
+
+    if (prop.size == 0) return impl::get(result);
+
+    if (prop.part.empty())
+        prop.part = vex::partition(prop.size, queue);
+
+    std::vector<std::string> types, shared_types, init;
+    std::vector<size_t> sizes;
+    static_for<0, F::N>::loop(typename F::info(types, shared_types, init, sizes, result));
+
+    std::vector<std::string> acc, other;
+    for(size_t k = 0; k < F::N; ++k) {
+        std::ostringstream s;
+        s << "acc_" << k;
+        acc.push_back(s.str());
+    }
+
+    for(unsigned d = 0; d < queue.size(); ++d) {
+        auto kernel = cache.find(queue[d]);
+
+        backend::select_context(queue[d]);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue[d]);
+
+            output_terminal_preamble termpream(source, queue[d], "prm", empty_state());
+            boost::proto::eval(boost::proto::as_child(expr),  termpream);
+
+            source.kernel("vexcl_compound_reductor_kernel")
+                .open("(")
+                .template parameter<size_t>("n")
+                .template parameter<size_t>("offset");
+
+            extract_terminals()( expr, declare_expression_parameter(source, queue[d], "prm", empty_state()) );
+
+            static_for<0, F::N>::loop(typename F::parameters(source));
+
+            if (!backend::is_cpu(queue[d]))
+                source.template smem_parameter<char>();
+
+            source.close(")").open("{");
+
+            for(size_t k = 0; k < F::N; ++k)
+                source.new_line() << types[k] << " " << acc[k] << " = " << init[k] << ";";
+
+            source.grid_stride_loop().open("{");
+
+            output_local_preamble loc_init(source, queue[d], "prm", empty_state());
+            boost::proto::eval(expr, loc_init);
+
+            source.new_line() << type_name<real>() << " val = ";
+            vector_expr_context expr_ctx(source, queue[d], "prm", empty_state());
+            boost::proto::eval(expr, expr_ctx);
+            source << ";";
+
+            impl::element(source, acc, "val", "(offset + idx)");
+
+            source.close("}");
+
+            if ( backend::is_cpu(queue[d]) ) {
+                for(size_t k = 0; k < F::N; ++k)
+                    source.new_line() << "g_odata_" << k << "[" << source.group_id(0)
+                        << "] = " << acc[k] << ";";
+            } else {
+                source.smem_declaration<char>();
+
+                source.new_line() << "size_t tid = " << source.local_id(0) << ";";
+                source.new_line() << "size_t block_size = " << source.local_size(0) << ";";
+
+                // Fields are stored in consecutive arrays in shared memory.
+                std::vector<std::string> sdata, sother, vdata, vother;
+                for(size_t k = 0, offset = 0; k < F::N; offset += sizes[k++]) {
+                    std::ostringstream s, v;
+                    s << "sdata_" << k;
+                    v << "vdata_" << k;
+
+                    source.new_line() << shared_types[k] << " " << s.str()
+                        << " = (" << shared_types[k] << ")(smem + "
+                        << offset << " * block_size);";
+                    source.new_line() << s.str() << "[tid] = " << acc[k] << ";";
+
+                    sdata.push_back(s.str() + "[tid]");
+                    vdata.push_back(v.str() + "[tid]");
+                    sother.push_back(s.str() + "[tid + bs]");
+                    vother.push_back(v.str() + "[tid + bs]");
+                }
+                source.new_line().barrier();
+
+                for(unsigned bs = 512; bs > 32; bs /= 2) {
+                    source.new_line() << "if (block_size >= " << bs * 2 << ")";
+                    source.open("{").new_line() << "if (tid < " << bs << ")";
+                    source.open("{");
+                    source.new_line() << "const size_t bs = " << bs << ";";
+                    impl::combine(source, acc, sother);
+                    for(size_t k = 0; k < F::N; ++k)
+                        source.new_line() << sdata[k] << " = " << acc[k] << ";";
+                    source.close("}");
+                    source.new_line().barrier().close("}");
+                }
+
+                source.new_line() << "if (tid < 32)";
+                source.open("{");
+                for(size_t k = 0; k < F::N; ++k)
+                    source.new_line() << "volatile " << shared_types[k]
+                        << " vdata_" << k << " = sdata_" << k << ";";
+                for(unsigned bs = 32; bs > 0; bs /= 2) {
+                    source.new_line() << "if (block_size >= " << 2 * bs << ")";
+                    source.open("{");
+                    source.new_line() << "const size_t bs = " << bs << ";";
+                    impl::combine(source, acc, vother);
+                    for(size_t k = 0; k < F::N; ++k)
+                        source.new_line() << vdata[k] << " = " << acc[k] << ";";
+                    source.close("}");
+                }
+                source.close("}");
+
+                source.new_line() << "if (tid == 0)";
+                source.open("{");
+                for(size_t k = 0; k < F::N; ++k)
+                    source.new_line() << "g_odata_" << k << "[" << source.group_id(0)
+                        << "] = " << acc[k] << ";";
+                source.close("}");
+            }
+
+            source.close("}");
+
+            size_t smem_per_thread = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+
+            kernel = cache.insert(queue[d], backend::kernel(
+                        queue[d], source.str(), "vexcl_compound_reductor_kernel",
+                        smem_per_thread));
+        }
+
+        if (size_t psize = prop.part_size(d)) {
+            auto data = data_cache.find(queue[d]);
+            if (data == data_cache.end())
+                data = data_cache.insert(queue[d], reductor_data(queue[d], sizes));
+
+            kernel->second.push_arg(psize);
+            kernel->second.push_arg(prop.part_start(d));
+
+            extract_terminals()(
+                    expr,
+                    set_expression_argument(kernel->second, d, prop.part_start(d), empty_state())
+                    );
+
+            for(size_t k = 0; k < F::N; ++k)
+                kernel->second.push_arg(data->second.dbuf[k]);
+
+            if (!backend::is_cpu(queue[d])) {
+                size_t smem_per_thread = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+
+                kernel->second.set_smem(
+                        [smem_per_thread](size_t wgs){
+                            return wgs * smem_per_thread;
+                        });
+            }
+
+            kernel->second(queue[d]);
+
+            for(size_t k = 0; k < F::N; ++k)
+                data->second.dbuf[k].read(queue[d], 0, data->second.hbuf[k].size(),
+                        data->second.hbuf[k].data());
+        }
+    }
+
+    impl rdc;
+    for(unsigned d = 0; d < queue.size(); d++) {
+        if (prop.part_size(d)) {
+            auto data = data_cache.find(queue[d]);
+
+            backend::finish(queue[d]);
+
+            size_t nwg = data->second.hbuf[0].size() / sizes[0];
+            for(size_t g = 0; g < nwg; ++g) {
+                fields f;
+                static_for<0, F::N>::loop(typename F::unpack(data->second.hbuf, g, f));
+                result = rdc(result, f);
+            }
+        }
+    }
+
+    return impl::get(result);
 }
 #endif
 
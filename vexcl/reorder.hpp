@@ -0,0 +1,324 @@
+#ifndef VEXCL_REORDER_HPP
+#define VEXCL_REORDER_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/reorder.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Bandwidth-reducing reordering of sparse matrices.
+ *
+ * The reverse Cuthill-McKee ordering is computed on the host for the
+ * symmetrized pattern of a square CSR matrix. Each connected component is
+ * traversed breadth-first from a pseudo-peripheral node, level by level. The
+ * neighbours of all nodes of a level are sorted by degree in parallel; only
+ * the final numbering of the level is sequential.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include <vexcl/util.hpp>
+
+namespace vex {
+
+/// Reordering of sparse matrices.
+namespace reorder {
+
+/// \cond INTERNAL
+namespace detail {
+
+// Symmetrized adjacency graph of a square CSR matrix, without the diagonal.
+struct graph {
+    std::vector<size_t> ptr;
+    std::vector<size_t> adj;
+
+    template <typename idx_t, typename col_t>
+    graph(size_t n, const idx_t *row, const col_t *col) : ptr(n + 1, 0) {
+        const ptrdiff_t nrows = n;
+
+        // Count elements of the matrix and of its transpose.
+        for(size_t i = 0; i < n; ++i) {
+            for(idx_t j = row[i]; j < row[i + 1]; ++j) {
+                size_t c = static_cast<size_t>(col[j]);
+                if (c == i) continue;
+
+                precondition(c < n, "reorder: matrix should be square");
+
+                ++ptr[i + 1];
+                ++ptr[c + 1];
+            }
+        }
+
+        std::partial_sum(ptr.begin(), ptr.end(), ptr.begin());
+
+        std::vector<size_t> pos(ptr.begin(), ptr.end() - 1);
+        std::vector<size_t> tmp(ptr.back());
+
+        for(size_t i = 0; i < n; ++i) {
+            for(idx_t j = row[i]; j < row[i + 1]; ++j) {
+                size_t c = static_cast<size_t>(col[j]);
+                if (c == i) continue;
+
+                tmp[pos[i]++] = c;
+                tmp[pos[c]++] = i;
+            }
+        }
+
+        // Remove duplicates, which appear for symmetric elements.
+        std::vector<size_t> deg(n + 1, 0);
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t i = 0; i < nrows; ++i) {
+            auto b = tmp.begin() + ptr[i];
+            auto e = tmp.begin() + ptr[i + 1];
+            std::sort(b, e);
+            deg[i + 1] = std::unique(b, e) - b;
+        }
+
+        std::partial_sum(deg.begin(), deg.end(), deg.begin());
+        adj.resize(deg.back());
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t i = 0; i < nrows; ++i)
+            std::copy(tmp.begin() + ptr[i], tmp.begin() + ptr[i] + (deg[i + 1] - deg[i]),
+                    adj.begin() + deg[i]);
+
+        ptr.swap(deg);
+    }
+
+    size_t degree(size_t i) const {
+        return ptr[i + 1] - ptr[i];
+    }
+};
+
+// Breadth-first traversal of the nodes that are not yet numbered. Returns
+// number of levels in the traversal and fills the last level.
+inline size_t traverse(const graph &g, size_t root,
+        const std::vector<char> &numbered, std::vector<size_t> &mark, size_t stamp,
+        std::vector<size_t> &last)
+{
+    std::vector<size_t> level(1, root), next;
+    mark[root] = stamp;
+
+    size_t depth = 1;
+    for(;;) {
+        next.clear();
+        for(auto i = level.begin(); i != level.end(); ++i) {
+            for(size_t j = g.ptr[*i]; j < g.ptr[*i + 1]; ++j) {
+                size_t c = g.adj[j];
+                if (numbered[c] || mark[c] == stamp) continue;
+                mark[c] = stamp;
+                next.push_back(c);
+            }
+        }
+
+        if (next.empty()) break;
+
+        level.swap(next);
+        ++depth;
+    }
+
+    last.swap(level);
+    return depth;
+}
+
+// George-Liu search for a pseudo-peripheral node of the component
+// containing the start node.
+inline size_t peripheral_node(const graph &g, size_t start,
+        const std::vector<char> &numbered, std::vector<size_t> &mark, size_t &stamp)
+{
+    std::vector<size_t> last;
+
+    size_t root  = start;
+    size_t depth = traverse(g, root, numbered, mark, ++stamp, last);
+
+    for(;;) {
+        size_t x = *std::min_element(last.begin(), last.end(),
+                [&g](size_t a, size_t b) { return g.degree(a) < g.degree(b); });
+
+        std::vector<size_t> xlast;
+        size_t xdepth = traverse(g, x, numbered, mark, ++stamp, xlast);
+
+        if (xdepth <= depth) return root;
+
+        root  = x;
+        depth = xdepth;
+        last.swap(xlast);
+    }
+}
+
+} // namespace detail
+/// \endcond
+
+/// Reverse Cuthill-McKee ordering of a square sparse matrix.
+/**
+ * Returns permutation p such that row p[i] of the original matrix becomes
+ * row i of the reordered matrix. The ordering is computed for the
+ * symmetrized pattern of the matrix, so it may be used for nonsymmetric
+ * matrices as well.
+ * \param n   number of rows (and columns) in the matrix.
+ * \param row row index into col vector.
+ * \param col column numbers of nonzero elements of the matrix.
+ */
+template <typename idx_t, typename col_t>
+std::vector<size_t> rcm(size_t n, const idx_t *row, const col_t *col) {
+    detail::graph g(n, row, col);
+
+    std::vector<char>   numbered(n, 0);
+    std::vector<size_t> mark(n, 0);
+    std::vector<size_t> order;
+    order.reserve(n);
+
+    size_t stamp = 0;
+
+    // Sorts neighbours by degree, ties are broken by node number.
+    auto by_degree = [&g](size_t a, size_t b) -> bool {
+        size_t da = g.degree(a), db = g.degree(b);
+        return da < db || (da == db && a < b);
+    };
+
+    std::vector< std::vector<size_t> > nbr;
+
+    for(size_t start = 0; start < n; ++start) {
+        if (numbered[start]) continue;
+
+        size_t root = detail::peripheral_node(g, start, numbered, mark, stamp);
+
+        numbered[root] = 1;
+        order.push_back(root);
+
+        for(size_t head = order.size() - 1; head < order.size(); ) {
+            const size_t tail = order.size();
+            const ptrdiff_t width = tail - head;
+
+            nbr.resize(width);
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+            for(ptrdiff_t k = 0; k < width; ++k) {
+                size_t i = order[head + k];
+
+                nbr[k].clear();
+                for(size_t j = g.ptr[i]; j < g.ptr[i + 1]; ++j)
+                    if (!numbered[g.adj[j]]) nbr[k].push_back(g.adj[j]);
+
+                std::sort(nbr[k].begin(), nbr[k].end(), by_degree);
+            }
+
+            for(ptrdiff_t k = 0; k < width; ++k) {
+                for(auto c = nbr[k].begin(); c != nbr[k].end(); ++c) {
+                    if (numbered[*c]) continue;
+                    numbered[*c] = 1;
+                    order.push_back(*c);
+                }
+            }
+
+            head = tail;
+        }
+    }
+
+    return std::vector<size_t>(order.rbegin(), order.rend());
+}
+
+/// Inverse of a permutation.
+inline std::vector<size_t> inverse(const std::vector<size_t> &p) {
+    const ptrdiff_t n = p.size();
+    std::vector<size_t> q(n);
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+    for(ptrdiff_t i = 0; i < n; ++i) q[p[i]] = i;
+
+    return q;
+}
+
+/// Applies symmetric permutation to a square CSR matrix.
+/**
+ * Row and column i of the result are row and column p[i] of the input
+ * matrix. Columns inside each row of the result are sorted.
+ */
+template <typename idx_t, typename col_t, typename val_t>
+void permute(size_t n, const std::vector<size_t> &p,
+        const idx_t *row, const col_t *col, const val_t *val,
+        std::vector<idx_t> &prow, std::vector<col_t> &pcol, std::vector<val_t> &pval)
+{
+    const ptrdiff_t nrows = n;
+    std::vector<size_t> q = inverse(p);
+
+    prow.resize(n + 1);
+    prow[0] = 0;
+    for(size_t i = 0; i < n; ++i)
+        prow[i + 1] = prow[i] + (row[p[i] + 1] - row[p[i]]);
+
+    pcol.resize(prow[n]);
+    pval.resize(prow[n]);
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+    for(ptrdiff_t i = 0; i < nrows; ++i) {
+        std::vector< std::pair<col_t, val_t> > r;
+        r.reserve(prow[i + 1] - prow[i]);
+
+        for(idx_t j = row[p[i]]; j < row[p[i] + 1]; ++j)
+            r.push_back(std::make_pair(static_cast<col_t>(q[col[j]]), val[j]));
+
+        std::sort(r.begin(), r.end(),
+                [](const std::pair<col_t, val_t> &a, const std::pair<col_t, val_t> &b) {
+                    return a.first < b.first;
+                });
+
+        for(size_t k = 0, j = prow[i]; k < r.size(); ++k, ++j) {
+            pcol[j] = r[k].first;
+            pval[j] = r[k].second;
+        }
+    }
+}
+
+/// Bandwidth of a square sparse matrix.
+template <typename idx_t, typename col_t>
+size_t bandwidth(size_t n, const idx_t *row, const col_t *col) {
+    size_t w = 0;
+    for(size_t i = 0; i < n; ++i) {
+        for(idx_t j = row[i]; j < row[i + 1]; ++j) {
+            size_t c = static_cast<size_t>(col[j]);
+            w = std::max(w, c > i ? c - i : i - c);
+        }
+    }
+    return w;
+}
+
+} // namespace reorder
+} // namespace vex
+
+#endif
@@ -1049,17 +1049,18 @@ backend::kernel merge_partition_kernel(const backend::command_queue &queue) {
 }
 
 //---------------------------------------------------------------------------
-template <typename Comp, class KT>
+template <typename Comp, class KTA, class KTB>
 backend::device_vector<int> merge_path_partitions(
         const backend::command_queue &queue,
-        const KT &keys,
-        int count, int nv, int coop
+        const KTA &a, const KTB &b,
+        int a_count, int b_count, int nv, int coop
         )
 {
-    typedef typename extract_value_types<KT>::type K;
+    typedef typename extract_value_types<KTA>::type K;
 
     const int NT = 64;
 
+    int count                = a_count + b_count;
     int num_partitions       = (count + nv - 1) / nv;
     int num_partition_blocks = (num_partitions + NT) / NT;
 
@@ -1067,9 +1068,6 @@ backend::device_vector<int> merge_path_partitions(
 
     auto merge_partition = merge_partition_kernel<NT, K, Comp>(queue);
 
-    int a_count = static_cast<int>(boost::fusion::at_c<0>(keys).size());
-    int b_count = 0;
-
     merge_partition.push_arg(a_count);
     merge_partition.push_arg(b_count);
     merge_partition.push_arg(nv);
@@ -1077,8 +1075,8 @@ backend::device_vector<int> merge_path_partitions(
     merge_partition.push_arg(partitions);
     merge_partition.push_arg(num_partitions + 1);
 
-    push_args<boost::mpl::size<K>::value>(merge_partition, keys);
-    push_args<boost::mpl::size<K>::value>(merge_partition, keys);
+    push_args<boost::mpl::size<K>::value>(merge_partition, a);
+    push_args<boost::mpl::size<K>::value>(merge_partition, b);
 
     merge_partition.config(num_partition_blocks, NT);
 
@@ -1087,6 +1085,17 @@ backend::device_vector<int> merge_path_partitions(
     return partitions;
 }
 
+//---------------------------------------------------------------------------
+template <typename Comp, class KT>
+backend::device_vector<int> merge_path_partitions(
+        const backend::command_queue &queue,
+        const KT &keys,
+        int count, int nv, int coop
+        )
+{
+    return merge_path_partitions<Comp>(queue, keys, keys, count, 0, nv, coop);
+}
+
 //---------------------------------------------------------------------------
 // Merge kernel
 //---------------------------------------------------------------------------
@@ -1858,6 +1867,98 @@ void sort_by_key(const backend::command_queue &queue, KTup &&keys, VTup &&vals,
     }
 }
 
+/// Merges two sorted single-partition sequences.
+template <class KA, class KB, class KO, class Comp>
+void merge(const backend::command_queue &queue,
+        const KA &a, int a_count, const KB &b, int b_count, KO &&out, Comp)
+{
+    typedef typename extract_value_types<KA>::type K;
+
+    typedef
+        typename boost::mpl::accumulate<
+            K,
+            boost::mpl::int_<0>,
+            boost::mpl::plus<boost::mpl::_1, boost::mpl::sizeof_<boost::mpl::_2> >
+            >::type
+        sizeof_keys;
+
+    backend::select_context(queue);
+
+    const int NT_cpu = 1;
+    const int NT_gpu = 256;
+    const int NT = is_cpu(queue) ? NT_cpu : NT_gpu;
+    const int VT = (sizeof_keys::value > 4) ? 7 : 11;
+    const int NV = NT * VT;
+
+    const int count = a_count + b_count;
+    const int num_blocks = (count + NV - 1) / NV;
+
+    auto partitions = detail::merge_path_partitions<Comp>(
+            queue, a, b, a_count, b_count, NV, 0);
+
+    auto merge = is_cpu(queue) ?
+        detail::merge_kernel<NT_cpu, VT, K, boost::mpl::vector<>, Comp>(queue) :
+        detail::merge_kernel<NT_gpu, VT, K, boost::mpl::vector<>, Comp>(queue);
+
+    merge.push_arg(a_count);
+    merge.push_arg(b_count);
+
+    push_args<boost::mpl::size<K>::value>(merge, a);
+    push_args<boost::mpl::size<K>::value>(merge, b);
+    push_args<boost::mpl::size<K>::value>(merge, out);
+    merge.push_arg(partitions);
+    merge.push_arg(0);
+
+    merge.config(num_blocks, NT);
+    merge(queue);
+}
+
+/// Merges two sorted single-partition sequences of keys and values.
+template <class KA, class VA, class KB, class VB, class KO, class VO, class Comp>
+void merge_by_key(const backend::command_queue &queue,
+        const KA &a_keys, const VA &a_vals, int a_count,
+        const KB &b_keys, const VB &b_vals, int b_count,
+        KO &&keys, VO &&vals, Comp)
+{
+    typedef typename extract_value_types<KA>::type K;
+    typedef typename extract_value_types<VA>::type V;
+
+    backend::select_context(queue);
+
+    const int NT_cpu = 1;
+    const int NT_gpu = 256;
+    const int NT = is_cpu(queue) ? NT_cpu : NT_gpu;
+    const int VT = (sizeof(K) > 4) ? 7 : 11;
+    const int NV = NT * VT;
+
+    const int count = a_count + b_count;
+    const int num_blocks = (count + NV - 1) / NV;
+
+    auto partitions = detail::merge_path_partitions<Comp>(
+            queue, a_keys, b_keys, a_count, b_count, NV, 0);
+
+    auto merge = is_cpu(queue) ?
+        detail::merge_kernel<NT_cpu, VT, K, V, Comp>(queue) :
+        detail::merge_kernel<NT_gpu, VT, K, V, Comp>(queue);
+
+    merge.push_arg(a_count);
+    merge.push_arg(b_count);
+
+    push_args<boost::mpl::size<K>::value>(merge, a_keys);
+    push_args<boost::mpl::size<K>::value>(merge, b_keys);
+    push_args<boost::mpl::size<K>::value>(merge, keys);
+
+    push_args<boost::mpl::size<V>::value>(merge, a_vals);
+    push_args<boost::mpl::size<V>::value>(merge, b_vals);
+    push_args<boost::mpl::size<V>::value>(merge, vals);
+
+    merge.push_arg(partitions);
+    merge.push_arg(0);
+
+    merge.config(num_blocks, NT);
+    merge(queue);
+}
+
 template <class S1, class S2>
 boost::fusion::zip_view< boost::fusion::vector<S1&, S2&> >
 make_zip_view(S1 &s1, S2 &s2) {
@@ -33,6 +33,7 @@ THE SOFTWARE.
 
 #include <vector>
 #include <set>
+#include <map>
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -42,6 +43,14 @@ THE SOFTWARE.
 
 #include <vexcl/vector.hpp>
 #include <vexcl/vector_view.hpp>
+#include <vexcl/element_index.hpp>
+#include <vexcl/reductor.hpp>
+#include <vexcl/scan.hpp>
+#include <vexcl/sort.hpp>
+#include <vexcl/reduce_by_key.hpp>
+#include <vexcl/histogram.hpp>
+#include <vexcl/binary_search.hpp>
+#include <vexcl/reorder.hpp>
 
 #if defined(VEXCL_BACKEND_CUDA)
 #  include <vexcl/backend/cuda/cusparse.hpp>
@@ -49,15 +58,81 @@ THE SOFTWARE.
 
 namespace vex {
 
+/// Storage formats for device parts of vex::SpMat.
+/**
+ * A format policy selects storage format for each of the compute devices.
+ */
+namespace spmat_format {
+
+/// \cond INTERNAL
+enum kind { csr_kind, hell_kind, sell_kind };
+/// \endcond
+
+/// Hybrid ELL-CSR format on GPUs and CSR format on CPUs.
+struct automatic {
+    static kind select(const backend::command_queue &q) {
+        return backend::is_cpu(q) ? csr_kind : hell_kind;
+    }
+};
+
+/// CSR format on all devices.
+struct csr {
+    static kind select(const backend::command_queue&) {
+        return csr_kind;
+    }
+};
+
+/// Hybrid ELL-CSR format on all devices.
+struct hybrid_ell {
+    static kind select(const backend::command_queue&) {
+        return hell_kind;
+    }
+};
+
+/// Sliced ELLPACK format with rows sorted by length (SELL-C-sigma).
+/**
+ * Slice height C is chosen for each device from its SIMD or warp width.
+ * Works well for matrices with skewed row lengths.
+ */
+struct sell {
+    static kind select(const backend::command_queue&) {
+        return sell_kind;
+    }
+};
+
+/// Sliced ELLPACK format with the given slice height C on all devices.
+template <size_t C>
+struct sell_c : sell {
+    static const size_t slice_height = C;
+};
+
+/// \cond INTERNAL
+// Slice height fixed by the format policy, or zero.
+template <class Format, class Enable = void>
+struct fixed_slice_height : boost::mpl::size_t<0> {};
+
+template <class Format>
+struct fixed_slice_height<Format,
+    typename std::enable_if<(Format::slice_height > 0)>::type
+    > : boost::mpl::size_t<Format::slice_height> {};
+/// \endcond
+
+} // namespace spmat_format
+
 /// Sparse matrix in hybrid ELL-CSR format.
-template <typename val_t, typename col_t = size_t, typename idx_t = size_t>
+/**
+ * The storage format of the device parts of the matrix may be changed with
+ * the Format policy (see vex::spmat_format).
+ */
+template <typename val_t, typename col_t = size_t, typename idx_t = size_t,
+          class Format = spmat_format::automatic>
 class SpMat {
     public:
         typedef val_t value_type;
         typedef typename cl_scalar_of<val_t>::type scalar_type;
 
         /// Empty constructor.
-        SpMat() : nrows(0), ncols(0), nnz(0) {}
+        SpMat() : nrows(0), ncols(0), nnz(0), has_ghosts(false) {}
 
         /// Constructor.
         /**
@@ -79,7 +154,7 @@ class SpMat {
               )
             : queue(queue), part(partition(n, queue)),
               mtx(queue.size()), exc(queue.size()),
-              nrows(n), ncols(m), nnz(row[n])
+              nrows(n), ncols(m), nnz(row[n]), has_ghosts(false)
         {
             auto col_part = partition(m, queue);
 
@@ -87,7 +162,7 @@ class SpMat {
             for(auto q = queue.begin(); q != queue.end(); q++)
                 squeue.push_back(backend::duplicate_queue(*q));
 
-            std::vector<std::set<col_t>> ghost_cols = setup_exchange(col_part, row, col);
+            std::vector<std::vector<col_t>> ghost_cols = setup_exchange(col_part, row, col);
 
             // Each device get it's own strip of the matrix.
 #ifdef _OPENMP
@@ -95,22 +170,225 @@ class SpMat {
 #endif
             for(int d = 0; d < static_cast<int>(queue.size()); d++) {
                 if (part[d + 1] > part[d]) {
-                    if ( backend::is_cpu(queue[d]) )
-                        mtx[d].reset(
-                                new SpMatCSR(queue[d],
-                                    row + part[d], row + part[d+1], col, val,
-                                    static_cast<col_t>(col_part[d]), static_cast<col_t>(col_part[d+1]), ghost_cols[d])
-                                );
-                    else
-                        mtx[d].reset(
-                                new SpMatHELL(queue[d],
-                                    row + part[d], row + part[d + 1], col, val,
-                                    static_cast<col_t>(col_part[d]), static_cast<col_t>(col_part[d+1]), ghost_cols[d])
-                                );
+                    switch ( Format::select(queue[d]) ) {
+                        case spmat_format::csr_kind:
+                            mtx[d].reset(
+                                    new SpMatCSR(queue[d],
+                                        row + part[d], row + part[d+1], col, val,
+                                        static_cast<col_t>(col_part[d]), static_cast<col_t>(col_part[d+1]), ghost_cols[d])
+                                    );
+                            break;
+                        case spmat_format::hell_kind:
+                            mtx[d].reset(
+                                    new SpMatHELL(queue[d],
+                                        row + part[d], row + part[d + 1], col, val,
+                                        static_cast<col_t>(col_part[d]), static_cast<col_t>(col_part[d+1]), ghost_cols[d])
+                                    );
+                            break;
+                        case spmat_format::sell_kind:
+                            mtx[d].reset(
+                                    new SpMatSELL(queue[d],
+                                        row + part[d], row + part[d + 1], col, val,
+                                        col_part[d], col_part[d+1], ghost_cols[d],
+                                        spmat_format::fixed_slice_height<Format>::value)
+                                    );
+                            break;
+                    }
+                }
+            }
+        }
+
+
+        /// Assembles the matrix from COO triplets located on a compute device.
+        /**
+         * The triplets are sorted by row and column on the device, duplicate
+         * entries are summed up, and row pointers are found with a binary
+         * search over the sorted rows. When the matrix is stored in CSR or
+         * hybrid ELL format on the same single device the triplets are
+         * located on, the matrix is assembled without leaving the device.
+         * Otherwise, the compressed matrix is copied to the host and split
+         * between the devices as usual.
+         * \param queue vector of queues for the matrix.
+         * \param n     number of rows in the matrix.
+         * \param m     number of cols in the matrix.
+         * \param rows  row numbers of the triplets.
+         * \param cols  column numbers of the triplets.
+         * \param vals  values of the triplets.
+         */
+        static SpMat from_coo(const std::vector<backend::command_queue> &queue,
+                size_t n, size_t m,
+                const vector<col_t> &rows, const vector<col_t> &cols,
+                const vector<val_t> &vals)
+        {
+            precondition(rows.nparts() <= 1,
+                    "from_coo: triplets should be located on a single device");
+            precondition(rows.size() == cols.size() && rows.size() == vals.size(),
+                    "from_coo: triplet components have different sizes");
+
+            const std::vector<backend::command_queue> &tq = rows.queue_list();
+            const size_t count = rows.size();
+
+            if (!count) {
+                std::vector<idx_t> row(n + 1, 0);
+                return SpMat(queue, n, m, row.data(),
+                        static_cast<const col_t*>(0), static_cast<const val_t*>(0));
+            }
+
+            /* 1. Sort triplets by row and column. */
+            vector<col_t> r(tq, count), c(tq, count);
+            vector<val_t> v(tq, count);
+
+            r = rows;
+            c = cols;
+            v = vals;
+
+            sort_by_key(std::tie(r, c), v, coo_less());
+
+            /* 2. Sum duplicates. */
+            VEX_FUNCTION(bool, equal, (col_t, r1)(col_t, c1)(col_t, r2)(col_t, c2),
+                    return r1 == r2 && c1 == c2;
+                    );
+            VEX_FUNCTION(val_t, plus, (val_t, x)(val_t, y), return x + y;);
+
+            vector<col_t> ur(tq, count), uc(tq, count);
+            vector<val_t> uv(tq, count);
+
+            size_t nnz = reduce_by_key(std::tie(r, c), v, std::tie(ur, uc), uv, equal, plus);
+
+            slicer<1> slice(extents[count]);
+
+            vector<col_t> row_of(tq, nnz), col(tq, nnz);
+            vector<val_t> val(tq, nnz);
+
+            row_of = slice[range(0, nnz)](ur);
+            col    = slice[range(0, nnz)](uc);
+            val    = slice[range(0, nnz)](uv);
+
+            /* 3. Find row pointers. */
+            vector<idx_t> ptr(tq, n + 1);
+            ptr = lower_bound(row_of, element_index());
+
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+            /* 4. Build device representation on the device. */
+            if (queue.size() == 1 &&
+                    backend::get_context_id(queue[0]) == backend::get_context_id(tq[0]))
+            {
+                switch (Format::select(queue[0])) {
+                    case spmat_format::csr_kind:
+                        {
+                            SpMat A(queue, n, m, nnz);
+                            A.mtx[0].reset(new SpMatCSR(A.queue[0], n, m, ptr, col, val));
+                            return A;
+                        }
+                    case spmat_format::hell_kind:
+                        {
+                            SpMat A(queue, n, m, nnz);
+                            A.mtx[0].reset(new SpMatHELL(A.queue[0], n, m, ptr, col, val));
+                            return A;
+                        }
+                    default:
+                        break;
                 }
             }
+#endif
+
+            /* 4. Otherwise build the matrix on the host. */
+            std::vector<idx_t> hptr(n + 1);
+            std::vector<col_t> hcol(nnz);
+            std::vector<val_t> hval(nnz);
+
+            vex::copy(ptr, hptr);
+            vex::copy(col, hcol);
+            vex::copy(val, hval);
+
+            return SpMat(queue, n, m, hptr.data(), hcol.data(), hval.data());
+        }
+
+        /// Constructs square matrix with rows and columns in reverse Cuthill-McKee order.
+        /**
+         * The matrix is renumbered with vex::reorder::rcm() before it is
+         * split between the devices. The reduced bandwidth improves locality
+         * of accesses to the input vector, and, for multi-device contexts,
+         * reduces the number of ghost points. The permutation is kept with
+         * the matrix; to_reordered() and to_original() return views that
+         * convert vectors between the original and the new numbering.
+         * \param queue vector of queues.
+         * \param n   number of rows and cols in the matrix.
+         * \param row row index into col and val vectors.
+         * \param col column numbers of nonzero elements of the matrix.
+         * \param val values of nonzero elements of the matrix.
+         */
+        static SpMat reordered(const std::vector<backend::command_queue> &queue,
+                size_t n, const idx_t *row, const col_t *col, const val_t *val)
+        {
+            std::vector<size_t> p = reorder::rcm(n, row, col);
+
+            std::vector<idx_t> prow;
+            std::vector<col_t> pcol;
+            std::vector<val_t> pval;
+
+            reorder::permute(n, p, row, col, val, prow, pcol, pval);
+
+            SpMat A(queue, n, n, prow.data(), pcol.data(), pval.data());
+
+            // Permutation views are only supported in single-device contexts,
+            // so there is no point in keeping the device copies otherwise.
+            if (queue.size() == 1) {
+                std::vector<size_t> q = reorder::inverse(p);
+                std::vector<col_t> hp(p.begin(), p.end()), hq(q.begin(), q.end());
+
+                A.fwd.resize(queue, hp);
+                A.inv.resize(queue, hq);
+            }
+
+            A.perm.swap(p);
+
+            return A;
+        }
+
+        /// Permutation applied to the matrix by reordered().
+        /**
+         * Row i of the matrix is row permutation()[i] of the original
+         * matrix. The permutation is empty for matrices that were not
+         * reordered.
+         */
+        const std::vector<size_t>& permutation() const {
+            return perm;
+        }
+
+        /// View of the vector in the numbering of the reordered matrix.
+        /**
+         * Like any permutation, the view is only supported in
+         * single-device contexts; for multi-device matrices use
+         * permutation() to renumber the vectors on the host. Example:
+         \code
+         auto A = vex::SpMat<double>::reordered(ctx, n, row, col, val);
+         X = A.to_reordered(x);
+         Y = A * X;
+         y = A.to_original(Y);
+         \endcode
+         */
+        template <class Expr>
+        auto to_reordered(const Expr &x) const ->
+            decltype(vex::permutation(std::declval<const vector<col_t>&>())(x))
+        {
+            precondition(!perm.empty(), "The matrix has not been reordered");
+            precondition(queue.size() == 1,
+                    "Permuted views are not supported for multi-device matrices");
+            return vex::permutation(fwd)(x);
         }
 
+        /// View of the vector in the original numbering.
+        /** \sa to_reordered() */
+        template <class Expr>
+        auto to_original(const Expr &x) const ->
+            decltype(vex::permutation(std::declval<const vector<col_t>&>())(x))
+        {
+            precondition(!perm.empty(), "The matrix has not been reordered");
+            precondition(queue.size() == 1,
+                    "Permuted views are not supported for multi-device matrices");
+            return vex::permutation(inv)(x);
+        }
 
         /// Matrix-vector multiplication.
         /**
@@ -126,24 +404,19 @@ class SpMat {
         void apply(const vex::vector<val_t> &x, vex::vector<val_t> &y,
                  scalar_type alpha = 1, bool append = false) const
         {
-            using namespace detail;
-
-            static kernel_cache cache;
+            std::vector<backend::event> ready;
 
-            if (rx.size()) {
+            if (has_ghosts) {
                 // Gather values to send to neighbors.
                 for(unsigned d = 0; d < queue.size(); d++) {
-                    if (cidx[d + 1] > cidx[d]) {
-                        vex::vector<col_t> cols(queue[d], exc[d].cols_to_send);
-                        vex::vector<val_t> vals(queue[d], exc[d].vals_to_send);
-                        vex::vector<val_t> xloc(queue[d], x(d));
+                    backend::select_context(queue[d]);
+                    backend::enqueue_barrier(queue[d], exc[d].sent);
 
-                        vals = permutation(cols)(xloc);
-                    }
-                }
+                    if (size_t ns = exc[d].send_size())
+                        gather(queue[d], ns, exc[d].cols_to_send, x(d), exc[d].vals_to_send);
 
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (cidx[d + 1] > cidx[d]) queue[d].finish();
+                    ready.push_back(backend::event::marker(queue[d]));
+                }
             }
 
             // Start computing contribution from local part of the matrix.
@@ -154,44 +427,204 @@ class SpMat {
                 }
 
 
-            if (rx.size()) {
-                // Meanwhile, get gathered values to host, ...
+            if (has_ghosts) {
+                // Meanwhile, send ghost points from our neighbors to device, ...
+                std::vector<backend::event> landed = exchange(1, false, ready,
+                        [&](unsigned d, size_t) -> const backend::device_vector<val_t>& {
+                            return exc[d].vals_to_send;
+                        },
+                        [&](unsigned d, size_t) -> const backend::device_vector<val_t>& {
+                            return exc[d].rx;
+                        });
+
+                // ... and compute contribution from remote part of the matrix.
                 for(unsigned d = 0; d < queue.size(); d++) {
-                    if (cidx[d + 1] > cidx[d]) {
-                        backend::select_context(squeue[d]);
-                        vex::vector<val_t> vals(squeue[d], exc[d].vals_to_send);
-                        vex::copy(vals.begin(), vals.end(), &rx[cidx[d]], /*blocking=*/false);
+                    if (exc[d].recv_size()) {
+                        backend::select_context(queue[d]);
+                        backend::enqueue_barrier(queue[d], landed[d]);
+                        mtx[d]->mul_remote(exc[d].rx, y(d), alpha);
                     }
                 }
+            }
+        }
 
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (cidx[d + 1] > cidx[d]) squeue[d].finish();
+        /// Matrix-multivector multiplication.
+        /**
+         * All components of the multivector are multiplied on each device by
+         * a single kernel, so that the matrix is read from memory once per
+         * product instead of once per component. Ghost values of all
+         * components are exchanged together.
+         * \param x      input multivector.
+         * \param y      output multivector.
+         * \param alpha  coefficient in front of matrix-vector product
+         * \param append if set, matrix-vector product is appended to y.
+         *               Otherwise, y is replaced with matrix-vector product.
+         */
+        template <class MV>
+        typename std::enable_if<
+            std::is_same<typename MV::sub_value_type, val_t>::value
+            >::type
+        apply(const MV &x, MV &y, scalar_type alpha = 1, bool append = false) const
+        {
+            using namespace detail;
+
+            typedef std::vector< backend::device_vector<val_t> > dvec_list;
+
+            const size_t N = traits::number_of_components<MV>::value;
+
+            std::vector<dvec_list> xd(queue.size()), yd(queue.size());
+            for(unsigned d = 0; d < queue.size(); d++) {
+                for(size_t i = 0; i < N; i++) {
+                    xd[d].push_back(x(i)(d));
+                    yd[d].push_back(y(i)(d));
+                }
+            }
 
-                // ... send ghost points from our neighbors to device, ...
+            std::vector<backend::event> ready;
+
+            if (has_ghosts) {
+                // Gather values to send to neighbors.
                 for(unsigned d = 0; d < queue.size(); d++) {
-                    if (exc[d].cols_to_recv.size()) {
-                        for(size_t i = 0; i < exc[d].cols_to_recv.size(); i++)
-                            exc[d].vals_to_recv[i] = rx[exc[d].cols_to_recv[i]];
+                    backend::select_context(queue[d]);
+                    backend::enqueue_barrier(queue[d], exc[d].sent);
+
+                    if (size_t ns = exc[d].send_size()) {
+                        while(exc[d].mvals_to_send.size() < N)
+                            exc[d].mvals_to_send.push_back(
+                                    backend::device_vector<val_t>(queue[d], ns));
+
+                        for(size_t i = 0; i < N; i++)
+                            gather(queue[d], ns, exc[d].cols_to_send, xd[d][i],
+                                    exc[d].mvals_to_send[i]);
+                    }
+
+                    ready.push_back(backend::event::marker(queue[d]));
+                }
+            }
+
+            // Start computing contribution from local part of the matrix.
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (mtx[d]) {
+                    backend::select_context(queue[d]);
+                    mtx[d]->spmm_local(xd[d], yd[d], alpha, append);
+                }
 
-                        exc[d].rx.write(squeue[d], 0, exc[d].vals_to_recv.size(),
-                                exc[d].vals_to_recv.data()
-                                );
+            if (has_ghosts) {
+                // Meanwhile, send ghost points from our neighbors to device, ...
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    if (size_t nr = exc[d].recv_size()) {
+                        while(exc[d].mrx.size() < N)
+                            exc[d].mrx.push_back(backend::device_vector<val_t>(
+                                        queue[d], nr, static_cast<const val_t*>(0),
+                                        backend::MEM_READ_ONLY));
                     }
                 }
 
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (exc[d].cols_to_recv.size()) squeue[d].finish();
+                std::vector<backend::event> landed = exchange(N, false, ready,
+                        [&](unsigned d, size_t i) -> const backend::device_vector<val_t>& {
+                            return exc[d].mvals_to_send[i];
+                        },
+                        [&](unsigned d, size_t i) -> const backend::device_vector<val_t>& {
+                            return exc[d].mrx[i];
+                        });
 
-                // Compute contribution from remote part of the matrix.
+                // ... and compute contribution from remote part of the matrix.
                 for(unsigned d = 0; d < queue.size(); d++) {
-                    if (exc[d].cols_to_recv.size()) {
+                    if (exc[d].recv_size()) {
                         backend::select_context(queue[d]);
-                        mtx[d]->mul_remote(exc[d].rx, y(d), alpha);
+                        backend::enqueue_barrier(queue[d], landed[d]);
+                        dvec_list rxd(exc[d].mrx.begin(), exc[d].mrx.begin() + N);
+                        mtx[d]->spmm_remote(rxd, yd[d], alpha);
                     }
                 }
             }
         }
 
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+        /// Transposed matrix-vector multiplication.
+        /**
+         * Computes \f$y = \alpha A^T x\f$ or \f$y += \alpha A^T x\f$
+         * without the transposed matrix being supplied by the user. On first
+         * use, each device transposes its own strip of the matrix and keeps
+         * the result in CSR format. Rows of the transposed strip either
+         * belong to the device, or are ghost points owned by other devices.
+         * Contributions to the ghost points are sent to the owning devices
+         * and are added up there.
+         * \param x      input vector (partitioned as the matrix rows).
+         * \param y      output vector (partitioned as the matrix columns).
+         * \param alpha  coefficient in front of matrix-vector product
+         * \param append if set, matrix-vector product is appended to y.
+         *               Otherwise, y is replaced with matrix-vector product.
+         */
+        void apply_transposed(const vex::vector<val_t> &x, vex::vector<val_t> &y,
+                scalar_type alpha = 1, bool append = false) const
+        {
+            using namespace detail;
+
+            precondition(x.size() == nrows && y.size() == ncols,
+                    "Transposed product: vector sizes do not match the matrix");
+
+            if (tloc.empty()) transpose_strips();
+
+            // Contributions to the ghost points are computed first, so that
+            // they are transfered while the local parts are being processed.
+            std::vector<backend::event> ready;
+
+            if (has_ghosts) {
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    backend::select_context(queue[d]);
+                    backend::enqueue_barrier(queue[d], exc[d].sent);
+
+                    if (trem[d]) trem[d]->mul_local(x(d), exc[d].tx, alpha, false);
+
+                    ready.push_back(backend::event::marker(queue[d]));
+                }
+            }
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (tloc[d]) {
+                    backend::select_context(queue[d]);
+                    tloc[d]->mul_local(x(d), y(d), alpha, append);
+                } else if (!append && y.part_size(d)) {
+                    backend::select_context(queue[d]);
+                    vector<val_t>(queue[d], y(d)) = 0;
+                }
+            }
+
+            if (has_ghosts) {
+                // Meanwhile, send ghost contributions to the owners of the
+                // ghost points, ...
+                std::vector<backend::event> landed = exchange(1, true, ready,
+                        [&](unsigned d, size_t) -> const backend::device_vector<val_t>& {
+                            return exc[d].tx;
+                        },
+                        [&](unsigned d, size_t) -> const backend::device_vector<val_t>& {
+                            return exc[d].vals_to_send;
+                        });
+
+                // ... and add them to the result. Points are unique within
+                // each segment, and the segments are processed in order.
+                for(unsigned o = 0; o < queue.size(); o++) {
+                    if (exc[o].send_size()) {
+                        backend::select_context(queue[o]);
+                        backend::enqueue_barrier(queue[o], landed[o]);
+                    }
+
+                    for(unsigned d = 0; d < queue.size(); d++) {
+                        size_t beg = exc[o].send_ptr[d];
+                        size_t end = exc[o].send_ptr[d + 1];
+
+                        if (end > beg) {
+                            backend::select_context(queue[o]);
+                            scatter_add(queue[o], beg, end - beg, exc[o].cols_to_send,
+                                    exc[o].vals_to_send, y(o));
+                        }
+                    }
+                }
+            }
+        }
+#endif
+
         /// Number of rows.
         size_t rows() const { return nrows; }
         /// Number of columns.
@@ -199,35 +632,75 @@ class SpMat {
         /// Number of non-zero entries.
         size_t nonzeros() const { return nnz;   }
 
+        /// Size in bytes of the column numbers stored on the compute devices.
+        /**
+         * Column numbers are stored in the narrowest type that holds the
+         * columns of each device part, and the stored elements include
+         * padding, if any. Useful for estimates of the memory traffic of
+         * the product.
+         */
+        size_t column_bytes() const {
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+            size_t bytes = 0;
+            for(auto m = mtx.begin(); m != mtx.end(); ++m)
+                if (*m) bytes += (*m)->column_bytes();
+            return bytes;
+#else
+            // CUSPARSE stores 32-bit column numbers.
+            return nnz * sizeof(int);
+#endif
+        }
+
 #if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
         static void inline_preamble(backend::source_generator &src,
                 const backend::command_queue &queue, const std::string &prm_name,
                 detail::kernel_generator_state_ptr)
         {
-            if (backend::is_cpu(queue))
-                SpMatCSR::inline_preamble(src, prm_name);
-            else
-                SpMatHELL::inline_preamble(src, prm_name);
+            switch (Format::select(queue)) {
+                case spmat_format::csr_kind:
+                    SpMatCSR::inline_preamble(src, prm_name);
+                    break;
+                case spmat_format::hell_kind:
+                    SpMatHELL::inline_preamble(src, prm_name);
+                    break;
+                case spmat_format::sell_kind:
+                    SpMatSELL::inline_preamble(src, prm_name);
+                    break;
+            }
         }
 
         static void inline_expression(backend::source_generator &src,
                 const backend::command_queue &queue, const std::string &prm_name,
                 detail::kernel_generator_state_ptr)
         {
-            if (backend::is_cpu(queue))
-                SpMatCSR::inline_expression(src, prm_name);
-            else
-                SpMatHELL::inline_expression(src, prm_name);
+            switch (Format::select(queue)) {
+                case spmat_format::csr_kind:
+                    SpMatCSR::inline_expression(src, prm_name);
+                    break;
+                case spmat_format::hell_kind:
+                    SpMatHELL::inline_expression(src, prm_name);
+                    break;
+                case spmat_format::sell_kind:
+                    SpMatSELL::inline_expression(src, prm_name);
+                    break;
+            }
         }
 
         static void inline_parameters(backend::source_generator &src,
                 const backend::command_queue &queue, const std::string &prm_name,
                 detail::kernel_generator_state_ptr)
         {
-            if (backend::is_cpu(queue))
-                SpMatCSR::inline_parameters(src, prm_name);
-            else
-                SpMatHELL::inline_parameters(src, prm_name);
+            switch (Format::select(queue)) {
+                case spmat_format::csr_kind:
+                    SpMatCSR::inline_parameters(src, prm_name);
+                    break;
+                case spmat_format::hell_kind:
+                    SpMatHELL::inline_parameters(src, prm_name);
+                    break;
+                case spmat_format::sell_kind:
+                    SpMatSELL::inline_parameters(src, prm_name);
+                    break;
+            }
         }
 
         static void inline_arguments(backend::kernel &kernel, unsigned part,
@@ -238,11 +711,192 @@ class SpMat {
         }
 #endif
     private:
+        // Creates matrix without device parts. Used by from_coo().
+        SpMat(const std::vector<backend::command_queue> &queue,
+              size_t n, size_t m, size_t nnz)
+            : queue(queue), part(partition(n, queue)),
+              mtx(queue.size()), exc(queue.size()),
+              nrows(n), ncols(m), nnz(nnz), has_ghosts(false)
+        {
+            for(auto q = queue.begin(); q != queue.end(); q++)
+                squeue.push_back(backend::duplicate_queue(*q));
+        }
+
+        // Orders COO triplets by row and column.
+        struct coo_less {
+            VEX_FUNCTION(bool, device, (col_t, r1)(col_t, c1)(col_t, r2)(col_t, c2),
+                    return (r1 == r2) ? (c1 < c2) : (r1 < r2);
+                    );
+
+            coo_less() {}
+
+            bool operator()(col_t r1, col_t c1, col_t r2, col_t c2) const {
+                return (r1 == r2) ? (c1 < c2) : (r1 < r2);
+            }
+        };
+
+
         template <typename T>
         static inline size_t bytes(const std::vector<T> &v) {
             return v.size() * sizeof(T);
         }
 
+        // Gathers values of the points to be sent to other devices.
+        static void gather(const backend::command_queue &q, size_t n,
+                const backend::device_vector<col_t> &cols,
+                const backend::device_vector<val_t> &x,
+                const backend::device_vector<val_t> &vals)
+        {
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            auto kernel = cache.find(q);
+
+            if (kernel == cache.end()) {
+                backend::source_generator src(q);
+
+                src.kernel("spmat_gather")
+                    .open("(")
+                        .template parameter<size_t>("n")
+                        .template parameter< global_ptr<const col_t> >("cols")
+                        .template parameter< global_ptr<const val_t> >("x")
+                        .template parameter< global_ptr<val_t> >("vals")
+                    .close(")")
+                    .open("{")
+                        .grid_stride_loop("i").open("{");
+                src.new_line() << "vals[i] = x[cols[i]];";
+                src.close("}").close("}");
+
+                kernel = cache.insert(q, backend::kernel(q, src.str(), "spmat_gather"));
+            }
+
+            kernel->second.push_arg(n);
+            kernel->second.push_arg(cols);
+            kernel->second.push_arg(x);
+            kernel->second.push_arg(vals);
+
+            kernel->second(q);
+        }
+
+        // Adds values to the points listed in [start, start + n) segment of
+        // cols. The points should be unique within the segment.
+        static void scatter_add(const backend::command_queue &q,
+                size_t start, size_t n,
+                const backend::device_vector<col_t> &cols,
+                const backend::device_vector<val_t> &vals,
+                const backend::device_vector<val_t> &y)
+        {
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            auto kernel = cache.find(q);
+
+            if (kernel == cache.end()) {
+                backend::source_generator src(q);
+
+                src.kernel("spmat_scatter_add")
+                    .open("(")
+                        .template parameter<size_t>("n")
+                        .template parameter<size_t>("start")
+                        .template parameter< global_ptr<const col_t> >("cols")
+                        .template parameter< global_ptr<const val_t> >("vals")
+                        .template parameter< global_ptr<val_t> >("y")
+                    .close(")")
+                    .open("{")
+                        .grid_stride_loop("i").open("{");
+                src.new_line() << "y[cols[start + i]] += vals[start + i];";
+                src.close("}").close("}");
+
+                kernel = cache.insert(q, backend::kernel(q, src.str(), "spmat_scatter_add"));
+            }
+
+            kernel->second.push_arg(n);
+            kernel->second.push_arg(start);
+            kernel->second.push_arg(cols);
+            kernel->second.push_arg(vals);
+            kernel->second.push_arg(y);
+
+            kernel->second(q);
+        }
+
+        // Local number of a ghost column (its position in the sorted list of
+        // the ghost columns).
+        static col_t ghost_index(const std::vector<col_t> &ghost_cols, col_t c) {
+            auto g = std::lower_bound(ghost_cols.begin(), ghost_cols.end(), c);
+            assert(g != ghost_cols.end() && *g == c);
+            return static_cast<col_t>(g - ghost_cols.begin());
+        }
+
+        // Splits a strip of matrix rows into local and remote parts in CSR
+        // format. Columns of the local part are counted from col_begin;
+        // columns of the remote part are renumbered with ghost_index().
+        // Nonzeros are counted and then copied in parallel passes over the
+        // rows, so that each row is written directly to its final position.
+        struct csr_split {
+            std::vector<idx_t> lrow, rrow;
+            std::vector<col_t> lcol, rcol;
+            std::vector<val_t> lval, rval;
+
+            csr_split(
+                    const idx_t *row_begin, const idx_t *row_end,
+                    const col_t *col, const val_t *val,
+                    size_t col_begin, size_t col_end,
+                    const std::vector<col_t> &ghost_cols
+                    )
+                : lrow(row_end - row_begin + 1), rrow(row_end - row_begin + 1)
+            {
+                const ptrdiff_t n = row_end - row_begin;
+
+                auto is_local = [col_begin, col_end](size_t c) {
+                    return c >= col_begin && c < col_end;
+                };
+
+                lrow[0] = rrow[0] = 0;
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+                for(ptrdiff_t i = 0; i < n; ++i) {
+                    idx_t wl = 0, wr = 0;
+                    for(idx_t j = row_begin[i]; j < row_begin[i + 1]; ++j) {
+                        if (is_local(col[j])) ++wl; else ++wr;
+                    }
+                    lrow[i + 1] = wl;
+                    rrow[i + 1] = wr;
+                }
+
+                for(ptrdiff_t i = 0; i < n; ++i) {
+                    lrow[i + 1] += lrow[i];
+                    rrow[i + 1] += rrow[i];
+                }
+
+                lcol.resize(lrow.back());
+                lval.resize(lrow.back());
+                rcol.resize(rrow.back());
+                rval.resize(rrow.back());
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+                for(ptrdiff_t i = 0; i < n; ++i) {
+                    idx_t l = lrow[i], r = rrow[i];
+                    for(idx_t j = row_begin[i]; j < row_begin[i + 1]; ++j) {
+                        if (is_local(col[j])) {
+                            lcol[l] = static_cast<col_t>(col[j] - col_begin);
+                            lval[l] = val[j];
+                            ++l;
+                        } else {
+                            rcol[r] = ghost_index(ghost_cols, col[j]);
+                            rval[r] = val[j];
+                            ++r;
+                        }
+                    }
+                }
+            }
+        };
+
         struct sparse_matrix {
             virtual void mul_local(
                     const backend::device_vector<val_t> &x,
@@ -256,13 +910,182 @@ class SpMat {
                     scalar_type alpha
                     ) const = 0;
 
+            // Products with several vectors at once. Formats that are able
+            // to read the matrix once for all of the vectors override these.
+            virtual void spmm_local(
+                    const std::vector< backend::device_vector<val_t> > &x,
+                    std::vector< backend::device_vector<val_t> > &y,
+                    scalar_type alpha, bool append
+                    ) const
+            {
+                for(size_t i = 0; i < x.size(); ++i)
+                    mul_local(x[i], y[i], alpha, append);
+            }
+
+            virtual void spmm_remote(
+                    const std::vector< backend::device_vector<val_t> > &x,
+                    std::vector< backend::device_vector<val_t> > &y,
+                    scalar_type alpha
+                    ) const
+            {
+                for(size_t i = 0; i < x.size(); ++i)
+                    mul_remote(x[i], y[i], alpha);
+            }
+
 #if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
             virtual void setArgs(backend::kernel &kernel, unsigned part, const vector<val_t> &x) const = 0;
+
+            // Writes elements of the local or the remote part as COO
+            // triplets with rows counted from the first row of the strip.
+            // Padding elements, if any, get the sentinel column.
+            virtual void triplets(bool remote, col_t sentinel,
+                    vector<col_t> &row, vector<col_t> &col, vector<val_t> &val) const = 0;
+
+            // Size in bytes of the stored column numbers.
+            virtual size_t column_bytes() const = 0;
 #endif
 
             virtual ~sparse_matrix() {}
         };
 
+        // Column numbers of a matrix part. The numbers are stored in the
+        // narrowest unsigned type able to hold all columns of the part, which
+        // reduces memory traffic of the product kernels. All ones in the
+        // storage type mark padding elements.
+        struct column_index {
+            enum storage { full = 0, uint16 = 1, uint32 = 2 } kind;
+
+            // Number of storage kinds, used to size per-kind kernel caches.
+            static const int kinds = 3;
+
+            backend::device_vector<cl_ushort> c16;
+            backend::device_vector<cl_uint>   c32;
+            backend::device_vector<col_t>     c;
+
+            // Number of stored column numbers.
+            size_t n;
+
+            column_index() : kind(full), n(0) {}
+
+            // Uploads column numbers from the host.
+            column_index(const backend::command_queue &q, size_t ncols,
+                    size_t size, const col_t *host)
+                : kind(select(ncols)), n(size)
+            {
+                switch (kind) {
+                    case uint16:
+                        c16 = narrow<cl_ushort>(q, size, host);
+                        break;
+                    case uint32:
+                        c32 = narrow<cl_uint>(q, size, host);
+                        break;
+                    default:
+                        c = backend::device_vector<col_t>(q, size, host, backend::MEM_READ_ONLY);
+                }
+            }
+
+            // Narrows column numbers that are already on the device.
+            column_index(const backend::command_queue &q, size_t ncols,
+                    const backend::device_vector<col_t> &col)
+                : kind(select(ncols)), n(col.size())
+            {
+                switch (kind) {
+                    case uint16:
+                        c16 = backend::device_vector<cl_ushort>(q, col.size());
+                        vector<cl_ushort>(q, c16) = vector<col_t>(q, col);
+                        break;
+                    case uint32:
+                        c32 = backend::device_vector<cl_uint>(q, col.size());
+                        vector<cl_uint>(q, c32) = vector<col_t>(q, col);
+                        break;
+                    default:
+                        c = col;
+                }
+            }
+
+            static storage select(size_t ncols) {
+                if (sizeof(col_t) > sizeof(cl_ushort) && ncols < 0xFFFFu) return uint16;
+                if (sizeof(col_t) > sizeof(cl_uint) && ncols < 0xFFFFFFFFu) return uint32;
+                return full;
+            }
+
+            template <typename T>
+            static backend::device_vector<T> narrow(const backend::command_queue &q,
+                    size_t size, const col_t *host)
+            {
+                std::vector<T> c(size);
+                for(size_t i = 0; i < size; ++i) c[i] = static_cast<T>(host[i]);
+                return backend::device_vector<T>(q, size, c.data(), backend::MEM_READ_ONLY);
+            }
+
+            size_t bytes() const {
+                switch (kind) {
+                    case uint16: return n * sizeof(cl_ushort);
+                    case uint32: return n * sizeof(cl_uint);
+                    default:     return n * sizeof(col_t);
+                }
+            }
+
+            std::string type() const {
+                switch (kind) {
+                    case uint16: return type_name<cl_ushort>();
+                    case uint32: return type_name<cl_uint>();
+                    default:     return type_name<col_t>();
+                }
+            }
+
+            void parameter(backend::source_generator &src, const std::string &name) const {
+                switch (kind) {
+                    case uint16:
+                        src.template parameter< global_ptr<const cl_ushort> >(name);
+                        break;
+                    case uint32:
+                        src.template parameter< global_ptr<const cl_uint> >(name);
+                        break;
+                    default:
+                        src.template parameter< global_ptr<const col_t> >(name);
+                }
+            }
+
+            void push(backend::kernel &k) const {
+                switch (kind) {
+                    case uint16: k.push_arg(c16); break;
+                    case uint32: k.push_arg(c32); break;
+                    default:     k.push_arg(c);
+                }
+            }
+
+            // Inlined products are generated before the storage type is
+            // known, so they take the storage kind as a parameter. The
+            // generated function returns (col_t)(-1) for padding.
+            static void inline_reader(backend::source_generator &src,
+                    const std::string &name)
+            {
+                src.function<col_t>(name)
+                    .open("(")
+                        .template parameter< global_ptr<const col_t> >("col")
+                        .template parameter< int >("kind")
+                        .template parameter< size_t >("j")
+                    .close(")").open("{");
+                src.new_line() << "if (kind == " << uint16 << ")";
+                src.open("{");
+                src.new_line() << type_name<cl_ushort>() << " c = (("
+                    << type_name< global_ptr<const cl_ushort> >() << ")col)[j];";
+                src.new_line() << "return c == (" << type_name<cl_ushort>() << ")(-1) ? ("
+                    << type_name<col_t>() << ")(-1) : c;";
+                src.close("}");
+                src.new_line() << "if (kind == " << uint32 << ")";
+                src.open("{");
+                src.new_line() << type_name<cl_uint>() << " c = (("
+                    << type_name< global_ptr<const cl_uint> >() << ")col)[j];";
+                src.new_line() << "return c == (" << type_name<cl_uint>() << ")(-1) ? ("
+                    << type_name<col_t>() << ")(-1) : c;";
+                src.close("}");
+                src.new_line() << "return col[j];";
+                src.close("}");
+            }
+        };
+
 
 #if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
 #  include <vexcl/spmat/hybrid_ell.inl>
@@ -271,14 +1094,53 @@ class SpMat {
 #  include <vexcl/backend/cuda/hybrid_ell.inl>
 #  include <vexcl/backend/cuda/csr.inl>
 #endif
-
+#include <vexcl/spmat/sell.inl>
+
+        // Persistent plan of the ghost exchange. Ghost points of a device
+        // are sorted, so the points owned by each of the other devices form
+        // a contiguous segment of the ghost list. The owner gathers the
+        // segment into its send buffer, and the segment is copied as a whole
+        // to the receiver, either directly or through the pinned staging
+        // buffer of the receiver. The steps of the exchange are chained with
+        // events, so the host does not wait for any of them.
         struct exdata {
-            std::vector<col_t> cols_to_recv;
-            mutable std::vector<val_t> vals_to_recv;
+            // Ghost points owned by device o are in [recv_ptr[o], recv_ptr[o + 1]).
+            std::vector<size_t> recv_ptr;
+
+            // Data from device o may be copied directly if peer[o] is set.
+            std::vector<char> peer;
+
+            // Points sent to device d are in [send_ptr[d], send_ptr[d + 1]).
+            std::vector<size_t> send_ptr;
 
             backend::device_vector<col_t> cols_to_send;
             backend::device_vector<val_t> vals_to_send;
             backend::device_vector<val_t> rx;
+
+            // Contributions of the transposed product to the ghost points.
+            mutable backend::device_vector<val_t> tx;
+
+            // Buffers for the exchange of multivector components.
+            mutable std::vector< backend::device_vector<val_t> > mvals_to_send;
+            mutable std::vector< backend::device_vector<val_t> > mrx;
+
+            // Host memory for the segments that can not be copied directly.
+            mutable backend::pinned_buffer<val_t> stage;
+
+            // Transfers reading the outgoing data of the device, and the
+            // last transfer through the staging buffer.
+            mutable std::vector<backend::event> sent;
+            mutable backend::event unstaged;
+
+            size_t recv_size() const { return recv_ptr.empty() ? 0 : recv_ptr.back(); }
+            size_t send_size() const { return send_ptr.empty() ? 0 : send_ptr.back(); }
+        };
+
+        // Segment of the exchange between a pair of devices.
+        struct exsegment {
+            size_t size;  // Number of points.
+            size_t src;   // Offset in the buffer of the sender.
+            size_t dst;   // Offset in the buffer of the receiver.
         };
 
         mutable std::vector<backend::command_queue> queue;
@@ -288,14 +1150,189 @@ class SpMat {
         std::vector< std::unique_ptr<sparse_matrix> > mtx;
 
         std::vector<exdata> exc;
-        std::vector<size_t> cidx;
-        mutable std::vector<val_t> rx;
+
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+        // Transposed local and remote parts, built on first use.
+        mutable std::vector< std::unique_ptr<SpMatCSR> > tloc, trem;
+#endif
 
         size_t nrows;
         size_t ncols;
         size_t nnz;
 
-        std::vector<std::set<col_t>> setup_exchange(
+        bool has_ghosts;
+
+        // Permutation set by reordered(), with its device copy and inverse.
+        std::vector<size_t> perm;
+        vector<col_t> fwd, inv;
+
+        // Segment sent from device s to device r. The transposed product
+        // sends contributions to the ghost points back to their owners.
+        exsegment segment(unsigned s, unsigned r, bool transposed) const {
+            exsegment g;
+            if (transposed) {
+                g.size = exc[s].recv_ptr[r + 1] - exc[s].recv_ptr[r];
+                g.src  = exc[s].recv_ptr[r];
+                g.dst  = exc[r].send_ptr.empty() ? 0 : exc[r].send_ptr[s];
+            } else {
+                g.size = exc[r].recv_ptr[s + 1] - exc[r].recv_ptr[s];
+                g.src  = exc[s].send_ptr.empty() ? 0 : exc[s].send_ptr[r];
+                g.dst  = exc[r].recv_ptr[s];
+            }
+            return g;
+        }
+
+        // Copies N components of the exchange segments from src(s, i) of the
+        // senders to dst(r, i) of the receivers on the secondary queues.
+        // Data of sender s is complete when ready[s] is. Segments that can
+        // not be copied directly are downloaded into the staging buffer of
+        // the receiver, and uploaded from there. Returns the events
+        // signalling the arrival of all segments to each of the receivers.
+        template <class Src, class Dst>
+        std::vector<backend::event> exchange(size_t N, bool transposed,
+                const std::vector<backend::event> &ready, Src &&src, Dst &&dst) const
+        {
+            const unsigned nd = static_cast<unsigned>(queue.size());
+
+            std::vector<backend::event> landed(nd);
+            std::vector< std::vector<backend::event> > staged(nd);
+
+            for(unsigned d = 0; d < nd; d++) exc[d].sent.clear();
+
+            // Size of the staging buffer, per component.
+            auto stage_size = [&](unsigned r) {
+                return transposed ? exc[r].send_size() : exc[r].recv_size();
+            };
+
+            // Download segments to the staging buffers, ...
+            for(unsigned s = 0; s < nd; s++) {
+                std::vector<backend::event> wait(1, ready[s]);
+
+                for(unsigned r = 0; r < nd; r++) {
+                    if (!segment(s, r, transposed).size || exc[r].peer[s]) continue;
+
+                    if (exc[r].stage.size() < N * stage_size(r)) {
+                        if (!exc[r].unstaged.empty()) exc[r].unstaged.wait();
+                        exc[r].stage = backend::pinned_buffer<val_t>(squeue[r], N * stage_size(r));
+                    }
+
+                    wait.push_back(exc[r].unstaged);
+                }
+
+                if (wait.size() == 1) continue;
+
+                backend::select_context(squeue[s]);
+                backend::enqueue_barrier(squeue[s], wait);
+
+                for(unsigned r = 0; r < nd; r++) {
+                    exsegment g = segment(s, r, transposed);
+                    if (!g.size || exc[r].peer[s]) continue;
+
+                    for(size_t i = 0; i < N; i++)
+                        src(s, i).read_async(squeue[s], g.src, g.size,
+                                exc[r].stage.data() + i * stage_size(r) + g.dst);
+                }
+
+                backend::event e = backend::event::marker(squeue[s]);
+                exc[s].sent.push_back(e);
+
+                for(unsigned r = 0; r < nd; r++)
+                    if (segment(s, r, transposed).size && !exc[r].peer[s])
+                        staged[r].push_back(e);
+            }
+
+            // ... and move them to the receivers. The receiver queue also
+            // waits for its own producer, which follows the last use of the
+            // destination buffer.
+            for(unsigned r = 0; r < nd; r++) {
+                std::vector<backend::event> wait(staged[r]);
+                wait.push_back(ready[r]);
+
+                bool direct = false;
+                for(unsigned s = 0; s < nd; s++) {
+                    if (segment(s, r, transposed).size && exc[r].peer[s]) {
+                        wait.push_back(ready[s]);
+                        direct = true;
+                    }
+                }
+
+                if (!direct && staged[r].empty()) continue;
+
+                backend::select_context(squeue[r]);
+                backend::enqueue_barrier(squeue[r], wait);
+
+                for(unsigned s = 0; s < nd; s++) {
+                    exsegment g = segment(s, r, transposed);
+                    if (!g.size) continue;
+
+                    for(size_t i = 0; i < N; i++) {
+                        if (exc[r].peer[s])
+                            src(s, i).copy_async(squeue[r], g.src, g.size, dst(r, i), g.dst);
+                        else
+                            dst(r, i).write_async(squeue[r], g.dst, g.size,
+                                    exc[r].stage.data() + i * stage_size(r) + g.dst);
+                    }
+                }
+
+                landed[r] = backend::event::marker(squeue[r]);
+
+                if (!staged[r].empty()) exc[r].unstaged = landed[r];
+
+                for(unsigned s = 0; s < nd; s++)
+                    if (segment(s, r, transposed).size && exc[r].peer[s])
+                        exc[s].sent.push_back(landed[r]);
+            }
+
+            return landed;
+        }
+
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+        // Transposes local and remote parts of the device strips.
+        void transpose_strips() const {
+            auto col_part = partition(ncols, queue);
+
+            tloc.resize(queue.size());
+            trem.resize(queue.size());
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!mtx[d]) continue;
+
+                tloc[d] = transpose_part(d, false, col_part[d + 1] - col_part[d]);
+
+                if (size_t rcols = exc[d].recv_size()) {
+                    trem[d] = transpose_part(d, true, rcols);
+                    exc[d].tx = backend::device_vector<val_t>(queue[d], rcols);
+                }
+            }
+        }
+
+        // Sorts elements of a part by column; the columns become row
+        // numbers of the transposed part, which has nt rows.
+        std::unique_ptr<SpMatCSR> transpose_part(unsigned d, bool remote, size_t nt) const {
+            std::unique_ptr<SpMatCSR> t;
+            if (!nt) return t;
+
+            std::vector<backend::command_queue> q(1, queue[d]);
+
+            // Padding gets column nt and ends up past the last row.
+            vector<col_t> row, col;
+            vector<val_t> val;
+            mtx[d]->triplets(remote, static_cast<col_t>(nt), row, col, val);
+
+            vector<idx_t> ptr;
+            if (col.size()) {
+                sort_by_key(std::tie(col, row), val, coo_less());
+
+                ptr.resize(q, nt + 1);
+                ptr = lower_bound(col, element_index());
+            }
+
+            t.reset(new SpMatCSR(queue[d], nt, part[d + 1] - part[d], ptr, row, val));
+            return t;
+        }
+#endif
+
+        std::vector<std::vector<col_t>> setup_exchange(
                 const std::vector<size_t> &col_part,
                 const idx_t *row, const col_t *col
                 )
@@ -304,11 +1341,11 @@ class SpMat {
                 return c >= col_part[part] && c < col_part[part + 1];
             };
 
-            std::vector<std::set<col_t>> ghost_cols(queue.size());
+            std::vector<std::vector<col_t>> ghost_cols(queue.size());
 
             if (queue.size() <= 1) return ghost_cols;
 
-            // Build sets of ghost points.
+            // Build sorted lists of ghost points.
 #ifdef _OPENMP
 #  pragma omp parallel for schedule(static,1)
 #endif
@@ -316,93 +1353,136 @@ class SpMat {
                 for(size_t i = part[d]; i < part[d + 1]; i++) {
                     for(idx_t j = row[i]; j < row[i + 1]; j++) {
                         if (!is_local(col[j], d)) {
-                            ghost_cols[d].insert(col[j]);
+                            ghost_cols[d].push_back(col[j]);
                         }
                     }
                 }
+
+                std::sort(ghost_cols[d].begin(), ghost_cols[d].end());
+                ghost_cols[d].erase(
+                        std::unique(ghost_cols[d].begin(), ghost_cols[d].end()),
+                        ghost_cols[d].end());
             }
 
-            // Complete set of points to be exchanged between devices.
-            std::vector<col_t> cols_to_send;
-            {
-                std::set<col_t> cols_to_send_s;
-                for(unsigned d = 0; d < queue.size(); d++)
-                    cols_to_send_s.insert(ghost_cols[d].begin(), ghost_cols[d].end());
+            // Split ghost lists into segments by owner.
+            for(unsigned d = 0; d < queue.size(); d++) {
+                exc[d].recv_ptr.resize(queue.size() + 1);
 
-                cols_to_send.insert(cols_to_send.begin(), cols_to_send_s.begin(), cols_to_send_s.end());
-            }
+                auto beg = ghost_cols[d].begin();
+                auto end = ghost_cols[d].end();
+                for(unsigned o = 0; o <= queue.size(); o++) {
+                    beg = std::lower_bound(beg, end, static_cast<col_t>(col_part[o]));
+                    exc[d].recv_ptr[o] = beg - ghost_cols[d].begin();
+                }
 
-            // Build local structures to facilitate exchange.
-            if (cols_to_send.size()) {
-#ifdef _OPENMP
-#  pragma omp parallel for schedule(static,1)
-#endif
-                for(int d = 0; d < static_cast<int>(queue.size()); d++) {
-                    if (size_t rcols = ghost_cols[d].size()) {
-                        exc[d].cols_to_recv.resize(rcols);
-                        exc[d].vals_to_recv.resize(rcols);
+                exc[d].peer.resize(queue.size());
+                for(unsigned o = 0; o < queue.size(); o++)
+                    if (o != d) exc[d].peer[o] = backend::can_copy_peer(queue[o], queue[d]);
 
-                        exc[d].rx = backend::device_vector<val_t>(queue[d], rcols,
-                                static_cast<const val_t*>(0), backend::MEM_READ_ONLY);
+                if (size_t rcols = ghost_cols[d].size()) {
+                    has_ghosts = true;
 
-                        for(size_t i = 0, j = 0; i < cols_to_send.size(); i++)
-                            if (ghost_cols[d].count(cols_to_send[i]))
-                                exc[d].cols_to_recv[j++] = static_cast<col_t>(i);
-                    }
+                    exc[d].rx = backend::device_vector<val_t>(queue[d], rcols,
+                            static_cast<const val_t*>(0), backend::MEM_READ_ONLY);
                 }
+            }
 
-                rx.resize(cols_to_send.size());
-                cidx.resize(queue.size() + 1);
+            if (!has_ghosts) return ghost_cols;
 
-                {
-                    auto beg = cols_to_send.begin();
-                    auto end = cols_to_send.end();
-                    for(unsigned d = 0; d <= queue.size(); d++) {
-                        cidx[d] = std::lower_bound(beg, end, static_cast<col_t>(col_part[d]))
-                                - cols_to_send.begin();
-                        beg = cols_to_send.begin() + cidx[d];
-                    }
-                }
+            // Lists of points to send, ordered by receiver.
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static,1)
+#endif
+            for(int o = 0; o < static_cast<int>(queue.size()); o++) {
+                exc[o].send_ptr.resize(queue.size() + 1);
+                exc[o].send_ptr[0] = 0;
 
+                std::vector<col_t> cols_to_send;
                 for(unsigned d = 0; d < queue.size(); d++) {
-                    if (size_t ncols = cidx[d + 1] - cidx[d]) {
-                        exc[d].vals_to_send = backend::device_vector<val_t>(
-                                queue[d], ncols);
+                    for(size_t i = exc[d].recv_ptr[o]; i < exc[d].recv_ptr[o + 1]; i++)
+                        cols_to_send.push_back(
+                                static_cast<col_t>(ghost_cols[d][i] - col_part[o]));
 
-                        for(size_t i = cidx[d]; i < cidx[d + 1]; i++)
-                            cols_to_send[i] -= static_cast<col_t>(col_part[d]);
-
-                        exc[d].cols_to_send = backend::device_vector<col_t>(
-                                queue[d], ncols, &cols_to_send[cidx[d]], backend::MEM_READ_ONLY);
-                    }
+                    exc[o].send_ptr[d + 1] = cols_to_send.size();
                 }
 
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (cidx[d + 1] > cidx[d]) queue[d].finish();
+                if (size_t ncols = cols_to_send.size()) {
+                    exc[o].vals_to_send = backend::device_vector<val_t>(queue[o], ncols);
+                    exc[o].cols_to_send = backend::device_vector<col_t>(
+                            queue[o], ncols, cols_to_send.data(), backend::MEM_READ_ONLY);
+                }
             }
 
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (exc[d].send_size()) backend::finish(queue[d]);
+
             return ghost_cols;
         }
 };
 
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+/// Transposed view of a sparse matrix.
+/**
+ * Returned by vex::transpose(). Products with the view are computed with
+ * SpMat::apply_transposed(). The view only references the matrix, so the
+ * product should be used in the same expression it was created in.
+ */
+template <class Matrix>
+struct transposed_matrix {
+    typedef typename Matrix::value_type  value_type;
+    typedef typename Matrix::scalar_type scalar_type;
+
+    const Matrix &A;
+
+    transposed_matrix(const Matrix &A) : A(A) {}
+
+    void apply(const vector<value_type> &x, vector<value_type> &y,
+            scalar_type alpha = 1, bool append = false) const
+    {
+        A.apply_transposed(x, y, alpha, append);
+    }
+};
+
+/// Returns transposed view of the sparse matrix.
+/**
+ \code
+ y = vex::transpose(A) * x;
+ \endcode
+ */
+template <typename val_t, typename col_t, typename idx_t, class F>
+transposed_matrix< SpMat<val_t, col_t, idx_t, F> >
+transpose(const SpMat<val_t, col_t, idx_t, F> &A) {
+    return transposed_matrix< SpMat<val_t, col_t, idx_t, F> >(A);
+}
+#endif
+
 /// \cond INTERNAL
 
-template <typename val_t, typename col_t, typename idx_t>
-additive_operator< SpMat<val_t, col_t, idx_t >, vector<val_t> >
-operator*(const SpMat<val_t, col_t, idx_t> &A, const vector<val_t> &x)
+#if !defined(VEXCL_BACKEND_CUDA) || !defined(VEXCL_USE_CUSPARSE)
+template <class M>
+additive_operator< transposed_matrix<M>, vector<typename M::value_type> >
+operator*(const transposed_matrix<M> &A, const vector<typename M::value_type> &x)
+{
+    return additive_operator< transposed_matrix<M>, vector<typename M::value_type> >(A, x);
+}
+#endif
+
+template <typename val_t, typename col_t, typename idx_t, class F>
+additive_operator< SpMat<val_t, col_t, idx_t, F>, vector<val_t> >
+operator*(const SpMat<val_t, col_t, idx_t, F> &A, const vector<val_t> &x)
 {
-    return additive_operator< SpMat<val_t, col_t, idx_t >, vector<val_t> >(A, x);
+    return additive_operator< SpMat<val_t, col_t, idx_t, F>, vector<val_t> >(A, x);
 }
 
 #ifdef VEXCL_MULTIVECTOR_HPP
-template <typename val_t, typename col_t, typename idx_t, class V>
+template <typename val_t, typename col_t, typename idx_t, class F, class V>
 typename std::enable_if<
     std::is_base_of<multivector_terminal_expression, V>::value &&
     std::is_same<val_t, typename V::sub_value_type>::value,
-    multiadditive_operator< SpMat<val_t, col_t, idx_t>, V >
+    multiadditive_operator< SpMat<val_t, col_t, idx_t, F>, V >
 >::type
-operator*(const SpMat<val_t, col_t, idx_t> &A, const V &x) {
-    return multiadditive_operator< SpMat<val_t, col_t, idx_t>, V >(A, x);
+operator*(const SpMat<val_t, col_t, idx_t, F> &A, const V &x) {
+    return multiadditive_operator< SpMat<val_t, col_t, idx_t, F>, V >(A, x);
 }
 #endif
 
@@ -485,18 +1565,19 @@ inline double device_spmv_perf(const backend::command_queue &q) {
     // Warming run.
     x = 1;
     A.apply(x, y);
+    backend::finish(queue[0]);
 
     // Measure performance.
-    profiler<> prof(queue);
-    prof.tic_cl("");
+    stopwatch<> watch;
     A.apply(x, y);
-    double time = prof.toc("");
-    return 1.0 / time;
+    backend::finish(queue[0]);
+    return 1.0 / watch.toc();
 }
 
 } // namespace vex
 
 #include <vexcl/spmat/ccsr.hpp>
+#include <vexcl/spmat/bsr.hpp>
 #include <vexcl/spmat/inline_spmv.hpp>
 
 #endif
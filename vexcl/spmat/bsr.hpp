@@ -0,0 +1,352 @@
+#ifndef VEXCL_SPMAT_BSR_HPP
+#define VEXCL_SPMAT_BSR_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/bsr.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Sparse matrix in block CSR format.
+ */
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <vexcl/gather.hpp>
+
+namespace vex {
+
+/// Sparse matrix in block CSR (BSR) format.
+/**
+ * The matrix consists of dense B x B blocks. row and col arrays describe the
+ * structure of the matrix in terms of blocks, and val array holds values of
+ * the blocks, each stored in row-major order. Only one column number is
+ * stored for each block, and the kernels load values of a block row
+ * contiguously.
+ *
+ * Rows of the matrix are split between the compute devices in the same way
+ * vectors are partitioned; a block row may be shared by two devices. Blocks
+ * that reference columns owned by other devices are kept separately, and the
+ * values of x they need are gathered before the product.
+ */
+template <typename val_t, size_t B, typename col_t = size_t, typename idx_t = size_t>
+class SpMatBSR {
+    static_assert(B > 0, "Block size should be positive");
+
+    public:
+        typedef val_t value_type;
+        typedef typename cl_scalar_of<val_t>::type scalar_type;
+
+        /// Constructor.
+        /**
+         * \param queue vector of queues. Each queue represents one
+         *              compute device.
+         * \param nb    number of block rows in the matrix.
+         * \param mb    number of block cols in the matrix.
+         * \param row   index into col vector for each block row.
+         * \param col   block column numbers of the blocks.
+         * \param val   values of the blocks, B * B values per block.
+         */
+        SpMatBSR(const std::vector<backend::command_queue> &queue,
+                size_t nb, size_t mb, const idx_t *row, const col_t *col, const val_t *val
+                )
+            : queue(queue), part(partition(nb * B, queue)),
+              loc(queue.size()), rem(queue.size()), exc(queue.size()), rx(queue.size()),
+              nrows(nb * B), ncols(mb * B), nnzb(row[nb])
+        {
+            std::vector<size_t> col_part = partition(ncols, queue);
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (part[d + 1] == part[d]) continue;
+
+                // Block rows touching the strip of the device.
+                size_t br_begin = part[d] / B;
+                size_t br_end   = (part[d + 1] + B - 1) / B;
+
+                size_t c_begin = col_part[d];
+                size_t c_end   = col_part[d + 1];
+
+                auto is_local = [c_begin, c_end](size_t c) {
+                    return c * B >= c_begin && (c + 1) * B <= c_end;
+                };
+
+                // Blocks referencing columns of other devices.
+                std::vector<size_t> ghost;
+                for(size_t i = br_begin; i < br_end; ++i)
+                    for(idx_t j = row[i]; j < row[i + 1]; ++j)
+                        if (!is_local(col[j])) ghost.push_back(col[j]);
+
+                std::sort(ghost.begin(), ghost.end());
+                ghost.erase(std::unique(ghost.begin(), ghost.end()), ghost.end());
+
+                setup(loc[d], d, br_begin, br_end, row, col, val,
+                        [&](size_t c) -> size_t {
+                            return is_local(c) ? c * B - c_begin : not_a_column;
+                        });
+
+                if (ghost.empty()) continue;
+
+                setup(rem[d], d, br_begin, br_end, row, col, val,
+                        [&](size_t c) -> size_t {
+                            if (is_local(c)) return not_a_column;
+                            return B * (std::lower_bound(ghost.begin(), ghost.end(), c) - ghost.begin());
+                        });
+
+                std::vector<size_t> cols_to_recv;
+                cols_to_recv.reserve(ghost.size() * B);
+                for(auto c = ghost.begin(); c != ghost.end(); ++c)
+                    for(size_t k = 0; k < B; ++k)
+                        cols_to_recv.push_back(*c * B + k);
+
+                exc[d].reset(new gather<val_t>(queue, ncols, cols_to_recv));
+                rx[d].host.resize(cols_to_recv.size());
+                rx[d].dev = backend::device_vector<val_t>(queue[d], cols_to_recv.size());
+            }
+        }
+
+        /// Matrix-vector multiplication.
+        /**
+         * Matrix vector multiplication (\f$y = \alpha Ax\f$ or \f$y += \alpha
+         * Ax\f$) is performed in parallel on all registered compute devices.
+         * \param x      input vector.
+         * \param y      output vector.
+         * \param alpha  coefficient in front of matrix-vector product
+         * \param append if set, matrix-vector product is appended to y.
+         *               Otherwise, y is replaced with matrix-vector product.
+         */
+        void apply(const vex::vector<val_t> &x, vex::vector<val_t> &y,
+                 scalar_type alpha = 1, bool append = false) const
+        {
+            // Start with the local blocks, ...
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (part[d + 1] == part[d]) continue;
+
+                backend::select_context(queue[d]);
+
+                if (append)
+                    mul<assign::ADD>(d, loc[d], x(d), y(d), alpha);
+                else
+                    mul<assign::SET>(d, loc[d], x(d), y(d), alpha);
+            }
+
+            // ... gather values of x owned by other devices, ...
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!exc[d]) continue;
+
+                (*exc[d])(x, rx[d].host);
+                rx[d].dev.write(queue[d], 0, rx[d].host.size(), rx[d].host.data(), true);
+            }
+
+            // ... and add contribution of the remote blocks.
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!exc[d]) continue;
+
+                backend::select_context(queue[d]);
+                mul<assign::ADD>(d, rem[d], rx[d].dev, y(d), alpha);
+            }
+        }
+
+        /// Number of rows.
+        size_t rows() const { return nrows; }
+        /// Number of columns.
+        size_t cols() const { return ncols; }
+        /// Number of non-zero blocks.
+        size_t nonzero_blocks() const { return nnzb; }
+        /// Number of stored values.
+        size_t nonzeros() const { return nnzb * B * B; }
+    private:
+        static const size_t not_a_column = static_cast<size_t>(-1);
+
+        struct matrix_part {
+            size_t nbrows; // Number of block rows.
+            size_t shift;  // Position of the first row of the strip in the first block row.
+            backend::device_vector<idx_t> ptr;
+            backend::device_vector<col_t> col; // Position of the first input value of the block.
+            backend::device_vector<val_t> val;
+
+            matrix_part() : nbrows(0), shift(0) {}
+        };
+
+        struct host_device_buffer {
+            std::vector<val_t> host;
+            backend::device_vector<val_t> dev;
+        };
+
+        std::vector<backend::command_queue> queue;
+        std::vector<size_t> part;
+
+        std::vector<matrix_part> loc, rem;
+
+        mutable std::vector< std::unique_ptr< gather<val_t> > > exc;
+        mutable std::vector< host_device_buffer > rx;
+
+        size_t nrows;
+        size_t ncols;
+        size_t nnzb;
+
+        // Builds the strip of block rows [br_begin, br_end) from the blocks
+        // accepted by colmap.
+        template <class ColMap>
+        void setup(matrix_part &p, unsigned d,
+                size_t br_begin, size_t br_end,
+                const idx_t *row, const col_t *col, const val_t *val,
+                ColMap colmap)
+        {
+            p.nbrows = br_end - br_begin;
+            p.shift  = part[d] - br_begin * B;
+
+            const backend::command_queue &q = queue[d];
+
+            std::vector<idx_t> ptr(p.nbrows + 1, 0);
+            std::vector<col_t> pcol;
+            std::vector<val_t> pval;
+
+            for(size_t i = br_begin; i < br_end; ++i) {
+                for(idx_t j = row[i]; j < row[i + 1]; ++j) {
+                    size_t c = colmap(col[j]);
+                    if (c == not_a_column) continue;
+
+                    pcol.push_back(static_cast<col_t>(c));
+                    pval.insert(pval.end(), val + j * B * B, val + (j + 1) * B * B);
+                }
+                ptr[i - br_begin + 1] = static_cast<idx_t>(pcol.size());
+            }
+
+            p.ptr = backend::device_vector<idx_t>(q, ptr.size(), ptr.data(), backend::MEM_READ_ONLY);
+
+            if (!pcol.empty()) {
+                p.col = backend::device_vector<col_t>(q, pcol.size(), pcol.data(), backend::MEM_READ_ONLY);
+                p.val = backend::device_vector<val_t>(q, pval.size(), pval.data(), backend::MEM_READ_ONLY);
+            }
+        }
+
+        template <class OP>
+        void mul(unsigned d, const matrix_part &p,
+                const backend::device_vector<val_t> &in,
+                backend::device_vector<val_t> &out,
+                scalar_type scale) const
+        {
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            auto kernel = cache.find(queue[d]);
+
+            if (kernel == cache.end()) {
+                backend::source_generator source(queue[d]);
+
+                source.kernel("bsr_spmv")
+                    .open("(")
+                        .template parameter<size_t>("n")
+                        .template parameter<size_t>("shift")
+                        .template parameter<size_t>("nrows")
+                        .template parameter<scalar_type>("scale")
+                        .template parameter< global_ptr<const idx_t> >("ptr")
+                        .template parameter< global_ptr<const col_t> >("col")
+                        .template parameter< global_ptr<const val_t> >("val")
+                        .template parameter< global_ptr<const val_t> >("in")
+                        .template parameter< global_ptr<val_t> >("out")
+                    .close(")")
+                    .open("{")
+                        .grid_stride_loop("i").open("{");
+
+                for(size_t r = 0; r < B; ++r)
+                    source.new_line() << type_name<val_t>() << " sum" << r << " = 0;";
+
+                source.new_line() << "for(size_t j = ptr[i], e = ptr[i + 1]; j < e; ++j)";
+                source.open("{");
+                source.new_line() << type_name< global_ptr<const val_t> >() << " v = val + j * " << B * B << ";";
+                source.new_line() << type_name< global_ptr<const val_t> >() << " x = in + col[j];";
+                for(size_t k = 0; k < B; ++k)
+                    source.new_line() << type_name<val_t>() << " x" << k << " = x[" << k << "];";
+                for(size_t r = 0; r < B; ++r) {
+                    source.new_line() << "sum" << r << " +=";
+                    for(size_t k = 0; k < B; ++k)
+                        source << (k ? " + " : " ") << "v[" << r * B + k << "] * x" << k;
+                    source << ";";
+                }
+                source.close("}");
+
+                // The first and the last block rows may be shared with
+                // the neighbour devices.
+                for(size_t r = 0; r < B; ++r) {
+                    source.new_line() << "if (i * " << B << " + " << r << " >= shift && "
+                        << "i * " << B << " + " << r << " < shift + nrows) "
+                        << "out[i * " << B << " + " << r << " - shift] "
+                        << OP::string() << " scale * sum" << r << ";";
+                }
+
+                source.close("}").close("}");
+
+                kernel = cache.insert(queue[d], backend::kernel(
+                            queue[d], source.str(), "bsr_spmv"));
+            }
+
+            kernel->second.push_arg(p.nbrows);
+            kernel->second.push_arg(p.shift);
+            kernel->second.push_arg(part[d + 1] - part[d]);
+            kernel->second.push_arg(scale);
+            kernel->second.push_arg(p.ptr);
+
+            if (p.col.size()) {
+                kernel->second.push_arg(p.col);
+                kernel->second.push_arg(p.val);
+            } else {
+                kernel->second.push_arg(static_cast<size_t>(0));
+                kernel->second.push_arg(static_cast<size_t>(0));
+            }
+
+            kernel->second.push_arg(in);
+            kernel->second.push_arg(out);
+
+            kernel->second(queue[d]);
+        }
+};
+
+/// Multiply block sparse matrix by a vector.
+template <typename val_t, size_t B, typename col_t, typename idx_t>
+additive_operator< SpMatBSR<val_t, B, col_t, idx_t>, vector<val_t> >
+operator*(const SpMatBSR<val_t, B, col_t, idx_t> &A, const vector<val_t> &x)
+{
+    return additive_operator< SpMatBSR<val_t, B, col_t, idx_t>, vector<val_t> >(A, x);
+}
+
+#ifdef VEXCL_MULTIVECTOR_HPP
+/// Multiply block sparse matrix by each component of a multivector.
+template <typename val_t, size_t B, typename col_t, typename idx_t, class V>
+typename std::enable_if<
+    std::is_base_of<multivector_terminal_expression, V>::value &&
+    std::is_same<val_t, typename V::sub_value_type>::value,
+    multiadditive_operator< SpMatBSR<val_t, B, col_t, idx_t>, V >
+>::type
+operator*(const SpMatBSR<val_t, B, col_t, idx_t> &A, const V &x) {
+    return multiadditive_operator< SpMatBSR<val_t, B, col_t, idx_t>, V >(A, x);
+}
+#endif
+
+} // namespace vex
+
+#endif
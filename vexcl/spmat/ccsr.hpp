@@ -47,9 +47,11 @@ namespace vex {
      y[i] = sum;
  }
  \endcode
- * This format does not support multi-device computation, so it accepts single
- * queue at initialization. Vectors x and y should also be single-queued and
- * reside on the same device with matrix.
+ * In a multi-device context the matrix is split into strips of rows in the
+ * same way vectors are partitioned. The unique rows are replicated on each of
+ * the devices. Before the product is computed on a device, the values of x
+ * that the strip references across the partition boundaries (halos) are
+ * fetched from the neighbours, as it is done for stencil convolutions.
  */
 template <typename val_t, typename col_t = ptrdiff_t, typename idx_t = size_t>
 struct SpMatCCSR {
@@ -58,7 +60,7 @@ struct SpMatCCSR {
 
     /// Constructor for CCSR format.
     /**
-     * Constructs GPU representation of the CCSR matrix.
+     * Constructs GPU representation of the CCSR matrix on a single device.
      * \param queue single queue.
      * \param n     number of rows in the matrix.
      * \param m     number of unique rows in the matrix.
@@ -70,19 +72,179 @@ struct SpMatCCSR {
     SpMatCCSR(const backend::command_queue &queue, size_t n, size_t m,
             const idx_t *idx, const idx_t *row, const col_t *col, const val_t *val
             )
-        : queue(queue), n(n),
-          idx(queue, n,      idx, backend::MEM_READ_ONLY),
-          row(queue, (m+1),  row, backend::MEM_READ_ONLY),
-          col(queue, row[m], col, backend::MEM_READ_ONLY),
-          val(queue, row[m], val, backend::MEM_READ_ONLY)
-    { }
-
-    backend::command_queue queue;
+        : queue(1, queue), part(2), n(n), halo_lookups(0)
+    {
+        part[0] = 0;
+        part[1] = n;
+
+        init(m, idx, row, col, val);
+    }
+
+    /// Constructor for CCSR format.
+    /**
+     * Constructs GPU representation of the CCSR matrix. The rows are split
+     * between the compute devices.
+     * \param queue vector of queues. Each queue represents one
+     *              compute device.
+     * \param n     number of rows in the matrix.
+     * \param m     number of unique rows in the matrix.
+     * \param idx   index into row vector.
+     * \param row   row index into col and val vectors.
+     * \param col   column positions of nonzero elements wrt to diagonal.
+     * \param val   values of nonzero elements of the matrix.
+     */
+    SpMatCCSR(const std::vector<backend::command_queue> &queue, size_t n, size_t m,
+            const idx_t *idx, const idx_t *row, const col_t *col, const val_t *val
+            )
+        : queue(queue), part(partition(n, queue)), n(n), halo_lookups(0)
+    {
+        init(m, idx, row, col, val);
+    }
+
+    std::vector<backend::command_queue> queue;
+    std::vector<size_t> part;
     size_t n;
-    backend::device_vector<idx_t> idx;
-    backend::device_vector<idx_t> row;
-    backend::device_vector<col_t> col;
-    backend::device_vector<val_t> val;
+
+    // Halo widths: the largest offsets to the left and to the right of the
+    // diagonal.
+    int lhalo;
+    int rhalo;
+
+    std::vector< backend::device_vector<idx_t> > idx;
+    std::vector< backend::device_vector<idx_t> > row;
+    std::vector< backend::device_vector<col_t> > col;
+    std::vector< backend::device_vector<val_t> > val;
+
+    /// \cond INTERNAL
+    // Halo buffers for input vectors of type T.
+    struct halo_base {
+        size_t last_use;    // Position in the sequence of lookups.
+        size_t last_launch; // Kernel launch count of the thread at last use.
+
+        virtual ~halo_base() {}
+    };
+
+    template <typename T>
+    struct halo_buffers : public halo_base {
+        std::vector<T> host;
+        std::vector< backend::device_vector<T> > dev;
+    };
+
+    // Halo buffers are kept per source vector. Several products of the matrix
+    // may be terms of a single kernel (e.g. A * x + A * z, or a multivector
+    // product), and arguments of all terms are set before the kernel is
+    // launched, so the terms may not share a buffer. Once the table grows
+    // too large, the least recently used buffers are dropped. Buffers used
+    // since the last kernel launch may already be arguments of the pending
+    // launch and are kept, even if the table grows beyond the limit.
+    static const size_t max_halos = 64;
+
+    mutable std::map< const void*, std::unique_ptr<halo_base> > halo;
+    mutable size_t halo_lookups;
+
+    template <typename T>
+    halo_buffers<T>& halo_of(const vector<T> &x) const {
+        // Single-device products never read the halo, so they share a buffer.
+        const void *key = queue.size() > 1 ? static_cast<const void*>(&x) : 0;
+
+        const size_t launch = vex::detail::launch_counter::get();
+
+        auto i = halo.find(key);
+        if (i != halo.end())
+            if (halo_buffers<T> *h = dynamic_cast<halo_buffers<T>*>(i->second.get())) {
+                h->last_use    = ++halo_lookups;
+                h->last_launch = launch;
+                return *h;
+            }
+
+        if (i == halo.end()) {
+            while (halo.size() >= max_halos) {
+                auto lru = halo.end();
+                for(auto j = halo.begin(); j != halo.end(); ++j)
+                    if (j->second->last_launch != launch &&
+                            (lru == halo.end() || j->second->last_use < lru->second->last_use))
+                        lru = j;
+
+                if (lru == halo.end()) break;
+                halo.erase(lru);
+            }
+        }
+
+        const size_t width = lhalo + rhalo;
+
+        halo_buffers<T> *h = new halo_buffers<T>();
+        h->last_use    = ++halo_lookups;
+        h->last_launch = launch;
+        halo[key].reset(h);
+
+        // Allocate one element more than needed, to be sure size is nonzero.
+        h->host.resize(width + 1);
+        for(unsigned k = 0; k < queue.size(); ++k)
+            h->dev.push_back(backend::device_vector<T>(queue[k], width + 1));
+
+        return *h;
+    }
+
+    // Fetches values of x referenced by strip d across its boundaries.
+    // Halo of the strip is laid out as [lhalo left values, rhalo right
+    // values]. Values outside of x are never referenced and are left
+    // undefined.
+    template <typename T>
+    const backend::device_vector<T>& exchange_halo(const vector<T> &x, unsigned d) const {
+        const size_t width = lhalo + rhalo;
+
+        halo_buffers<T> &h = halo_of(x);
+
+        if (queue.size() > 1 && width > 0) {
+            T *hbuf = h.host.data();
+
+            if (lhalo > 0) {
+                size_t end   = part[d];
+                size_t begin = end >= static_cast<size_t>(lhalo) ? end - lhalo : 0;
+                x.read_data(begin, end - begin, hbuf + lhalo - (end - begin), true);
+            }
+
+            if (rhalo > 0) {
+                size_t begin = part[d + 1];
+                size_t end   = std::min(begin + rhalo, n);
+                x.read_data(begin, end - begin, hbuf + lhalo, true);
+            }
+
+            h.dev[d].write(queue[d], 0, width, hbuf, true);
+        }
+
+        return h.dev[d];
+    }
+    /// \endcond
+
+    private:
+        void init(size_t m,
+                const idx_t *idx_h, const idx_t *row_h, const col_t *col_h, const val_t *val_h)
+        {
+            lhalo = 0;
+            rhalo = 0;
+
+            for(idx_t j = 0; j < row_h[m]; ++j) {
+                lhalo = std::max<int>(lhalo, static_cast<int>(-col_h[j]));
+                rhalo = std::max<int>(rhalo, static_cast<int>( col_h[j]));
+            }
+
+            idx.resize(queue.size());
+            row.resize(queue.size());
+            col.resize(queue.size());
+            val.resize(queue.size());
+
+            // Each device gets its strip of the index and a copy of the unique rows.
+            for(unsigned d = 0; d < queue.size(); ++d) {
+                size_t psize = part[d + 1] - part[d];
+                if (!psize) continue;
+
+                idx[d] = backend::device_vector<idx_t>(queue[d], psize,    idx_h + part[d], backend::MEM_READ_ONLY);
+                row[d] = backend::device_vector<idx_t>(queue[d], m + 1,    row_h, backend::MEM_READ_ONLY);
+                col[d] = backend::device_vector<col_t>(queue[d], row_h[m], col_h, backend::MEM_READ_ONLY);
+                val[d] = backend::device_vector<val_t>(queue[d], row_h[m], val_h, backend::MEM_READ_ONLY);
+            }
+        }
 };
 
 /// \cond INTERNAL
@@ -189,13 +351,18 @@ struct terminal_preamble< ccsr_product<val_t, col_t, idx_t, T> > {
                 .template parameter< global_ptr<const col_t> >("col")
                 .template parameter< global_ptr<const val_t> >("val")
                 .template parameter< global_ptr<const T>     >("vec")
+                .template parameter< global_ptr<const T>     >("halo")
+                .template parameter< size_t >("n")
+                .template parameter< int >("lhalo")
                 .template parameter< size_t >("i")
             .close(")").open("{");
 
         src.new_line() << type_name<res_t>() << " sum = 0;";
         src.new_line() << "for(size_t pos = idx[i], j = row[pos], end = row[pos+1]; j < end; ++j)";
         src.open("{");
-        src.new_line() << "sum += val[j] * vec[i + col[j]];";
+        src.new_line() << type_name<ptrdiff_t>() << " c = (" << type_name<ptrdiff_t>() << ")i + col[j];";
+        src.new_line() << "sum += val[j] * (c < 0 ? halo[lhalo + c] : "
+            "(c < (" << type_name<ptrdiff_t>() << ")n ? vec[c] : halo[lhalo + c - n]));";
         src.close("}");
         src.new_line() << "return sum;";
         src.close("}");
@@ -214,6 +381,9 @@ struct kernel_param_declaration< ccsr_product<val_t, col_t, idx_t, T> > {
         src.template parameter< global_ptr<const col_t> >(prm_name) << "_col";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_val";
         src.template parameter< global_ptr<const T    > >(prm_name) << "_vec";
+        src.template parameter< global_ptr<const T    > >(prm_name) << "_halo";
+        src.template parameter< size_t >(prm_name) << "_n";
+        src.template parameter< int >(prm_name) << "_lhalo";
     }
 };
 
@@ -229,7 +399,10 @@ struct partial_vector_expr< ccsr_product<val_t, col_t, idx_t, T> > {
             << prm_name << "_row, "
             << prm_name << "_col, "
             << prm_name << "_val, "
-            << prm_name << "_vec, idx)";
+            << prm_name << "_vec, "
+            << prm_name << "_halo, "
+            << prm_name << "_n, "
+            << prm_name << "_lhalo, idx)";
     }
 };
 
@@ -239,13 +412,16 @@ struct kernel_arg_setter< ccsr_product<val_t, col_t, idx_t, T> > {
             backend::kernel &kernel, unsigned part, size_t/*index_offset*/,
             detail::kernel_generator_state_ptr)
     {
-        assert(part == 0);
+        const auto &halo = term.A.exchange_halo(term.x, part);
 
-        kernel.push_arg(term.A.idx);
-        kernel.push_arg(term.A.row);
-        kernel.push_arg(term.A.col);
-        kernel.push_arg(term.A.val);
+        kernel.push_arg(term.A.idx[part]);
+        kernel.push_arg(term.A.row[part]);
+        kernel.push_arg(term.A.col[part]);
+        kernel.push_arg(term.A.val[part]);
         kernel.push_arg(term.x(part));
+        kernel.push_arg(halo);
+        kernel.push_arg(term.A.part[part + 1] - term.A.part[part]);
+        kernel.push_arg(term.A.lhalo);
     }
 };
 
@@ -261,8 +437,8 @@ struct expression_properties< ccsr_product<val_t, col_t, idx_t, T> > {
         partition  = term.x.partition();
         size       = term.x.size();
 
-        assert(partition.size() == 2);
-        partition.back() = size;
+        precondition(partition == term.A.part,
+                "CCSR matrix and vector are partitioned differently");
     }
 };
 
@@ -38,7 +38,7 @@ struct SpMatCSR : public sparse_matrix {
     struct matrix_part {
         size_t nnz;
         backend::device_vector<idx_t> row;
-        backend::device_vector<col_t> col;
+        column_index col;
         backend::device_vector<val_t> val;
     } loc, rem;
 
@@ -47,91 +47,61 @@ struct SpMatCSR : public sparse_matrix {
             const idx_t *row_begin, const idx_t *row_end,
             const col_t *col, const val_t *val,
             col_t col_begin, col_t col_end,
-            std::set<col_t> ghost_cols
+            const std::vector<col_t> &ghost_cols
             )
         : queue(queue), n(row_end - row_begin)
     {
-        auto is_local = [col_begin, col_end](col_t c) {
-            return c >= col_begin && c < col_end;
-        };
-
-        if (ghost_cols.empty()) {
+        if (ghost_cols.empty() && col_begin == 0) {
             loc.nnz = *row_end - *row_begin;
             rem.nnz = 0;
 
             if (loc.nnz) {
                 loc.row = backend::device_vector<idx_t>(queue, (n + 1), row_begin,        backend::MEM_READ_ONLY);
-                loc.col = backend::device_vector<col_t>(queue, loc.nnz, col + *row_begin, backend::MEM_READ_ONLY);
+                loc.col = column_index(queue, col_end, loc.nnz, col + *row_begin);
                 loc.val = backend::device_vector<val_t>(queue, loc.nnz, val + *row_begin, backend::MEM_READ_ONLY);
 
                 if (*row_begin > 0) vector<idx_t>(queue, loc.row) -= *row_begin;
             }
         } else {
-            std::vector<idx_t> lrow;
-            std::vector<col_t> lcol;
-            std::vector<val_t> lval;
-
-            std::vector<idx_t> rrow;
-            std::vector<col_t> rcol;
-            std::vector<val_t> rval;
-
-            lrow.reserve(n + 1);
-            lrow.push_back(0);
-
-            lcol.reserve(*row_end - *row_begin);
-            lval.reserve(*row_end - *row_begin);
-
-            if (!ghost_cols.empty()) {
-                rrow.reserve(n + 1);
-                rrow.push_back(0);
-
-                rcol.reserve(*row_end - *row_begin);
-                rval.reserve(*row_end - *row_begin);
-            }
-
-            // Renumber columns.
-            std::unordered_map<col_t, col_t> r2l(2 * ghost_cols.size());
-            size_t nghost = 0;
-            for(auto c = ghost_cols.begin(); c != ghost_cols.end(); ++c)
-                r2l[*c] = static_cast<col_t>(nghost++);
-
-            for(auto row = row_begin; row != row_end; ++row) {
-                for(idx_t j = row[0]; j < row[1]; j++) {
-                    if (is_local(col[j])) {
-                        lcol.push_back(static_cast<col_t>(col[j] - col_begin));
-                        lval.push_back(val[j]);
-                    } else {
-                        assert(r2l.count(col[j]));
-                        rcol.push_back(r2l[col[j]]);
-                        rval.push_back(val[j]);
-                    }
-                }
-
-                lrow.push_back(static_cast<idx_t>(lcol.size()));
-                rrow.push_back(static_cast<idx_t>(rcol.size()));
-            }
+            csr_split A(row_begin, row_end, col, val, col_begin, col_end, ghost_cols);
 
+            loc.nnz = A.lrow.back();
+            rem.nnz = A.rrow.back();
 
             // Copy local part to the device.
-            if (lrow.back()) {
-                loc.nnz = lrow.back();
-
-                loc.row = backend::device_vector<idx_t>(queue, lrow.size(), lrow.data(), backend::MEM_READ_ONLY);
-                loc.col = backend::device_vector<col_t>(queue, lcol.size(), lcol.data(), backend::MEM_READ_ONLY);
-                loc.val = backend::device_vector<val_t>(queue, lval.size(), lval.data(), backend::MEM_READ_ONLY);
+            if (loc.nnz) {
+                loc.row = backend::device_vector<idx_t>(queue, A.lrow.size(), A.lrow.data(), backend::MEM_READ_ONLY);
+                loc.col = column_index(queue, col_end - col_begin, A.lcol.size(), A.lcol.data());
+                loc.val = backend::device_vector<val_t>(queue, A.lval.size(), A.lval.data(), backend::MEM_READ_ONLY);
             }
 
             // Copy remote part to the device.
-            if (!ghost_cols.empty()) {
-                rem.nnz = rrow.back();
-
-                rem.row = backend::device_vector<idx_t>(queue, rrow.size(), rrow.data(), backend::MEM_READ_ONLY);
-                rem.col = backend::device_vector<col_t>(queue, rcol.size(), rcol.data(), backend::MEM_READ_ONLY);
-                rem.val = backend::device_vector<val_t>(queue, rval.size(), rval.data(), backend::MEM_READ_ONLY);
+            if (rem.nnz) {
+                rem.row = backend::device_vector<idx_t>(queue, A.rrow.size(), A.rrow.data(), backend::MEM_READ_ONLY);
+                rem.col = column_index(queue, ghost_cols.size(), A.rcol.size(), A.rcol.data());
+                rem.val = backend::device_vector<val_t>(queue, A.rval.size(), A.rval.data(), backend::MEM_READ_ONLY);
             }
         }
     }
 
+    // Builds single-device matrix with m columns from CSR arrays located on
+    // the device.
+    SpMatCSR(
+            const backend::command_queue &queue, size_t n, size_t m,
+            const vector<idx_t> &row, const vector<col_t> &col, const vector<val_t> &val
+            )
+        : queue(queue), n(n)
+    {
+        loc.nnz = col.size();
+        rem.nnz = 0;
+
+        if (loc.nnz) {
+            loc.row = row(0);
+            loc.col = column_index(queue, m, col(0));
+            loc.val = val(0);
+        }
+    }
+
     template <class OP>
     void mul(const matrix_part &part,
             const backend::device_vector<val_t> &in,
@@ -141,22 +111,22 @@ struct SpMatCSR : public sparse_matrix {
     {
         using namespace detail;
 
-        static kernel_cache cache;
+        static kernel_cache cache[column_index::kinds];
 
-        auto kernel = cache.find(queue);
+        auto kernel = cache[part.col.kind].find(queue);
 
         backend::select_context(queue);
 
-        if (kernel == cache.end()) {
+        if (kernel == cache[part.col.kind].end()) {
             backend::source_generator source(queue);
 
             source.kernel("csr_spmv")
                 .open("(")
                     .template parameter<size_t>("n")
                     .template parameter<scalar_type>("scale")
-                    .template parameter< global_ptr< const idx_t > >("row")
-                    .template parameter< global_ptr< const col_t > >("col")
-                    .template parameter< global_ptr< const val_t > >("val")
+                    .template parameter< global_ptr< const idx_t > >("row");
+            part.col.parameter(source, "col");
+            source.template parameter< global_ptr< const val_t > >("val")
                     .template parameter< global_ptr< const val_t > >("in")
                     .template parameter< global_ptr< val_t > >("out")
                 .close(")")
@@ -170,14 +140,14 @@ struct SpMatCSR : public sparse_matrix {
             source.new_line() << "out[i] " << OP::string() << " scale * sum;";
             source.close("}").close("}");
 
-            kernel = cache.insert(queue, backend::kernel(
+            kernel = cache[part.col.kind].insert(queue, backend::kernel(
                         queue, source.str(), "csr_spmv"));
         }
 
         kernel->second.push_arg(n);
         kernel->second.push_arg(scale);
         kernel->second.push_arg(part.row);
-        kernel->second.push_arg(part.col);
+        part.col.push(kernel->second);
         kernel->second.push_arg(part.val);
         kernel->second.push_arg(in);
         kernel->second.push_arg(out);
@@ -185,6 +155,69 @@ struct SpMatCSR : public sparse_matrix {
         kernel->second(queue);
     }
 
+    template <class OP>
+    void mul(const matrix_part &part,
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache_map<size_t> caches[column_index::kinds];
+
+        const size_t N = in.size();
+        kernel_cache &cache = caches[part.col.kind][N];
+
+        auto kernel = cache.find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("csr_spmm")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter< global_ptr< const idx_t > >("row");
+            part.col.parameter(source, "col");
+            source.template parameter< global_ptr< const val_t > >("val");
+            for(size_t k = 0; k < N; ++k)
+                source.template parameter< global_ptr< const val_t > >("in") << k;
+            for(size_t k = 0; k < N; ++k)
+                source.template parameter< global_ptr< val_t > >("out") << k;
+            source.close(")")
+                .open("{")
+                    .grid_stride_loop("i").open("{");
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << type_name<val_t>() << " sum" << k << " = 0;";
+            source.new_line() << "for(size_t j = row[i], e = row[i + 1]; j < e; ++j)";
+            source.open("{");
+            source.new_line() << part.col.type() << " c = col[j];";
+            source.new_line() << type_name<val_t>() << " v = val[j];";
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "sum" << k << " += v * in" << k << "[c];";
+            source.close("}");
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "out" << k << "[i] " << OP::string() << " scale * sum" << k << ";";
+            source.close("}").close("}");
+
+            kernel = cache.insert(queue, backend::kernel(
+                        queue, source.str(), "csr_spmm"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+        kernel->second.push_arg(part.row);
+        part.col.push(kernel->second);
+        kernel->second.push_arg(part.val);
+        for(size_t k = 0; k < N; ++k) kernel->second.push_arg(in[k]);
+        for(size_t k = 0; k < N; ++k) kernel->second.push_arg(out[k]);
+
+        kernel->second(queue);
+    }
+
     void mul_local(
             const backend::device_vector<val_t> &in,
             backend::device_vector<val_t> &out,
@@ -208,13 +241,102 @@ struct SpMatCSR : public sparse_matrix {
         if (rem.nnz) mul<assign::ADD>(rem, in, out, scale);
     }
 
+    void spmm_local(
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale, bool append) const
+    {
+        if (append) {
+            if (loc.nnz) mul<assign::ADD>(loc, in, out, scale);
+        } else {
+            if (loc.nnz)
+                mul<assign::SET>(loc, in, out, scale);
+            else
+                for(size_t k = 0; k < out.size(); ++k)
+                    vector<val_t>(queue, out[k]) = 0;
+        }
+    }
+
+    void spmm_remote(
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale) const
+    {
+        if (rem.nnz) mul<assign::ADD>(rem, in, out, scale);
+    }
+
+    size_t column_bytes() const {
+        return loc.col.bytes() + rem.col.bytes();
+    }
+
+    void triplets(bool remote, col_t /*sentinel*/,
+            vector<col_t> &t_row, vector<col_t> &t_col, vector<val_t> &t_val) const
+    {
+        using namespace detail;
+
+        const matrix_part &part = remote ? rem : loc;
+
+        std::vector<backend::command_queue> q(1, queue);
+        t_row.resize(q, part.nnz);
+        t_col.resize(q, part.nnz);
+        t_val.resize(q, part.nnz);
+
+        if (!part.nnz) return;
+
+        static kernel_cache cache[column_index::kinds];
+
+        auto kernel = cache[part.col.kind].find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache[part.col.kind].end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("csr_triplets")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter< global_ptr<const idx_t> >("row");
+            part.col.parameter(source, "col");
+            source.template parameter< global_ptr<const val_t> >("val")
+                    .template parameter< global_ptr<col_t> >("t_row")
+                    .template parameter< global_ptr<col_t> >("t_col")
+                    .template parameter< global_ptr<val_t> >("t_val")
+                .close(")")
+                .open("{")
+                    .grid_stride_loop("i").open("{");
+            source.new_line() << "for(size_t j = row[i], e = row[i + 1]; j < e; ++j)";
+            source.open("{");
+            source.new_line() << "t_row[j] = i;";
+            source.new_line() << "t_col[j] = col[j];";
+            source.new_line() << "t_val[j] = val[j];";
+            source.close("}");
+            source.close("}").close("}");
+
+            kernel = cache[part.col.kind].insert(queue, backend::kernel(
+                        queue, source.str(), "csr_triplets"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(part.row);
+        part.col.push(kernel->second);
+        kernel->second.push_arg(part.val);
+        kernel->second.push_arg(t_row(0));
+        kernel->second.push_arg(t_col(0));
+        kernel->second.push_arg(t_val(0));
+
+        kernel->second(queue);
+    }
+
     static void inline_preamble(backend::source_generator &src,
             const std::string &prm_name)
     {
+        column_index::inline_reader(src, prm_name + "_col_at");
+
         src.function<val_t>(prm_name + "_csr_spmv")
             .open("(")
                 .template parameter< global_ptr<const idx_t> >("row")
                 .template parameter< global_ptr<const col_t> >("col")
+                .template parameter< int >("col_kind")
                 .template parameter< global_ptr<const val_t> >("val")
                 .template parameter< global_ptr<const val_t> >("in")
                 .template parameter< size_t >("i")
@@ -222,7 +344,7 @@ struct SpMatCSR : public sparse_matrix {
         src.new_line() << type_name<val_t>() << " sum = 0;";
         src.new_line() << "for(size_t j = row[i], e = row[i + 1]; j < e; ++j)";
         src.open("{");
-        src.new_line() << "sum += val[j] * in[col[j]];";
+        src.new_line() << "sum += val[j] * in[" << prm_name << "_col_at(col, col_kind, j)];";
         src.close("}");
         src.new_line() << "return sum;";
         src.close("}");
@@ -234,6 +356,7 @@ struct SpMatCSR : public sparse_matrix {
         src << prm_name << "_csr_spmv" << "("
             << prm_name << "_row, "
             << prm_name << "_col, "
+            << prm_name << "_col_kind, "
             << prm_name << "_val, "
             << prm_name << "_vec, idx)";
     }
@@ -243,13 +366,15 @@ struct SpMatCSR : public sparse_matrix {
     {
         src.template parameter< global_ptr<const idx_t> >(prm_name) << "_row";
         src.template parameter< global_ptr<const col_t> >(prm_name) << "_col";
+        src.template parameter< int >(prm_name) << "_col_kind";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_val";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_vec";
     }
 
     void setArgs(backend::kernel &krn, unsigned device, const vector<val_t> &x) const {
         krn.push_arg(loc.row);
-        krn.push_arg(loc.col);
+        loc.col.push(krn);
+        krn.push_arg(static_cast<int>(loc.col.kind));
         krn.push_arg(loc.val);
         krn.push_arg(x(device));
     }
@@ -38,14 +38,14 @@ struct SpMatHELL : public sparse_matrix {
     struct matrix_part {
         struct {
             size_t     width;
-            backend::device_vector<col_t> col;
+            column_index col;
             backend::device_vector<val_t> val;
         } ell;
 
         struct {
             size_t     nnz;
             backend::device_vector<idx_t> row;
-            backend::device_vector<col_t> col;
+            column_index col;
             backend::device_vector<val_t> val;
         } csr;
     } loc, rem;
@@ -55,7 +55,7 @@ struct SpMatHELL : public sparse_matrix {
             const idx_t *row_begin, const idx_t *row_end,
             const col_t *col, const val_t *val,
             size_t col_begin, size_t col_end,
-            std::set<col_t> ghost_cols
+            const std::vector<col_t> &ghost_cols
             )
         : queue(queue), n(row_end - row_begin), pitch( alignup(n, 16U) )
     {
@@ -63,79 +63,62 @@ struct SpMatHELL : public sparse_matrix {
             return c >= col_begin && c < col_end;
         };
 
-        /* 1. Get optimal ELL widths for local and remote parts. */
-        {
-            // Speed of ELL relative to CSR (e.g. 2.0 -> ELL is twice as fast):
-            const double ell_vs_csr = 3.0;
+        const ptrdiff_t nrows = n;
+
+        /* 1. Get widths of local and remote parts of each row. */
+        std::vector<idx_t> lcsr_row(n + 1, 0);
+        std::vector<idx_t> rcsr_row(n + 1, 0);
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t i = 0; i < nrows; ++i) {
+            idx_t wl = 0, wr = 0;
+            for(idx_t j = row_begin[i]; j < row_begin[i + 1]; ++j) {
+                if (is_local(col[j]))
+                    ++wl;
+                else
+                    ++wr;
+            }
+
+            lcsr_row[i + 1] = wl;
+            rcsr_row[i + 1] = wr;
+        }
 
+        /* 2. Get optimal ELL widths for local and remote parts. */
+        {
             // Find maximum widths for local and remote parts:
             loc.ell.width = rem.ell.width = 0;
-            for(auto row = row_begin; row != row_end; ++row) {
-                size_t wl = 0, wr = 0;
-                for(idx_t j = row[0]; j < row[1]; ++j) {
-                    if (is_local(col[j]))
-                        ++wl;
-                    else
-                        ++wr;
-                }
-
-                loc.ell.width = std::max(loc.ell.width, wl);
-                rem.ell.width = std::max(rem.ell.width, wr);
+            for(size_t i = 0; i < n; ++i) {
+                loc.ell.width = std::max<size_t>(loc.ell.width, lcsr_row[i + 1]);
+                rem.ell.width = std::max<size_t>(rem.ell.width, rcsr_row[i + 1]);
             }
 
             // Build histograms for width distribution.
             std::vector<size_t> loc_hist(loc.ell.width + 1, 0);
             std::vector<size_t> rem_hist(rem.ell.width + 1, 0);
 
-            for(auto row = row_begin; row != row_end; ++row) {
-                size_t wl = 0, wr = 0;
-                for(idx_t j = row[0]; j < row[1]; ++j) {
-                    if (is_local(col[j]))
-                        ++wl;
-                    else
-                        ++wr;
-                }
-
-                ++loc_hist[wl];
-                ++rem_hist[wr];
+            for(size_t i = 0; i < n; ++i) {
+                ++loc_hist[lcsr_row[i + 1]];
+                ++rem_hist[rcsr_row[i + 1]];
             }
 
-            auto optimal_width = [&](size_t max_width, const std::vector<size_t> &hist) -> size_t {
-                for(size_t i = 0, rows = n; i < max_width; ++i) {
-                    rows -= hist[i]; // Number of rows wider than i.
-                    if (ell_vs_csr * rows < n) return i;
-                }
-
-                return max_width;
-            };
-
-            loc.ell.width = optimal_width(loc.ell.width, loc_hist);
-            rem.ell.width = optimal_width(rem.ell.width, rem_hist);
+            loc.ell.width = optimal_width(n, loc.ell.width, loc_hist);
+            rem.ell.width = optimal_width(n, rem.ell.width, rem_hist);
         }
 
-        /* 2. Count nonzeros in CSR parts of the matrix. */
-        loc.csr.nnz = 0, rem.csr.nnz = 0;
-
-        for(auto row = row_begin; row != row_end; ++row) {
-            size_t wl = 0, wr = 0;
-            for(idx_t j = row[0]; j < row[1]; ++j) {
-                if (is_local(col[j]))
-                    ++wl;
-                else
-                    ++wr;
-            }
+        /* 3. Get row pointers of CSR parts of the matrix. */
+        for(size_t i = 0; i < n; ++i) {
+            size_t wl = lcsr_row[i + 1], wr = rcsr_row[i + 1];
 
-            if (wl > loc.ell.width) loc.csr.nnz += wl - loc.ell.width;
-            if (wr > rem.ell.width) rem.csr.nnz += wr - rem.ell.width;
+            lcsr_row[i + 1] = lcsr_row[i] + static_cast<idx_t>(wl > loc.ell.width ? wl - loc.ell.width : 0);
+            rcsr_row[i + 1] = rcsr_row[i] + static_cast<idx_t>(wr > rem.ell.width ? wr - rem.ell.width : 0);
         }
 
-        /* 3. Renumber columns. */
-        std::unordered_map<col_t,col_t> r2l(2 * ghost_cols.size());
-        size_t nghost = 0;
-        for(auto c = ghost_cols.begin(); c != ghost_cols.end(); c++)
-            r2l[*c] = static_cast<col_t>(nghost++);
+        loc.csr.nnz = lcsr_row.back();
+        rem.csr.nnz = rcsr_row.back();
 
-        // Prepare ELL and COO formats for transfer to devices.
+        /* 4. Fill ELL and CSR parts, renumbering the columns. */
         const col_t not_a_column = static_cast<col_t>(-1);
 
         std::vector<col_t> lell_col(pitch * loc.ell.width, not_a_column);
@@ -143,79 +126,216 @@ struct SpMatHELL : public sparse_matrix {
         std::vector<col_t> rell_col(pitch * rem.ell.width, not_a_column);
         std::vector<val_t> rell_val(pitch * rem.ell.width, val_t());
 
-        std::vector<idx_t> lcsr_row;
-        std::vector<col_t> lcsr_col;
-        std::vector<val_t> lcsr_val;
-
-        std::vector<idx_t> rcsr_row;
-        std::vector<col_t> rcsr_col;
-        std::vector<val_t> rcsr_val;
-
-        lcsr_row.reserve(n + 1);
-        lcsr_col.reserve(loc.csr.nnz);
-        lcsr_val.reserve(loc.csr.nnz);
-
-        rcsr_row.reserve(n + 1);
-        rcsr_col.reserve(rem.csr.nnz);
-        rcsr_val.reserve(rem.csr.nnz);
+        std::vector<col_t> lcsr_col(loc.csr.nnz);
+        std::vector<val_t> lcsr_val(loc.csr.nnz);
+        std::vector<col_t> rcsr_col(rem.csr.nnz);
+        std::vector<val_t> rcsr_val(rem.csr.nnz);
 
-        lcsr_row.push_back(0);
-        rcsr_row.push_back(0);
-
-        size_t k = 0;
-        for(auto row = row_begin; row != row_end; ++row, ++k) {
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t k = 0; k < nrows; ++k) {
             size_t lcnt = 0, rcnt = 0;
-            for(idx_t j = row[0]; j < row[1]; ++j) {
+            idx_t  lpos = lcsr_row[k], rpos = rcsr_row[k];
+
+            for(idx_t j = row_begin[k]; j < row_begin[k + 1]; ++j) {
                 if (is_local(col[j])) {
+                    col_t c = static_cast<col_t>(col[j] - col_begin);
                     if (lcnt < loc.ell.width) {
-                        lell_col[k + pitch * lcnt] = static_cast<col_t>(col[j] - col_begin);
+                        lell_col[k + pitch * lcnt] = c;
                         lell_val[k + pitch * lcnt] = val[j];
                         ++lcnt;
                     } else {
-                        lcsr_col.push_back(static_cast<col_t>(col[j] - col_begin));
-                        lcsr_val.push_back(val[j]);
+                        lcsr_col[lpos] = c;
+                        lcsr_val[lpos] = val[j];
+                        ++lpos;
                     }
                 } else {
-                    assert(r2l.count(col[j]));
+                    col_t c = ghost_index(ghost_cols, col[j]);
                     if (rcnt < rem.ell.width) {
-                        rell_col[k + pitch * rcnt] = r2l[col[j]];
+                        rell_col[k + pitch * rcnt] = c;
                         rell_val[k + pitch * rcnt] = val[j];
                         ++rcnt;
                     } else {
-                        rcsr_col.push_back(r2l[col[j]]);
-                        rcsr_val.push_back(val[j]);
+                        rcsr_col[rpos] = c;
+                        rcsr_val[rpos] = val[j];
+                        ++rpos;
                     }
                 }
             }
-
-            lcsr_row.push_back(static_cast<idx_t>(lcsr_col.size()));
-            rcsr_row.push_back(static_cast<idx_t>(rcsr_col.size()));
         }
 
         /* Copy data to device */
         if (loc.ell.width) {
-            loc.ell.col = backend::device_vector<col_t>(queue, lell_col.size(), lell_col.data());
+            loc.ell.col = column_index(queue, col_end - col_begin, lell_col.size(), lell_col.data());
             loc.ell.val = backend::device_vector<val_t>(queue, lell_val.size(), lell_val.data());
         }
 
         if (loc.csr.nnz) {
             loc.csr.row = backend::device_vector<idx_t>(queue, lcsr_row.size(), lcsr_row.data());
-            loc.csr.col = backend::device_vector<col_t>(queue, lcsr_col.size(), lcsr_col.data());
+            loc.csr.col = column_index(queue, col_end - col_begin, lcsr_col.size(), lcsr_col.data());
             loc.csr.val = backend::device_vector<val_t>(queue, lcsr_val.size(), lcsr_val.data());
         }
 
         if (rem.ell.width) {
-            rem.ell.col = backend::device_vector<col_t>(queue, rell_col.size(), rell_col.data());
+            rem.ell.col = column_index(queue, ghost_cols.size(), rell_col.size(), rell_col.data());
             rem.ell.val = backend::device_vector<val_t>(queue, rell_val.size(), rell_val.data());
         }
 
         if (rem.csr.nnz) {
             rem.csr.row = backend::device_vector<idx_t>(queue, rcsr_row.size(), rcsr_row.data());
-            rem.csr.col = backend::device_vector<col_t>(queue, rcsr_col.size(), rcsr_col.data());
+            rem.csr.col = column_index(queue, ghost_cols.size(), rcsr_col.size(), rcsr_col.data());
             rem.csr.val = backend::device_vector<val_t>(queue, rcsr_val.size(), rcsr_val.data());
         }
     }
 
+    // Builds single-device matrix with m columns from CSR arrays located on
+    // the device.
+    SpMatHELL(
+            const backend::command_queue &queue, size_t n, size_t m,
+            const vector<idx_t> &row, const vector<col_t> &col, const vector<val_t> &val
+            )
+        : queue(queue), n(n), pitch( alignup(n, 16U) )
+    {
+        using namespace detail;
+
+        std::vector<backend::command_queue> q(1, queue);
+
+        rem.ell.width = 0;
+        rem.csr.nnz   = 0;
+
+        /* 1. Get optimal ELL width from the distribution of row widths. */
+        slicer<1> slice(extents[n + 1]);
+
+        vector<idx_t> w(q, n);
+        w = slice[range(1, n + 1)](row) - slice[range(0, n)](row);
+
+        Reductor<idx_t, MAX> max_width(q);
+        size_t max_w = max_width(w);
+
+        loc.ell.width = optimal_width(n, max_w, bincount(w, max_w + 1));
+
+        /* 2. Get row pointers of CSR part of the matrix. */
+        vector<idx_t> csr_nnz(q, n + 1);
+        vector<idx_t> csr_row(q, n + 1);
+        {
+            idx_t ell_w = static_cast<idx_t>(loc.ell.width);
+            slice[range(0, n)](csr_nnz) = if_else(w > ell_w, w - ell_w, 0);
+            csr_nnz[n] = 0;
+        }
+        exclusive_scan(csr_nnz, csr_row);
+        loc.csr.nnz = csr_row[n];
+
+        /* 3. Fill ELL and CSR parts. Column numbers are narrowed afterwards. */
+        backend::device_vector<col_t> ell_col, csr_col;
+
+        if (loc.ell.width) {
+            ell_col     = backend::device_vector<col_t>(queue, pitch * loc.ell.width);
+            loc.ell.val = backend::device_vector<val_t>(queue, pitch * loc.ell.width);
+
+            vector<col_t>(queue, ell_col) = static_cast<col_t>(-1);
+            vector<val_t>(queue, loc.ell.val) = val_t();
+        }
+
+        if (loc.csr.nnz) {
+            loc.csr.row = csr_row(0);
+            csr_col     = backend::device_vector<col_t>(queue, loc.csr.nnz);
+            loc.csr.val = backend::device_vector<val_t>(queue, loc.csr.nnz);
+        }
+
+        static kernel_cache cache;
+
+        auto kernel = cache.find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("hybrid_ell_from_csr")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<size_t>("ell_w")
+                    .template parameter<size_t>("ell_pitch")
+                    .template parameter< global_ptr<const idx_t> >("row")
+                    .template parameter< global_ptr<const col_t> >("col")
+                    .template parameter< global_ptr<const val_t> >("val")
+                    .template parameter< global_ptr<col_t> >("ell_col")
+                    .template parameter< global_ptr<val_t> >("ell_val")
+                    .template parameter< global_ptr<const idx_t> >("csr_row")
+                    .template parameter< global_ptr<col_t> >("csr_col")
+                    .template parameter< global_ptr<val_t> >("csr_val")
+                .close(")")
+                .open("{")
+                    .grid_stride_loop("i").open("{");
+
+            source.new_line() << "for(size_t j = row[i], e = row[i + 1], k = 0; j < e; ++j, ++k)";
+            source.open("{");
+            source.new_line() << "if (k < ell_w)";
+            source.open("{");
+            source.new_line() << "ell_col[i + k * ell_pitch] = col[j];";
+            source.new_line() << "ell_val[i + k * ell_pitch] = val[j];";
+            source.close("}");
+            source.new_line() << "else";
+            source.open("{");
+            source.new_line() << "size_t p = csr_row[i] + k - ell_w;";
+            source.new_line() << "csr_col[p] = col[j];";
+            source.new_line() << "csr_val[p] = val[j];";
+            source.close("}");
+            source.close("}");
+            source.close("}").close("}");
+
+            kernel = cache.insert(queue, backend::kernel(
+                        queue, source.str(), "hybrid_ell_from_csr"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(loc.ell.width);
+        kernel->second.push_arg(pitch);
+        kernel->second.push_arg(row(0));
+        kernel->second.push_arg(col(0));
+        kernel->second.push_arg(val(0));
+
+        if (loc.ell.width) {
+            kernel->second.push_arg(ell_col);
+            kernel->second.push_arg(loc.ell.val);
+        } else {
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+        }
+
+        kernel->second.push_arg(csr_row(0));
+
+        if (loc.csr.nnz) {
+            kernel->second.push_arg(csr_col);
+            kernel->second.push_arg(loc.csr.val);
+        } else {
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+        }
+
+        kernel->second(queue);
+
+        if (loc.ell.width) loc.ell.col = column_index(queue, m, ell_col);
+        if (loc.csr.nnz)   loc.csr.col = column_index(queue, m, csr_col);
+    }
+
+    // Number of columns to keep in ELL format, given the histogram of row
+    // widths.
+    static size_t optimal_width(size_t n, size_t max_width,
+            const std::vector<size_t> &hist)
+    {
+        // Speed of ELL relative to CSR (e.g. 2.0 -> ELL is twice as fast):
+        const double ell_vs_csr = 3.0;
+
+        for(size_t i = 0, rows = n; i < max_width; ++i) {
+            rows -= hist[i]; // Number of rows wider than i.
+            if (ell_vs_csr * rows < n) return i;
+        }
+
+        return max_width;
+    }
+
     template <class OP>
     void mul(
             const matrix_part &part,
@@ -226,7 +346,8 @@ struct SpMatHELL : public sparse_matrix {
     {
         using namespace detail;
 
-        static kernel_cache cache;
+        static kernel_cache caches[column_index::kinds][column_index::kinds];
+        kernel_cache &cache = caches[part.ell.col.kind][part.csr.col.kind];
 
         auto kernel = cache.find(queue);
 
@@ -240,12 +361,12 @@ struct SpMatHELL : public sparse_matrix {
                     .template parameter<size_t>("n")
                     .template parameter<scalar_type>("scale")
                     .template parameter<size_t>("ell_w")
-                    .template parameter<size_t>("ell_pitch")
-                    .template parameter< global_ptr<const col_t> >("ell_col")
-                    .template parameter< global_ptr<const val_t> >("ell_val")
-                    .template parameter< global_ptr<const idx_t> >("csr_row")
-                    .template parameter< global_ptr<const col_t> >("csr_col")
-                    .template parameter< global_ptr<const val_t> >("csr_val")
+                    .template parameter<size_t>("ell_pitch");
+            part.ell.col.parameter(source, "ell_col");
+            source.template parameter< global_ptr<const val_t> >("ell_val")
+                    .template parameter< global_ptr<const idx_t> >("csr_row");
+            part.csr.col.parameter(source, "csr_col");
+            source.template parameter< global_ptr<const val_t> >("csr_val")
                     .template parameter< global_ptr<const val_t> >("in")
                     .template parameter< global_ptr<val_t> >("out")
                 .close(")")
@@ -255,8 +376,8 @@ struct SpMatHELL : public sparse_matrix {
             source.new_line() << type_name<val_t>() << " sum = 0;";
             source.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
             source.open("{");
-            source.new_line() << type_name<col_t>() << " c = ell_col[i + j * ell_pitch];";
-            source.new_line() << "if (c != ("<< type_name<col_t>() << ")(-1))";
+            source.new_line() << part.ell.col.type() << " c = ell_col[i + j * ell_pitch];";
+            source.new_line() << "if (c != ("<< part.ell.col.type() << ")(-1))";
             source.open("{").new_line() << "sum += ell_val[i + j * ell_pitch] * in[c];";
             source.close("}").close("}");
             source.new_line() << "if (csr_row)";
@@ -278,7 +399,7 @@ struct SpMatHELL : public sparse_matrix {
         kernel->second.push_arg(pitch);
 
         if (part.ell.width) {
-            kernel->second.push_arg(part.ell.col);
+            part.ell.col.push(kernel->second);
             kernel->second.push_arg(part.ell.val);
         } else {
             kernel->second.push_arg(static_cast<size_t>(0));
@@ -287,7 +408,7 @@ struct SpMatHELL : public sparse_matrix {
 
         if (part.csr.nnz) {
             kernel->second.push_arg(part.csr.row);
-            kernel->second.push_arg(part.csr.col);
+            part.csr.col.push(kernel->second);
             kernel->second.push_arg(part.csr.val);
         } else {
             kernel->second.push_arg(static_cast<size_t>(0));
@@ -300,6 +421,104 @@ struct SpMatHELL : public sparse_matrix {
         kernel->second(queue);
     }
 
+    template <class OP>
+    void mul(
+            const matrix_part &part,
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache_map<size_t> caches[column_index::kinds][column_index::kinds];
+
+        const size_t N = in.size();
+        kernel_cache &cache = caches[part.ell.col.kind][part.csr.col.kind][N];
+
+        auto kernel = cache.find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("hybrid_ell_spmm")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter<size_t>("ell_w")
+                    .template parameter<size_t>("ell_pitch");
+            part.ell.col.parameter(source, "ell_col");
+            source.template parameter< global_ptr<const val_t> >("ell_val")
+                    .template parameter< global_ptr<const idx_t> >("csr_row");
+            part.csr.col.parameter(source, "csr_col");
+            source.template parameter< global_ptr<const val_t> >("csr_val");
+            for(size_t k = 0; k < N; ++k)
+                source.template parameter< global_ptr<const val_t> >("in") << k;
+            for(size_t k = 0; k < N; ++k)
+                source.template parameter< global_ptr<val_t> >("out") << k;
+            source.close(")")
+                .open("{")
+                    .grid_stride_loop("i").open("{");
+
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << type_name<val_t>() << " sum" << k << " = 0;";
+            source.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
+            source.open("{");
+            source.new_line() << part.ell.col.type() << " c = ell_col[i + j * ell_pitch];";
+            source.new_line() << "if (c != ("<< part.ell.col.type() << ")(-1))";
+            source.open("{");
+            source.new_line() << type_name<val_t>() << " v = ell_val[i + j * ell_pitch];";
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "sum" << k << " += v * in" << k << "[c];";
+            source.close("}").close("}");
+            source.new_line() << "if (csr_row)";
+            source.open("{");
+            source.new_line() << "for(size_t j = csr_row[i], e = csr_row[i + 1]; j < e; ++j)";
+            source.open("{");
+            source.new_line() << part.csr.col.type() << " c = csr_col[j];";
+            source.new_line() << type_name<val_t>() << " v = csr_val[j];";
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "sum" << k << " += v * in" << k << "[c];";
+            source.close("}").close("}");
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "out" << k << "[i] " << OP::string() << " scale * sum" << k << ";";
+            source.close("}").close("}");
+
+            kernel = cache.insert(queue, backend::kernel(
+                        queue, source.str(), "hybrid_ell_spmm"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+        kernel->second.push_arg(part.ell.width);
+        kernel->second.push_arg(pitch);
+
+        if (part.ell.width) {
+            part.ell.col.push(kernel->second);
+            kernel->second.push_arg(part.ell.val);
+        } else {
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+        }
+
+        if (part.csr.nnz) {
+            kernel->second.push_arg(part.csr.row);
+            part.csr.col.push(kernel->second);
+            kernel->second.push_arg(part.csr.val);
+        } else {
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+        }
+
+        for(size_t k = 0; k < N; ++k) kernel->second.push_arg(in[k]);
+        for(size_t k = 0; k < N; ++k) kernel->second.push_arg(out[k]);
+
+        kernel->second(queue);
+    }
+
     void mul_local(
             const backend::device_vector<val_t> &in,
             backend::device_vector<val_t> &out,
@@ -319,17 +538,147 @@ struct SpMatHELL : public sparse_matrix {
         mul<assign::ADD>(rem, in, out, scale);
     }
 
+    void spmm_local(
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale, bool append) const
+    {
+        if (append)
+            mul<assign::ADD>(loc, in, out, scale);
+        else
+            mul<assign::SET>(loc, in, out, scale);
+    }
+
+    void spmm_remote(
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale) const
+    {
+        mul<assign::ADD>(rem, in, out, scale);
+    }
+
+    size_t column_bytes() const {
+        return loc.ell.col.bytes() + loc.csr.col.bytes()
+             + rem.ell.col.bytes() + rem.csr.col.bytes();
+    }
+
+    void triplets(bool remote, col_t sentinel,
+            vector<col_t> &t_row, vector<col_t> &t_col, vector<val_t> &t_val) const
+    {
+        using namespace detail;
+
+        const matrix_part &part = remote ? rem : loc;
+
+        // ELL elements come first, followed by the CSR tail.
+        const size_t ell_size = pitch * part.ell.width;
+        const size_t size     = ell_size + part.csr.nnz;
+
+        std::vector<backend::command_queue> q(1, queue);
+        t_row.resize(q, size);
+        t_col.resize(q, size);
+        t_val.resize(q, size);
+
+        if (!size) return;
+
+        // Padding is never written by the kernel below.
+        t_col = sentinel;
+
+        static kernel_cache caches[column_index::kinds][column_index::kinds];
+        kernel_cache &cache = caches[part.ell.col.kind][part.csr.col.kind];
+
+        auto kernel = cache.find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("hybrid_ell_triplets")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<size_t>("ell_w")
+                    .template parameter<size_t>("ell_pitch");
+            part.ell.col.parameter(source, "ell_col");
+            source.template parameter< global_ptr<const val_t> >("ell_val")
+                    .template parameter< global_ptr<const idx_t> >("csr_row");
+            part.csr.col.parameter(source, "csr_col");
+            source.template parameter< global_ptr<const val_t> >("csr_val")
+                    .template parameter< global_ptr<col_t> >("t_row")
+                    .template parameter< global_ptr<col_t> >("t_col")
+                    .template parameter< global_ptr<val_t> >("t_val")
+                .close(")")
+                .open("{")
+                    .grid_stride_loop("i").open("{");
+
+            source.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
+            source.open("{");
+            source.new_line() << "size_t k = i + j * ell_pitch;";
+            source.new_line() << part.ell.col.type() << " c = ell_col[k];";
+            source.new_line() << "if (c != ("<< part.ell.col.type() << ")(-1))";
+            source.open("{");
+            source.new_line() << "t_row[k] = i;";
+            source.new_line() << "t_col[k] = c;";
+            source.new_line() << "t_val[k] = ell_val[k];";
+            source.close("}").close("}");
+            source.new_line() << "if (csr_row)";
+            source.open("{");
+            source.new_line() << "for(size_t j = csr_row[i], e = csr_row[i + 1]; j < e; ++j)";
+            source.open("{");
+            source.new_line() << "size_t k = ell_w * ell_pitch + j;";
+            source.new_line() << "t_row[k] = i;";
+            source.new_line() << "t_col[k] = csr_col[j];";
+            source.new_line() << "t_val[k] = csr_val[j];";
+            source.close("}").close("}");
+            source.close("}").close("}");
+
+            kernel = cache.insert(queue, backend::kernel(
+                        queue, source.str(), "hybrid_ell_triplets"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(part.ell.width);
+        kernel->second.push_arg(pitch);
+
+        if (part.ell.width) {
+            part.ell.col.push(kernel->second);
+            kernel->second.push_arg(part.ell.val);
+        } else {
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+        }
+
+        if (part.csr.nnz) {
+            kernel->second.push_arg(part.csr.row);
+            part.csr.col.push(kernel->second);
+            kernel->second.push_arg(part.csr.val);
+        } else {
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+            kernel->second.push_arg(static_cast<size_t>(0));
+        }
+
+        kernel->second.push_arg(t_row(0));
+        kernel->second.push_arg(t_col(0));
+        kernel->second.push_arg(t_val(0));
+
+        kernel->second(queue);
+    }
+
     static void inline_preamble(backend::source_generator &src,
         const std::string &prm_name)
     {
+        column_index::inline_reader(src, prm_name + "_hell_col_at");
+
         src.function<val_t>(prm_name + "_hell_spmv")
             .open("(")
                 .template parameter<size_t>("ell_w")
                 .template parameter<size_t>("ell_pitch")
                 .template parameter< global_ptr<const col_t> >("ell_col")
+                .template parameter< int >("ell_col_kind")
                 .template parameter< global_ptr<const val_t> >("ell_val")
                 .template parameter< global_ptr<const idx_t> >("csr_row")
                 .template parameter< global_ptr<const col_t> >("csr_col")
+                .template parameter< int >("csr_col_kind")
                 .template parameter< global_ptr<const val_t> >("csr_val")
                 .template parameter< global_ptr<const val_t> >("in")
                 .template parameter< size_t >("i")
@@ -337,14 +686,16 @@ struct SpMatHELL : public sparse_matrix {
         src.new_line() << type_name<val_t>() << " sum = 0;";
         src.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
         src.open("{");
-        src.new_line() << type_name<col_t>() << " c = ell_col[i + j * ell_pitch];";
+        src.new_line() << type_name<col_t>() << " c = " << prm_name
+            << "_hell_col_at(ell_col, ell_col_kind, i + j * ell_pitch);";
         src.new_line() << "if (c != ("<< type_name<col_t>() << ")(-1))";
         src.open("{").new_line() << "sum += ell_val[i + j * ell_pitch] * in[c];";
         src.close("}").close("}");
         src.new_line() << "if (csr_row)";
         src.open("{");
         src.new_line() << "for(size_t j = csr_row[i], e = csr_row[i + 1]; j < e; ++j)";
-        src.open("{").new_line() << "sum += csr_val[j] * in[csr_col[j]];";
+        src.open("{").new_line() << "sum += csr_val[j] * in["
+            << prm_name << "_hell_col_at(csr_col, csr_col_kind, j)];";
         src.close("}").close("}");
         src.new_line() << "return sum;";
         src.close("}");
@@ -357,9 +708,11 @@ struct SpMatHELL : public sparse_matrix {
             << prm_name << "_ell_w, "
             << prm_name << "_ell_pitch, "
             << prm_name << "_ell_col, "
+            << prm_name << "_ell_col_kind, "
             << prm_name << "_ell_val, "
             << prm_name << "_csr_row, "
             << prm_name << "_csr_col, "
+            << prm_name << "_csr_col_kind, "
             << prm_name << "_csr_val, "
             << prm_name << "_vec, idx)";
     }
@@ -370,9 +723,11 @@ struct SpMatHELL : public sparse_matrix {
         src.template parameter<size_t>(prm_name) << "_ell_w";
         src.template parameter<size_t>(prm_name) << "_ell_pitch";
         src.template parameter< global_ptr<const col_t> >(prm_name) << "_ell_col";
+        src.template parameter< int >(prm_name) << "_ell_col_kind";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_ell_val";
         src.template parameter< global_ptr<const idx_t> >(prm_name) << "_csr_row";
         src.template parameter< global_ptr<const col_t> >(prm_name) << "_csr_col";
+        src.template parameter< int >(prm_name) << "_csr_col_kind";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_csr_val";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_vec";
     }
@@ -381,19 +736,23 @@ struct SpMatHELL : public sparse_matrix {
         krn.push_arg(loc.ell.width);
         krn.push_arg(pitch);
         if (loc.ell.width) {
-            krn.push_arg(loc.ell.col);
+            loc.ell.col.push(krn);
+            krn.push_arg(static_cast<int>(loc.ell.col.kind));
             krn.push_arg(loc.ell.val);
         } else {
             krn.push_arg(static_cast<size_t>(0));
+            krn.push_arg(static_cast<int>(loc.ell.col.kind));
             krn.push_arg(static_cast<size_t>(0));
         }
         if (loc.csr.nnz) {
             krn.push_arg(loc.csr.row);
-            krn.push_arg(loc.csr.col);
+            loc.csr.col.push(krn);
+            krn.push_arg(static_cast<int>(loc.csr.col.kind));
             krn.push_arg(loc.csr.val);
         } else {
             krn.push_arg(static_cast<size_t>(0));
             krn.push_arg(static_cast<size_t>(0));
+            krn.push_arg(static_cast<int>(loc.csr.col.kind));
             krn.push_arg(static_cast<size_t>(0));
         }
         krn.push_arg(x(device));
@@ -64,12 +64,12 @@ struct inline_spmv : inline_spmv_terminal_expression {
  eps = sum( fabs(f - vex::make_inline(A * x)) );
  \endcode
  */
-template <typename val_t, typename col_t, typename idx_t>
-inline_spmv< SpMat<val_t, col_t, idx_t>, vector<val_t> >
-make_inline(const additive_operator< SpMat<val_t, col_t, idx_t>, vector<val_t> > &base) {
+template <typename val_t, typename col_t, typename idx_t, class F>
+inline_spmv< SpMat<val_t, col_t, idx_t, F>, vector<val_t> >
+make_inline(const additive_operator< SpMat<val_t, col_t, idx_t, F>, vector<val_t> > &base) {
     precondition(base.x.nparts() == 1, "Can not inline multi-device SpMV operation.");
 
-    return inline_spmv< SpMat<val_t, col_t, idx_t>, vector<val_t> >(base.A, base.x);
+    return inline_spmv< SpMat<val_t, col_t, idx_t, F>, vector<val_t> >(base.A, base.x);
 }
 
 #ifdef VEXCL_MULTIVECTOR_HPP
@@ -102,12 +102,12 @@ struct mv_inline_spmv : mv_inline_spmv_terminal_expression {
  eps = sum( fabs(f - vex::make_inline(A * x)) );
  \endcode
  */
-template <typename val_t, typename col_t, typename idx_t, class V>
-mv_inline_spmv<SpMat<val_t, col_t, idx_t>, V>
-make_inline(const multiadditive_operator<SpMat<val_t, col_t, idx_t>, V> &base) {
+template <typename val_t, typename col_t, typename idx_t, class F, class V>
+mv_inline_spmv<SpMat<val_t, col_t, idx_t, F>, V>
+make_inline(const multiadditive_operator<SpMat<val_t, col_t, idx_t, F>, V> &base) {
     precondition(base.x(0).nparts() == 1, "Can not inline multi-device SpMV operation.");
 
-    return mv_inline_spmv<SpMat<val_t, col_t, idx_t>, V>(base.A, base.x);
+    return mv_inline_spmv<SpMat<val_t, col_t, idx_t, F>, V>(base.A, base.x);
 }
 #endif
 
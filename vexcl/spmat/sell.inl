@@ -0,0 +1,536 @@
+#ifndef VEXCL_SPMAT_SELL_INL
+#define VEXCL_SPMAT_SELL_INL
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/sell.inl
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Sparse matrix in sliced ELLPACK format (SELL-C-sigma).
+ *
+ * Rows are sorted by length inside windows of sigma rows, and the sorted rows
+ * are split into slices of C rows. Each slice is stored in column-major ELL
+ * format padded to the width of its longest row only. Unless fixed by the
+ * format policy, C is chosen to match the SIMD width of a CPU or the warp
+ * (wavefront) width of a GPU, so that the work-items processing a slice
+ * access memory in a coalesced way.
+ */
+
+struct SpMatSELL : public sparse_matrix {
+    const backend::command_queue &queue;
+    size_t n, C;
+
+    // Number of slices in a sorting window.
+    static const size_t sort_window = 16;
+
+    struct matrix_part {
+        size_t nnz; // Number of stored elements, including the padding.
+        backend::device_vector<idx_t> ptr; // Start of each slice.
+        backend::device_vector<idx_t> row; // Matrix row at each sorted position.
+        backend::device_vector<idx_t> pos; // Sorted position of each matrix row.
+        column_index col;
+        backend::device_vector<val_t> val;
+    } loc, rem;
+
+#if !defined(VEXCL_BACKEND_CUDA)
+    // A CPU slice holds two SIMD registers worth of values.
+    static size_t cpu_slice_height(const backend::command_queue &q) {
+#if defined(VEXCL_BACKEND_COMPUTE)
+        cl_uint w = q.get_device().get_info<cl_uint>(CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT);
+#else
+        cl_uint w = q.getInfo<CL_QUEUE_DEVICE>().getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT>();
+#endif
+        return 2 * w * sizeof(cl_float) / sizeof(val_t);
+    }
+
+    // A GPU slice is processed by a single warp or wavefront. Its width is
+    // only known to the OpenCL runtime through a compiled kernel.
+    static size_t gpu_slice_height(const backend::command_queue &q) {
+        using namespace detail;
+
+        static kernel_cache cache;
+
+        auto kernel = cache.find(q);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(q);
+
+            source.kernel("sell_probe")
+                .open("(")
+                    .template parameter< global_ptr<int> >("x")
+                .close(")")
+                .open("{");
+            source.new_line() << "x[0] = 0;";
+            source.close("}");
+
+            kernel = cache.insert(q, backend::kernel(q, source.str(), "sell_probe"));
+        }
+
+        return kernel->second.preferred_work_group_size_multiple(q);
+    }
+#endif
+
+    static size_t slice_height(const backend::command_queue &q) {
+#if defined(VEXCL_BACKEND_CUDA)
+        return q.device().warp_size();
+#else
+        size_t c = backend::is_cpu(q) ? cpu_slice_height(q) : gpu_slice_height(q);
+
+        // Common SIMD and warp widths, when the device does not tell.
+        if (!c) c = backend::is_cpu(q) ? 8 : 32;
+
+        return c;
+#endif
+    }
+
+    // When fixed_C is zero, the slice height is chosen for the device.
+    SpMatSELL(
+            const backend::command_queue &queue,
+            const idx_t *row_begin, const idx_t *row_end,
+            const col_t *col, const val_t *val,
+            size_t col_begin, size_t col_end,
+            const std::vector<col_t> &ghost_cols,
+            size_t fixed_C = 0
+            )
+        : queue(queue), n(row_end - row_begin),
+          C(fixed_C ? fixed_C : slice_height(queue))
+    {
+        const col_t not_a_column = static_cast<col_t>(-1);
+
+        auto is_local = [col_begin, col_end](size_t c) {
+            return c >= col_begin && c < col_end;
+        };
+
+        setup(loc, col_end - col_begin, row_begin, col, val, [&](col_t c) -> col_t {
+                return is_local(c) ? static_cast<col_t>(c - col_begin) : not_a_column;
+                });
+
+        rem.nnz = 0;
+        if (ghost_cols.empty()) return;
+
+        setup(rem, ghost_cols.size(), row_begin, col, val, [&](col_t c) -> col_t {
+                return is_local(c) ? not_a_column : ghost_index(ghost_cols, c);
+                });
+    }
+
+    // Builds SELL-C-sigma representation of the columns accepted by colmap.
+    // The part has ncols columns.
+    template <class ColMap>
+    void setup(matrix_part &part, size_t ncols, const idx_t *row_begin,
+            const col_t *col, const val_t *val, ColMap colmap)
+    {
+        const col_t not_a_column = static_cast<col_t>(-1);
+        const ptrdiff_t nrows = n;
+
+        std::vector<size_t> width(n, 0);
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t i = 0; i < nrows; ++i)
+            for(idx_t j = row_begin[i]; j < row_begin[i + 1]; ++j)
+                if (colmap(col[j]) != not_a_column) ++width[i];
+
+        // Sort rows by width inside each window. Windows consist of whole
+        // slices, so the first row of a slice is also the widest one.
+        std::vector<idx_t> row(n);
+        for(size_t i = 0; i < n; ++i) row[i] = static_cast<idx_t>(i);
+
+        const size_t    sigma = C * sort_window;
+        const ptrdiff_t nwin  = (n + sigma - 1) / sigma;
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t w = 0; w < nwin; ++w)
+            std::stable_sort(row.begin() + w * sigma, row.begin() + std::min(n, (w + 1) * sigma),
+                    [&width](idx_t a, idx_t b) { return width[a] > width[b]; });
+
+        std::vector<idx_t> pos(n);
+        for(size_t i = 0; i < n; ++i) pos[row[i]] = static_cast<idx_t>(i);
+
+        const size_t nslices = (n + C - 1) / C;
+
+        std::vector<idx_t> ptr(nslices + 1);
+        ptr[0] = 0;
+        for(size_t s = 0; s < nslices; ++s)
+            ptr[s + 1] = static_cast<idx_t>(ptr[s] + C * width[row[s * C]]);
+
+        part.nnz = ptr.back();
+
+        std::vector<col_t> scol(part.nnz, not_a_column);
+        std::vector<val_t> sval(part.nnz, val_t());
+
+#ifdef _OPENMP
+#  pragma omp parallel for
+#endif
+        for(ptrdiff_t i = 0; i < nrows; ++i) {
+            size_t k = ptr[i / C] + i % C;
+            for(idx_t j = row_begin[row[i]]; j < row_begin[row[i] + 1]; ++j) {
+                col_t c = colmap(col[j]);
+                if (c == not_a_column) continue;
+
+                scol[k] = c;
+                sval[k] = val[j];
+                k += C;
+            }
+        }
+
+        /* Copy data to device */
+        part.ptr = backend::device_vector<idx_t>(queue, ptr.size(), ptr.data());
+        part.row = backend::device_vector<idx_t>(queue, row.size(), row.data());
+        part.pos = backend::device_vector<idx_t>(queue, pos.size(), pos.data());
+
+        if (part.nnz) {
+            part.col = column_index(queue, ncols, scol.size(), scol.data());
+            part.val = backend::device_vector<val_t>(queue, sval.size(), sval.data());
+        }
+    }
+
+    // Sums up the row at sorted position p. Column numbers have type ctype
+    // and are read with the cread expression.
+    static void slice_loop(backend::source_generator &src,
+            const std::string &ctype, const std::string &cread)
+    {
+        src.new_line() << type_name<val_t>() << " sum = 0;";
+        src.new_line() << "for(size_t j = ptr[p / C] + p % C, e = ptr[p / C + 1]; j < e; j += C)";
+        src.open("{");
+        src.new_line() << ctype << " c = " << cread << ";";
+        src.new_line() << "if (c != ("<< ctype << ")(-1))";
+        src.open("{").new_line() << "sum += val[j] * in[c];";
+        src.close("}").close("}");
+    }
+
+    template <class OP>
+    void mul(
+            const matrix_part &part,
+            const backend::device_vector<val_t> &in,
+            backend::device_vector<val_t> &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache cache[column_index::kinds];
+
+        auto kernel = cache[part.col.kind].find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache[part.col.kind].end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("sell_spmv")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter<size_t>("C")
+                    .template parameter< global_ptr<const idx_t> >("ptr")
+                    .template parameter< global_ptr<const idx_t> >("row");
+            part.col.parameter(source, "col");
+            source.template parameter< global_ptr<const val_t> >("val")
+                    .template parameter< global_ptr<const val_t> >("in")
+                    .template parameter< global_ptr<val_t> >("out")
+                .close(")")
+                .open("{")
+                    .grid_stride_loop("p").open("{");
+
+            slice_loop(source, part.col.type(), "col[j]");
+            source.new_line() << "out[row[p]] " << OP::string() << " scale * sum;";
+            source.close("}").close("}");
+
+            kernel = cache[part.col.kind].insert(queue, backend::kernel(
+                        queue, source.str(), "sell_spmv"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+        kernel->second.push_arg(C);
+        kernel->second.push_arg(part.ptr);
+        kernel->second.push_arg(part.row);
+        part.col.push(kernel->second);
+        kernel->second.push_arg(part.val);
+        kernel->second.push_arg(in);
+        kernel->second.push_arg(out);
+
+        kernel->second(queue);
+    }
+
+    template <class OP>
+    void mul(
+            const matrix_part &part,
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache_map<size_t> caches[column_index::kinds];
+
+        const size_t N = in.size();
+        kernel_cache &cache = caches[part.col.kind][N];
+
+        auto kernel = cache.find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("sell_spmm")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter<size_t>("C")
+                    .template parameter< global_ptr<const idx_t> >("ptr")
+                    .template parameter< global_ptr<const idx_t> >("row");
+            part.col.parameter(source, "col");
+            source.template parameter< global_ptr<const val_t> >("val");
+            for(size_t k = 0; k < N; ++k)
+                source.template parameter< global_ptr<const val_t> >("in") << k;
+            for(size_t k = 0; k < N; ++k)
+                source.template parameter< global_ptr<val_t> >("out") << k;
+            source.close(")")
+                .open("{")
+                    .grid_stride_loop("p").open("{");
+
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << type_name<val_t>() << " sum" << k << " = 0;";
+            source.new_line() << "for(size_t j = ptr[p / C] + p % C, e = ptr[p / C + 1]; j < e; j += C)";
+            source.open("{");
+            source.new_line() << part.col.type() << " c = col[j];";
+            source.new_line() << "if (c != ("<< part.col.type() << ")(-1))";
+            source.open("{");
+            source.new_line() << type_name<val_t>() << " v = val[j];";
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "sum" << k << " += v * in" << k << "[c];";
+            source.close("}").close("}");
+            source.new_line() << "size_t i = row[p];";
+            for(size_t k = 0; k < N; ++k)
+                source.new_line() << "out" << k << "[i] " << OP::string() << " scale * sum" << k << ";";
+            source.close("}").close("}");
+
+            kernel = cache.insert(queue, backend::kernel(
+                        queue, source.str(), "sell_spmm"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+        kernel->second.push_arg(C);
+        kernel->second.push_arg(part.ptr);
+        kernel->second.push_arg(part.row);
+        part.col.push(kernel->second);
+        kernel->second.push_arg(part.val);
+        for(size_t k = 0; k < N; ++k) kernel->second.push_arg(in[k]);
+        for(size_t k = 0; k < N; ++k) kernel->second.push_arg(out[k]);
+
+        kernel->second(queue);
+    }
+
+    void mul_local(
+            const backend::device_vector<val_t> &in,
+            backend::device_vector<val_t> &out,
+            scalar_type scale, bool append) const
+    {
+        if (append) {
+            if (loc.nnz) mul<assign::ADD>(loc, in, out, scale);
+        } else {
+            if (loc.nnz)
+                mul<assign::SET>(loc, in, out, scale);
+            else
+                vector<val_t>(queue, out) = 0;
+        }
+    }
+
+    void mul_remote(
+            const backend::device_vector<val_t> &in,
+            backend::device_vector<val_t> &out,
+            scalar_type scale) const
+    {
+        if (rem.nnz) mul<assign::ADD>(rem, in, out, scale);
+    }
+
+    void spmm_local(
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale, bool append) const
+    {
+        if (append) {
+            if (loc.nnz) mul<assign::ADD>(loc, in, out, scale);
+        } else {
+            if (loc.nnz)
+                mul<assign::SET>(loc, in, out, scale);
+            else
+                for(size_t k = 0; k < out.size(); ++k)
+                    vector<val_t>(queue, out[k]) = 0;
+        }
+    }
+
+    void spmm_remote(
+            const std::vector< backend::device_vector<val_t> > &in,
+            std::vector< backend::device_vector<val_t> > &out,
+            scalar_type scale) const
+    {
+        if (rem.nnz) mul<assign::ADD>(rem, in, out, scale);
+    }
+
+    size_t column_bytes() const {
+        return loc.col.bytes() + rem.col.bytes();
+    }
+
+    void triplets(bool remote, col_t sentinel,
+            vector<col_t> &t_row, vector<col_t> &t_col, vector<val_t> &t_val) const
+    {
+        using namespace detail;
+
+        const matrix_part &part = remote ? rem : loc;
+
+        std::vector<backend::command_queue> q(1, queue);
+        t_row.resize(q, part.nnz);
+        t_col.resize(q, part.nnz);
+        t_val.resize(q, part.nnz);
+
+        if (!part.nnz) return;
+
+        // Padding is never written by the kernel below.
+        t_col = sentinel;
+
+        static kernel_cache cache[column_index::kinds];
+
+        auto kernel = cache[part.col.kind].find(queue);
+
+        backend::select_context(queue);
+
+        if (kernel == cache[part.col.kind].end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("sell_triplets")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<size_t>("C")
+                    .template parameter< global_ptr<const idx_t> >("ptr")
+                    .template parameter< global_ptr<const idx_t> >("row");
+            part.col.parameter(source, "col");
+            source.template parameter< global_ptr<const val_t> >("val")
+                    .template parameter< global_ptr<col_t> >("t_row")
+                    .template parameter< global_ptr<col_t> >("t_col")
+                    .template parameter< global_ptr<val_t> >("t_val")
+                .close(")")
+                .open("{")
+                    .grid_stride_loop("p").open("{");
+            source.new_line() << type_name<idx_t>() << " r = row[p];";
+            source.new_line() << "for(size_t j = ptr[p / C] + p % C, e = ptr[p / C + 1]; j < e; j += C)";
+            source.open("{");
+            source.new_line() << part.col.type() << " c = col[j];";
+            source.new_line() << "if (c != ("<< part.col.type() << ")(-1))";
+            source.open("{");
+            source.new_line() << "t_row[j] = r;";
+            source.new_line() << "t_col[j] = c;";
+            source.new_line() << "t_val[j] = val[j];";
+            source.close("}");
+            source.close("}");
+            source.close("}").close("}");
+
+            kernel = cache[part.col.kind].insert(queue, backend::kernel(
+                        queue, source.str(), "sell_triplets"));
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(C);
+        kernel->second.push_arg(part.ptr);
+        kernel->second.push_arg(part.row);
+        part.col.push(kernel->second);
+        kernel->second.push_arg(part.val);
+        kernel->second.push_arg(t_row(0));
+        kernel->second.push_arg(t_col(0));
+        kernel->second.push_arg(t_val(0));
+
+        kernel->second(queue);
+    }
+
+    static void inline_preamble(backend::source_generator &src,
+        const std::string &prm_name)
+    {
+        column_index::inline_reader(src, prm_name + "_sell_col_at");
+
+        src.function<val_t>(prm_name + "_sell_spmv")
+            .open("(")
+                .template parameter<size_t>("C")
+                .template parameter< global_ptr<const idx_t> >("ptr")
+                .template parameter< global_ptr<const idx_t> >("pos")
+                .template parameter< global_ptr<const col_t> >("col")
+                .template parameter< int >("col_kind")
+                .template parameter< global_ptr<const val_t> >("val")
+                .template parameter< global_ptr<const val_t> >("in")
+                .template parameter< size_t >("i")
+            .close(")").open("{");
+        src.new_line() << "size_t p = pos[i];";
+        slice_loop(src, type_name<col_t>(), prm_name + "_sell_col_at(col, col_kind, j)");
+        src.new_line() << "return sum;";
+        src.close("}");
+    }
+
+    static void inline_expression(backend::source_generator &src,
+            const std::string &prm_name)
+    {
+        src << prm_name << "_sell_spmv" << "("
+            << prm_name << "_sell_c, "
+            << prm_name << "_sell_ptr, "
+            << prm_name << "_sell_pos, "
+            << prm_name << "_sell_col, "
+            << prm_name << "_sell_col_kind, "
+            << prm_name << "_sell_val, "
+            << prm_name << "_vec, idx)";
+    }
+
+    static void inline_parameters(backend::source_generator &src,
+            const std::string &prm_name)
+    {
+        src.template parameter<size_t>(prm_name) << "_sell_c";
+        src.template parameter< global_ptr<const idx_t> >(prm_name) << "_sell_ptr";
+        src.template parameter< global_ptr<const idx_t> >(prm_name) << "_sell_pos";
+        src.template parameter< global_ptr<const col_t> >(prm_name) << "_sell_col";
+        src.template parameter< int >(prm_name) << "_sell_col_kind";
+        src.template parameter< global_ptr<const val_t> >(prm_name) << "_sell_val";
+        src.template parameter< global_ptr<const val_t> >(prm_name) << "_vec";
+    }
+
+    void setArgs(backend::kernel &krn, unsigned device, const vector<val_t> &x) const {
+        krn.push_arg(C);
+        krn.push_arg(loc.ptr);
+        krn.push_arg(loc.pos);
+        if (loc.nnz) {
+            loc.col.push(krn);
+            krn.push_arg(static_cast<int>(loc.col.kind));
+            krn.push_arg(loc.val);
+        } else {
+            krn.push_arg(static_cast<size_t>(0));
+            krn.push_arg(static_cast<int>(loc.col.kind));
+            krn.push_arg(static_cast<size_t>(0));
+        }
+        krn.push_arg(x(device));
+    }
+};
+
+#endif
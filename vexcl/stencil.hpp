@@ -83,7 +83,7 @@ stencil_base<T>::stencil_base(
         dbuf[d] = backend::device_vector<T>(queue[d], width);
     }
 
-    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+    for(unsigned d = 0; d < queue.size(); d++) backend::finish(queue[d]);
 }
 
 template <typename T>
@@ -114,7 +114,7 @@ void stencil_base<T>::exchange_halos(const vex::vector<T> &x) const {
     }
 
     // Wait for the end of transfer.
-    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+    for(unsigned d = 0; d < queue.size(); d++) backend::finish(queue[d]);
 
     // Write halos to a local buffer.
     for(unsigned d = 0; d < queue.size(); d++) {
@@ -146,7 +146,7 @@ void stencil_base<T>::exchange_halos(const vex::vector<T> &x) const {
     }
 
     // Wait for the end of transfer.
-    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+    for(unsigned d = 0; d < queue.size(); d++) backend::finish(queue[d]);
 }
 
 /// \endcond
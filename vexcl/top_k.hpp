@@ -0,0 +1,302 @@
+#ifndef VEXCL_TOP_K_HPP
+#define VEXCL_TOP_K_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/top_k.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Top-k selection and nth_element with radix select.
+ *
+ * Keys are mapped to unsigned integers that preserve the order of the
+ * original values. The k-th largest key is then found digit by digit, most
+ * significant digit first: each pass builds a histogram of the current digit
+ * over the keys that match the already selected prefix. The selected elements
+ * are gathered with stream compaction, and only these are sorted.
+ */
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/util.hpp>
+#include <vexcl/operations.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/function.hpp>
+#include <vexcl/histogram.hpp>
+#include <vexcl/compaction.hpp>
+#include <vexcl/sort.hpp>
+
+namespace vex {
+namespace detail {
+namespace topk {
+
+//---------------------------------------------------------------------------
+// Order-preserving mapping of values to unsigned keys.
+//---------------------------------------------------------------------------
+template <typename T, class Enable = void>
+struct radix_key {};
+
+template <typename T>
+struct radix_key<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    typedef typename std::conditional<
+        sizeof(T) <= sizeof(cl_uint), cl_uint, cl_ulong>::type key_type;
+
+    static const key_type sign = std::is_signed<T>::value ?
+        key_type(1) << (8 * sizeof(key_type) - 1) : 0;
+
+    static std::string body() {
+        std::ostringstream s;
+        s << "return (" << type_name<key_type>() << ")("
+          << (sizeof(key_type) == sizeof(T) ? type_name<T>() :
+                  (std::is_signed<T>::value ? "int" : "uint"))
+          << ")x";
+        if (sign) s << " ^ ((" << type_name<key_type>() << ")1 << "
+                    << 8 * sizeof(key_type) - 1 << ")";
+        s << ";";
+        return s.str();
+    }
+
+    static T decode(key_type k) {
+        return static_cast<T>(k ^ sign);
+    }
+};
+
+template <typename T>
+struct radix_key<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    typedef typename std::conditional<
+        sizeof(T) == sizeof(cl_uint), cl_uint, cl_ulong>::type key_type;
+
+    static const key_type sign = key_type(1) << (8 * sizeof(key_type) - 1);
+
+    static std::string body() {
+        const bool dbl = sizeof(T) == sizeof(cl_ulong);
+
+        std::ostringstream s;
+        s << type_name<key_type>() << " u = "
+#if defined(VEXCL_BACKEND_CUDA)
+          << (dbl ? "(ulong)__double_as_longlong(x);" : "__float_as_uint(x);")
+#else
+          << (dbl ? "as_ulong(x);" : "as_uint(x);")
+#endif
+          << "\n    " << type_name<key_type>() << " sign = ("
+          << type_name<key_type>() << ")1 << " << 8 * sizeof(key_type) - 1 << ";"
+          << "\n    return (u & sign) ? ~u : (u | sign);";
+        return s.str();
+    }
+
+    static T decode(key_type k) {
+        key_type u = (k & sign) ? (k ^ sign) : ~k;
+        T x;
+        std::memcpy(&x, &u, sizeof(T));
+        return x;
+    }
+};
+
+//---------------------------------------------------------------------------
+// Result of the radix select.
+//---------------------------------------------------------------------------
+template <typename key_type>
+struct selection {
+    // Keys that are greater than thr (or greater or equal, when inclusive
+    // is true) are selected.
+    key_type thr;
+    bool     inclusive;
+
+    // Number of selected keys.
+    size_t   above;
+
+    // Number of keys equal to thr.
+    size_t   ties;
+};
+
+//---------------------------------------------------------------------------
+// Finds the k-th largest key. When full is false, the search stops as soon
+// as the set of the k largest keys is known, even if the k-th key itself is
+// not.
+//---------------------------------------------------------------------------
+template <typename T, class KeyFunc>
+selection<typename radix_key<T>::key_type>
+radix_select(const vector<T> &x, size_t k, const KeyFunc &key, bool full)
+{
+    typedef typename radix_key<T>::key_type key_type;
+
+    const int bits  = 8;
+    const int width = 8 * sizeof(key_type);
+    const key_type radix = 1 << bits;
+
+    selection<key_type> s = {0, true, 0, 0};
+
+    key_type prefix = 0;
+    key_type himask = 0;
+
+    for(int shift = width - bits; shift >= 0; shift -= bits) {
+        std::vector<size_t> hist = bincount(
+                if_else((key(x) & himask) == prefix,
+                    (key(x) >> static_cast<key_type>(shift)) & (radix - 1),
+                    radix),
+                radix);
+
+        key_type digit = radix - 1;
+        for(; digit > 0; --digit) {
+            if (s.above + hist[digit] >= k) break;
+            s.above += hist[digit];
+        }
+
+        prefix |= digit << shift;
+        himask |= (radix - 1) << shift;
+
+        if (shift == 0 || (!full && s.above + hist[digit] == k)) {
+            // Keys in the selected bucket are all taken, or are equal to
+            // the k-th key.
+            s.thr       = prefix;
+            s.inclusive = (s.above + hist[digit] == k);
+            s.ties      = hist[digit];
+            if (s.inclusive) s.above = k;
+            break;
+        }
+    }
+
+    return s;
+}
+
+//---------------------------------------------------------------------------
+template <typename T>
+struct key_function {
+    typedef typename radix_key<T>::key_type key_type;
+
+    VEX_FUNCTION_S(key_type, device, (T, x), radix_key<T>::body());
+};
+
+} // namespace topk
+} // namespace detail
+
+/// Returns k largest elements of the vector sorted in descending order.
+/**
+ * The elements are selected with radix select, so that only the selected
+ * elements are sorted. The result is allocated on the queues of the input
+ * vector.
+ */
+template <typename T>
+vector<T> top_k(const vector<T> &keys, size_t k) {
+    using namespace detail::topk;
+    typedef typename radix_key<T>::key_type key_type;
+
+    precondition(k <= keys.size(), "top_k: k is larger than the vector size");
+
+    vector<T> out(keys.queue_list(), k);
+    if (!k) return out;
+
+    key_function<T> f;
+    selection<key_type> s = radix_select(keys, k, f.device, false);
+
+    size_t n = s.inclusive ?
+        copy_if(keys, f.device(keys) >= s.thr, out) :
+        copy_if(keys, f.device(keys) >  s.thr, out);
+
+    // The rest are copies of the k-th largest key.
+    if (n < k) {
+        std::vector<T> tail(k - n, radix_key<T>::decode(s.thr));
+        out.write_data(n, tail.size(), tail.data(), true);
+    }
+
+    sort(out, greater<T>());
+
+    return out;
+}
+
+/// Returns k largest keys with the corresponding values.
+/**
+ * The result is sorted by key in descending order.
+ */
+template <typename K, typename V>
+std::pair< vector<K>, vector<V> >
+top_k_by_key(const vector<K> &keys, const vector<V> &vals, size_t k) {
+    using namespace detail::topk;
+    typedef typename radix_key<K>::key_type key_type;
+
+    precondition(k <= keys.size(), "top_k: k is larger than the vector size");
+    precondition(keys.size() == vals.size(), "top_k: keys and values have different sizes");
+
+    std::pair< vector<K>, vector<V> > out(
+            vector<K>(keys.queue_list(), k), vector<V>(keys.queue_list(), k));
+    if (!k) return out;
+
+    key_function<K> f;
+    selection<key_type> s = radix_select(keys, k, f.device, false);
+
+    size_t n;
+    if (s.inclusive) {
+        n = copy_if(keys, f.device(keys) >= s.thr, out.first);
+            copy_if(vals, f.device(keys) >= s.thr, out.second);
+    } else {
+        n = copy_if(keys, f.device(keys) >  s.thr, out.first);
+            copy_if(vals, f.device(keys) >  s.thr, out.second);
+    }
+
+    if (n < k) {
+        // Take values of the first few elements equal to the k-th key.
+        vector<V> ties(keys.queue_list(), s.ties);
+        copy_if(vals, f.device(keys) == s.thr, ties);
+
+        std::vector<K> tail_keys(k - n, radix_key<K>::decode(s.thr));
+        std::vector<V> tail_vals(k - n);
+
+        ties.read_data(0, k - n, tail_vals.data(), true);
+
+        out.first .write_data(n, k - n, tail_keys.data(), true);
+        out.second.write_data(n, k - n, tail_vals.data(), true);
+    }
+
+    sort_by_key(out.first, out.second, greater<K>());
+
+    return out;
+}
+
+/// Returns the element that would be at the given position in the sorted vector.
+/**
+ * The vector itself is not modified.
+ */
+template <typename T>
+T nth_element(const vector<T> &x, size_t nth) {
+    using namespace detail::topk;
+    typedef typename radix_key<T>::key_type key_type;
+
+    precondition(nth < x.size(), "nth_element: position is out of range");
+
+    key_function<T> f;
+    selection<key_type> s = radix_select(x, x.size() - nth, f.device, true);
+
+    return radix_key<T>::decode(s.thr);
+}
+
+} // namespace vex
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef VEXCL_TRACE_HPP
+#define VEXCL_TRACE_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2012-2015 Denis Demidov <dennis.demidov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/trace.hpp
+ * \author Denis Demidov <dennis.demidov@gmail.com>
+ * \brief  Timeline of device commands in Chrome trace format.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdexcept>
+
+#include <boost/thread.hpp>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/detail/trace.hpp>
+
+namespace vex {
+
+/// Timeline of device commands.
+/**
+ * When enabled, every kernel launch (with its name and source hash), every
+ * host/device transfer, program build, and wait for a queue to finish
+ * (including the waits made inside the library) is recorded. The timeline
+ * may be saved in Chrome trace format and inspected with chrome://tracing or
+ * Perfetto UI:
+ \code
+ vex::trace::start(ctx);
+ // ... the code to trace ...
+ vex::trace::stop();
+ vex::trace::save("vexcl.json");
+ \endcode
+ * Host timestamps are recorded for all commands. Commands enqueued to the
+ * queues that were passed to start() and that have profiling enabled (see
+ * vex::backend::profiling_queue) also get device timestamps, one timeline
+ * per queue. When tracing is disabled, the overhead is a single check of an
+ * atomic flag per command.
+ */
+namespace trace {
+
+/// \cond INTERNAL
+namespace detail {
+
+// Labels of the queues passed to start(), guarded by the mutex.
+struct queue_labels {
+    typedef std::map<const void*, std::string> map_type;
+
+    static map_type& get() {
+        static map_type labels;
+        return labels;
+    }
+
+    static boost::mutex& mx() {
+        static boost::mutex m;
+        return m;
+    }
+
+    static void set(const void *queue, const std::string &label) {
+        boost::lock_guard<boost::mutex> lock(mx());
+        get()[queue] = label;
+    }
+
+    static map_type copy() {
+        boost::lock_guard<boost::mutex> lock(mx());
+        return get();
+    }
+};
+
+inline std::string escape(const std::string &s) {
+    std::ostringstream out;
+    for(auto c = s.begin(); c != s.end(); ++c) {
+        switch (*c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20)
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                        << static_cast<int>(*c) << std::dec;
+                else
+                    out << *c;
+        }
+    }
+    return out.str();
+}
+
+} // namespace detail
+/// \endcond
+
+/// Starts recording the commands.
+/**
+ * \param queue Queues to get device timelines for. Each queue is finished
+ *              in order to relate device timestamps to the host clock.
+ */
+inline void start(const std::vector<backend::command_queue> &queue = std::vector<backend::command_queue>())
+{
+    for(auto q = queue.begin(); q != queue.end(); ++q) {
+        std::ostringstream label;
+        label << *q;
+
+        detail::queue_labels::set(backend::detail::queue_id(*q), label.str());
+        backend::detail::trace_start(*q);
+    }
+
+    vex::detail::trace::get_state().on = true;
+}
+
+/// Stops recording the commands.
+/**
+ * Waits for the traced commands that are still in flight in order to get
+ * their device timestamps.
+ */
+inline void stop() {
+    vex::detail::trace::state &s = vex::detail::trace::get_state();
+    s.on = false;
+
+    boost::lock_guard<boost::mutex> lock(s.mx);
+    vex::detail::trace::flush(s);
+}
+
+/// Checks if the commands are being recorded.
+inline bool enabled() {
+    return vex::detail::trace::enabled();
+}
+
+/// Discards recorded commands.
+inline void clear() {
+    vex::detail::trace::state &s = vex::detail::trace::get_state();
+    boost::lock_guard<boost::mutex> lock(s.mx);
+    s.in_flight.clear();
+    s.first += s.log.size();
+    s.log.clear();
+    s.dropped = 0;
+}
+
+/// Sets the maximum number of recorded commands.
+/**
+ * When the limit is reached, the oldest commands are discarded. The number
+ * of discarded commands is reported in the written trace. The default limit
+ * is 2^20 commands.
+ */
+inline void set_capacity(size_t n) {
+    vex::detail::trace::state &s = vex::detail::trace::get_state();
+    boost::lock_guard<boost::mutex> lock(s.mx);
+    s.capacity = n;
+    vex::detail::trace::trim(s);
+}
+
+/// Writes recorded commands to the stream in Chrome trace format.
+/**
+ * Host side of the commands is shown in the "Host" process, one timeline
+ * per thread. Device side is shown in the "Devices" process, one timeline
+ * per queue.
+ */
+inline void write(std::ostream &os) {
+    std::vector<vex::detail::trace::record> log;
+    size_t dropped;
+    {
+        vex::detail::trace::state &s = vex::detail::trace::get_state();
+        boost::lock_guard<boost::mutex> lock(s.mx);
+        vex::detail::trace::flush(s);
+        log.assign(s.log.begin(), s.log.end());
+        dropped = s.dropped;
+    }
+
+    const detail::queue_labels::map_type labels = detail::queue_labels::copy();
+
+    std::map<boost::thread::id, int> thread;
+    std::map<const void*, int> queue;
+
+    // Registered queues come first.
+    for(auto q = labels.begin(); q != labels.end(); ++q)
+        queue.insert(std::make_pair(q->first, static_cast<int>(queue.size())));
+
+    for(auto r = log.begin(); r != log.end(); ++r) {
+        thread.insert(std::make_pair(r->thread, static_cast<int>(thread.size())));
+        queue.insert(std::make_pair(r->queue, static_cast<int>(queue.size())));
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"traceEvents\":[\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Host\"}},\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Devices\"}}";
+
+    for(auto t = thread.begin(); t != thread.end(); ++t)
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t->second
+            << ",\"args\":{\"name\":\"thread " << t->second << "\"}}";
+
+    for(auto q = queue.begin(); q != queue.end(); ++q) {
+        auto l = labels.find(q->first);
+
+        std::ostringstream label;
+        if (l != labels.end()) label << l->second << " / ";
+        label << "queue " << q->second;
+
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << q->second
+            << ",\"args\":{\"name\":\"" << detail::escape(label.str()) << "\"}}";
+    }
+
+    for(auto r = log.begin(); r != log.end(); ++r) {
+        std::ostringstream args;
+        args << "{\"queue\":" << queue[r->queue];
+        if (r->bytes) args << ",\"bytes\":" << r->bytes;
+        if (r->hash)  args << ",\"source_hash\":\"" << std::hex << r->hash << std::dec << "\"";
+        args << "}";
+
+        const std::string name = detail::escape(r->name);
+
+        out << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << r->category
+            << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread[r->thread]
+            << ",\"ts\":" << r->begin << ",\"dur\":" << (r->end - r->begin)
+            << ",\"args\":" << args.str() << "}";
+
+        if (r->on_device)
+            out << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << r->category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << queue[r->queue]
+                << ",\"ts\":" << r->device_begin << ",\"dur\":" << (r->device_end - r->device_begin)
+                << ",\"args\":" << args.str() << "}";
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"";
+    if (dropped) out << ",\"otherData\":{\"dropped_records\":" << dropped << "}";
+    out << "}\n";
+
+    os << out.str();
+}
+
+/// Saves recorded commands to the file in Chrome trace format.
+inline void save(const std::string &fname) {
+    std::ofstream f(fname);
+    if (!f) throw std::runtime_error("Failed to open " + fname);
+    write(f);
+}
+
+} // namespace trace
+} // namespace vex
+
+#endif
@@ -39,6 +39,8 @@ THE SOFTWARE.
 #include <string>
 #include <type_traits>
 #include <functional>
+#include <algorithm>
+#include <limits>
 
 #include <boost/proto/proto.hpp>
 #include <boost/io/ios_state.hpp>
@@ -781,7 +783,7 @@ class vector : public vector_terminal_expression {
                     size_t start = std::max(offset,        part[d]);
                     size_t stop  = std::min(offset + size, part[d + 1]);
 
-                    if (start < stop) queue[d].finish();
+                    if (start < stop) backend::finish(queue[d]);
                 }
         }
 
@@ -804,7 +806,7 @@ class vector : public vector_terminal_expression {
                     size_t start = std::max(offset,        part[d]);
                     size_t stop  = std::min(offset + size, part[d + 1]);
 
-                    if (start < stop) queue[d].finish();
+                    if (start < stop) backend::finish(queue[d]);
                 }
         }
 
@@ -872,6 +874,9 @@ struct kernel_arg_setter< vector<T> > {
     }
 };
 
+template <typename T>
+struct terminal_bytes< vector<T> > : known_terminal_bytes<sizeof(T)> {};
+
 template <class T>
 struct expression_properties< vector<T> > {
     static void get(const vector<T> &term,
@@ -975,8 +980,16 @@ void swap(vector<T> &x, vector<T> &y) {
     x.swap(y);
 }
 
-/// Returns device weight after simple bandwidth test
-inline double device_vector_perf(const backend::command_queue &q) {
+/// Measures global memory bandwidth of the device in bytes per second.
+/**
+ * Times the following kernel:
+ \code
+ a = b + c;
+ \endcode
+ * where a, b and c are device vectors. The best of several runs is returned.
+ * The result may be used as the peak bandwidth for vex::profiler.
+ */
+inline double device_bandwidth(const backend::command_queue &q) {
     static const size_t test_size = 1024U * 1024U;
     std::vector<backend::command_queue> queue(1, q);
 
@@ -988,12 +1001,22 @@ inline double device_vector_perf(const backend::command_queue &q) {
 
     // Skip the first run.
     a = b + c;
+    backend::finish(queue[0]);
+
+    double time = std::numeric_limits<double>::max();
+    for(int i = 0; i < 3; ++i) {
+        stopwatch<> watch;
+        a = b + c;
+        backend::finish(queue[0]);
+        time = std::min(time, watch.toc());
+    }
 
-    // Measure the second run.
-    profiler<> prof(queue);
-    prof.tic_cl("");
-    a = b + c;
-    return 1.0 / prof.toc("");
+    return 3 * sizeof(float) * test_size / time;
+}
+
+/// Returns device weight after simple bandwidth test
+inline double device_vector_perf(const backend::command_queue &q) {
+    return device_bandwidth(q);
 }
 
 
@@ -41,9 +41,7 @@ THE SOFTWARE.
 #include <vexcl/vector.hpp>
 #include <vexcl/element_index.hpp>
 #include <vexcl/tagged_terminal.hpp>
-#if (VEXCL_CHECK_SIZES > 1)
-#  include <vexcl/reductor.hpp>
-#endif
+#include <vexcl/reductor.hpp>
 
 #include <boost/fusion/container/vector.hpp>
 #include <boost/fusion/container/vector/convert.hpp>
@@ -759,6 +757,85 @@ struct reduced_vector_view : public reduced_vector_view_terminal_expression
     }
 };
 
+namespace detail {
+
+// Accumulation of the reduced elements for a single element of the view.
+template <class RDC, typename T, class Enable = void>
+struct view_reduction {
+    typedef typename RDC::template impl<T>::device fun;
+
+    static void preamble(output_terminal_preamble &termpream) {
+        boost::proto::eval(boost::proto::as_child( fun() (T(), T()) ), termpream);
+    }
+
+    static void init(backend::source_generator &src, const std::string &prm_name) {
+        src.new_line() << type_name<T>() << " " << prm_name << "_sum = (" <<
+            type_name<T>() << ")" << RDC::template impl<T>::initial() << ";";
+    }
+
+    static void update_begin(backend::source_generator &src, const std::string &prm_name) {
+        src.new_line()
+            << prm_name << "_sum = " << fun::name() << "("
+            << prm_name << "_sum, ";
+    }
+
+    static void update_end(backend::source_generator &src, const std::string&) {
+        src << ");";
+    }
+
+    static void finish(backend::source_generator&, const std::string&) {}
+};
+
+// Compound reductions keep their accumulator fields in separate variables.
+template <class RDC, typename T>
+struct view_reduction<RDC, T,
+    typename std::enable_if<std::is_base_of<compound_reduction, RDC>::value>::type>
+{
+    typedef typename RDC::template impl<T> impl;
+    typedef typename impl::fields fields;
+    typedef compound_fields<fields> F;
+
+    static void preamble(output_terminal_preamble&) {}
+
+    static std::vector<std::string> acc(const std::string &prm_name) {
+        std::vector<std::string> a;
+        for(size_t k = 0; k < F::N; ++k) {
+            std::ostringstream s;
+            s << prm_name << "_acc_" << k;
+            a.push_back(s.str());
+        }
+        return a;
+    }
+
+    static void init(backend::source_generator &src, const std::string &prm_name) {
+        std::vector<std::string> types, shared_types, init;
+        std::vector<size_t> sizes;
+        static_for<0, F::N>::loop(
+                typename F::info(types, shared_types, init, sizes, impl::initial()));
+
+        std::vector<std::string> a = acc(prm_name);
+        for(size_t k = 0; k < F::N; ++k)
+            src.new_line() << types[k] << " " << a[k] << " = " << init[k] << ";";
+    }
+
+    static void update_begin(backend::source_generator &src, const std::string &prm_name) {
+        src.new_line() << type_name<T>() << " " << prm_name << "_val = ";
+    }
+
+    static void update_end(backend::source_generator &src, const std::string &prm_name) {
+        src << ";";
+        impl::element(src, acc(prm_name), prm_name + "_val", "idx");
+    }
+
+    static void finish(backend::source_generator &src, const std::string &prm_name) {
+        src.new_line() << type_name<T>() << " " << prm_name << "_sum = ";
+        impl::device_result(src, acc(prm_name));
+        src << ";";
+    }
+};
+
+} // namespace detail
+
 namespace traits {
 
 template <>
@@ -782,9 +859,7 @@ struct terminal_preamble< reduced_vector_view<Expr, NDIM, NR, RDC> > {
         boost::proto::eval(boost::proto::as_child(term.expr), termpream);
 
         typedef typename detail::return_type<Expr>::type T;
-        typedef typename RDC::template impl<T>::device fun;
-
-        boost::proto::eval(boost::proto::as_child( fun() (T(), T()) ), termpream);
+        detail::view_reduction<RDC, T>::preamble(termpream);
     }
 };
 
@@ -796,10 +871,9 @@ struct local_terminal_init< reduced_vector_view<Expr, NDIM, NR, RDC> > {
             detail::kernel_generator_state_ptr state)
     {
         typedef typename detail::return_type<Expr>::type T;
-        typedef typename RDC::template impl<T>::device fun;
+        typedef detail::view_reduction<RDC, T> reduction;
 
-        src.new_line() << type_name<T>() << " " << prm_name << "_sum = (" <<
-            type_name<T>() << ")" << RDC::template impl<T>::initial() << ";";
+        reduction::init(src, prm_name);
         src.open("{");
 
         src.new_line()
@@ -836,17 +910,17 @@ struct local_terminal_init< reduced_vector_view<Expr, NDIM, NR, RDC> > {
         detail::output_local_preamble init_ctx(src, queue, prm_name, state);
         boost::proto::eval(boost::proto::as_child(term.expr), init_ctx);
 
-        src.new_line()
-            << prm_name << "_sum = " << fun::name() << "("
-            << prm_name << "_sum, ";
+        reduction::update_begin(src, prm_name);
 
         detail::vector_expr_context expr_ctx(src, queue, prm_name, state);
         boost::proto::eval(boost::proto::as_child(term.expr), expr_ctx);
 
-        src << ");";
+        reduction::update_end(src, prm_name);
 
         for(size_t k = NDIM - NR; k < NDIM; ++k) src.close("}");
         src.close("}");
+
+        reduction::finish(src, prm_name);
     }
 };
 
@@ -45,7 +45,9 @@ THE SOFTWARE.
 #include <vexcl/cast.hpp>
 #include <vexcl/multivector.hpp>
 #include <vexcl/reductor.hpp>
+#include <vexcl/device_scalar.hpp>
 #include <vexcl/spmat.hpp>
+#include <vexcl/reorder.hpp>
 #include <vexcl/stencil.hpp>
 #include <vexcl/gather.hpp>
 #include <vexcl/random.hpp>
@@ -57,7 +59,14 @@ THE SOFTWARE.
 #include <vexcl/scan.hpp>
 #include <vexcl/scan_by_key.hpp>
 #include <vexcl/reduce_by_key.hpp>
+#include <vexcl/compaction.hpp>
+#include <vexcl/histogram.hpp>
+#include <vexcl/top_k.hpp>
+#include <vexcl/binary_search.hpp>
+#include <vexcl/merge.hpp>
 #include <vexcl/profiler.hpp>
+#include <vexcl/trace.hpp>
+#include <vexcl/metrics.hpp>
 #include <vexcl/function.hpp>
 #include <vexcl/logical.hpp>
 